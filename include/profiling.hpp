@@ -0,0 +1,22 @@
+#pragma once
+
+// Tracy
+#if defined(__clang__) || defined(__GNUC__)
+#    define TracyFunction __PRETTY_FUNCTION__
+#elif defined(_MSC_VER)
+#    define TracyFunction __FUNCSIG__
+#endif
+
+// Libraries only link Tracy::TracyClient when TRACY_ENABLE is set, so the
+// header may not be reachable otherwise. Provide the no-op macros ourselves.
+#if defined(TRACY_ENABLE)
+#    include <tracy/Tracy.hpp>
+#else
+#    define ZoneScoped
+#    define ZoneScopedN(name)
+#    define ZoneName(text, size)
+#    define FrameMark
+#    define TracyPlot(name, value)
+#    define TracyPlotConfig(name, type, step, fill, color)
+#    define TracyMessage(text, size)
+#endif
@@ -0,0 +1,181 @@
+#include "Lz4.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace Assets {
+
+namespace {
+
+constexpr size_t MIN_MATCH     = 4;
+constexpr size_t LAST_LITERALS = 5;   // the block always ends with literals
+constexpr size_t MATCH_LIMIT   = 12;  // no match starts in the last 12 bytes
+constexpr size_t MAX_OFFSET    = 65535;
+constexpr int    HASH_BITS     = 16;
+
+uint32_t read32(const std::byte *source)
+{
+    uint32_t value;
+    std::memcpy(&value, source, sizeof(value));
+    return value;
+}
+
+uint32_t hash(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void writeLength(std::vector<std::byte> &output, size_t length)
+{
+    for (; length >= 255; length -= 255)
+    {
+        output.push_back(std::byte{255});
+    }
+    output.push_back(static_cast<std::byte>(length));
+}
+
+void writeSequence(std::vector<std::byte>    &output,
+                   std::span<const std::byte> literals,
+                   size_t                     offset,
+                   size_t                     matchLength)
+{
+    size_t  literalLength = literals.size();
+    uint8_t token         = static_cast<uint8_t>(std::min<size_t>(literalLength, 15) << 4);
+    if (matchLength != 0)
+    {
+        token |= static_cast<uint8_t>(std::min<size_t>(matchLength - MIN_MATCH, 15));
+    }
+    output.push_back(static_cast<std::byte>(token));
+    if (literalLength >= 15)
+    {
+        writeLength(output, literalLength - 15);
+    }
+    output.insert(output.end(), literals.begin(), literals.end());
+    if (matchLength == 0)
+    {
+        return;
+    }
+    output.push_back(static_cast<std::byte>(offset & 0xFF));
+    output.push_back(static_cast<std::byte>(offset >> 8));
+    if (matchLength - MIN_MATCH >= 15)
+    {
+        writeLength(output, matchLength - MIN_MATCH - 15);
+    }
+}
+
+size_t readLength(std::span<const std::byte> source, size_t &position)
+{
+    size_t  length = 0;
+    uint8_t value;
+    do
+    {
+        if (position == source.size())
+        {
+            throw std::runtime_error("truncated LZ4 block!");
+        }
+        value   = static_cast<uint8_t>(source[position++]);
+        length += value;
+    } while (value == 255);
+    return length;
+}
+
+}  // namespace
+
+PROJECT_API std::vector<std::byte> Lz4::compress(std::span<const std::byte> source)
+{
+    std::vector<std::byte> output;
+    output.reserve(getMaxCompressedSize(source.size()));
+
+    // Last position + 1 of each hashed sequence, 0 when empty.
+    std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0);
+    size_t                anchor = 0;
+    size_t                cursor = 0;
+    while (source.size() > MATCH_LIMIT && cursor + MATCH_LIMIT <= source.size())
+    {
+        uint32_t  sequence = read32(&source[cursor]);
+        uint32_t &entry    = table[hash(sequence)];
+        size_t    match    = entry;
+        entry              = static_cast<uint32_t>(cursor + 1);
+        if (match == 0 || cursor - (match - 1) > MAX_OFFSET || read32(&source[match - 1]) != sequence)
+        {
+            cursor++;
+            continue;
+        }
+        match--;
+
+        size_t length = MIN_MATCH;
+        while (cursor + length < source.size() - LAST_LITERALS && source[match + length] == source[cursor + length])
+        {
+            length++;
+        }
+        writeSequence(output, source.subspan(anchor, cursor - anchor), cursor - match, length);
+        cursor += length;
+        anchor  = cursor;
+    }
+    writeSequence(output, source.subspan(anchor), 0, 0);
+    return output;
+}
+
+PROJECT_API void Lz4::decompress(std::span<const std::byte> source, std::span<std::byte> destination)
+{
+    size_t input  = 0;
+    size_t output = 0;
+    while (input < source.size())
+    {
+        uint8_t token         = static_cast<uint8_t>(source[input++]);
+        size_t  literalLength = token >> 4;
+        if (literalLength == 15)
+        {
+            literalLength += readLength(source, input);
+        }
+        if (literalLength > source.size() - input || literalLength > destination.size() - output)
+        {
+            throw std::runtime_error("corrupted LZ4 block!");
+        }
+        if (literalLength != 0)
+        {
+            // An empty destination may have no data pointer at all.
+            std::memcpy(destination.data() + output, source.data() + input, literalLength);
+        }
+        input  += literalLength;
+        output += literalLength;
+        if (input == source.size())
+        {
+            break;
+        }
+
+        if (source.size() - input < 2)
+        {
+            throw std::runtime_error("truncated LZ4 block!");
+        }
+        size_t offset = static_cast<size_t>(source[input]) | static_cast<size_t>(source[input + 1]) << 8;
+        size_t length = (token & 15) + MIN_MATCH;
+        input += 2;
+        if ((token & 15) == 15)
+        {
+            length += readLength(source, input);
+        }
+        if (offset == 0 || offset > output || length > destination.size() - output)
+        {
+            throw std::runtime_error("corrupted LZ4 block!");
+        }
+        // Byte by byte: the match may overlap what it writes.
+        for (size_t i = 0; i < length; i++, output++)
+        {
+            destination[output] = destination[output - offset];
+        }
+    }
+    if (output != destination.size())
+    {
+        throw std::runtime_error("LZ4 block size mismatch!");
+    }
+}
+
+PROJECT_API size_t Lz4::getMaxCompressedSize(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+}  // namespace Assets
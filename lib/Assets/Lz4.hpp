@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "config.hpp"
+
+namespace Assets {
+
+/**
+ * @class Lz4
+ * @brief LZ4 block format, compatible with LZ4_decompress_safe().
+ *
+ * Greedy single probe compressor: about the ratio of the reference "fast"
+ * mode, good enough for cooked data compressed once at build time. The
+ * decompressor checks every length and offset, a corrupted block throws
+ * instead of writing out of bounds.
+ */
+class PROJECT_API Lz4
+{
+    // Methods
+   public:
+    static std::vector<std::byte> compress(std::span<const std::byte> source);
+
+    /**
+     * @brief Decompress a block whose decompressed size is known, it must
+     * fill destination exactly.
+     */
+    static void decompress(std::span<const std::byte> source, std::span<std::byte> destination);
+
+    static size_t getMaxCompressedSize(size_t size);
+};
+
+}  // namespace Assets
@@ -0,0 +1,458 @@
+#include "Pack.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(PACK_ZSTD)
+#    include <zstd.h>
+#endif
+
+#include "Lz4.hpp"
+#include "profiling.hpp"
+
+namespace Assets {
+
+namespace {
+
+constexpr std::array<char, 4> MAGIC   = {'A', 'P', 'A', 'K'};
+constexpr uint32_t            VERSION = 1;
+
+#if defined(PACK_ZSTD)
+// Packs are built once and read many times, favour the ratio.
+constexpr int ZSTD_LEVEL = 19;
+#endif
+
+struct Header
+{
+    std::array<char, 4> magic;
+    uint32_t            version;
+    uint32_t            entryCount;
+    uint32_t            chunkCount;
+    uint32_t            chunkSize;
+    uint32_t            padding;
+    uint64_t            entriesOffset;
+    uint64_t            chunksOffset;
+    uint64_t            namesOffset;
+    uint64_t            namesSize;
+};
+static_assert(sizeof(Header) == 56);
+static_assert(sizeof(Pack::Entry) == 32);
+static_assert(sizeof(Pack::Chunk) == 16);
+
+constexpr uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+template <typename T>
+std::span<const T> viewTable(const Utils::Handlers::MappedFile &file, uint64_t offset, uint32_t count)
+{
+    if (offset % alignof(T) != 0 || offset + uint64_t(count) * sizeof(T) > file.getSize())
+    {
+        throw std::runtime_error("invalid asset pack table!");
+    }
+    return std::span<const T>(reinterpret_cast<const T *>(file.getData() + offset), count);
+}
+
+/**
+ * @brief Entry being written, its chunks either view the mapped source or
+ * own their compressed bytes.
+ */
+struct StagedEntry
+{
+    std::string                             name;
+    uint64_t                                nameHash = 0;
+    uint64_t                                size     = 0;
+    Utils::Handlers::MappedFile             source;
+    std::vector<Compression>                compressions;
+    std::vector<std::span<const std::byte>> payloads;
+    std::vector<std::vector<std::byte>>     compressed;  // reserved up front, payloads view it
+};
+
+std::vector<std::byte> compressChunk(std::span<const std::byte> chunk, Compression compression)
+{
+    switch (compression)
+    {
+        case Compression::eLz4:
+            return Lz4::compress(chunk);
+#if defined(PACK_ZSTD)
+        case Compression::eZstd:
+        {
+            std::vector<std::byte> output(ZSTD_compressBound(chunk.size()));
+            size_t size = ZSTD_compress(output.data(), output.size(), chunk.data(), chunk.size(), ZSTD_LEVEL);
+            if (ZSTD_isError(size))
+            {
+                throw std::runtime_error(std::string("zstd compression failed: ") + ZSTD_getErrorName(size));
+            }
+            output.resize(size);
+            return output;
+        }
+#endif
+        default:
+            throw std::runtime_error("unsupported asset compression!");
+    }
+}
+
+}  // namespace
+
+PROJECT_API Pack::Pack(const std::string &filename) : file(filename, false)
+{
+    if (file.getSize() < sizeof(Header))
+    {
+        throw std::runtime_error("not an asset pack: " + filename);
+    }
+    Header header;
+    std::memcpy(&header, file.getData(), sizeof(Header));
+    if (header.magic != MAGIC)
+    {
+        throw std::runtime_error("not an asset pack: " + filename);
+    }
+    if (header.version != VERSION)
+    {
+        throw std::runtime_error("outdated asset pack, build it again: " + filename);
+    }
+    if (header.namesOffset > file.getSize() || header.namesSize > file.getSize() - header.namesOffset)
+    {
+        throw std::runtime_error("truncated asset pack: " + filename);
+    }
+    if (header.chunkSize == 0)
+    {
+        throw std::runtime_error("corrupted asset pack: " + filename);
+    }
+
+    chunkSize = header.chunkSize;
+    entries   = viewTable<Entry>(file, header.entriesOffset, header.entryCount);
+    chunks    = viewTable<Chunk>(file, header.chunksOffset, header.chunkCount);
+    names     = std::string_view(reinterpret_cast<const char *>(file.getData() + header.namesOffset), header.namesSize);
+    for (const Entry &entry : entries)
+    {
+        if (uint64_t(entry.firstChunk) + entry.chunkCount > chunks.size() ||
+            uint64_t(entry.nameOffset) + entry.nameLength > names.size())
+        {
+            throw std::runtime_error("corrupted asset pack: " + filename);
+        }
+        // Stored entries are one chunk of their whole size, the others are
+        // cut in chunkSize pieces.
+        bool stored = entry.chunkCount == 1 && chunks[entry.firstChunk].compression == Compression::eNone &&
+                      chunks[entry.firstChunk].storedSize == entry.size;
+        if (not stored && entry.chunkCount != entry.size / chunkSize + (entry.size % chunkSize != 0))
+        {
+            throw std::runtime_error("corrupted asset pack: " + filename);
+        }
+    }
+    for (const Chunk &chunk : chunks)
+    {
+        if (chunk.offset > file.getSize() || chunk.storedSize > file.getSize() - chunk.offset)
+        {
+            throw std::runtime_error("truncated asset pack: " + filename);
+        }
+    }
+}
+
+PROJECT_API std::optional<uint32_t> Pack::find(std::string_view name) const
+{
+    uint64_t hash = hashName(name);
+    auto     it   = std::lower_bound(entries.begin(), entries.end(), hash, [](const Entry &entry, uint64_t value) {
+        return entry.nameHash < value;
+    });
+    for (; it != entries.end() && it->nameHash == hash; ++it)
+    {
+        if (getName(*it) == name)
+        {
+            return static_cast<uint32_t>(it - entries.begin());
+        }
+    }
+    return std::nullopt;
+}
+
+PROJECT_API bool Pack::contains(std::string_view name) const
+{
+    return find(name).has_value();
+}
+
+PROJECT_API uint64_t Pack::getSize(std::string_view name) const
+{
+    return lookup(name).size;
+}
+
+PROJECT_API std::span<const std::byte> Pack::view(std::string_view name) const
+{
+    const Entry &entry = lookup(name);
+    if (entry.chunkCount == 0)
+    {
+        return {};
+    }
+    const Chunk &chunk = chunks[entry.firstChunk];
+    if (entry.chunkCount != 1 || chunk.compression != Compression::eNone)
+    {
+        throw std::runtime_error("asset is compressed, it can't be viewed: " + std::string(name));
+    }
+    return file.getBytes().subspan(chunk.offset, entry.size);
+}
+
+PROJECT_API std::span<const std::byte> Pack::get(std::string_view name, std::vector<std::byte> &storage) const
+{
+    const Entry &entry = lookup(name);
+    if (entry.chunkCount == 1 && chunks[entry.firstChunk].compression == Compression::eNone)
+    {
+        return file.getBytes().subspan(chunks[entry.firstChunk].offset, entry.size);
+    }
+    storage.resize(entry.size);
+    read(name, storage);
+    return storage;
+}
+
+PROJECT_API void Pack::read(std::string_view name, std::span<std::byte> destination) const
+{
+    ZoneScoped;
+    const Entry &entry = lookup(name);
+    if (destination.size() != entry.size)
+    {
+        throw std::runtime_error("asset read size mismatch: " + std::string(name));
+    }
+    for (uint32_t chunk = 0; chunk < entry.chunkCount; chunk++)
+    {
+        readChunk(entry, chunk, destination);
+    }
+}
+
+PROJECT_API void Pack::readChunk(const Entry &entry, uint32_t chunk, std::span<std::byte> destination) const
+{
+    if (chunk >= entry.chunkCount || destination.size() != entry.size)
+    {
+        throw std::runtime_error("invalid asset chunk read!");
+    }
+    const Chunk &stored = chunks[entry.firstChunk + chunk];
+    uint64_t     offset = uint64_t(chunk) * chunkSize;
+    uint64_t     size   = chunk + 1 == entry.chunkCount ? entry.size - offset : chunkSize;
+
+    std::span<const std::byte> source = file.getBytes().subspan(stored.offset, stored.storedSize);
+    std::span<std::byte>       target = destination.subspan(offset, size);
+    switch (stored.compression)
+    {
+        case Compression::eNone:
+            if (source.size() != target.size())
+            {
+                throw std::runtime_error("corrupted asset pack chunk!");
+            }
+            std::memcpy(target.data(), source.data(), target.size());
+            break;
+        case Compression::eLz4:
+            Lz4::decompress(source, target);
+            break;
+        case Compression::eZstd:
+#if defined(PACK_ZSTD)
+        {
+            size_t result = ZSTD_decompress(target.data(), target.size(), source.data(), source.size());
+            if (ZSTD_isError(result) || result != target.size())
+            {
+                throw std::runtime_error("corrupted zstd asset pack chunk!");
+            }
+            break;
+        }
+#else
+            throw std::runtime_error("zstd compressed asset, the engine was built without zstd!");
+#endif
+        default:
+            throw std::runtime_error("unknown asset compression!");
+    }
+}
+
+PROJECT_API void Pack::prefetch(std::string_view name) const
+{
+    const Entry &entry = lookup(name);
+    if (entry.chunkCount == 0)
+    {
+        return;
+    }
+    // The chunks of an entry are contiguous in the file.
+    const Chunk &first = chunks[entry.firstChunk];
+    const Chunk &last  = chunks[entry.firstChunk + entry.chunkCount - 1];
+    file.prefetch(first.offset, last.offset + last.storedSize - first.offset);
+}
+
+PROJECT_API const Pack::Entry &Pack::getEntry(uint32_t index) const
+{
+    return entries[index];
+}
+
+PROJECT_API uint32_t Pack::getEntryCount() const
+{
+    return static_cast<uint32_t>(entries.size());
+}
+
+PROJECT_API std::string_view Pack::getName(const Entry &entry) const
+{
+    return names.substr(entry.nameOffset, entry.nameLength);
+}
+
+PROJECT_API uint32_t Pack::getChunkSize() const
+{
+    return chunkSize;
+}
+
+PROJECT_API bool Pack::isSupported(Compression compression)
+{
+#if defined(PACK_ZSTD)
+    return compression <= Compression::eZstd;
+#else
+    return compression <= Compression::eLz4;
+#endif
+}
+
+PROJECT_API uint64_t Pack::hashName(std::string_view name)
+{
+    // FNV-1a
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (char c : name)
+    {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+PROJECT_API void Pack::write(const std::string &filename, std::span<const Source> sources, uint32_t chunkSize)
+{
+    ZoneScoped;
+    if (chunkSize == 0)
+    {
+        throw std::runtime_error("asset pack chunk size can't be 0!");
+    }
+
+    std::vector<StagedEntry> staged;
+    staged.reserve(sources.size());
+    for (const Source &source : sources)
+    {
+        if (not isSupported(source.compression))
+        {
+            throw std::runtime_error("unsupported compression for " + source.name);
+        }
+        StagedEntry &entry = staged.emplace_back();
+        entry.name         = source.name;
+        entry.nameHash     = hashName(source.name);
+        entry.source       = Utils::Handlers::MappedFile(source.path);
+        entry.size         = entry.source.getSize();
+
+        std::span<const std::byte> bytes = entry.source.getBytes();
+        if (source.compression == Compression::eNone)
+        {
+            // Stored entries stay one contiguous chunk so they can be viewed in place.
+            if (bytes.size() > UINT32_MAX)
+            {
+                throw std::runtime_error("stored asset over 4 GiB, compress it: " + source.name);
+            }
+            if (not bytes.empty())
+            {
+                entry.compressions.push_back(Compression::eNone);
+                entry.payloads.push_back(bytes);
+            }
+            continue;
+        }
+        entry.compressed.reserve((bytes.size() + chunkSize - 1) / chunkSize);
+        for (size_t offset = 0; offset < bytes.size(); offset += chunkSize)
+        {
+            size_t                     length = std::min<size_t>(chunkSize, bytes.size() - offset);
+            std::span<const std::byte> chunk  = bytes.subspan(offset, length);
+            std::vector<std::byte>     data   = compressChunk(chunk, source.compression);
+            if (data.size() < chunk.size())
+            {
+                entry.compressions.push_back(source.compression);
+                entry.payloads.push_back(entry.compressed.emplace_back(std::move(data)));
+            }
+            else
+            {
+                entry.compressions.push_back(Compression::eNone);
+                entry.payloads.push_back(chunk);
+            }
+        }
+    }
+
+    std::sort(staged.begin(), staged.end(), [](const StagedEntry &a, const StagedEntry &b) {
+        return a.nameHash != b.nameHash ? a.nameHash < b.nameHash : a.name < b.name;
+    });
+    for (size_t i = 1; i < staged.size(); i++)
+    {
+        if (staged[i].name == staged[i - 1].name)
+        {
+            throw std::runtime_error("duplicate asset in pack: " + staged[i].name);
+        }
+    }
+
+    // Tables first, then the payloads in entry order.
+    std::vector<Entry> entries;
+    std::vector<Chunk> chunks;
+    std::string        names;
+    for (const StagedEntry &entry : staged)
+    {
+        entries.push_back({.nameHash   = entry.nameHash,
+                           .nameOffset = static_cast<uint32_t>(names.size()),
+                           .nameLength = static_cast<uint32_t>(entry.name.size()),
+                           .size       = entry.size,
+                           .firstChunk = static_cast<uint32_t>(chunks.size()),
+                           .chunkCount = static_cast<uint32_t>(entry.payloads.size())});
+        names += entry.name;
+        for (size_t chunk = 0; chunk < entry.payloads.size(); chunk++)
+        {
+            chunks.push_back({.offset      = 0,
+                              .storedSize  = static_cast<uint32_t>(entry.payloads[chunk].size()),
+                              .compression = entry.compressions[chunk]});
+        }
+    }
+
+    Header header{.magic         = MAGIC,
+                  .version       = VERSION,
+                  .entryCount    = static_cast<uint32_t>(entries.size()),
+                  .chunkCount    = static_cast<uint32_t>(chunks.size()),
+                  .chunkSize     = chunkSize,
+                  .padding       = 0,
+                  .entriesOffset = sizeof(Header),
+                  .chunksOffset  = sizeof(Header) + entries.size() * sizeof(Entry),
+                  .namesOffset   = sizeof(Header) + entries.size() * sizeof(Entry) + chunks.size() * sizeof(Chunk),
+                  .namesSize     = names.size()};
+    uint64_t offset = header.namesOffset + header.namesSize;
+    for (Chunk &chunk : chunks)
+    {
+        offset       = alignUp(offset, PAYLOAD_ALIGNMENT);
+        chunk.offset = offset;
+        offset      += chunk.storedSize;
+    }
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (not out.is_open())
+    {
+        throw std::runtime_error("failed to open file " + filename + "!");
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    out.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(Entry));
+    out.write(reinterpret_cast<const char *>(chunks.data()), chunks.size() * sizeof(Chunk));
+    out.write(names.data(), names.size());
+    size_t chunk = 0;
+    for (const StagedEntry &entry : staged)
+    {
+        for (std::span<const std::byte> payload : entry.payloads)
+        {
+            std::vector<char> padding(chunks[chunk++].offset - out.tellp(), 0);
+            out.write(padding.data(), padding.size());
+            out.write(reinterpret_cast<const char *>(payload.data()), payload.size());
+        }
+    }
+    if (not out)
+    {
+        throw std::runtime_error("failed to write file " + filename + "!");
+    }
+}
+
+PROJECT_API const Pack::Entry &Pack::lookup(std::string_view name) const
+{
+    std::optional<uint32_t> index = find(name);
+    if (not index)
+    {
+        throw std::runtime_error("asset not found in pack: " + std::string(name));
+    }
+    return entries[*index];
+}
+
+}  // namespace Assets
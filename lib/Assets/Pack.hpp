@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Utils/MappedFile.hpp"
+#include "config.hpp"
+
+namespace Assets {
+
+enum class Compression : uint32_t
+{
+    eNone,
+    eLz4,
+    eZstd,  // only when built with zstd, see isSupported()
+};
+
+/**
+ * @class Pack
+ * @brief Read-only asset archive (.apak), mapped once for all its entries.
+ *
+ * The file is a header, a table of contents sorted by name hash, the names,
+ * then the payloads. Entries are split into independently compressed chunks
+ * of getChunkSize() bytes, so a streamed region decompresses only the chunks
+ * it needs, possibly on several workers. Stored entries are one contiguous
+ * chunk viewed in place, like a loose mapped file, below 4 GiB since stored
+ * chunk sizes are 32 bits. Every chunk starts on PAYLOAD_ALIGNMENT so any
+ * scalar type or texel block can be read from it.
+ *
+ * Opening an entry costs a binary search, no system call: the whole archive
+ * is one mapping and the OS pages it in on access. prefetch() starts reading
+ * an entry ahead of time.
+ *
+ * Thread safe, nothing is mutable after construction.
+ */
+class PROJECT_API Pack
+{
+   public:
+    static constexpr uint64_t PAYLOAD_ALIGNMENT  = 64;
+    static constexpr uint32_t DEFAULT_CHUNK_SIZE = 256 * 1024;
+
+    struct Entry
+    {
+        uint64_t nameHash;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint64_t size;  // decompressed
+        uint32_t firstChunk;
+        uint32_t chunkCount;
+    };
+
+    struct Chunk
+    {
+        uint64_t    offset;
+        uint32_t    storedSize;
+        Compression compression;
+    };
+
+    /**
+     * @brief File given to write(), every chunk that doesn't shrink is stored.
+     */
+    struct Source
+    {
+        std::string name;
+        std::string path;
+        Compression compression = Compression::eNone;
+    };
+
+    // Members
+   private:
+    Utils::Handlers::MappedFile file;
+    uint32_t                    chunkSize = 0;
+    std::span<const Entry>      entries;
+    std::span<const Chunk>      chunks;
+    std::string_view            names;
+
+    // Methods
+   public:
+    explicit Pack(const std::string &filename);
+
+    std::optional<uint32_t> find(std::string_view name) const;
+    bool                    contains(std::string_view name) const;
+    uint64_t                getSize(std::string_view name) const;
+
+    /**
+     * @brief The entry in place, throws when it is compressed.
+     */
+    std::span<const std::byte> view(std::string_view name) const;
+
+    /**
+     * @brief The entry in place when stored, else decompressed into storage.
+     */
+    std::span<const std::byte> get(std::string_view name, std::vector<std::byte> &storage) const;
+
+    /**
+     * @brief Decompress the whole entry, destination holds getSize() bytes.
+     */
+    void read(std::string_view name, std::span<std::byte> destination) const;
+
+    /**
+     * @brief Decompress one chunk into its part of the entry, destination is
+     * the whole entry. Chunks of an entry may be read concurrently.
+     */
+    void readChunk(const Entry &entry, uint32_t chunk, std::span<std::byte> destination) const;
+
+    void prefetch(std::string_view name) const;
+
+    const Entry     &getEntry(uint32_t index) const;
+    uint32_t         getEntryCount() const;
+    std::string_view getName(const Entry &entry) const;
+    uint32_t         getChunkSize() const;
+
+    static bool     isSupported(Compression compression);
+    static uint64_t hashName(std::string_view name);
+
+    static void write(const std::string      &filename,
+                      std::span<const Source> sources,
+                      uint32_t                chunkSize = DEFAULT_CHUNK_SIZE);
+
+   private:
+    /**
+     * @brief Throws when the entry doesn't exist.
+     */
+    const Entry &lookup(std::string_view name) const;
+};
+
+}  // namespace Assets
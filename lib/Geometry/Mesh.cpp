@@ -0,0 +1,161 @@
+#include "Mesh.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace Geometry {
+
+namespace {
+
+constexpr std::array<char, 4> MAGIC   = {'A', 'M', 'S', 'H'};
+constexpr uint32_t            VERSION = 1;
+
+// Large enough for every array element, including the float4 of meshlets.
+constexpr uint64_t SECTION_ALIGNMENT = 16;
+
+enum SectionIndex : uint32_t
+{
+    VERTICES,
+    INDICES,
+    MESHLETS,
+    MESHLET_VERTICES,
+    MESHLET_TRIANGLES,
+    SECTION_COUNT
+};
+
+struct Section
+{
+    uint64_t byteOffset;
+    uint64_t byteLength;
+};
+
+struct Header
+{
+    std::array<char, 4>                magic;
+    uint32_t                           version;
+    uint32_t                           vertexStride;
+    uint32_t                           meshletStride;
+    std::array<float, 4>               boundingSphere;
+    std::array<Section, SECTION_COUNT> sections;
+};
+static_assert(sizeof(Header) == 112);
+
+constexpr uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+template <typename T>
+std::span<const T> viewSection(const Utils::Handlers::MappedFile &file, const Section &section)
+{
+    if (section.byteOffset % SECTION_ALIGNMENT != 0 || section.byteLength % sizeof(T) != 0 ||
+        section.byteOffset + section.byteLength > file.getSize())
+    {
+        throw std::runtime_error("invalid mesh section!");
+    }
+    return std::span<const T>(reinterpret_cast<const T *>(file.getData() + section.byteOffset),
+                              section.byteLength / sizeof(T));
+}
+
+}  // namespace
+
+PROJECT_API Mesh::Mesh(const std::string &filename) : file(filename)
+{
+    if (file.getSize() < sizeof(Header))
+    {
+        throw std::runtime_error("not a mesh file: " + filename);
+    }
+    Header header;
+    std::memcpy(&header, file.getData(), sizeof(Header));
+    if (header.magic != MAGIC)
+    {
+        throw std::runtime_error("not a mesh file: " + filename);
+    }
+    if (header.version != VERSION || header.vertexStride != sizeof(CompactVertex) ||
+        header.meshletStride != sizeof(Meshlet))
+    {
+        throw std::runtime_error("outdated mesh file, cook it again: " + filename);
+    }
+
+    vertices         = viewSection<CompactVertex>(file, header.sections[VERTICES]);
+    indices          = viewSection<uint32_t>(file, header.sections[INDICES]);
+    meshlets         = viewSection<Meshlet>(file, header.sections[MESHLETS]);
+    meshletVertices  = viewSection<uint32_t>(file, header.sections[MESHLET_VERTICES]);
+    meshletTriangles = viewSection<uint8_t>(file, header.sections[MESHLET_TRIANGLES]);
+    boundingSphere   = header.boundingSphere;
+}
+
+PROJECT_API std::span<const CompactVertex> Mesh::getVertices() const
+{
+    return vertices;
+}
+
+PROJECT_API std::span<const uint32_t> Mesh::getIndices() const
+{
+    return indices;
+}
+
+PROJECT_API std::span<const Meshlet> Mesh::getMeshlets() const
+{
+    return meshlets;
+}
+
+PROJECT_API std::span<const uint32_t> Mesh::getMeshletVertices() const
+{
+    return meshletVertices;
+}
+
+PROJECT_API std::span<const uint8_t> Mesh::getMeshletTriangles() const
+{
+    return meshletTriangles;
+}
+
+PROJECT_API const std::array<float, 4> &Mesh::getBoundingSphere() const
+{
+    return boundingSphere;
+}
+
+PROJECT_API void Mesh::write(const std::string &filename, const MeshData &mesh)
+{
+    std::array<std::span<const std::byte>, SECTION_COUNT> payloads = {
+        std::as_bytes(std::span(mesh.vertices)),
+        std::as_bytes(std::span(mesh.indices)),
+        std::as_bytes(std::span(mesh.meshlets)),
+        std::as_bytes(std::span(mesh.meshletVertices)),
+        std::as_bytes(std::span(mesh.meshletTriangles))};
+
+    Header header{.magic          = MAGIC,
+                  .version        = VERSION,
+                  .vertexStride   = sizeof(CompactVertex),
+                  .meshletStride  = sizeof(Meshlet),
+                  .boundingSphere = mesh.boundingSphere,
+                  .sections       = {}};
+    uint64_t offset = sizeof(Header);
+    for (uint32_t section = 0; section < SECTION_COUNT; section++)
+    {
+        offset                   = alignUp(offset, SECTION_ALIGNMENT);
+        header.sections[section] = {.byteOffset = offset, .byteLength = payloads[section].size()};
+        offset += payloads[section].size();
+    }
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (not out.is_open())
+    {
+        throw std::runtime_error("failed to open file " + filename + "!");
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    for (uint32_t section = 0; section < SECTION_COUNT; section++)
+    {
+        std::vector<char> padding(header.sections[section].byteOffset - out.tellp(), 0);
+        out.write(padding.data(), padding.size());
+        out.write(reinterpret_cast<const char *>(payloads[section].data()), payloads[section].size());
+    }
+    if (not out)
+    {
+        throw std::runtime_error("failed to write file " + filename + "!");
+    }
+}
+
+}  // namespace Geometry
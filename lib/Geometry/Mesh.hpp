@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+
+#include "MeshOptimizer.hpp"
+#include "Utils/MappedFile.hpp"
+#include "config.hpp"
+
+namespace Geometry {
+
+/**
+ * @class Mesh
+ * @brief Cooked mesh container (.amesh), mapped as is at runtime.
+ *
+ * A header followed by the arrays of MeshData, each 16-byte aligned in the
+ * file. Every getter is a view on the mapped file, the vertex and index
+ * arrays go to the staging ring without an intermediate copy. The vertex
+ * stride is checked against CompactVertex so stale files fail to load
+ * instead of drawing garbage.
+ */
+class PROJECT_API Mesh
+{
+    // Members
+   private:
+    Utils::Handlers::MappedFile    file;
+    std::span<const CompactVertex> vertices;
+    std::span<const uint32_t>      indices;
+    std::span<const Meshlet>       meshlets;
+    std::span<const uint32_t>      meshletVertices;
+    std::span<const uint8_t>       meshletTriangles;
+    std::array<float, 4>           boundingSphere = {};
+
+    // Methods
+   public:
+    explicit Mesh(const std::string &filename);
+
+    std::span<const CompactVertex> getVertices() const;
+    std::span<const uint32_t>      getIndices() const;
+    std::span<const Meshlet>       getMeshlets() const;
+    std::span<const uint32_t>      getMeshletVertices() const;
+    std::span<const uint8_t>       getMeshletTriangles() const;
+
+    /**
+     * @return xyz center, w radius, in model space.
+     */
+    const std::array<float, 4> &getBoundingSphere() const;
+
+    static void write(const std::string &filename, const MeshData &mesh);
+};
+
+}  // namespace Geometry
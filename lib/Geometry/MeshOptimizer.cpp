@@ -0,0 +1,469 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+#include "profiling.hpp"
+
+namespace Geometry {
+
+namespace {
+
+constexpr uint32_t UNUSED = std::numeric_limits<uint32_t>::max();
+
+/**
+ * @brief Triangles around each vertex, in compressed rows.
+ */
+struct Adjacency
+{
+    std::vector<uint32_t> offsets;    // vertexCount + 1
+    std::vector<uint32_t> triangles;  // by vertex
+};
+
+Adjacency buildAdjacency(std::span<const uint32_t> indices, size_t vertexCount)
+{
+    Adjacency adjacency;
+    adjacency.offsets.assign(vertexCount + 1, 0);
+    for (uint32_t index : indices)
+    {
+        adjacency.offsets[index + 1]++;
+    }
+    std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+
+    std::vector<uint32_t> cursor(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    adjacency.triangles.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        adjacency.triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+    return adjacency;
+}
+
+glm::vec3 triangleNormal(std::span<const CompactVertex> vertices, const uint32_t *triangle)
+{
+    // Not normalized: its length is twice the area.
+    return glm::cross(vertices[triangle[1]].pos - vertices[triangle[0]].pos,
+                      vertices[triangle[2]].pos - vertices[triangle[0]].pos);
+}
+
+/**
+ * @brief Sphere around the axis aligned box of the points, not the smallest
+ * one but cheap and close enough for culling.
+ */
+template <typename Positions>
+std::array<float, 4> boundingSphere(const Positions &positions)
+{
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    for (const glm::vec3 &position : positions)
+    {
+        boundsMin = glm::min(boundsMin, position);
+        boundsMax = glm::max(boundsMax, position);
+    }
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    float     radius = 0.0f;
+    for (const glm::vec3 &position : positions)
+    {
+        radius = std::max(radius, glm::distance(center, position));
+    }
+    return {center.x, center.y, center.z, radius};
+}
+
+}  // namespace
+
+PROJECT_API MeshData MeshOptimizer::process(std::vector<CompactVertex> vertices,
+                                            std::vector<uint32_t>      indices,
+                                            const Options             &options)
+{
+    ZoneScoped;
+    if (indices.size() % 3 != 0)
+    {
+        throw std::runtime_error("index count is not a multiple of 3!");
+    }
+
+    MeshData mesh;
+    deduplicate(vertices, indices);
+
+    std::vector<uint32_t> clusters;
+    optimizeVertexCache(indices, vertices.size(), options.reduceOverdraw ? &clusters : nullptr);
+    if (options.reduceOverdraw)
+    {
+        optimizeOverdraw(indices, vertices, clusters);
+    }
+    optimizeVertexFetch(vertices, indices);
+
+    mesh.vertices = std::move(vertices);
+    mesh.indices  = std::move(indices);
+
+    std::vector<glm::vec3> positions(mesh.vertices.size());
+    std::transform(mesh.vertices.begin(), mesh.vertices.end(), positions.begin(), [](const CompactVertex &vertex) {
+        return vertex.pos;
+    });
+    mesh.boundingSphere = boundingSphere(positions);
+
+    if (options.buildMeshlets)
+    {
+        buildMeshlets(mesh);
+    }
+    return mesh;
+}
+
+PROJECT_API void MeshOptimizer::deduplicate(std::vector<CompactVertex> &vertices, std::span<uint32_t> indices)
+{
+    ZoneScoped;
+    // The vertex has no padding, comparing its bytes compares its fields.
+    static_assert(sizeof(CompactVertex) == sizeof(glm::vec3) + 3 * sizeof(uint32_t));
+
+    std::unordered_map<std::string_view, uint32_t> unique;
+    unique.reserve(vertices.size());
+    std::vector<uint32_t>      remap(vertices.size());
+    std::vector<CompactVertex> merged;
+    merged.reserve(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        std::string_view key(reinterpret_cast<const char *>(&vertices[i]), sizeof(CompactVertex));
+        auto [it, inserted] = unique.try_emplace(key, static_cast<uint32_t>(merged.size()));
+        if (inserted)
+        {
+            merged.push_back(vertices[i]);
+        }
+        remap[i] = it->second;
+    }
+
+    for (uint32_t &index : indices)
+    {
+        index = remap[index];
+    }
+    vertices = std::move(merged);
+}
+
+PROJECT_API void MeshOptimizer::optimizeVertexCache(std::span<uint32_t>    indices,
+                                                    size_t                 vertexCount,
+                                                    std::vector<uint32_t> *clusters)
+{
+    ZoneScoped;
+    if (clusters)
+    {
+        clusters->clear();
+    }
+    if (indices.empty())
+    {
+        return;
+    }
+
+    Adjacency             adjacency = buildAdjacency(indices, vertexCount);
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    }
+
+    // A vertex is in the cache while time - cacheTime <= CACHE_SIZE.
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t              time = CACHE_SIZE + 1;
+
+    const size_t          triangleCount = indices.size() / 3;
+    std::vector<bool>     emitted(triangleCount, false);
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    uint32_t              cursor  = 0;
+    uint32_t              fanning = indices[0];
+    if (clusters)
+    {
+        clusters->push_back(0);
+    }
+
+    while (fanning != UNUSED)
+    {
+        candidates.clear();
+        for (uint32_t i = adjacency.offsets[fanning]; i < adjacency.offsets[fanning + 1]; i++)
+        {
+            uint32_t triangle = adjacency.triangles[i];
+            if (emitted[triangle])
+            {
+                continue;
+            }
+            emitted[triangle] = true;
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                uint32_t vertex = indices[triangle * 3 + corner];
+                output.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+                if (time - cacheTime[vertex] > CACHE_SIZE)
+                {
+                    cacheTime[vertex] = time++;
+                }
+            }
+        }
+
+        // Next fan: the candidate that stays longest in the cache without
+        // being evicted by its own remaining triangles.
+        uint32_t next        = UNUSED;
+        int64_t  maxPriority = -1;
+        for (uint32_t candidate : candidates)
+        {
+            if (liveTriangles[candidate] == 0)
+            {
+                continue;
+            }
+            int64_t priority = 0;
+            if (time - cacheTime[candidate] + 2 * liveTriangles[candidate] <= CACHE_SIZE)
+            {
+                priority = time - cacheTime[candidate];
+            }
+            if (priority > maxPriority)
+            {
+                maxPriority = priority;
+                next        = candidate;
+            }
+        }
+
+        // Dead end: go back to a recent vertex with triangles left, else to
+        // the next one in input order. This starts a new cluster.
+        if (next == UNUSED)
+        {
+            while (not deadEnds.empty() && next == UNUSED)
+            {
+                uint32_t vertex = deadEnds.back();
+                deadEnds.pop_back();
+                if (liveTriangles[vertex] > 0)
+                {
+                    next = vertex;
+                }
+            }
+            while (next == UNUSED && cursor < vertexCount)
+            {
+                if (liveTriangles[cursor] > 0)
+                {
+                    next = cursor;
+                }
+                cursor++;
+            }
+            if (clusters && next != UNUSED)
+            {
+                clusters->push_back(static_cast<uint32_t>(output.size() / 3));
+            }
+        }
+        fanning = next;
+    }
+
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+PROJECT_API void MeshOptimizer::optimizeOverdraw(std::span<uint32_t>            indices,
+                                                 std::span<const CompactVertex> vertices,
+                                                 std::span<const uint32_t>      clusters)
+{
+    ZoneScoped;
+    const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (clusters.size() < 2)
+    {
+        return;
+    }
+
+    // Area weighted centroid of the whole mesh.
+    glm::vec3 meshCentroid(0.0f);
+    float     meshArea = 0.0f;
+    for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+    {
+        const uint32_t *corners = &indices[triangle * 3];
+        float           area    = glm::length(triangleNormal(vertices, corners));
+        meshCentroid += area * (vertices[corners[0]].pos + vertices[corners[1]].pos + vertices[corners[2]].pos) / 3.0f;
+        meshArea += area;
+    }
+    meshCentroid /= std::max(meshArea, std::numeric_limits<float>::min());
+
+    // Clusters whose average normal points away from the centroid are on the
+    // outside of the mesh, they occlude and go first.
+    struct Cluster
+    {
+        uint32_t begin;
+        uint32_t end;
+        float    occlusion;
+    };
+    std::vector<Cluster> sorted(clusters.size());
+    for (size_t i = 0; i < clusters.size(); i++)
+    {
+        Cluster &cluster = sorted[i];
+        cluster.begin    = clusters[i];
+        cluster.end      = i + 1 < clusters.size() ? clusters[i + 1] : triangleCount;
+
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        for (uint32_t triangle = cluster.begin; triangle < cluster.end; triangle++)
+        {
+            const uint32_t *corners = &indices[triangle * 3];
+            centroid += vertices[corners[0]].pos + vertices[corners[1]].pos + vertices[corners[2]].pos;
+            normal += triangleNormal(vertices, corners);
+        }
+        centroid /= static_cast<float>((cluster.end - cluster.begin) * 3);
+        float length      = glm::length(normal);
+        cluster.occlusion = length > 0.0f ? glm::dot(centroid - meshCentroid, normal / length) : 0.0f;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster &a, const Cluster &b) {
+        return a.occlusion > b.occlusion;
+    });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (const Cluster &cluster : sorted)
+    {
+        output.insert(output.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+    }
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+PROJECT_API void MeshOptimizer::optimizeVertexFetch(std::vector<CompactVertex> &vertices, std::span<uint32_t> indices)
+{
+    ZoneScoped;
+    std::vector<uint32_t>      remap(vertices.size(), UNUSED);
+    std::vector<CompactVertex> ordered;
+    ordered.reserve(vertices.size());
+    for (uint32_t &index : indices)
+    {
+        if (remap[index] == UNUSED)
+        {
+            remap[index] = static_cast<uint32_t>(ordered.size());
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices = std::move(ordered);
+}
+
+PROJECT_API void MeshOptimizer::buildMeshlets(MeshData &mesh)
+{
+    ZoneScoped;
+    mesh.meshlets.clear();
+    mesh.meshletVertices.clear();
+    mesh.meshletTriangles.clear();
+
+    // Local index of each vertex in the current meshlet.
+    std::vector<uint8_t> local(mesh.vertices.size(), 0xFF);
+    static_assert(MAX_MESHLET_VERTICES < 0xFF);
+
+    Meshlet                meshlet;
+    std::vector<glm::vec3> normals;
+
+    auto flush = [&]() {
+        if (meshlet.triangleCount == 0)
+        {
+            return;
+        }
+        std::span<const uint32_t> meshletVertices(mesh.meshletVertices.data() + meshlet.vertexOffset,
+                                                  meshlet.vertexCount);
+        std::vector<glm::vec3>    positions;
+        positions.reserve(meshlet.vertexCount);
+        for (uint32_t vertex : meshletVertices)
+        {
+            positions.push_back(mesh.vertices[vertex].pos);
+            local[vertex] = 0xFF;
+        }
+        meshlet.boundingSphere = boundingSphere(positions);
+
+        // Cone around the triangle normals. Past 90 degrees from the axis
+        // some triangle faces every viewer, the meshlet is never back facing.
+        glm::vec3 axis(0.0f);
+        for (const glm::vec3 &normal : normals)
+        {
+            axis += normal;
+        }
+        float length = glm::length(axis);
+        float cutoff = 1.0f;
+        if (length > 0.0f)
+        {
+            axis /= length;
+            float minDot = 1.0f;
+            for (const glm::vec3 &normal : normals)
+            {
+                minDot = std::min(minDot, glm::dot(axis, normal));
+            }
+            if (minDot > 0.0f)
+            {
+                cutoff = std::sqrt(1.0f - minDot * minDot);
+            }
+        }
+        meshlet.cone = {axis.x, axis.y, axis.z, cutoff};
+        mesh.meshlets.push_back(meshlet);
+
+        // Triangle ranges start 4-byte aligned so shaders read them as uints.
+        mesh.meshletTriangles.resize((mesh.meshletTriangles.size() + 3) & ~size_t(3), 0);
+        meshlet = {.vertexOffset   = static_cast<uint32_t>(mesh.meshletVertices.size()),
+                   .triangleOffset = static_cast<uint32_t>(mesh.meshletTriangles.size())};
+        normals.clear();
+    };
+
+    for (size_t i = 0; i < mesh.indices.size(); i += 3)
+    {
+        const uint32_t *corners     = &mesh.indices[i];
+        uint32_t        newVertices = 0;
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            newVertices += local[corners[corner]] == 0xFF ? 1 : 0;
+        }
+        if (meshlet.vertexCount + newVertices > MAX_MESHLET_VERTICES ||
+            meshlet.triangleCount + 1 > MAX_MESHLET_TRIANGLES)
+        {
+            flush();
+        }
+
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            uint32_t vertex = corners[corner];
+            if (local[vertex] == 0xFF)
+            {
+                local[vertex] = static_cast<uint8_t>(meshlet.vertexCount++);
+                mesh.meshletVertices.push_back(vertex);
+            }
+            mesh.meshletTriangles.push_back(local[vertex]);
+        }
+        meshlet.triangleCount++;
+
+        glm::vec3 normal = triangleNormal(mesh.vertices, corners);
+        float     length = glm::length(normal);
+        if (length > 0.0f)
+        {
+            normals.push_back(normal / length);
+        }
+    }
+    flush();
+}
+
+PROJECT_API float MeshOptimizer::getAcmr(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize)
+{
+    if (indices.size() < 3)
+    {
+        return 0.0f;
+    }
+    std::vector<bool>    cached(vertexCount, false);
+    std::deque<uint32_t> fifo;
+    size_t               misses = 0;
+    for (uint32_t index : indices)
+    {
+        if (cached[index])
+        {
+            continue;
+        }
+        misses++;
+        cached[index] = true;
+        fifo.push_back(index);
+        if (fifo.size() > cacheSize)
+        {
+            cached[fifo.front()] = false;
+            fifo.pop_front();
+        }
+    }
+    return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+}  // namespace Geometry
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Vextex.hpp"
+#include "config.hpp"
+
+namespace Geometry {
+
+/**
+ * @brief Cluster of at most MeshOptimizer::MAX_MESHLET_VERTICES vertices and
+ * MeshOptimizer::MAX_MESHLET_TRIANGLES triangles (std430).
+ *
+ * The cone culls back facing clusters: they are invisible when
+ *   dot(center - camera, axis) >= cutoff * length(center - camera) + radius
+ * A cutoff of 1 never culls.
+ */
+struct Meshlet
+{
+    uint32_t             vertexOffset   = 0;  // in MeshData::meshletVertices
+    uint32_t             triangleOffset = 0;  // in MeshData::meshletTriangles, 4-byte aligned
+    uint32_t             vertexCount    = 0;
+    uint32_t             triangleCount  = 0;
+    std::array<float, 4> boundingSphere = {};  // xyz center, w radius
+    std::array<float, 4> cone           = {};  // xyz axis, w cutoff
+};
+static_assert(sizeof(Meshlet) == 48);
+
+/**
+ * @brief Indexed triangle list ready for rendering, and its meshlets.
+ */
+struct MeshData
+{
+    std::vector<CompactVertex> vertices;
+    std::vector<uint32_t>      indices;
+    std::vector<Meshlet>       meshlets;
+    std::vector<uint32_t>      meshletVertices;   // indices in vertices
+    std::vector<uint8_t>       meshletTriangles;  // three local vertex indices per triangle
+    std::array<float, 4>       boundingSphere = {};
+};
+
+/**
+ * @class MeshOptimizer
+ * @brief Offline mesh processing run by the mesh cooker.
+ *
+ * process() chains the passes in the order they depend on each other:
+ * vertex deduplication, post-transform cache ordering (Tipsify), cluster
+ * ordering against overdraw, vertex fetch ordering, then meshlets built from
+ * the final triangle order so they inherit its locality.
+ */
+class PROJECT_API MeshOptimizer
+{
+   public:
+    static constexpr uint32_t CACHE_SIZE            = 16;
+    static constexpr uint32_t MAX_MESHLET_VERTICES  = 64;
+    static constexpr uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+    struct Options
+    {
+        bool reduceOverdraw = true;
+        bool buildMeshlets  = true;
+    };
+
+    // Methods
+   public:
+    static MeshData process(std::vector<CompactVertex> vertices, std::vector<uint32_t> indices, const Options &options);
+
+    /**
+     * @brief Merge bitwise identical vertices, e.g. the ones quantization made
+     * equal, and remap the indices.
+     */
+    static void deduplicate(std::vector<CompactVertex> &vertices, std::span<uint32_t> indices);
+
+    /**
+     * @brief Reorder the triangles for the post-transform vertex cache
+     * (Sander et al., "Fast Triangle Reordering for Vertex Locality and
+     * Reduced Overdraw", linear time).
+     *
+     * @param clusters if not null, receives the first triangle of every
+     * cluster, i.e. every point where the ordering had to restart from a dead
+     * end. They can be moved around without hurting the cache.
+     */
+    static void optimizeVertexCache(std::span<uint32_t>    indices,
+                                    size_t                 vertexCount,
+                                    std::vector<uint32_t> *clusters = nullptr);
+
+    /**
+     * @brief Sort the clusters of optimizeVertexCache() so the ones facing
+     * away from the mesh center come first and occlude the others.
+     */
+    static void optimizeOverdraw(std::span<uint32_t>            indices,
+                                 std::span<const CompactVertex> vertices,
+                                 std::span<const uint32_t>      clusters);
+
+    /**
+     * @brief Store the vertices in the order the indices first reference
+     * them, unreferenced vertices are dropped.
+     */
+    static void optimizeVertexFetch(std::vector<CompactVertex> &vertices, std::span<uint32_t> indices);
+
+    /**
+     * @brief Greedily split the triangles, in order, into meshlets.
+     */
+    static void buildMeshlets(MeshData &mesh);
+
+    /**
+     * @brief Average cache miss ratio of a FIFO cache: transformed vertices
+     * per triangle, 0.5 at best and 3 at worst.
+     */
+    static float getAcmr(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize = CACHE_SIZE);
+};
+
+}  // namespace Geometry
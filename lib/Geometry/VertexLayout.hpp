@@ -0,0 +1,216 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/packing.hpp>
+
+namespace Geometry {
+
+/**
+ * @brief Two half floats, e.g. texture coordinates.
+ */
+struct Half2
+{
+    uint32_t packed = 0;
+
+    static Half2 pack(glm::vec2 value)
+    {
+        return {glm::packHalf2x16(value)};
+    }
+};
+
+/**
+ * @brief Four signed normalized bytes, e.g. normals and tangents.
+ */
+struct Snorm8x4
+{
+    uint32_t packed = 0;
+
+    static Snorm8x4 pack(glm::vec4 value)
+    {
+        return {glm::packSnorm4x8(value)};
+    }
+};
+
+/**
+ * @brief Four unsigned normalized bytes, e.g. colors.
+ */
+struct Unorm8x4
+{
+    uint32_t packed = 0;
+
+    static Unorm8x4 pack(glm::vec4 value)
+    {
+        return {glm::packUnorm4x8(value)};
+    }
+};
+
+/**
+ * @brief vk::Format of an attribute type, undefined for unsupported types so
+ * they fail to compile.
+ */
+template <typename T>
+struct VertexFormat;
+
+template <>
+struct VertexFormat<float>
+{
+    static constexpr vk::Format value = vk::Format::eR32Sfloat;
+};
+
+template <>
+struct VertexFormat<glm::vec2>
+{
+    static constexpr vk::Format value = vk::Format::eR32G32Sfloat;
+};
+
+template <>
+struct VertexFormat<glm::vec3>
+{
+    static constexpr vk::Format value = vk::Format::eR32G32B32Sfloat;
+};
+
+template <>
+struct VertexFormat<glm::vec4>
+{
+    static constexpr vk::Format value = vk::Format::eR32G32B32A32Sfloat;
+};
+
+template <>
+struct VertexFormat<uint32_t>
+{
+    static constexpr vk::Format value = vk::Format::eR32Uint;
+};
+
+template <>
+struct VertexFormat<Half2>
+{
+    static constexpr vk::Format value = vk::Format::eR16G16Sfloat;
+};
+
+template <>
+struct VertexFormat<Snorm8x4>
+{
+    static constexpr vk::Format value = vk::Format::eR8G8B8A8Snorm;
+};
+
+template <>
+struct VertexFormat<Unorm8x4>
+{
+    static constexpr vk::Format value = vk::Format::eR8G8B8A8Unorm;
+};
+
+struct VertexAttribute
+{
+    uint32_t   location;
+    vk::Format format;
+    uint32_t   offset;
+};
+
+template <typename T>
+constexpr VertexAttribute attribute(uint32_t location, size_t offset)
+{
+    return {location, VertexFormat<T>::value, static_cast<uint32_t>(offset)};
+}
+
+/**
+ * @brief One vertex buffer binding of a VertexLayout.
+ *
+ * Vertex describes its attributes with a static constexpr getAttributes().
+ * Stride is larger than the type when the attributes are the head of a bigger
+ * record, e.g. the transform of a GPU instance.
+ */
+template <typename Vertex,
+          vk::VertexInputRate Rate   = vk::VertexInputRate::eVertex,
+          uint32_t            Stride = sizeof(Vertex)>
+struct VertexStream
+{
+    static_assert(Stride >= sizeof(Vertex), "the stride is smaller than the vertex");
+
+    using Type = Vertex;
+
+    static constexpr vk::VertexInputRate rate   = Rate;
+    static constexpr uint32_t            stride = Stride;
+};
+
+/**
+ * @class VertexLayout
+ * @brief Binding and attribute descriptions of several vertex streams, built
+ * at compile time. Stream i is bound at binding i.
+ */
+template <typename... Streams>
+class VertexLayout
+{
+   public:
+    static constexpr uint32_t BINDING_COUNT   = sizeof...(Streams);
+    static constexpr uint32_t ATTRIBUTE_COUNT = (static_cast<uint32_t>(Streams::Type::getAttributes().size()) + ...);
+
+    static constexpr std::array<vk::VertexInputBindingDescription, BINDING_COUNT> getBindingDescriptions()
+    {
+        uint32_t binding = 0;
+        return {vk::VertexInputBindingDescription(binding++, Streams::stride, Streams::rate)...};
+    }
+
+    static constexpr std::array<vk::VertexInputAttributeDescription, ATTRIBUTE_COUNT> getAttributeDescriptions()
+    {
+        std::array<vk::VertexInputAttributeDescription, ATTRIBUTE_COUNT> descriptions{};
+        uint32_t                                                          index   = 0;
+        uint32_t                                                          binding = 0;
+
+        auto append = [&](const auto &attributes) {
+            for (const VertexAttribute &input : attributes)
+            {
+                descriptions[index++] =
+                    vk::VertexInputAttributeDescription(input.location, binding, input.format, input.offset);
+            }
+            binding++;
+        };
+        (append(Streams::Type::getAttributes()), ...);
+        return descriptions;
+    }
+
+    static constexpr bool hasUniqueLocations()
+    {
+        auto descriptions = getAttributeDescriptions();
+        for (uint32_t i = 0; i < ATTRIBUTE_COUNT; i++)
+        {
+            for (uint32_t j = i + 1; j < ATTRIBUTE_COUNT; j++)
+            {
+                if (descriptions[i].location == descriptions[j].location)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Vertex input state pointing at descriptions with static storage.
+     */
+    static vk::PipelineVertexInputStateCreateInfo getInputState()
+    {
+        static_assert(hasUniqueLocations(), "two vertex attributes share a location");
+        return {.vertexBindingDescriptionCount   = BINDING_COUNT,
+                .pVertexBindingDescriptions      = bindingDescriptions.data(),
+                .vertexAttributeDescriptionCount = ATTRIBUTE_COUNT,
+                .pVertexAttributeDescriptions    = attributeDescriptions.data()};
+    }
+
+   private:
+    static constexpr auto bindingDescriptions   = getBindingDescriptions();
+    static constexpr auto attributeDescriptions = getAttributeDescriptions();
+};
+
+}  // namespace Geometry
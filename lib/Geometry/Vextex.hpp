@@ -1,35 +1,72 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 
-#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
-#    include <vulkan/vulkan_raii.hpp>
-#else
-import vulkan_hpp;
-#endif
-
-#define GLM_FORCE_RADIANS
-#define GLM_FORCE_DEPTH_ZERO_TO_ONE
-#include <glm/glm.hpp>
+#include "VertexLayout.hpp"
 
 namespace Geometry {
 
+/**
+ * @brief Full precision vertex, as authored or loaded (32 bytes).
+ */
 struct Vertex
 {
     glm::vec3 pos;
     glm::vec3 color;
     glm::vec2 texCoord;
 
-    static constexpr vk::VertexInputBindingDescription getBindingDescription()
+    static constexpr std::array<VertexAttribute, 3> getAttributes()
+    {
+        return {attribute<glm::vec3>(0, offsetof(Vertex, pos)),
+                attribute<glm::vec3>(1, offsetof(Vertex, color)),
+                attribute<glm::vec2>(2, offsetof(Vertex, texCoord))};
+    }
+};
+
+/**
+ * @brief Quantized vertex for rendering (24 bytes): 8 bit normal and color,
+ * half float texture coordinates. Positions stay full precision.
+ */
+struct CompactVertex
+{
+    glm::vec3 pos;
+    Unorm8x4  color;
+    Half2     texCoord;
+    Snorm8x4  normal;  // w unused, free for the tangent sign
+
+    static CompactVertex pack(const Vertex &vertex, glm::vec3 normal = {0.0f, 0.0f, 1.0f})
+    {
+        return {.pos      = vertex.pos,
+                .color    = Unorm8x4::pack(glm::vec4(glm::clamp(vertex.color, 0.0f, 1.0f), 1.0f)),
+                .texCoord = Half2::pack(vertex.texCoord),
+                .normal   = Snorm8x4::pack(glm::vec4(normal, 0.0f))};
+    }
+
+    static constexpr std::array<VertexAttribute, 4> getAttributes()
     {
-        return {0, sizeof(Vertex), vk::VertexInputRate::eVertex};
+        return {attribute<glm::vec3>(0, offsetof(CompactVertex, pos)),
+                attribute<Unorm8x4>(1, offsetof(CompactVertex, color)),
+                attribute<Half2>(2, offsetof(CompactVertex, texCoord)),
+                attribute<Snorm8x4>(3, offsetof(CompactVertex, normal))};
     }
+};
+
+/**
+ * @brief Per-instance model matrix, its columns at locations 4 to 7. Meant
+ * for a VertexStream with vk::VertexInputRate::eInstance.
+ */
+struct InstanceTransform
+{
+    glm::mat4 model;
 
-    static constexpr std::array<vk::VertexInputAttributeDescription, 3> getAttributeDescriptions()
+    static constexpr std::array<VertexAttribute, 4> getAttributes()
     {
-        return {vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, pos)),
-                vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, color)),
-                vk::VertexInputAttributeDescription(2, 0, vk::Format::eR32G32Sfloat, offsetof(Vertex, texCoord))};
+        constexpr size_t offset = offsetof(InstanceTransform, model);
+        return {attribute<glm::vec4>(4, offset),
+                attribute<glm::vec4>(5, offset + sizeof(glm::vec4)),
+                attribute<glm::vec4>(6, offset + 2 * sizeof(glm::vec4)),
+                attribute<glm::vec4>(7, offset + 3 * sizeof(glm::vec4))};
     }
 };
 
@@ -0,0 +1,138 @@
+#include "BindlessTable.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+#include "profiling.hpp"
+
+namespace Graphics {
+
+PROJECT_API BindlessTable::BindlessTable(const vk::raii::PhysicalDevice &physicalDevice,
+                                         const vk::raii::Device         &device,
+                                         uint32_t                        maxTextures,
+                                         uint32_t                        maxSamplers) :
+    device(device)
+{
+    ZoneScoped;
+    auto properties =
+        physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>();
+    const auto &limits = properties.get<vk::PhysicalDeviceVulkan12Properties>();
+    this->maxTextures  = std::min({maxTextures,
+                                   limits.maxDescriptorSetUpdateAfterBindSampledImages,
+                                   limits.maxPerStageDescriptorUpdateAfterBindSampledImages});
+    this->maxSamplers  = std::min({maxSamplers,
+                                   limits.maxDescriptorSetUpdateAfterBindSamplers,
+                                   limits.maxPerStageDescriptorUpdateAfterBindSamplers});
+
+    std::array bindings = {vk::DescriptorSetLayoutBinding(TEXTURE_BINDING,
+                                                          vk::DescriptorType::eSampledImage,
+                                                          this->maxTextures,
+                                                          vk::ShaderStageFlagBits::eAll),
+                           vk::DescriptorSetLayoutBinding(SAMPLER_BINDING,
+                                                          vk::DescriptorType::eSampler,
+                                                          this->maxSamplers,
+                                                          vk::ShaderStageFlagBits::eAll)};
+    vk::DescriptorBindingFlags bindingFlag = vk::DescriptorBindingFlagBits::ePartiallyBound |
+                                             vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+                                             vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+    std::array bindingFlags = {bindingFlag, bindingFlag};
+
+    vk::StructureChain<vk::DescriptorSetLayoutCreateInfo, vk::DescriptorSetLayoutBindingFlagsCreateInfo> layoutInfo = {
+        {.flags        = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+         .bindingCount = bindings.size(),
+         .pBindings    = bindings.data()},
+        {.bindingCount = bindingFlags.size(), .pBindingFlags = bindingFlags.data()}};
+    layout = vk::raii::DescriptorSetLayout(device, layoutInfo.get<vk::DescriptorSetLayoutCreateInfo>());
+
+    std::array poolSizes = {vk::DescriptorPoolSize(vk::DescriptorType::eSampledImage, this->maxTextures),
+                            vk::DescriptorPoolSize(vk::DescriptorType::eSampler, this->maxSamplers)};
+    vk::DescriptorPoolCreateInfo poolInfo{.flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet |
+                                                   vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind,
+                                          .maxSets       = 1,
+                                          .poolSizeCount = poolSizes.size(),
+                                          .pPoolSizes    = poolSizes.data()};
+    pool = vk::raii::DescriptorPool(device, poolInfo);
+
+    vk::DescriptorSetAllocateInfo allocInfo{.descriptorPool = pool, .descriptorSetCount = 1, .pSetLayouts = &*layout};
+    set = std::move(device.allocateDescriptorSets(allocInfo).front());
+}
+
+PROJECT_API bool BindlessTable::isSupported(const vk::PhysicalDeviceVulkan12Features &features)
+{
+    return features.runtimeDescriptorArray && features.descriptorBindingPartiallyBound &&
+           features.descriptorBindingSampledImageUpdateAfterBind && features.descriptorBindingUpdateUnusedWhilePending;
+}
+
+PROJECT_API uint32_t BindlessTable::addTexture(vk::ImageView imageView, vk::ImageLayout imageLayout)
+{
+    uint32_t index;
+    if (not freeTextures.empty())
+    {
+        index = freeTextures.back();
+        freeTextures.pop_back();
+    }
+    else if (textureCount < maxTextures)
+    {
+        index = textureCount++;
+    }
+    else
+    {
+        throw std::runtime_error("bindless texture table is full!");
+    }
+    updateTexture(index, imageView, imageLayout);
+    return index;
+}
+
+PROJECT_API void BindlessTable::updateTexture(uint32_t index, vk::ImageView imageView, vk::ImageLayout imageLayout)
+{
+    vk::DescriptorImageInfo imageInfo{.imageView = imageView, .imageLayout = imageLayout};
+    vk::WriteDescriptorSet  write{.dstSet          = set,
+                                  .dstBinding      = TEXTURE_BINDING,
+                                  .dstArrayElement = index,
+                                  .descriptorCount = 1,
+                                  .descriptorType  = vk::DescriptorType::eSampledImage,
+                                  .pImageInfo      = &imageInfo};
+    device.updateDescriptorSets(write, {});
+}
+
+PROJECT_API void BindlessTable::removeTexture(uint32_t index)
+{
+    // Partially bound: the stale descriptor stays until the slot is reused,
+    // it is never read in between.
+    freeTextures.push_back(index);
+}
+
+PROJECT_API uint32_t BindlessTable::addSampler(vk::Sampler sampler)
+{
+    if (samplerCount == maxSamplers)
+    {
+        throw std::runtime_error("bindless sampler table is full!");
+    }
+    vk::DescriptorImageInfo samplerInfo{.sampler = sampler};
+    vk::WriteDescriptorSet  write{.dstSet          = set,
+                                  .dstBinding      = SAMPLER_BINDING,
+                                  .dstArrayElement = samplerCount,
+                                  .descriptorCount = 1,
+                                  .descriptorType  = vk::DescriptorType::eSampler,
+                                  .pImageInfo      = &samplerInfo};
+    device.updateDescriptorSets(write, {});
+    return samplerCount++;
+}
+
+PROJECT_API const vk::raii::DescriptorSetLayout &BindlessTable::getLayout() const
+{
+    return layout;
+}
+
+PROJECT_API vk::DescriptorSet BindlessTable::getSet() const
+{
+    return *set;
+}
+
+PROJECT_API uint32_t BindlessTable::getMaxTextures() const
+{
+    return maxTextures;
+}
+
+}  // namespace Graphics
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#include "config.hpp"
+
+namespace Graphics {
+
+/**
+ * @class BindlessTable
+ * @brief One descriptor set holding every sampled image and sampler, indexed
+ * from the shaders.
+ *
+ * The set is bound once per command buffer, draws select their resources with
+ * the indices returned by addTexture() / addSampler(), usually through push
+ * constants. Bindings are partially bound and update after bind: a slot may be
+ * written while the set is in use by pending command buffers as long as they
+ * don't read that slot, so adding a texture never waits for the GPU nor
+ * touches the other frames.
+ *
+ * Declared in shaders as:
+ *   [[vk::binding(0, 0)]] Texture2D    textures[];
+ *   [[vk::binding(1, 0)]] SamplerState samplers[];
+ *
+ * Not thread safe. A removed slot must not be read by any pending work.
+ */
+class PROJECT_API BindlessTable
+{
+   public:
+    static constexpr uint32_t TEXTURE_BINDING      = 0;
+    static constexpr uint32_t SAMPLER_BINDING      = 1;
+    static constexpr uint32_t DEFAULT_MAX_TEXTURES = 16384;
+    static constexpr uint32_t DEFAULT_MAX_SAMPLERS = 64;
+
+    // Members
+   private:
+    const vk::raii::Device &device;
+    uint32_t                maxTextures;
+    uint32_t                maxSamplers;
+
+    vk::raii::DescriptorSetLayout layout = nullptr;
+    vk::raii::DescriptorPool      pool   = nullptr;
+    vk::raii::DescriptorSet       set    = nullptr;
+
+    uint32_t              textureCount = 0;  // slots ever handed out
+    uint32_t              samplerCount = 0;
+    std::vector<uint32_t> freeTextures;
+
+    // Methods
+   public:
+    /**
+     * @brief The capacities are clamped to the device update after bind
+     * limits.
+     */
+    BindlessTable(const vk::raii::PhysicalDevice &physicalDevice,
+                  const vk::raii::Device         &device,
+                  uint32_t                        maxTextures = DEFAULT_MAX_TEXTURES,
+                  uint32_t                        maxSamplers = DEFAULT_MAX_SAMPLERS);
+    BindlessTable(const BindlessTable &)            = delete;
+    BindlessTable &operator=(const BindlessTable &) = delete;
+
+    /**
+     * @brief Whether the device exposes the descriptor indexing features the
+     * table relies on.
+     */
+    static bool isSupported(const vk::PhysicalDeviceVulkan12Features &features);
+
+    /**
+     * @return the index of the texture in textures[].
+     */
+    uint32_t addTexture(vk::ImageView imageView, vk::ImageLayout imageLayout);
+    void     updateTexture(uint32_t index, vk::ImageView imageView, vk::ImageLayout imageLayout);
+    void     removeTexture(uint32_t index);
+
+    /**
+     * @return the index of the sampler in samplers[].
+     */
+    uint32_t addSampler(vk::Sampler sampler);
+
+    const vk::raii::DescriptorSetLayout &getLayout() const;
+    vk::DescriptorSet                    getSet() const;
+    uint32_t                             getMaxTextures() const;
+};
+
+}  // namespace Graphics
@@ -0,0 +1,160 @@
+#include "CommandRecorder.hpp"
+
+#include <algorithm>
+
+#include "profiling.hpp"
+
+namespace Graphics {
+
+PROJECT_API CommandRecorder::CommandRecorder(const vk::raii::Device &device,
+                                             Jobs::JobSystem        &jobSystem,
+                                             uint32_t                queueFamilyIndex,
+                                             uint32_t                framesInFlight) :
+    device(device), jobSystem(jobSystem), queueFamilyIndex(queueFamilyIndex),
+    threadCount(jobSystem.getWorkerCount() + 1)
+{
+    createPools(framesInFlight);
+}
+
+PROJECT_API void CommandRecorder::setFramesInFlight(uint32_t framesInFlight)
+{
+    if (framesInFlight * threadCount != pools.size())
+    {
+        createPools(framesInFlight);
+    }
+}
+
+PROJECT_API void CommandRecorder::beginFrame(uint32_t frameSlot)
+{
+    ZoneScoped;
+    this->frameSlot = frameSlot;
+    for (uint32_t thread = 0; thread < threadCount; thread++)
+    {
+        ThreadPool &threadPool = pools[frameSlot * threadCount + thread];
+        threadPool.pool.reset();
+        threadPool.used = 0;
+    }
+}
+
+PROJECT_API std::vector<vk::CommandBuffer> CommandRecorder::record(const RenderingFormats &formats,
+                                                                   uint32_t                drawCount,
+                                                                   const RecordFunction   &recordFunction)
+{
+    ZoneScoped;
+    vk::CommandBufferInheritanceRenderingInfo inheritanceRenderingInfo{
+        .colorAttachmentCount    = static_cast<uint32_t>(formats.colorFormats.size()),
+        .pColorAttachmentFormats = formats.colorFormats.data(),
+        .depthAttachmentFormat   = formats.depthFormat,
+        .stencilAttachmentFormat = formats.stencilFormat,
+        .rasterizationSamples    = formats.samples};
+    vk::CommandBufferInheritanceInfo inheritanceInfo{.pNext = &inheritanceRenderingInfo};
+
+    // Chunks are big enough to amortize a secondary buffer, and never more
+    // than the threads.
+    uint32_t           wantedChunks = (drawCount + minDrawsPerChunk - 1) / minDrawsPerChunk;
+    uint32_t           chunkCount   = std::clamp(wantedChunks, 1u, threadCount);
+    uint32_t           chunkSize    = (drawCount + chunkCount - 1) / chunkCount;
+    std::vector<Chunk> chunks;
+    chunks.reserve(chunkCount);
+    for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+    {
+        uint32_t first = std::min(chunk * chunkSize, drawCount);
+        chunks.push_back({.first = first, .count = std::min(chunkSize, drawCount - first)});
+    }
+
+    if (chunkCount == 1)
+    {
+        recordChunk(chunks[0], recordFunction, inheritanceInfo);
+    }
+    else
+    {
+        // The caller helps through wait(), recording into its own pools.
+        Jobs::JobHandle job = jobSystem.parallelFor(
+            chunkCount,
+            1,
+            [&](uint32_t begin, uint32_t end) {
+                for (uint32_t chunk = begin; chunk < end; chunk++)
+                {
+                    recordChunk(chunks[chunk], recordFunction, inheritanceInfo);
+                }
+            },
+            {},
+            "Record commands");
+        jobSystem.wait(job);
+    }
+
+    std::vector<vk::CommandBuffer> commandBuffers;
+    commandBuffers.reserve(chunks.size());
+    for (const Chunk &chunk : chunks)
+    {
+        if (chunk.error)
+        {
+            std::rethrow_exception(chunk.error);
+        }
+        commandBuffers.push_back(chunk.commandBuffer);
+    }
+    return commandBuffers;
+}
+
+PROJECT_API uint32_t CommandRecorder::getThreadCount() const
+{
+    return threadCount;
+}
+
+PROJECT_API void CommandRecorder::setMinDrawsPerChunk(uint32_t count)
+{
+    minDrawsPerChunk = std::max(1u, count);
+}
+
+void CommandRecorder::createPools(uint32_t framesInFlight)
+{
+    pools.clear();
+    pools.resize(static_cast<size_t>(framesInFlight) * threadCount);
+    for (ThreadPool &threadPool : pools)
+    {
+        vk::CommandPoolCreateInfo poolInfo{.flags            = vk::CommandPoolCreateFlagBits::eTransient,
+                                           .queueFamilyIndex = queueFamilyIndex};
+        threadPool.pool = vk::raii::CommandPool(device, poolInfo);
+    }
+}
+
+const vk::raii::CommandBuffer &CommandRecorder::acquireCommandBuffer()
+{
+    // Workers use their own pools, the calling thread the last one.
+    uint32_t thread = Jobs::JobSystem::getWorkerIndex();
+    if (thread == Jobs::JobSystem::EXTERNAL_THREAD)
+    {
+        thread = threadCount - 1;
+    }
+    ThreadPool &threadPool = pools[frameSlot * threadCount + thread];
+    if (threadPool.used == threadPool.buffers.size())
+    {
+        vk::CommandBufferAllocateInfo allocInfo{.commandPool        = threadPool.pool,
+                                                .level              = vk::CommandBufferLevel::eSecondary,
+                                                .commandBufferCount = 1};
+        threadPool.buffers.push_back(std::move(vk::raii::CommandBuffers(device, allocInfo).front()));
+    }
+    return threadPool.buffers[threadPool.used++];
+}
+
+void CommandRecorder::recordChunk(Chunk                                  &chunk,
+                                  const RecordFunction                   &recordFunction,
+                                  const vk::CommandBufferInheritanceInfo &inheritanceInfo)
+{
+    ZoneScoped;
+    try
+    {
+        const vk::raii::CommandBuffer &commandBuffer = acquireCommandBuffer();
+        commandBuffer.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit |
+                                      vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+                             .pInheritanceInfo = &inheritanceInfo});
+        recordFunction(commandBuffer, chunk.first, chunk.count);
+        commandBuffer.end();
+        chunk.commandBuffer = *commandBuffer;
+    } catch (...)
+    {
+        chunk.error = std::current_exception();
+    }
+}
+
+}  // namespace Graphics
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <vector>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#include "Jobs/JobSystem.hpp"
+#include "config.hpp"
+
+namespace Graphics {
+
+/**
+ * @brief Attachment formats of the dynamic rendering pass the secondary
+ * command buffers are executed in.
+ */
+struct RenderingFormats
+{
+    std::vector<vk::Format> colorFormats;
+    vk::Format              depthFormat   = vk::Format::eUndefined;
+    vk::Format              stencilFormat = vk::Format::eUndefined;
+    vk::SampleCountFlagBits samples       = vk::SampleCountFlagBits::e1;
+};
+
+/**
+ * @class CommandRecorder
+ * @brief Records draws into secondary command buffers as jobs.
+ *
+ * Every job system worker, and the calling thread, owns one command pool per
+ * frame slot, so recording never locks a pool and a slot's pools are reset in
+ * one call once the frame pacer gives the slot back. record() splits a draw
+ * range into contiguous chunks recorded by parallel jobs and returns the
+ * secondary buffers in draw order, to be executed inside a rendering pass
+ * begun with vk::RenderingFlagBits::eContentsSecondaryCommandBuffers.
+ *
+ * Secondaries inherit no state: the record function binds everything it uses.
+ * record() must always be called from the same thread, the only one outside
+ * of the job system using the recorder pools.
+ */
+class PROJECT_API CommandRecorder
+{
+   public:
+    static constexpr uint32_t DEFAULT_MIN_DRAWS_PER_CHUNK = 64;
+
+    /**
+     * @brief Records the draws [first, first + count) into commandBuffer.
+     */
+    using RecordFunction =
+        std::function<void(const vk::raii::CommandBuffer &commandBuffer, uint32_t first, uint32_t count)>;
+
+    // Members
+   private:
+    struct ThreadPool
+    {
+        vk::raii::CommandPool                pool = nullptr;
+        std::vector<vk::raii::CommandBuffer> buffers;
+        size_t                               used = 0;
+    };
+
+    struct Chunk
+    {
+        uint32_t           first;
+        uint32_t           count;
+        vk::CommandBuffer  commandBuffer;
+        std::exception_ptr error;
+    };
+
+    const vk::raii::Device &device;
+    Jobs::JobSystem        &jobSystem;
+    uint32_t                queueFamilyIndex;
+    uint32_t                threadCount;  // workers + the caller
+    uint32_t                minDrawsPerChunk = DEFAULT_MIN_DRAWS_PER_CHUNK;
+    std::vector<ThreadPool> pools;  // [frameSlot * threadCount + thread]
+    uint32_t                frameSlot = 0;
+
+    // Methods
+   public:
+    CommandRecorder(const vk::raii::Device &device,
+                    Jobs::JobSystem        &jobSystem,
+                    uint32_t                queueFamilyIndex,
+                    uint32_t                framesInFlight);
+    CommandRecorder(const CommandRecorder &)            = delete;
+    CommandRecorder &operator=(const CommandRecorder &) = delete;
+
+    /**
+     * @brief Recreate the pools for a new frame slot count. No slot may be in
+     * use by the GPU.
+     */
+    void setFramesInFlight(uint32_t framesInFlight);
+
+    /**
+     * @brief Recycle the pools of the slot, its previous frame must have
+     * completed on the GPU.
+     */
+    void beginFrame(uint32_t frameSlot);
+
+    /**
+     * @brief Record drawCount draws on the job system.
+     * @return the secondary command buffers, in draw order.
+     */
+    std::vector<vk::CommandBuffer> record(const RenderingFormats &formats,
+                                          uint32_t                drawCount,
+                                          const RecordFunction   &recordFunction);
+
+    uint32_t getThreadCount() const;
+    void     setMinDrawsPerChunk(uint32_t count);
+
+   private:
+    void                           createPools(uint32_t framesInFlight);
+    const vk::raii::CommandBuffer &acquireCommandBuffer();
+    void                           recordChunk(Chunk                                  &chunk,
+                                               const RecordFunction                   &recordFunction,
+                                               const vk::CommandBufferInheritanceInfo &inheritanceInfo);
+};
+
+}  // namespace Graphics
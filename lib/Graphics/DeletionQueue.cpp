@@ -0,0 +1,64 @@
+#include "DeletionQueue.hpp"
+
+#include "profiling.hpp"
+
+namespace Graphics {
+
+PROJECT_API DeletionQueue::~DeletionQueue()
+{
+    flush();
+}
+
+PROJECT_API void DeletionQueue::collect(uint64_t completedValue)
+{
+    if (batches.empty() || batches.front().value > completedValue)
+    {
+        return;
+    }
+    ZoneScoped;
+    while (not batches.empty() && batches.front().value <= completedValue)
+    {
+        destroy(batches.front());
+        batches.pop_front();
+    }
+}
+
+PROJECT_API void DeletionQueue::flush()
+{
+    for (Batch &batch : batches)
+    {
+        destroy(batch);
+    }
+    batches.clear();
+}
+
+PROJECT_API bool DeletionQueue::isEmpty() const
+{
+    return batches.empty();
+}
+
+PROJECT_API size_t DeletionQueue::getPendingCount() const
+{
+    return pendingCount;
+}
+
+std::vector<std::unique_ptr<DeletionQueue::Resource>> &DeletionQueue::getBatch(uint64_t value)
+{
+    if (batches.empty() || batches.back().value < value)
+    {
+        batches.push_back({.value = value, .resources = {}});
+    }
+    return batches.back().resources;
+}
+
+void DeletionQueue::destroy(Batch &batch)
+{
+    // In retirement order, whatever order the vector destroys its elements in.
+    for (std::unique_ptr<Resource> &resource : batch.resources)
+    {
+        resource.reset();
+    }
+    pendingCount -= batch.resources.size();
+}
+
+}  // namespace Graphics
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "config.hpp"
+
+namespace Graphics {
+
+/**
+ * @class DeletionQueue
+ * @brief Keeps resources alive until the GPU is past their last use.
+ *
+ * A resource is moved in with the timeline value of the last submission that
+ * may use it (a FramePacer frame value, an UploadBatcher batch value...) and
+ * destroyed once the completed value reaches it. Resources retired with the same
+ * value form a batch, freed together in the order they were retired: retire a
+ * buffer before its allocation. One queue follows a single timeline.
+ *
+ * Anything movable is accepted: vk::raii handles, Memory::Allocation, or a
+ * struct grouping them.
+ */
+class PROJECT_API DeletionQueue
+{
+    // Members
+   private:
+    struct Resource
+    {
+        virtual ~Resource() = default;
+    };
+
+    template <typename T>
+    struct Holder final : Resource
+    {
+        T resource;
+
+        explicit Holder(T &&resource) : resource(std::move(resource)) {}
+    };
+
+    struct Batch
+    {
+        uint64_t                               value;
+        std::vector<std::unique_ptr<Resource>> resources;
+    };
+
+    std::deque<Batch> batches;  // by increasing value
+    size_t            pendingCount = 0;
+
+    // Methods
+   public:
+    DeletionQueue() = default;
+    DeletionQueue(const DeletionQueue &)            = delete;
+    DeletionQueue &operator=(const DeletionQueue &) = delete;
+    /**
+     * @brief Destroys what is left, the GPU must be done with it.
+     */
+    ~DeletionQueue();
+
+    /**
+     * @param value last use of the resources. A value older than the latest
+     * retired one joins the latest batch, it is only freed later.
+     */
+    template <typename... Resources>
+    void retire(uint64_t value, Resources &&...resources)
+    {
+        static_assert((not std::is_lvalue_reference_v<Resources> && ...), "resources are moved in");
+        std::vector<std::unique_ptr<Resource>> &batch = getBatch(value);
+        (batch.push_back(std::make_unique<Holder<std::remove_cvref_t<Resources>>>(std::move(resources))), ...);
+        pendingCount += sizeof...(Resources);
+    }
+
+    /**
+     * @brief Destroy the batches the GPU is done with, never waits.
+     */
+    void collect(uint64_t completedValue);
+
+    /**
+     * @brief Destroy everything, once the device is idle.
+     */
+    void flush();
+
+    bool   isEmpty() const;
+    size_t getPendingCount() const;
+
+   private:
+    std::vector<std::unique_ptr<Resource>> &getBatch(uint64_t value);
+    void                                    destroy(Batch &batch);
+};
+
+}  // namespace Graphics
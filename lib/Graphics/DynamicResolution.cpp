@@ -0,0 +1,80 @@
+#include "DynamicResolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "profiling.hpp"
+
+namespace Graphics {
+
+PROJECT_API DynamicResolution::DynamicResolution(double targetMilliseconds, float minScale, float maxScale) :
+    targetMilliseconds(targetMilliseconds),
+    minScale(std::clamp(minScale, SCALE_STEP, 1.0f)),
+    maxScale(std::clamp(maxScale, this->minScale, 1.0f)),
+    scale(this->maxScale)
+{
+    TracyPlotConfig("Render scale", tracy::PlotFormatType::Number, false, false, 0);
+}
+
+PROJECT_API void DynamicResolution::update(double gpuMilliseconds)
+{
+    if (gpuMilliseconds <= 0.0 || targetMilliseconds <= 0.0)
+    {
+        return;
+    }
+    averageMilliseconds = averageMilliseconds == 0.0 ? gpuMilliseconds
+                                                     : averageMilliseconds +
+                                                           SMOOTHING * (gpuMilliseconds - averageMilliseconds);
+    if (++samplesSinceChange < SETTLE_SAMPLES)
+    {
+        return;
+    }
+
+    bool overBudget  = averageMilliseconds > targetMilliseconds;
+    bool underBudget = averageMilliseconds < targetMilliseconds * (1.0 - HEADROOM);
+    if (not overBudget && not underBudget)
+    {
+        return;
+    }
+    float desired = scale * static_cast<float>(std::sqrt(targetMilliseconds / averageMilliseconds));
+    desired       = std::clamp(desired, scale - MAX_SCALE_CHANGE, scale + MAX_SCALE_CHANGE);
+    // Rounded down, scaling up never overshoots the budget.
+    desired       = std::floor(desired / SCALE_STEP) * SCALE_STEP;
+    desired       = std::clamp(desired, minScale, maxScale);
+    if (desired == scale)
+    {
+        return;
+    }
+
+    // The average now predicts the new scale until its frames come back.
+    averageMilliseconds *= static_cast<double>(desired * desired) / static_cast<double>(scale * scale);
+    scale                = desired;
+    samplesSinceChange   = 0;
+    TracyPlot("Render scale", static_cast<double>(scale));
+}
+
+PROJECT_API float DynamicResolution::getScale() const
+{
+    return scale;
+}
+
+PROJECT_API double DynamicResolution::getTargetMilliseconds() const
+{
+    return targetMilliseconds;
+}
+
+PROJECT_API void DynamicResolution::setTargetMilliseconds(double milliseconds)
+{
+    targetMilliseconds = milliseconds;
+    samplesSinceChange = 0;
+}
+
+PROJECT_API vk::Extent2D DynamicResolution::getRenderExtent(vk::Extent2D outputExtent) const
+{
+    auto scaled = [this](uint32_t size) {
+        return std::max(1u, static_cast<uint32_t>(std::lround(static_cast<float>(size) * scale)));
+    };
+    return {scaled(outputExtent.width), scaled(outputExtent.height)};
+}
+
+}  // namespace Graphics
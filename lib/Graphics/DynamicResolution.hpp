@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#include "config.hpp"
+
+namespace Graphics {
+
+/**
+ * @class DynamicResolution
+ * @brief Scales the render resolution to hold a GPU frame time.
+ *
+ * Fed with the GPU duration of every frame read back (GpuProfiler), it
+ * smooths them and, once the frames rendered at the current scale are the
+ * ones measured, moves the scale towards the target. GPU time is taken to
+ * follow the pixel count, the square of the scale. The scale goes down as soon
+ * as the frames are over budget but only goes back up with some headroom, so
+ * it doesn't oscillate around the target.
+ *
+ * The scale is a multiple of SCALE_STEP: the render target is allocated at
+ * the output extent and only a sub-rectangle of it is rendered, nothing is
+ * reallocated when the scale changes.
+ */
+class PROJECT_API DynamicResolution
+{
+   public:
+    static constexpr float    SCALE_STEP       = 1.0f / 32.0f;
+    static constexpr float    MAX_SCALE_CHANGE = 0.125f;  // per adjustment
+    static constexpr double   SMOOTHING        = 0.2;     // weight of a new sample in the average
+    static constexpr double   HEADROOM         = 0.15;    // under budget by this much before scaling up
+    static constexpr uint32_t SETTLE_SAMPLES   = 8;       // older timings measured the previous scale
+
+    // Members
+   private:
+    double   targetMilliseconds;
+    float    minScale;
+    float    maxScale;
+    float    scale;
+    double   averageMilliseconds = 0.0;
+    uint32_t samplesSinceChange  = 0;
+
+    // Methods
+   public:
+    /**
+     * @param minScale lowest scale of each axis, maxScale the highest one,
+     * both clamped to (0, 1].
+     */
+    explicit DynamicResolution(double targetMilliseconds, float minScale = 0.5f, float maxScale = 1.0f);
+
+    /**
+     * @brief GPU duration of the latest frame read back.
+     */
+    void update(double gpuMilliseconds);
+
+    float  getScale() const;
+    double getTargetMilliseconds() const;
+    void   setTargetMilliseconds(double milliseconds);
+
+    /**
+     * @brief Rendered part of an output of that extent, at least 1x1.
+     */
+    vk::Extent2D getRenderExtent(vk::Extent2D outputExtent) const;
+};
+
+}  // namespace Graphics
@@ -0,0 +1,107 @@
+#include "FrameArena.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "profiling.hpp"
+
+namespace Graphics {
+
+namespace {
+
+// Largest minimum offset alignment the specification allows, every region
+// starts on it whatever the device.
+constexpr vk::DeviceSize REGION_ALIGNMENT = 256;
+
+constexpr vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+}  // namespace
+
+PROJECT_API FrameArena::FrameArena(const vk::raii::PhysicalDevice   &physicalDevice,
+                                   const vk::raii::Device           &device,
+                                   Memory::Allocator                &allocator,
+                                   const Memory::UploadCapabilities &uploadCapabilities,
+                                   uint32_t                          framesInFlight,
+                                   vk::DeviceSize                    frameSize) :
+    device(device), allocator(allocator), memoryFlags(uploadCapabilities.getHostWriteFlags()),
+    frameSize(alignUp(frameSize, REGION_ALIGNMENT)), framesInFlight(framesInFlight)
+{
+    auto limits  = physicalDevice.getProperties().limits;
+    minAlignment = std::max({minAlignment,
+                             limits.minUniformBufferOffsetAlignment,
+                             limits.minStorageBufferOffsetAlignment});
+    TracyPlotConfig("Frame arena", tracy::PlotFormatType::Memory, false, true, 0);
+    createBuffer();
+}
+
+PROJECT_API void FrameArena::setFramesInFlight(uint32_t framesInFlight)
+{
+    if (framesInFlight != this->framesInFlight)
+    {
+        this->framesInFlight = framesInFlight;
+        frameSlot            = 0;
+        head                 = 0;
+        createBuffer();
+    }
+}
+
+PROJECT_API void FrameArena::beginFrame(uint32_t frameSlot)
+{
+    TracyPlot("Frame arena", static_cast<int64_t>(head.load(std::memory_order_relaxed)));
+    this->frameSlot = frameSlot;
+    head.store(0, std::memory_order_relaxed);
+}
+
+PROJECT_API FrameAllocation FrameArena::allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+    alignment = std::max(alignment, minAlignment);
+
+    vk::DeviceSize offset = head.load(std::memory_order_relaxed);
+    vk::DeviceSize aligned;
+    do
+    {
+        aligned = alignUp(offset, alignment);
+        if (aligned + size > frameSize)
+        {
+            throw std::runtime_error("frame arena is full!");
+        }
+    } while (not head.compare_exchange_weak(offset, aligned + size, std::memory_order_relaxed));
+
+    vk::DeviceSize bufferOffset = frameSlot * frameSize + aligned;
+    return {.mapped = mapped + bufferOffset, .offset = bufferOffset, .address = baseAddress + bufferOffset};
+}
+
+PROJECT_API vk::Buffer FrameArena::getBuffer() const
+{
+    return *buffer;
+}
+
+PROJECT_API vk::DeviceSize FrameArena::getFrameSize() const
+{
+    return frameSize;
+}
+
+PROJECT_API vk::DeviceSize FrameArena::getUsedSize() const
+{
+    return head.load(std::memory_order_relaxed);
+}
+
+void FrameArena::createBuffer()
+{
+    ZoneScoped;
+    allocation.reset();
+    vk::BufferCreateInfo bufferInfo{.size        = frameSize * framesInFlight,
+                                    .usage       = vk::BufferUsageFlagBits::eUniformBuffer |
+                                                   vk::BufferUsageFlagBits::eStorageBuffer |
+                                                   vk::BufferUsageFlagBits::eShaderDeviceAddress,
+                                    .sharingMode = vk::SharingMode::eExclusive};
+    buffer      = vk::raii::Buffer(device, bufferInfo);
+    allocation  = allocator.allocate(buffer, memoryFlags);
+    mapped      = static_cast<std::byte *>(allocation.getMappedData());
+    baseAddress = device.getBufferAddress({.buffer = buffer});
+}
+
+}  // namespace Graphics
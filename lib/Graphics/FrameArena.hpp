@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#include "Memory/Allocator.hpp"
+#include "Memory/UploadPath.hpp"
+#include "config.hpp"
+
+namespace Graphics {
+
+/**
+ * @brief Slice of the frame arena, valid until the frame retires.
+ */
+struct FrameAllocation
+{
+    void             *mapped  = nullptr;
+    vk::DeviceSize    offset  = 0;  // in getBuffer(), usable as a dynamic offset
+    vk::DeviceAddress address = 0;
+};
+
+/**
+ * @class FrameArena
+ * @brief Per-frame bump allocator for transient GPU data (per-object
+ * transforms, material parameters, frame uniforms).
+ *
+ * One persistently mapped buffer is split into one region per frame slot.
+ * allocate() only bumps an atomic offset in the region of the current slot,
+ * so any thread may allocate, and beginFrame() rewinds it: it must be called
+ * once the frame pacer gave the slot back, i.e. when the timeline value of the
+ * frame that last used it retired. Nothing is ever freed individually.
+ *
+ * Slices are reached either through their device address, typically passed in
+ * push constants, or through getBuffer() with the slice offset as the dynamic
+ * offset of a eUniformBufferDynamic / eStorageBufferDynamic descriptor.
+ * Per-draw data small enough for push constants should stay there.
+ */
+class PROJECT_API FrameArena
+{
+   public:
+    static constexpr vk::DeviceSize DEFAULT_FRAME_SIZE = 4ull * 1024 * 1024;
+
+    // Members
+   private:
+    const vk::raii::Device     &device;
+    Memory::Allocator          &allocator;
+    vk::MemoryPropertyFlags     memoryFlags;
+    vk::DeviceSize              frameSize;
+    vk::DeviceSize              minAlignment   = 16;
+    vk::raii::Buffer            buffer         = nullptr;
+    Memory::Allocation          allocation;
+    std::byte                  *mapped         = nullptr;
+    vk::DeviceAddress           baseAddress    = 0;
+    uint32_t                    framesInFlight = 0;
+    uint32_t                    frameSlot      = 0;
+    std::atomic<vk::DeviceSize> head           = 0;  // in the region of frameSlot
+
+    // Methods
+   public:
+    FrameArena(const vk::raii::PhysicalDevice   &physicalDevice,
+               const vk::raii::Device           &device,
+               Memory::Allocator                &allocator,
+               const Memory::UploadCapabilities &uploadCapabilities,
+               uint32_t                          framesInFlight,
+               vk::DeviceSize                    frameSize = DEFAULT_FRAME_SIZE);
+    FrameArena(const FrameArena &)            = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    /**
+     * @brief Recreate the buffer for a new slot count. No slot may be in use
+     * by the GPU.
+     */
+    void setFramesInFlight(uint32_t framesInFlight);
+
+    /**
+     * @brief Rewind the region of the slot, its previous frame must have
+     * completed on the GPU.
+     */
+    void beginFrame(uint32_t frameSlot);
+
+    /**
+     * @brief Thread safe. The alignment is raised to the device minimum
+     * uniform and storage buffer offset alignments.
+     */
+    FrameAllocation allocate(vk::DeviceSize size, vk::DeviceSize alignment = 0);
+
+    template <typename T>
+    FrameAllocation push(const T &value)
+    {
+        FrameAllocation slice = allocate(sizeof(T), alignof(T));
+        std::memcpy(slice.mapped, &value, sizeof(T));
+        return slice;
+    }
+
+    vk::Buffer     getBuffer() const;
+    vk::DeviceSize getFrameSize() const;
+    vk::DeviceSize getUsedSize() const;
+
+   private:
+    void createBuffer();
+};
+
+}  // namespace Graphics
@@ -0,0 +1,510 @@
+#include "FrameGraph.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+#include "GpuProfiler.hpp"
+#include "profiling.hpp"
+
+namespace Graphics {
+
+namespace {
+
+constexpr vk::AccessFlags2 WRITE_ACCESS =
+    vk::AccessFlagBits2::eShaderWrite | vk::AccessFlagBits2::eShaderStorageWrite |
+    vk::AccessFlagBits2::eColorAttachmentWrite | vk::AccessFlagBits2::eDepthStencilAttachmentWrite |
+    vk::AccessFlagBits2::eTransferWrite | vk::AccessFlagBits2::eHostWrite | vk::AccessFlagBits2::eMemoryWrite;
+
+bool overlaps(uint32_t firstA, uint32_t lastA, uint32_t firstB, uint32_t lastB)
+{
+    return firstA <= lastB && firstB <= lastA;
+}
+
+vk::ImageMemoryBarrier2 makeBarrier(vk::Image               image,
+                                    vk::ImageAspectFlags    aspect,
+                                    vk::ImageLayout         oldLayout,
+                                    vk::PipelineStageFlags2 srcStages,
+                                    vk::AccessFlags2        srcAccess,
+                                    const ImageState       &dst)
+{
+    return {.srcStageMask        = srcStages,
+            .srcAccessMask       = srcAccess,
+            .dstStageMask        = dst.stages,
+            .dstAccessMask       = dst.access,
+            .oldLayout           = oldLayout,
+            .newLayout           = dst.layout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = image,
+            .subresourceRange    = {.aspectMask     = aspect,
+                                    .baseMipLevel   = 0,
+                                    .levelCount     = vk::RemainingMipLevels,
+                                    .baseArrayLayer = 0,
+                                    .layerCount     = vk::RemainingArrayLayers}};
+}
+
+}  // namespace
+
+PROJECT_API FrameGraph::PassBuilder::PassBuilder(FrameGraph &graph, uint32_t pass) : graph(graph), pass(pass) {}
+
+PROJECT_API FrameGraph::PassBuilder &FrameGraph::PassBuilder::read(ImageId image, ImageAccess access)
+{
+    graph.passes[pass].uses.push_back({.image = image, .access = access, .write = false});
+    return *this;
+}
+
+PROJECT_API FrameGraph::PassBuilder &FrameGraph::PassBuilder::write(ImageId image, ImageAccess access)
+{
+    graph.passes[pass].uses.push_back({.image = image, .access = access, .write = true});
+    return *this;
+}
+
+PROJECT_API FrameGraph::PassBuilder &FrameGraph::PassBuilder::setSideEffects()
+{
+    graph.passes[pass].sideEffects = true;
+    return *this;
+}
+
+PROJECT_API FrameGraph::FrameGraph(const vk::raii::Device &device,
+                                   Memory::Allocator      &allocator,
+                                   uint32_t                framesInFlight) :
+    device(device), allocator(allocator), slots(framesInFlight)
+{
+}
+
+PROJECT_API void FrameGraph::setFramesInFlight(uint32_t framesInFlight)
+{
+    slots.clear();
+    slots.resize(framesInFlight);
+}
+
+PROJECT_API void FrameGraph::reset()
+{
+    passes.clear();
+    images.clear();
+}
+
+PROJECT_API FrameGraph::ImageId FrameGraph::importImage(const std::string   &name,
+                                                        vk::Image            image,
+                                                        vk::ImageView        view,
+                                                        vk::ImageAspectFlags aspect,
+                                                        const ImageState    &initialState,
+                                                        const ImageState    &finalState)
+{
+    Image &imported       = images.emplace_back();
+    imported.name         = name;
+    imported.image        = image;
+    imported.view         = view;
+    imported.initialState = initialState;
+    imported.finalState   = finalState;
+    imported.aspect       = aspect;
+    return static_cast<ImageId>(images.size() - 1);
+}
+
+PROJECT_API FrameGraph::ImageId FrameGraph::createImage(const std::string &name, const TransientImageDesc &desc)
+{
+    Image &transient    = images.emplace_back();
+    transient.name      = name;
+    transient.transient = true;
+    transient.desc      = desc;
+    transient.aspect    = desc.aspect;
+    return static_cast<ImageId>(images.size() - 1);
+}
+
+PROJECT_API FrameGraph::PassBuilder FrameGraph::addPass(const std::string &name, Execute execute)
+{
+    Pass &pass   = passes.emplace_back();
+    pass.name    = name;
+    pass.execute = std::move(execute);
+    return PassBuilder(*this, static_cast<uint32_t>(passes.size() - 1));
+}
+
+PROJECT_API void FrameGraph::execute(const vk::raii::CommandBuffer &commandBuffer,
+                                     uint32_t                       slot,
+                                     GpuProfiler                   *profiler)
+{
+    ZoneScoped;
+    if (slot >= slots.size())
+    {
+        throw std::runtime_error("frame graph slot out of range!");
+    }
+    currentSlot = slot;
+
+    cull();
+    computeLifetimes();
+    placeTransients(slots[slot]);
+
+    for (Image &image : images)
+    {
+        if (not image.transient)
+        {
+            image.layout      = image.initialState.layout;
+            image.writeStages = image.initialState.stages;
+            image.writeAccess = image.initialState.access;
+        }
+    }
+
+    for (uint32_t i = 0; i < passes.size(); i++)
+    {
+        if (passes[i].culled)
+        {
+            continue;
+        }
+        // The barriers are left out of the scope, they belong to no pass.
+        recordBarriers(commandBuffer, i);
+        ZoneScopedN("Pass");
+        ZoneName(passes[i].name.data(), passes[i].name.size());
+        if (profiler)
+        {
+            profiler->beginScope(commandBuffer, passes[i].name);
+        }
+        passes[i].execute(commandBuffer);
+        if (profiler)
+        {
+            profiler->endScope(commandBuffer);
+        }
+    }
+    recordFinalBarriers(commandBuffer);
+}
+
+PROJECT_API vk::Image FrameGraph::getImage(ImageId image) const
+{
+    const Image &entry = images[image];
+    return entry.transient ? *slots[currentSlot].images[entry.physical].image : entry.image;
+}
+
+PROJECT_API vk::ImageView FrameGraph::getImageView(ImageId image) const
+{
+    const Image &entry = images[image];
+    return entry.transient ? *slots[currentSlot].images[entry.physical].view : entry.view;
+}
+
+void FrameGraph::cull()
+{
+    // Backwards from the passes with visible results, what they read is
+    // needed in turn.
+    std::vector<bool> needed(images.size(), false);
+    for (uint32_t i = static_cast<uint32_t>(passes.size()); i-- > 0;)
+    {
+        Pass &pass = passes[i];
+        bool  kept = pass.sideEffects || std::ranges::any_of(pass.uses, [&](const Use &use) {
+                        return use.write && (not images[use.image].transient || needed[use.image]);
+                    });
+
+        pass.culled = not kept;
+        if (kept)
+        {
+            for (const Use &use : pass.uses)
+            {
+                if (not use.write)
+                {
+                    needed[use.image] = true;
+                }
+            }
+        }
+    }
+}
+
+void FrameGraph::computeLifetimes()
+{
+    for (uint32_t i = 0; i < passes.size(); i++)
+    {
+        if (passes[i].culled)
+        {
+            continue;
+        }
+        for (const Use &use : passes[i].uses)
+        {
+            Image &image = images[use.image];
+            if (image.transient)
+            {
+                image.usage |= getUsage(use.access);
+                image.firstPass = std::min(image.firstPass, i);
+                image.lastPass  = std::max(image.lastPass, i);
+            }
+        }
+    }
+}
+
+void FrameGraph::placeTransients(Slot &slot)
+{
+    ZoneScoped;
+    std::vector<ImageId> used;
+    for (ImageId id = 0; id < images.size(); id++)
+    {
+        if (images[id].transient && images[id].firstPass != UINT32_MAX)
+        {
+            used.push_back(id);
+        }
+    }
+
+    // Same shape as the last frame of the slot, its images fit as they are.
+    bool reusable = used.size() == slot.images.size() &&
+                    std::ranges::equal(used, slot.images, [&](ImageId id, const PhysicalImage &physical) {
+                        const Image &image = images[id];
+                        return image.desc == physical.desc && image.usage == physical.usage &&
+                               image.firstPass == physical.firstPass && image.lastPass == physical.lastPass;
+                    });
+    if (not reusable)
+    {
+        slot.images.clear();
+        slot.regions.clear();
+
+        std::vector<vk::MemoryRequirements> requirements;
+        for (ImageId id : used)
+        {
+            const Image   &image    = images[id];
+            PhysicalImage &physical = slot.images.emplace_back();
+            physical.desc           = image.desc;
+            physical.usage          = image.usage;
+            physical.firstPass      = image.firstPass;
+            physical.lastPass       = image.lastPass;
+
+            vk::ImageCreateInfo imageInfo{.imageType     = vk::ImageType::e2D,
+                                          .format        = image.desc.format,
+                                          .extent        = {image.desc.extent.width, image.desc.extent.height, 1},
+                                          .mipLevels     = 1,
+                                          .arrayLayers   = 1,
+                                          .samples       = vk::SampleCountFlagBits::e1,
+                                          .tiling        = vk::ImageTiling::eOptimal,
+                                          .usage         = image.usage,
+                                          .sharingMode   = vk::SharingMode::eExclusive,
+                                          .initialLayout = vk::ImageLayout::eUndefined};
+            physical.image = vk::raii::Image(device, imageInfo);
+            requirements.push_back(physical.image.getMemoryRequirements());
+        }
+
+        // Largest first, so a region is as large as the first image placed
+        // in it and the smaller ones reuse it.
+        std::vector<uint32_t> order(slot.images.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::ranges::stable_sort(order, std::ranges::greater{}, [&](uint32_t index) {
+            return requirements[index].size;
+        });
+        for (uint32_t index : order)
+        {
+            const vk::MemoryRequirements &requirement = requirements[index];
+            PhysicalImage                &physical    = slot.images[index];
+
+            auto fits = [&](const Region &region) {
+                return region.size >= requirement.size &&
+                       (requirement.memoryTypeBits & (1u << region.memory.getMemoryTypeIndex())) != 0 &&
+                       region.memory.getOffset() % requirement.alignment == 0 &&
+                       std::ranges::none_of(region.images, [&](uint32_t other) {
+                           return overlaps(physical.firstPass,
+                                           physical.lastPass,
+                                           slot.images[other].firstPass,
+                                           slot.images[other].lastPass);
+                       });
+            };
+            auto found = std::ranges::find_if(slot.regions, fits);
+            if (found == slot.regions.end())
+            {
+                Region &region = slot.regions.emplace_back();
+                region.memory  = allocator.allocate(requirement,
+                                                   vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                                   Memory::ResourceKind::eOptimal,
+                                                   Memory::AllocationStrategy::eDefault);
+                region.size    = requirement.size;
+                found          = std::prev(slot.regions.end());
+            }
+            found->images.push_back(index);
+            physical.region = static_cast<uint32_t>(std::distance(slot.regions.begin(), found));
+            physical.image.bindMemory(found->memory.getMemory(), found->memory.getOffset());
+
+            vk::ImageViewCreateInfo viewInfo{
+                .image            = *physical.image,
+                .viewType         = vk::ImageViewType::e2D,
+                .format           = physical.desc.format,
+                .subresourceRange = {.aspectMask = physical.desc.aspect, .levelCount = 1, .layerCount = 1}};
+            physical.view = vk::raii::ImageView(device, viewInfo);
+        }
+        for (Region &region : slot.regions)
+        {
+            std::ranges::sort(region.images, {}, [&](uint32_t index) { return slot.images[index].firstPass; });
+        }
+    }
+
+    for (uint32_t index = 0; index < used.size(); index++)
+    {
+        images[used[index]].physical = index;
+    }
+    for (const Region &region : slot.regions)
+    {
+        for (size_t i = 1; i < region.images.size(); i++)
+        {
+            images[used[region.images[i]]].aliased = used[region.images[i - 1]];
+        }
+    }
+}
+
+void FrameGraph::recordBarriers(const vk::raii::CommandBuffer &commandBuffer, uint32_t pass)
+{
+    // The uses of an image by a pass are merged, they share its layout.
+    std::vector<std::pair<ImageId, ImageState>> wanted;
+    for (const Use &use : passes[pass].uses)
+    {
+        ImageState state = getState(use.access);
+        auto       found = std::ranges::find(wanted, use.image, &std::pair<ImageId, ImageState>::first);
+        if (found == wanted.end())
+        {
+            wanted.emplace_back(use.image, state);
+            continue;
+        }
+        if (found->second.layout != state.layout)
+        {
+            throw std::runtime_error("image used with two layouts by the same pass!");
+        }
+        found->second.stages |= state.stages;
+        found->second.access |= state.access;
+    }
+
+    std::vector<vk::ImageMemoryBarrier2> barriers;
+    for (const auto &[id, want] : wanted)
+    {
+        Image &image = images[id];
+        if (image.transient && image.firstPass == pass)
+        {
+            // The content is discarded, only the previous user of the memory
+            // is waited for.
+            image.layout = vk::ImageLayout::eUndefined;
+            if (image.aliased != UINT32_MAX)
+            {
+                const Image &previous = images[image.aliased];
+                image.writeStages     = previous.writeStages | previous.readStages;
+                image.writeAccess     = previous.writeAccess;
+            }
+        }
+
+        if (image.layout != want.layout || isWrite(want.access))
+        {
+            // Waits for the reads since the last write as well.
+            barriers.push_back(makeBarrier(getImage(id),
+                                           image.aspect,
+                                           image.layout,
+                                           image.writeStages | image.readStages,
+                                           image.writeAccess,
+                                           want));
+            image.layout      = want.layout;
+            image.writeStages = want.stages;
+            image.writeAccess = want.access & WRITE_ACCESS;
+            image.readStages  = isWrite(want.access) ? vk::PipelineStageFlags2{} : want.stages;
+            image.readAccess  = isWrite(want.access) ? vk::AccessFlags2{} : want.access;
+        }
+        else if ((want.stages & ~image.readStages) || (want.access & ~image.readAccess))
+        {
+            // The last write isn't visible to these reads yet.
+            barriers.push_back(makeBarrier(
+                getImage(id), image.aspect, image.layout, image.writeStages, image.writeAccess, want));
+            image.readStages |= want.stages;
+            image.readAccess |= want.access;
+        }
+    }
+
+    if (not barriers.empty())
+    {
+        commandBuffer.pipelineBarrier2({.imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size()),
+                                        .pImageMemoryBarriers    = barriers.data()});
+    }
+}
+
+void FrameGraph::recordFinalBarriers(const vk::raii::CommandBuffer &commandBuffer)
+{
+    std::vector<vk::ImageMemoryBarrier2> barriers;
+    for (const Image &image : images)
+    {
+        if (not image.transient && (image.layout != image.finalState.layout || image.writeAccess))
+        {
+            barriers.push_back(makeBarrier(image.image,
+                                           image.aspect,
+                                           image.layout,
+                                           image.writeStages | image.readStages,
+                                           image.writeAccess,
+                                           image.finalState));
+        }
+    }
+    if (not barriers.empty())
+    {
+        commandBuffer.pipelineBarrier2({.imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size()),
+                                        .pImageMemoryBarriers    = barriers.data()});
+    }
+}
+
+ImageState FrameGraph::getState(ImageAccess access)
+{
+    constexpr vk::PipelineStageFlags2 fragmentTests =
+        vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests;
+    switch (access)
+    {
+        case ImageAccess::eColorAttachment:
+            return {vk::ImageLayout::eColorAttachmentOptimal,
+                    vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                    vk::AccessFlagBits2::eColorAttachmentRead | vk::AccessFlagBits2::eColorAttachmentWrite};
+        case ImageAccess::eDepthAttachment:
+            return {vk::ImageLayout::eDepthAttachmentOptimal,
+                    fragmentTests,
+                    vk::AccessFlagBits2::eDepthStencilAttachmentRead |
+                        vk::AccessFlagBits2::eDepthStencilAttachmentWrite};
+        case ImageAccess::eDepthRead:
+            return {vk::ImageLayout::eDepthReadOnlyOptimal,
+                    fragmentTests,
+                    vk::AccessFlagBits2::eDepthStencilAttachmentRead};
+        case ImageAccess::eFragmentSampled:
+            return {vk::ImageLayout::eShaderReadOnlyOptimal,
+                    vk::PipelineStageFlagBits2::eFragmentShader,
+                    vk::AccessFlagBits2::eShaderSampledRead};
+        case ImageAccess::eComputeSampled:
+            return {vk::ImageLayout::eShaderReadOnlyOptimal,
+                    vk::PipelineStageFlagBits2::eComputeShader,
+                    vk::AccessFlagBits2::eShaderSampledRead};
+        case ImageAccess::eComputeStorageRead:
+            return {vk::ImageLayout::eGeneral,
+                    vk::PipelineStageFlagBits2::eComputeShader,
+                    vk::AccessFlagBits2::eShaderStorageRead};
+        case ImageAccess::eComputeStorageWrite:
+            return {vk::ImageLayout::eGeneral,
+                    vk::PipelineStageFlagBits2::eComputeShader,
+                    vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite};
+        case ImageAccess::eTransferSrc:
+            return {vk::ImageLayout::eTransferSrcOptimal,
+                    vk::PipelineStageFlagBits2::eTransfer,
+                    vk::AccessFlagBits2::eTransferRead};
+        case ImageAccess::eTransferDst:
+            return {vk::ImageLayout::eTransferDstOptimal,
+                    vk::PipelineStageFlagBits2::eTransfer,
+                    vk::AccessFlagBits2::eTransferWrite};
+    }
+    throw std::runtime_error("unknown image access!");
+}
+
+vk::ImageUsageFlags FrameGraph::getUsage(ImageAccess access)
+{
+    switch (access)
+    {
+        case ImageAccess::eColorAttachment:
+            return vk::ImageUsageFlagBits::eColorAttachment;
+        case ImageAccess::eDepthAttachment:
+        case ImageAccess::eDepthRead:
+            return vk::ImageUsageFlagBits::eDepthStencilAttachment;
+        case ImageAccess::eFragmentSampled:
+        case ImageAccess::eComputeSampled:
+            return vk::ImageUsageFlagBits::eSampled;
+        case ImageAccess::eComputeStorageRead:
+        case ImageAccess::eComputeStorageWrite:
+            return vk::ImageUsageFlagBits::eStorage;
+        case ImageAccess::eTransferSrc:
+            return vk::ImageUsageFlagBits::eTransferSrc;
+        case ImageAccess::eTransferDst:
+            return vk::ImageUsageFlagBits::eTransferDst;
+    }
+    throw std::runtime_error("unknown image access!");
+}
+
+bool FrameGraph::isWrite(vk::AccessFlags2 access)
+{
+    return static_cast<bool>(access & WRITE_ACCESS);
+}
+
+}  // namespace Graphics
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#include "Memory/Allocator.hpp"
+#include "config.hpp"
+
+namespace Graphics {
+
+class GpuProfiler;
+
+/**
+ * @brief How a pass uses an image, each maps to a layout, stages and accesses.
+ */
+enum class ImageAccess : uint8_t
+{
+    eColorAttachment,      // written, loaded too with AttachmentLoadOp::eLoad
+    eDepthAttachment,      // tested and written
+    eDepthRead,            // tested only
+    eFragmentSampled,      // sampled by the fragment shader
+    eComputeSampled,       // sampled by a compute shader
+    eComputeStorageRead,   // storage image, compute
+    eComputeStorageWrite,  // storage image, compute
+    eTransferSrc,
+    eTransferDst,
+};
+
+/**
+ * @brief Synchronization state of an image outside of the graph.
+ */
+struct ImageState
+{
+    vk::ImageLayout         layout = vk::ImageLayout::eUndefined;
+    vk::PipelineStageFlags2 stages;
+    vk::AccessFlags2        access;
+};
+
+/**
+ * @brief Image owned by the graph, alive for the frame only.
+ */
+struct TransientImageDesc
+{
+    vk::Format           format = vk::Format::eUndefined;
+    vk::Extent2D         extent;
+    vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor;
+
+    bool operator==(const TransientImageDesc &) const = default;
+};
+
+/**
+ * @class FrameGraph
+ * @brief Records the passes of a frame from the images they declare to read
+ * and write, with the barriers worked out instead of written by hand.
+ *
+ * The graph is declared again every frame, then execute():
+ * - culls the passes whose results nothing uses: a pass is kept when it
+ *   writes an imported image, has side effects, or writes an image a kept
+ *   pass reads;
+ * - records before each pass one barrier batch, holding only the hazards
+ *   (read after write, write after read or write, layout change): reads of
+ *   the same layout don't wait for each other;
+ * - places transient images in memory shared by those whose lifetimes don't
+ *   overlap, from their first to their last kept pass.
+ *
+ * Transients are per frame in flight, so frames never wait on each other for
+ * a depth buffer, and stay allocated while the graph keeps the same shape:
+ * only a new description, usage or lifetime reallocates them. Their content
+ * is undefined at the first use of the frame.
+ *
+ * Images only: buffers are still synchronized by their owners (GpuCuller,
+ * UploadBatcher). Given a GpuProfiler, every kept pass is a GPU scope.
+ */
+class PROJECT_API FrameGraph
+{
+   public:
+    using ImageId = uint32_t;
+    using Execute = std::function<void(const vk::raii::CommandBuffer &commandBuffer)>;
+
+    /**
+     * @brief Declares the accesses of the pass added last.
+     */
+    class PROJECT_API PassBuilder
+    {
+        friend class FrameGraph;
+
+        // Members
+       private:
+        FrameGraph &graph;
+        uint32_t    pass;
+
+        // Methods
+       public:
+        PassBuilder &read(ImageId image, ImageAccess access);
+        PassBuilder &write(ImageId image, ImageAccess access);
+        /**
+         * @brief Never culled, e.g. it writes a buffer the graph doesn't see.
+         */
+        PassBuilder &setSideEffects();
+
+       private:
+        PassBuilder(FrameGraph &graph, uint32_t pass);
+    };
+
+    // Members
+   private:
+    struct Use
+    {
+        ImageId     image;
+        ImageAccess access;
+        bool        write;
+    };
+
+    struct Pass
+    {
+        std::string      name;
+        Execute          execute;
+        std::vector<Use> uses;
+        bool             sideEffects = false;
+        bool             culled      = false;
+    };
+
+    struct Image
+    {
+        std::string name;
+        // imported
+        vk::Image     image;
+        vk::ImageView view;
+        ImageState    initialState;
+        ImageState    finalState;
+        // transient
+        bool                transient = false;
+        TransientImageDesc  desc;
+        vk::ImageUsageFlags usage;
+        uint32_t            firstPass = UINT32_MAX;
+        uint32_t            lastPass  = 0;
+        uint32_t            physical  = UINT32_MAX;  // in Slot::images
+        ImageId             aliased   = UINT32_MAX;  // previous user of its memory in the frame
+
+        // While recording: what the last barrier waited for, and which of
+        // the following reads have seen the last write.
+        vk::ImageAspectFlags    aspect;
+        vk::ImageLayout         layout = vk::ImageLayout::eUndefined;
+        vk::PipelineStageFlags2 writeStages;
+        vk::AccessFlags2        writeAccess;
+        vk::PipelineStageFlags2 readStages;
+        vk::AccessFlags2        readAccess;
+    };
+
+    /**
+     * @brief Memory shared by transients whose lifetimes don't overlap.
+     */
+    struct Region
+    {
+        Memory::Allocation    memory;
+        vk::DeviceSize        size;
+        std::vector<uint32_t> images;  // in Slot::images, users sorted by first pass
+    };
+
+    struct PhysicalImage
+    {
+        TransientImageDesc  desc;
+        vk::ImageUsageFlags usage;
+        uint32_t            firstPass;
+        uint32_t            lastPass;
+        uint32_t            region;
+        vk::raii::Image     image = nullptr;
+        vk::raii::ImageView view  = nullptr;
+    };
+
+    /**
+     * @brief Transients of a frame in flight, kept while the graph has the
+     * same shape. Regions are declared first, they outlive their images.
+     */
+    struct Slot
+    {
+        std::vector<Region>        regions;
+        std::vector<PhysicalImage> images;
+    };
+
+    const vk::raii::Device &device;
+    Memory::Allocator      &allocator;
+    std::vector<Pass>       passes;
+    std::vector<Image>      images;
+    std::vector<Slot>       slots;
+    uint32_t                currentSlot = 0;  // of the frame being executed
+
+    // Methods
+   public:
+    FrameGraph(const vk::raii::Device &device, Memory::Allocator &allocator, uint32_t framesInFlight);
+    FrameGraph(const FrameGraph &)            = delete;
+    FrameGraph &operator=(const FrameGraph &) = delete;
+
+    /**
+     * @brief Release the transients of every slot, none of them may be in
+     * use by the GPU.
+     */
+    void setFramesInFlight(uint32_t framesInFlight);
+
+    /**
+     * @brief Start the declaration of a new frame.
+     */
+    void reset();
+
+    /**
+     * @brief Image living outside of the graph, e.g. a swapchain image: it is
+     * in initialState when the frame starts and left in finalState.
+     */
+    ImageId importImage(const std::string   &name,
+                        vk::Image            image,
+                        vk::ImageView        view,
+                        vk::ImageAspectFlags aspect,
+                        const ImageState    &initialState,
+                        const ImageState    &finalState);
+
+    ImageId createImage(const std::string &name, const TransientImageDesc &desc);
+
+    /**
+     * @brief Passes are recorded in the order they are added.
+     */
+    PassBuilder addPass(const std::string &name, Execute execute);
+
+    /**
+     * @brief Cull, place the transients of the slot then record the kept
+     * passes and their barriers. The previous frame of the slot must be
+     * completed.
+     */
+    void execute(const vk::raii::CommandBuffer &commandBuffer, uint32_t slot, GpuProfiler *profiler = nullptr);
+
+    /**
+     * @brief Valid in the execute callbacks of the passes using the image.
+     */
+    vk::Image     getImage(ImageId image) const;
+    vk::ImageView getImageView(ImageId image) const;
+
+   private:
+    void cull();
+    void computeLifetimes();
+    void placeTransients(Slot &slot);
+    void recordBarriers(const vk::raii::CommandBuffer &commandBuffer, uint32_t pass);
+    void recordFinalBarriers(const vk::raii::CommandBuffer &commandBuffer);
+
+    static ImageState          getState(ImageAccess access);
+    static vk::ImageUsageFlags getUsage(ImageAccess access);
+    static bool                isWrite(vk::AccessFlags2 access);
+};
+
+}  // namespace Graphics
@@ -0,0 +1,91 @@
+#include "FramePacer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "profiling.hpp"
+
+namespace Graphics {
+
+PROJECT_API FramePacer::FramePacer(const vk::raii::Device &device, uint32_t framesInFlight) :
+    device(device), slotValues(std::clamp(framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT), 0)
+{
+    vk::StructureChain<vk::SemaphoreCreateInfo, vk::SemaphoreTypeCreateInfo> semaphoreChain = {
+        {},
+        {.semaphoreType = vk::SemaphoreType::eTimeline, .initialValue = 0}};
+    semaphore = vk::raii::Semaphore(device, semaphoreChain.get<vk::SemaphoreCreateInfo>());
+    TracyPlotConfig("Frames in flight", tracy::PlotFormatType::Number, true, false, 0);
+}
+
+PROJECT_API uint32_t FramePacer::beginFrame()
+{
+    ZoneScoped;
+    // The slot is free once the frame framesInFlight frames back has retired.
+    wait(slotValues[frameSlot]);
+    TracyPlot("Frames in flight", static_cast<int64_t>(frameValue - getCompletedValue()));
+    return frameSlot;
+}
+
+PROJECT_API void FramePacer::endFrame()
+{
+    slotValues[frameSlot] = ++frameValue;
+    frameSlot             = (frameSlot + 1) % static_cast<uint32_t>(slotValues.size());
+}
+
+PROJECT_API void FramePacer::setFramesInFlight(uint32_t framesInFlight)
+{
+    framesInFlight = std::clamp(framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+    if (framesInFlight == slotValues.size())
+    {
+        return;
+    }
+    waitIdle();
+    slotValues.assign(framesInFlight, frameValue);
+    frameSlot = 0;
+}
+
+PROJECT_API uint32_t FramePacer::getFramesInFlight() const
+{
+    return static_cast<uint32_t>(slotValues.size());
+}
+
+PROJECT_API uint32_t FramePacer::getFrameSlot() const
+{
+    return frameSlot;
+}
+
+PROJECT_API uint64_t FramePacer::getFrameValue() const
+{
+    return frameValue + 1;
+}
+
+PROJECT_API uint64_t FramePacer::getCompletedValue() const
+{
+    return semaphore.getCounterValue();
+}
+
+PROJECT_API void FramePacer::wait(uint64_t value) const
+{
+    if (value == 0)
+    {
+        return;
+    }
+    vk::SemaphoreWaitInfo waitInfo{.semaphoreCount = 1, .pSemaphores = &*semaphore, .pValues = &value};
+    if (device.waitSemaphores(waitInfo, UINT64_MAX) != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("failed to wait for frame semaphore!");
+    }
+}
+
+PROJECT_API void FramePacer::waitIdle() const
+{
+    ZoneScoped;
+    wait(frameValue);
+}
+
+PROJECT_API vk::Semaphore FramePacer::getSemaphore() const
+{
+    return *semaphore;
+}
+
+}  // namespace Graphics
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#include "config.hpp"
+
+namespace Graphics {
+
+/**
+ * @class FramePacer
+ * @brief Paces the CPU against the GPU with one timeline semaphore.
+ *
+ * Every frame submission signals the next value of the timeline. Per-frame
+ * resources live in getFramesInFlight() slots and a slot is reused once the
+ * value of the frame that last used it has been reached, so the CPU runs at
+ * most getFramesInFlight() frames ahead. The same counter tells when anything
+ * used by a frame can be released: getFrameValue() at record time, then
+ * getCompletedValue() to know it is done.
+ *
+ * Fewer frames in flight lower latency, more of them absorb CPU spikes.
+ */
+class PROJECT_API FramePacer
+{
+   public:
+    static constexpr uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT     = 8;
+
+    // Members
+   private:
+    const vk::raii::Device &device;
+    vk::raii::Semaphore     semaphore  = nullptr;
+    uint64_t                frameValue = 0;  // last value handed to a submission
+    uint32_t                frameSlot  = 0;
+    std::vector<uint64_t>   slotValues;  // last value signaled by each slot
+
+    // Methods
+   public:
+    FramePacer(const vk::raii::Device &device, uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT);
+    FramePacer(const FramePacer &)            = delete;
+    FramePacer &operator=(const FramePacer &) = delete;
+
+    /**
+     * @brief Wait until the next slot is free on the GPU.
+     * @return the slot index of the frame, in [0, getFramesInFlight()).
+     */
+    uint32_t beginFrame();
+
+    /**
+     * @brief Mark the frame as submitted, its submission must signal
+     * getSemaphore() to getFrameValue().
+     */
+    void endFrame();
+
+    /**
+     * @brief Wait for every submitted frame, then change the slot count. The
+     * caller resizes its per-frame resources to match.
+     */
+    void setFramesInFlight(uint32_t framesInFlight);
+
+    uint32_t getFramesInFlight() const;
+    uint32_t getFrameSlot() const;
+    uint64_t getFrameValue() const;
+    uint64_t getCompletedValue() const;
+
+    void          wait(uint64_t value) const;
+    void          waitIdle() const;
+    vk::Semaphore getSemaphore() const;
+};
+
+}  // namespace Graphics
@@ -0,0 +1,283 @@
+#include "FrameTimings.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "profiling.hpp"
+
+namespace Graphics {
+
+namespace {
+
+using CpuCounter = std::pair<const char *, double CpuFrameTimings::*>;
+
+constexpr std::array<CpuCounter, 6> CPU_COUNTERS = {{
+    {"fence_wait", &CpuFrameTimings::fenceWait},
+    {"acquire_wait", &CpuFrameTimings::acquireWait},
+    {"record", &CpuFrameTimings::record},
+    {"submit", &CpuFrameTimings::submit},
+    {"present", &CpuFrameTimings::present},
+    {"total", &CpuFrameTimings::total},
+}};
+
+/**
+ * @brief "Frame/Scene" for a Scene scope opened inside the Frame one.
+ */
+std::vector<std::string> getScopePaths(std::span<const GpuTiming> gpu)
+{
+    std::vector<std::string> paths;
+    std::vector<std::string> parents;
+    for (const GpuTiming &timing : gpu)
+    {
+        parents.resize(std::min<size_t>(timing.depth, parents.size()));
+        std::string path = parents.empty() ? timing.name : parents.back() + "/" + timing.name;
+        parents.push_back(path);
+        paths.push_back(std::move(path));
+    }
+    return paths;
+}
+
+FrameTimePercentiles getPercentiles(std::vector<double> samples)
+{
+    FrameTimePercentiles percentiles;
+    if (samples.empty())
+    {
+        return percentiles;
+    }
+    std::ranges::sort(samples);
+    auto rank = [&samples](double percentile) {
+        size_t index = static_cast<size_t>(std::ceil(percentile * static_cast<double>(samples.size())));
+        return samples[std::clamp<size_t>(index, 1, samples.size()) - 1];
+    };
+    percentiles.frames = samples.size();
+    percentiles.p50    = rank(0.50);
+    percentiles.p90    = rank(0.90);
+    percentiles.p99    = rank(0.99);
+    percentiles.max    = samples.back();
+    return percentiles;
+}
+
+void writeJsonString(std::ostream &output, const std::string &text)
+{
+    output << '"';
+    for (char c : text)
+    {
+        switch (c)
+        {
+            case '"':
+                output << "\\\"";
+                break;
+            case '\\':
+                output << "\\\\";
+                break;
+            case '\n':
+                output << "\\n";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    output << ' ';
+                }
+                else
+                {
+                    output << c;
+                }
+        }
+    }
+    output << '"';
+}
+
+}  // namespace
+
+PROJECT_API FrameTimings::FrameTimings()
+{
+    TracyPlotConfig("Fence wait (ms)", tracy::PlotFormatType::Number, false, false, 0);
+    TracyPlotConfig("Acquire wait (ms)", tracy::PlotFormatType::Number, false, false, 0);
+    TracyPlotConfig("Record (ms)", tracy::PlotFormatType::Number, false, false, 0);
+    TracyPlotConfig("Submit (ms)", tracy::PlotFormatType::Number, false, false, 0);
+    TracyPlotConfig("Present (ms)", tracy::PlotFormatType::Number, false, false, 0);
+    TracyPlotConfig("GPU frame (ms)", tracy::PlotFormatType::Number, false, false, 0);
+    frames.reserve(HISTORY);
+}
+
+PROJECT_API void FrameTimings::addCpu(uint64_t frameValue, const CpuFrameTimings &cpu)
+{
+    TracyPlot("Fence wait (ms)", cpu.fenceWait);
+    TracyPlot("Acquire wait (ms)", cpu.acquireWait);
+    TracyPlot("Record (ms)", cpu.record);
+    TracyPlot("Submit (ms)", cpu.submit);
+    TracyPlot("Present (ms)", cpu.present);
+
+    FrameTiming frame{.frameValue = frameValue, .cpu = cpu, .gpu = {}};
+    if (frames.size() < HISTORY)
+    {
+        frames.push_back(std::move(frame));
+    }
+    else
+    {
+        frames[next] = std::move(frame);
+    }
+    next = (next + 1) % HISTORY;
+}
+
+PROJECT_API void FrameTimings::addGpu(uint64_t frameValue, std::span<const GpuTiming> gpu)
+{
+    if (not gpu.empty())
+    {
+        TracyPlot("GPU frame (ms)", gpu.front().milliseconds);
+    }
+    // Read back a few frames late, the entry is among the most recent ones.
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        FrameTiming &frame = frames[(next + frames.size() - 1 - i) % frames.size()];
+        if (frame.frameValue == frameValue)
+        {
+            frame.gpu.assign(gpu.begin(), gpu.end());
+            return;
+        }
+        if (frame.frameValue < frameValue)
+        {
+            return;
+        }
+    }
+}
+
+PROJECT_API std::vector<const FrameTiming *> FrameTimings::getFrames() const
+{
+    std::vector<const FrameTiming *> ordered;
+    size_t oldest = frames.size() < HISTORY ? 0 : next;
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        ordered.push_back(&frames[(oldest + i) % frames.size()]);
+    }
+    return ordered;
+}
+
+PROJECT_API FrameTimePercentiles FrameTimings::getCpuPercentiles(double CpuFrameTimings::*counter,
+                                                                 uint64_t firstFrameValue) const
+{
+    std::vector<double> samples;
+    for (const FrameTiming &frame : frames)
+    {
+        if (frame.frameValue >= firstFrameValue)
+        {
+            samples.push_back(frame.cpu.*counter);
+        }
+    }
+    return getPercentiles(std::move(samples));
+}
+
+PROJECT_API FrameTimePercentiles FrameTimings::getGpuPercentiles(uint64_t firstFrameValue) const
+{
+    std::vector<double> samples;
+    for (const FrameTiming &frame : frames)
+    {
+        if (frame.frameValue >= firstFrameValue && not frame.gpu.empty())
+        {
+            samples.push_back(frame.gpu.front().milliseconds);
+        }
+    }
+    return getPercentiles(std::move(samples));
+}
+
+PROJECT_API void FrameTimings::writeCsv(std::ostream &output) const
+{
+    std::vector<const FrameTiming *> ordered = getFrames();
+
+    // Scopes may come and go between frames (a culled pass), the columns are
+    // their union in order of appearance.
+    std::vector<std::string>      columns;
+    std::map<std::string, size_t> columnIndices;
+    for (const FrameTiming *frame : ordered)
+    {
+        for (std::string &path : getScopePaths(frame->gpu))
+        {
+            if (columnIndices.emplace(path, columns.size()).second)
+            {
+                columns.push_back(std::move(path));
+            }
+        }
+    }
+
+    output << "frame";
+    for (const CpuCounter &counter : CPU_COUNTERS)
+    {
+        output << ",cpu." << counter.first;
+    }
+    for (const std::string &column : columns)
+    {
+        // Scope names aren't quoted, nothing in them may split the column.
+        std::string name = column;
+        std::ranges::replace_if(name, [](char c) { return c == ',' || c == '"'; }, ' ');
+        output << ",gpu." << name;
+    }
+    output << '\n';
+
+    std::vector<std::string> cells(columns.size());
+    for (const FrameTiming *frame : ordered)
+    {
+        output << frame->frameValue;
+        for (const CpuCounter &counter : CPU_COUNTERS)
+        {
+            output << ',' << frame->cpu.*counter.second;
+        }
+
+        std::ranges::fill(cells, std::string());
+        std::vector<std::string> paths = getScopePaths(frame->gpu);
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            cells[columnIndices.at(paths[i])] = std::to_string(frame->gpu[i].milliseconds);
+        }
+        for (const std::string &cell : cells)
+        {
+            output << ',' << cell;
+        }
+        output << '\n';
+    }
+}
+
+PROJECT_API void FrameTimings::writeJson(std::ostream &output) const
+{
+    output << "{\"unit\":\"ms\",\"frames\":[";
+    bool firstFrame = true;
+    for (const FrameTiming *frame : getFrames())
+    {
+        output << (firstFrame ? "" : ",") << "\n{\"frame\":" << frame->frameValue << ",\"cpu\":{";
+        firstFrame = false;
+        for (size_t i = 0; i < CPU_COUNTERS.size(); i++)
+        {
+            const auto &[name, counter] = CPU_COUNTERS[i];
+            output << (i == 0 ? "" : ",") << '"' << name << "\":" << frame->cpu.*counter;
+        }
+        output << "},\"gpu\":[";
+        for (size_t i = 0; i < frame->gpu.size(); i++)
+        {
+            output << (i == 0 ? "" : ",") << "{\"name\":";
+            writeJsonString(output, frame->gpu[i].name);
+            output << ",\"depth\":" << frame->gpu[i].depth << ",\"ms\":" << frame->gpu[i].milliseconds << '}';
+        }
+        output << "]}";
+    }
+    output << "\n]}\n";
+}
+
+PROJECT_API bool FrameTimings::save(const std::filesystem::path &path) const
+{
+    std::ofstream output(path);
+    if (path.extension() == ".json")
+    {
+        writeJson(output);
+    }
+    else
+    {
+        writeCsv(output);
+    }
+    return static_cast<bool>(output);
+}
+
+}  // namespace Graphics
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <span>
+#include <vector>
+
+#include "GpuProfiler.hpp"
+#include "config.hpp"
+
+namespace Graphics {
+
+/**
+ * @brief Where the CPU spent a frame, in milliseconds.
+ */
+struct CpuFrameTimings
+{
+    double fenceWait   = 0.0;  // FramePacer::beginFrame(), waiting for the slot
+    double acquireWait = 0.0;  // vkAcquireNextImageKHR
+    double record      = 0.0;  // command buffers, with the simulation joined
+    double submit      = 0.0;  // vkQueueSubmit2
+    double present     = 0.0;  // vkQueuePresentKHR
+    double total       = 0.0;  // start of the frame to the start of the next one
+};
+
+/**
+ * @brief Nearest rank percentiles of a counter, in milliseconds.
+ */
+struct FrameTimePercentiles
+{
+    size_t frames = 0;
+    double p50    = 0.0;
+    double p90    = 0.0;
+    double p99    = 0.0;
+    double max    = 0.0;
+};
+
+struct FrameTiming
+{
+    uint64_t               frameValue = 0;  // FramePacer value
+    CpuFrameTimings        cpu;
+    std::vector<GpuTiming> gpu;  // empty until read back, see GpuProfiler
+};
+
+/**
+ * @class FrameTimings
+ * @brief Ring of the timings of the last HISTORY frames, exported for
+ * offline comparison between runs.
+ *
+ * CPU counters are added when the frame is submitted, GPU timings when they
+ * are read back a few frames later, to the same entry. Every counter is also
+ * a Tracy plot.
+ */
+class PROJECT_API FrameTimings
+{
+   public:
+    static constexpr size_t HISTORY = 1024;
+
+    // Members
+   private:
+    std::vector<FrameTiming> frames;  // ring, next is the oldest once full
+    size_t                   next = 0;
+
+    // Methods
+   public:
+    FrameTimings();
+
+    void addCpu(uint64_t frameValue, const CpuFrameTimings &cpu);
+    /**
+     * @brief Ignored when the frame already left the ring.
+     */
+    void addGpu(uint64_t frameValue, std::span<const GpuTiming> gpu);
+
+    /**
+     * @brief Oldest first.
+     */
+    std::vector<const FrameTiming *> getFrames() const;
+
+    /**
+     * @brief Over the frames of the ring from firstFrameValue on, e.g. to
+     * leave a warm-up out.
+     */
+    FrameTimePercentiles getCpuPercentiles(double CpuFrameTimings::*counter, uint64_t firstFrameValue = 0) const;
+    /**
+     * @brief Of the first GPU scope, the whole frame. Frames not read back yet
+     * are left out.
+     */
+    FrameTimePercentiles getGpuPercentiles(uint64_t firstFrameValue = 0) const;
+
+    /**
+     * @brief One row per frame, one column per CPU counter then per GPU
+     * scope, named after its scope path (e.g. "gpu.Frame/Scene").
+     */
+    void writeCsv(std::ostream &output) const;
+    /**
+     * @brief Array of frames, the GPU scopes keep their nesting depth.
+     */
+    void writeJson(std::ostream &output) const;
+    /**
+     * @brief JSON for a .json extension, CSV otherwise.
+     * @return false when the file can't be written.
+     */
+    bool save(const std::filesystem::path &path) const;
+};
+
+}  // namespace Graphics
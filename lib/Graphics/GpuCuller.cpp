@@ -0,0 +1,326 @@
+#include "GpuCuller.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "profiling.hpp"
+
+namespace Graphics {
+
+PROJECT_API GpuCuller::GpuCuller(const vk::raii::Device        &device,
+                                 Memory::Allocator             &allocator,
+                                 const vk::raii::PipelineCache &pipelineCache,
+                                 std::span<const uint32_t>      shaderCode,
+                                 uint32_t                       queueFamilyIndex,
+                                 uint32_t                       dstQueueFamilyIndex,
+                                 uint32_t                       framesInFlight) :
+    device(device), allocator(allocator), queueFamilyIndex(queueFamilyIndex),
+    dstQueueFamilyIndex(dstQueueFamilyIndex)
+{
+    ZoneScoped;
+    std::array bindings = {
+        vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute)};
+    vk::DescriptorSetLayoutCreateInfo layoutInfo{.bindingCount = bindings.size(), .pBindings = bindings.data()};
+    descriptorSetLayout = vk::raii::DescriptorSetLayout(device, layoutInfo);
+
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo{.setLayoutCount = 1, .pSetLayouts = &*descriptorSetLayout};
+    pipelineLayout = vk::raii::PipelineLayout(device, pipelineLayoutInfo);
+
+    vk::ShaderModuleCreateInfo    shaderInfo{.codeSize = shaderCode.size_bytes(), .pCode = shaderCode.data()};
+    vk::raii::ShaderModule        shaderModule(device, shaderInfo);
+    vk::ComputePipelineCreateInfo pipelineInfo{
+        .stage  = {.stage = vk::ShaderStageFlagBits::eCompute, .module = shaderModule, .pName = "compMain"},
+        .layout = *pipelineLayout};
+    pipeline = vk::raii::Pipeline(device, pipelineCache, pipelineInfo);
+
+    createFrames(framesInFlight);
+}
+
+PROJECT_API void GpuCuller::setFramesInFlight(uint32_t framesInFlight)
+{
+    if (framesInFlight != frames.size())
+    {
+        if (instanceStride != 0)
+        {
+            // The regions were laid out for the previous slot count.
+            instanceBuffer = nullptr;
+            instanceCount  = 0;
+            instanceStride = 0;
+        }
+        createFrames(framesInFlight);
+    }
+}
+
+PROJECT_API void GpuCuller::setInstances(vk::Buffer buffer, uint32_t instanceCount, vk::DeviceSize frameStride)
+{
+    instanceBuffer      = buffer;
+    instanceStride      = frameStride;
+    this->instanceCount = instanceCount;
+    if (instanceCount > drawCapacity)
+    {
+        // Every instance may be visible, the command buffers hold them all.
+        drawCapacity = instanceCount;
+        createFrames(static_cast<uint32_t>(frames.size()));
+        return;
+    }
+    for (uint32_t slot = 0; slot < frames.size(); slot++)
+    {
+        writeDescriptorSet(frames[slot], slot);
+    }
+}
+
+PROJECT_API void GpuCuller::beginFrame(uint32_t frameSlot)
+{
+    this->frameSlot = frameSlot;
+}
+
+PROJECT_API void GpuCuller::updateFrustum(std::span<const float, 16> viewProjection)
+{
+    // Gribb-Hartmann: the planes are sums of the rows of the matrix, clip
+    // space depth is [0, w] so the near plane is the third row alone.
+    auto row = [&](uint32_t index) {
+        return std::array{viewProjection[index],
+                          viewProjection[4 + index],
+                          viewProjection[8 + index],
+                          viewProjection[12 + index]};
+    };
+    std::array<float, 4> x = row(0);
+    std::array<float, 4> y = row(1);
+    std::array<float, 4> z = row(2);
+    std::array<float, 4> w = row(3);
+
+    CullParams params{.instanceCount = instanceCount, .maxDrawCount = drawCapacity};
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        params.planes[0][i] = w[i] + x[i];  // left
+        params.planes[1][i] = w[i] - x[i];  // right
+        params.planes[2][i] = w[i] + y[i];  // bottom
+        params.planes[3][i] = w[i] - y[i];  // top
+        params.planes[4][i] = z[i];         // near
+        params.planes[5][i] = w[i] - z[i];  // far
+    }
+    // Normalized, so the sphere test compares distances with the radius.
+    for (std::array<float, 4> &plane : params.planes)
+    {
+        float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        if (length > 0.0f)
+        {
+            std::ranges::transform(plane, plane.begin(), [length](float value) { return value / length; });
+        }
+    }
+
+    const Frame &frame = frames[frameSlot];
+    std::memcpy(frame.paramsAllocation.getMappedData(), &params, sizeof(params));
+    frame.paramsAllocation.flush();
+}
+
+PROJECT_API void GpuCuller::record(const vk::raii::CommandBuffer &commandBuffer) const
+{
+    ZoneScoped;
+    if (instanceCount == 0)
+    {
+        return;
+    }
+    const Frame &frame = frames[frameSlot];
+
+    // The previous use of the slot's buffers completed before beginFrame(),
+    // only the count reset has to be ordered before the dispatch.
+    commandBuffer.fillBuffer(*frame.countBuffer, 0, getBatchCount() * sizeof(uint32_t), 0);
+    vk::MemoryBarrier2 clearBarrier{.srcStageMask  = vk::PipelineStageFlagBits2::eClear,
+                                    .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+                                    .dstStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+                                    .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead |
+                                                     vk::AccessFlagBits2::eShaderStorageWrite};
+    commandBuffer.pipelineBarrier2({.memoryBarrierCount = 1, .pMemoryBarriers = &clearBarrier});
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *pipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *pipelineLayout, 0, *frame.descriptorSet, {});
+    commandBuffer.dispatch((instanceCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+    if (queueFamilyIndex != dstQueueFamilyIndex)
+    {
+        // The drawing queue waits for the submission, the release only has
+        // to follow the dispatch.
+        std::array releases = getTransferBarriers(frame);
+        for (vk::BufferMemoryBarrier2 &release : releases)
+        {
+            release.srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader;
+            release.srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite;
+        }
+        commandBuffer.pipelineBarrier2(
+            {.bufferMemoryBarrierCount = releases.size(), .pBufferMemoryBarriers = releases.data()});
+        return;
+    }
+    vk::MemoryBarrier2 drawBarrier{.srcStageMask  = vk::PipelineStageFlagBits2::eComputeShader,
+                                   .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+                                   .dstStageMask  = vk::PipelineStageFlagBits2::eDrawIndirect,
+                                   .dstAccessMask = vk::AccessFlagBits2::eIndirectCommandRead};
+    commandBuffer.pipelineBarrier2({.memoryBarrierCount = 1, .pMemoryBarriers = &drawBarrier});
+}
+
+PROJECT_API void GpuCuller::recordAcquireBarriers(const vk::raii::CommandBuffer &commandBuffer) const
+{
+    if (instanceCount == 0 || queueFamilyIndex == dstQueueFamilyIndex)
+    {
+        return;
+    }
+    // The submission waits for the culling at the indirect stage, the acquire
+    // follows that wait.
+    std::array acquires = getTransferBarriers(frames[frameSlot]);
+    for (vk::BufferMemoryBarrier2 &acquire : acquires)
+    {
+        acquire.srcStageMask  = vk::PipelineStageFlagBits2::eDrawIndirect;
+        acquire.dstStageMask  = vk::PipelineStageFlagBits2::eDrawIndirect;
+        acquire.dstAccessMask = vk::AccessFlagBits2::eIndirectCommandRead;
+    }
+    commandBuffer.pipelineBarrier2(
+        {.bufferMemoryBarrierCount = acquires.size(), .pBufferMemoryBarriers = acquires.data()});
+}
+
+PROJECT_API void GpuCuller::draw(const vk::raii::CommandBuffer &commandBuffer,
+                                 uint32_t                       firstBatch,
+                                 uint32_t                       batchCount) const
+{
+    if (instanceCount == 0)
+    {
+        return;
+    }
+    const Frame &frame    = frames[frameSlot];
+    uint32_t     endBatch = std::min(firstBatch + batchCount, getBatchCount());
+    for (uint32_t batch = firstBatch; batch < endBatch; batch++)
+    {
+        uint32_t first = batch * BATCH_SIZE;
+        commandBuffer.drawIndexedIndirectCount(*frame.drawBuffer,
+                                               first * sizeof(vk::DrawIndexedIndirectCommand),
+                                               *frame.countBuffer,
+                                               batch * sizeof(uint32_t),
+                                               std::min(BATCH_SIZE, instanceCount - first),
+                                               sizeof(vk::DrawIndexedIndirectCommand));
+    }
+}
+
+PROJECT_API uint32_t GpuCuller::getInstanceCount() const
+{
+    return instanceCount;
+}
+
+PROJECT_API uint32_t GpuCuller::getBatchCount() const
+{
+    return (instanceCount + BATCH_SIZE - 1) / BATCH_SIZE;
+}
+
+PROJECT_API vk::DeviceSize GpuCuller::getInstanceOffset() const
+{
+    return frameSlot * instanceStride;
+}
+
+void GpuCuller::createFrames(uint32_t framesInFlight)
+{
+    ZoneScoped;
+    frames.clear();
+    descriptorPool = nullptr;
+
+    std::array poolSizes = {vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, framesInFlight),
+                            vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 3 * framesInFlight)};
+    vk::DescriptorPoolCreateInfo poolInfo{.flags         = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+                                          .maxSets       = framesInFlight,
+                                          .poolSizeCount = poolSizes.size(),
+                                          .pPoolSizes    = poolSizes.data()};
+    descriptorPool = vk::raii::DescriptorPool(device, poolInfo);
+
+    auto createBuffer = [&](vk::DeviceSize          size,
+                            vk::BufferUsageFlags    usage,
+                            vk::MemoryPropertyFlags properties,
+                            vk::raii::Buffer       &buffer,
+                            Memory::Allocation     &allocation) {
+        vk::BufferCreateInfo bufferInfo{.size = size, .usage = usage, .sharingMode = vk::SharingMode::eExclusive};
+        buffer     = vk::raii::Buffer(device, bufferInfo);
+        allocation = allocator.allocate(buffer, properties);
+    };
+
+    vk::DeviceSize drawBufferSize  = std::max(drawCapacity, 1u) * sizeof(vk::DrawIndexedIndirectCommand);
+    vk::DeviceSize countBufferSize = std::max((drawCapacity + BATCH_SIZE - 1) / BATCH_SIZE, 1u) * sizeof(uint32_t);
+    frames.resize(framesInFlight);
+    for (uint32_t slot = 0; slot < framesInFlight; slot++)
+    {
+        Frame &frame = frames[slot];
+        createBuffer(drawBufferSize,
+                     vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal,
+                     frame.drawBuffer,
+                     frame.drawAllocation);
+        createBuffer(countBufferSize,
+                     vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer |
+                         vk::BufferUsageFlagBits::eTransferDst,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal,
+                     frame.countBuffer,
+                     frame.countAllocation);
+        createBuffer(sizeof(CullParams),
+                     vk::BufferUsageFlagBits::eUniformBuffer,
+                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                     frame.paramsBuffer,
+                     frame.paramsAllocation);
+
+        vk::DescriptorSetAllocateInfo allocInfo{.descriptorPool     = descriptorPool,
+                                                .descriptorSetCount = 1,
+                                                .pSetLayouts        = &*descriptorSetLayout};
+        frame.descriptorSet = std::move(device.allocateDescriptorSets(allocInfo).front());
+        writeDescriptorSet(frame, slot);
+    }
+}
+
+void GpuCuller::writeDescriptorSet(const Frame &frame, uint32_t slot) const
+{
+    vk::DescriptorBufferInfo paramsInfo{.buffer = frame.paramsBuffer, .offset = 0, .range = sizeof(CullParams)};
+    vk::DescriptorBufferInfo instanceInfo{.buffer = instanceBuffer,
+                                          .offset = slot * instanceStride,
+                                          .range  = instanceStride ? instanceStride : vk::WholeSize};
+    vk::DescriptorBufferInfo drawInfo{.buffer = frame.drawBuffer, .offset = 0, .range = vk::WholeSize};
+    vk::DescriptorBufferInfo countInfo{.buffer = frame.countBuffer, .offset = 0, .range = vk::WholeSize};
+
+    std::vector<vk::WriteDescriptorSet> writes = {
+        {.dstSet          = frame.descriptorSet,
+         .dstBinding      = 0,
+         .descriptorCount = 1,
+         .descriptorType  = vk::DescriptorType::eUniformBuffer,
+         .pBufferInfo     = &paramsInfo},
+        {.dstSet          = frame.descriptorSet,
+         .dstBinding      = 2,
+         .descriptorCount = 1,
+         .descriptorType  = vk::DescriptorType::eStorageBuffer,
+         .pBufferInfo     = &drawInfo},
+        {.dstSet          = frame.descriptorSet,
+         .dstBinding      = 3,
+         .descriptorCount = 1,
+         .descriptorType  = vk::DescriptorType::eStorageBuffer,
+         .pBufferInfo     = &countInfo}};
+    // The instances are only known once setInstances() is called.
+    if (instanceBuffer)
+    {
+        writes.push_back({.dstSet          = frame.descriptorSet,
+                          .dstBinding      = 1,
+                          .descriptorCount = 1,
+                          .descriptorType  = vk::DescriptorType::eStorageBuffer,
+                          .pBufferInfo     = &instanceInfo});
+    }
+    device.updateDescriptorSets(writes, {});
+}
+
+std::array<vk::BufferMemoryBarrier2, 2> GpuCuller::getTransferBarriers(const Frame &frame) const
+{
+    // The next record() overwrites both, they never go back to the culling family.
+    vk::BufferMemoryBarrier2 barrier{.srcQueueFamilyIndex = queueFamilyIndex,
+                                     .dstQueueFamilyIndex = dstQueueFamilyIndex,
+                                     .offset              = 0,
+                                     .size                = vk::WholeSize};
+    std::array barriers = {barrier, barrier};
+    barriers[0].buffer  = *frame.drawBuffer;
+    barriers[1].buffer  = *frame.countBuffer;
+    return barriers;
+}
+
+}  // namespace Graphics
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#include "Memory/Allocator.hpp"
+#include "config.hpp"
+
+namespace Graphics {
+
+/**
+ * @brief Object instance as read by the culling shader (std430), must match
+ * ObjectInstance in cull.slang. The model matrix comes first so the buffer
+ * doubles as a per-instance vertex stream (Geometry::InstanceTransform).
+ */
+struct GpuInstance
+{
+    std::array<float, 16> model;           // column major, like glm::mat4
+    std::array<float, 4>  boundingSphere;  // xyz center, w radius, in model space
+    uint32_t              indexCount   = 0;
+    uint32_t              firstIndex   = 0;
+    int32_t               vertexOffset = 0;
+    uint32_t              padding      = 0;
+};
+
+/**
+ * @class GpuCuller
+ * @brief Frustum culls object instances in a compute pass and draws the
+ * survivors with one vkCmdDrawIndexedIndirectCount per batch.
+ *
+ * The instances live in a storage buffer owned by the caller, the same for
+ * every frame or one region per frame slot the CPU rewrites. Every frame the
+ * compute pass tests their bounding sphere against the frustum planes and
+ * appends a vk::DrawIndexedIndirectCommand per visible instance, with the
+ * instance index as firstInstance so per-instance vertex attributes, or
+ * SV_VulkanInstanceID, select that instance. The CPU cost no longer depends
+ * on the number of objects. Commands, count and frustum parameters are per
+ * frame slot, so a frame culls while the previous one still draws.
+ *
+ * The instances are culled in batches of BATCH_SIZE, each with its own range
+ * of commands and its own count, so the batches can be drawn from different
+ * secondary command buffers.
+ *
+ * record() goes in the frame command buffer before the rendering pass, draw()
+ * inside it. On an async compute queue, another family than the one drawing,
+ * record() goes in a command buffer of that queue and releases the draws and
+ * counts to the drawing family. Its frame command buffer waits for the compute
+ * submission and calls recordAcquireBarriers() before the rendering pass. The
+ * instance buffer is then shared concurrently by both families.
+ *
+ * updateFrustum() may be called from another thread than record(), as long as
+ * both happen between beginFrame() and the submission.
+ */
+class PROJECT_API GpuCuller
+{
+   public:
+    static constexpr uint32_t WORKGROUP_SIZE = 64;   // numthreads of cull.slang
+    static constexpr uint32_t BATCH_SIZE     = 256;  // instances, must match cull.slang
+
+    // Members
+   private:
+    struct CullParams
+    {
+        std::array<std::array<float, 4>, 6> planes;  // xyz inward normal, w distance
+        uint32_t                             instanceCount = 0;
+        uint32_t                             maxDrawCount  = 0;
+        std::array<uint32_t, 2>              padding{};
+    };
+
+    struct Frame
+    {
+        vk::raii::Buffer        drawBuffer = nullptr;
+        Memory::Allocation      drawAllocation;
+        vk::raii::Buffer        countBuffer = nullptr;
+        Memory::Allocation      countAllocation;
+        vk::raii::Buffer        paramsBuffer = nullptr;
+        Memory::Allocation      paramsAllocation;
+        vk::raii::DescriptorSet descriptorSet = nullptr;
+    };
+
+    const vk::raii::Device &device;
+    Memory::Allocator      &allocator;
+    uint32_t                queueFamilyIndex;     // of the queue culling
+    uint32_t                dstQueueFamilyIndex;  // of the queue drawing
+
+    vk::raii::DescriptorSetLayout descriptorSetLayout = nullptr;
+    vk::raii::PipelineLayout      pipelineLayout      = nullptr;
+    vk::raii::Pipeline            pipeline            = nullptr;
+    vk::raii::DescriptorPool      descriptorPool      = nullptr;
+    std::vector<Frame>            frames;
+    uint32_t                      frameSlot = 0;
+
+    vk::Buffer     instanceBuffer;
+    vk::DeviceSize instanceStride = 0;  // between the regions of the slots
+    uint32_t       instanceCount  = 0;
+    uint32_t       drawCapacity   = 0;
+
+    // Methods
+   public:
+    GpuCuller(const vk::raii::Device        &device,
+              Memory::Allocator             &allocator,
+              const vk::raii::PipelineCache &pipelineCache,
+              std::span<const uint32_t>      shaderCode,
+              uint32_t                       queueFamilyIndex,
+              uint32_t                       dstQueueFamilyIndex,
+              uint32_t                       framesInFlight);
+    GpuCuller(const GpuCuller &)            = delete;
+    GpuCuller &operator=(const GpuCuller &) = delete;
+
+    /**
+     * @brief Recreate the per-frame resources for a new slot count. No slot
+     * may be in use by the GPU. Instances per slot must be set again.
+     */
+    void setFramesInFlight(uint32_t framesInFlight);
+
+    /**
+     * @brief Cull the instanceCount GpuInstance of buffer (created with
+     * eStorageBuffer). No slot may be in use by the GPU.
+     * @param frameStride 0 when every slot reads the start of buffer, else
+     * slot i reads the instances at i * frameStride, a multiple of
+     * minStorageBufferOffsetAlignment.
+     */
+    void setInstances(vk::Buffer buffer, uint32_t instanceCount, vk::DeviceSize frameStride = 0);
+
+    void beginFrame(uint32_t frameSlot);
+
+    /**
+     * @brief Set the frustum of the current slot from a column major
+     * view-projection matrix (Vulkan clip space, depth in [0, 1]). The planes
+     * are in the space the instance transforms map to.
+     */
+    void updateFrustum(std::span<const float, 16> viewProjection);
+
+    /**
+     * @brief Record the culling dispatch, outside of a rendering pass, on a
+     * queue of queueFamilyIndex.
+     */
+    void record(const vk::raii::CommandBuffer &commandBuffer) const;
+
+    /**
+     * @brief Acquire the draws and counts released by record() on the
+     * drawing queue, outside of a rendering pass. Its submission waits for the
+     * culling one at vk::PipelineStageFlagBits2::eDrawIndirect. No-op when
+     * both queues are of the same family.
+     */
+    void recordAcquireBarriers(const vk::raii::CommandBuffer &commandBuffer) const;
+
+    /**
+     * @brief Draw the visible instances of the batches [firstBatch,
+     * firstBatch + batchCount), the graphics pipeline, vertex and index
+     * buffers must be bound.
+     */
+    void draw(const vk::raii::CommandBuffer &commandBuffer, uint32_t firstBatch, uint32_t batchCount) const;
+
+    uint32_t getInstanceCount() const;
+    uint32_t getBatchCount() const;
+
+    /**
+     * @brief Offset of the instances of the current slot in their buffer.
+     */
+    vk::DeviceSize getInstanceOffset() const;
+
+   private:
+    void createFrames(uint32_t framesInFlight);
+    void writeDescriptorSet(const Frame &frame, uint32_t slot) const;
+    // Ownership transfers of the draws and counts, the caller sets the stages and accesses of its side.
+    std::array<vk::BufferMemoryBarrier2, 2> getTransferBarriers(const Frame &frame) const;
+};
+
+}  // namespace Graphics
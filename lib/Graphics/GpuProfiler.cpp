@@ -0,0 +1,206 @@
+#include "GpuProfiler.hpp"
+
+#include "profiling.hpp"
+
+#if defined(TRACY_ENABLE)
+#    include <tracy/TracyVulkan.hpp>
+#endif
+
+namespace Graphics {
+
+/**
+ * @brief Tracy Vulkan context and the zones opened by beginScope().
+ */
+struct GpuProfiler::TracyContext
+{
+#if defined(TRACY_ENABLE)
+    TracyVkCtx                                      context = nullptr;
+    std::vector<std::unique_ptr<tracy::VkCtxScope>> zones;  // closed by endScope()
+
+    ~TracyContext()
+    {
+        zones.clear();
+        TracyVkDestroy(context);
+    }
+#endif
+};
+
+PROJECT_API GpuProfiler::GpuProfiler(const vk::raii::PhysicalDevice &physicalDevice,
+                                     const vk::raii::Device         &device,
+                                     const vk::raii::Queue          &queue,
+                                     uint32_t                        queueFamilyIndex,
+                                     uint32_t                        framesInFlight) :
+    device(device), tracy(std::make_unique<TracyContext>())
+{
+    // Queues without timestamps have no valid bits, scopes are ignored then.
+    uint32_t validBits = physicalDevice.getQueueFamilyProperties()[queueFamilyIndex].timestampValidBits;
+    timestampMask      = validBits >= 64 ? UINT64_MAX : (uint64_t{1} << validBits) - 1;
+    timestampPeriod    = physicalDevice.getProperties().limits.timestampPeriod;
+    setFramesInFlight(framesInFlight);
+
+#if defined(TRACY_ENABLE)
+    // Tracy calibrates its context with a submission of its own.
+    vk::raii::CommandPool   pool(device, {.queueFamilyIndex = queueFamilyIndex});
+    vk::raii::CommandBuffer commandBuffer = std::move(vk::raii::CommandBuffers(
+        device, {.commandPool = pool, .level = vk::CommandBufferLevel::ePrimary, .commandBufferCount = 1})[0]);
+    tracy->context = TracyVkContext(*physicalDevice, *device, *queue, *commandBuffer);
+#else
+    (void)queue;
+#endif
+}
+
+PROJECT_API GpuProfiler::~GpuProfiler() = default;
+
+PROJECT_API void GpuProfiler::setFramesInFlight(uint32_t framesInFlight)
+{
+    slots.assign(framesInFlight, {});
+    openScopes.clear();
+    if (isSupported())
+    {
+        queryPool = vk::raii::QueryPool(device,
+                                        {.queryType  = vk::QueryType::eTimestamp,
+                                         .queryCount = MAX_QUERIES * framesInFlight});
+    }
+}
+
+PROJECT_API void GpuProfiler::beginFrame(const vk::raii::CommandBuffer &commandBuffer,
+                                         uint32_t                       slot,
+                                         uint64_t                       frameValue)
+{
+    ZoneScoped;
+    currentSlot = slot;
+    openScopes.clear();
+#if defined(TRACY_ENABLE)
+    TracyVkCollect(tracy->context, *commandBuffer);
+#endif
+    if (not isSupported())
+    {
+        return;
+    }
+
+    Slot &current = slots[slot];
+    readResults(current);
+    current.scopes.clear();
+    current.queryCount  = 0;
+    current.pendingEnds = 0;
+    current.frameValue  = frameValue;
+    commandBuffer.resetQueryPool(queryPool, slot * MAX_QUERIES, MAX_QUERIES);
+    beginScope(commandBuffer, "Frame");
+}
+
+PROJECT_API void GpuProfiler::endFrame(const vk::raii::CommandBuffer &commandBuffer)
+{
+    while (not openScopes.empty())
+    {
+        endScope(commandBuffer);
+    }
+}
+
+PROJECT_API void GpuProfiler::beginScope(const vk::raii::CommandBuffer &commandBuffer, const std::string &name)
+{
+#if defined(TRACY_ENABLE)
+    tracy->zones.push_back(std::make_unique<tracy::VkCtxScope>(tracy->context,
+                                                               __LINE__,
+                                                               __FILE__,
+                                                               sizeof(__FILE__) - 1,
+                                                               __func__,
+                                                               sizeof(__func__) - 1,
+                                                               name.data(),
+                                                               name.size(),
+                                                               *commandBuffer,
+                                                               true));
+#endif
+    Slot &slot = slots[currentSlot];
+    // Dropped scopes still open, endScope() pops them.
+    if (not isSupported() || slot.queryCount + slot.pendingEnds + 2 > MAX_QUERIES)
+    {
+        openScopes.push_back(UINT32_MAX);
+        return;
+    }
+    uint32_t query = currentSlot * MAX_QUERIES + slot.queryCount++;
+    slot.pendingEnds++;
+    commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, queryPool, query);
+    openScopes.push_back(static_cast<uint32_t>(slot.scopes.size()));
+    slot.scopes.push_back({.name       = name,
+                           .depth      = static_cast<uint32_t>(openScopes.size() - 1),
+                           .beginQuery = query});
+}
+
+PROJECT_API void GpuProfiler::endScope(const vk::raii::CommandBuffer &commandBuffer)
+{
+#if defined(TRACY_ENABLE)
+    if (not tracy->zones.empty())
+    {
+        tracy->zones.pop_back();
+    }
+#endif
+    if (openScopes.empty())
+    {
+        return;
+    }
+    uint32_t scope = openScopes.back();
+    openScopes.pop_back();
+    if (scope == UINT32_MAX)
+    {
+        return;
+    }
+    // The end query was reserved with the begin one.
+    Slot    &slot  = slots[currentSlot];
+    uint32_t query = currentSlot * MAX_QUERIES + slot.queryCount++;
+    slot.pendingEnds--;
+    commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eBottomOfPipe, queryPool, query);
+    slot.scopes[scope].endQuery = query;
+}
+
+PROJECT_API std::span<const GpuTiming> GpuProfiler::getTimings() const
+{
+    return timings;
+}
+
+PROJECT_API uint64_t GpuProfiler::getFrameValue() const
+{
+    return timingsFrameValue;
+}
+
+PROJECT_API bool GpuProfiler::isSupported() const
+{
+    return timestampMask != 0 && timestampPeriod > 0.0;
+}
+
+void GpuProfiler::readResults(Slot &slot)
+{
+    if (slot.frameValue == 0 || slot.queryCount == 0)
+    {
+        return;
+    }
+    // No eWait: the frame is complete, when it isn't its timings are lost
+    // rather than stalling the recording thread.
+    auto [result, ticks] = queryPool.getResults<uint64_t>(currentSlot * MAX_QUERIES,
+                                                          slot.queryCount,
+                                                          slot.queryCount * sizeof(uint64_t),
+                                                          sizeof(uint64_t),
+                                                          vk::QueryResultFlagBits::e64);
+    if (result != vk::Result::eSuccess)
+    {
+        return;
+    }
+
+    timings.clear();
+    uint32_t first = currentSlot * MAX_QUERIES;
+    for (const Scope &scope : slot.scopes)
+    {
+        if (scope.endQuery == UINT32_MAX)
+        {
+            continue;
+        }
+        uint64_t begin = ticks[scope.beginQuery - first] & timestampMask;
+        uint64_t end   = ticks[scope.endQuery - first] & timestampMask;
+        uint64_t delta = (end - begin) & timestampMask;  // wraps with the valid bits
+        timings.push_back({.name         = scope.name,
+                           .depth        = scope.depth,
+                           .milliseconds = static_cast<double>(delta) * timestampPeriod * 1e-6});
+    }
+    timingsFrameValue = slot.frameValue;
+}
+
+}  // namespace Graphics
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#include "config.hpp"
+
+namespace Graphics {
+
+/**
+ * @brief GPU duration of a scope, measured with timestamp queries.
+ */
+struct GpuTiming
+{
+    std::string name;
+    uint32_t    depth        = 0;  // scopes opened around it
+    double      milliseconds = 0.0;
+};
+
+/**
+ * @class GpuProfiler
+ * @brief Measures scopes of the frame command buffer on the GPU, in release
+ * builds too.
+ *
+ * Every frame slot owns a range of the timestamp query pool, reset at
+ * beginFrame(). The results of a slot are read when it comes back, once the
+ * frame pacer waited for its previous frame: the queries are complete then
+ * and the read never stalls, a frame not ready yet is skipped. The timings
+ * therefore lag by the number of frames in flight, getFrameValue() tells
+ * which frame they belong to.
+ *
+ * With TRACY_ENABLE the same scopes are Tracy Vulkan zones, collected at
+ * beginFrame().
+ */
+class PROJECT_API GpuProfiler
+{
+   public:
+    static constexpr uint32_t MAX_QUERIES = 128;  // per frame slot, two per scope
+
+    // Members
+   private:
+    struct TracyContext;
+
+    struct Scope
+    {
+        std::string name;
+        uint32_t    depth;
+        uint32_t    beginQuery;
+        uint32_t    endQuery = UINT32_MAX;
+    };
+
+    struct Slot
+    {
+        std::vector<Scope> scopes;
+        uint32_t           queryCount  = 0;
+        uint32_t           pendingEnds = 0;  // queries kept for the end of the open scopes
+        uint64_t           frameValue  = 0;  // 0 when the slot has no frame to read
+    };
+
+    const vk::raii::Device       &device;
+    double                        timestampPeriod = 0.0;  // nanoseconds per tick
+    uint64_t                      timestampMask   = 0;
+    vk::raii::QueryPool           queryPool       = nullptr;
+    std::vector<Slot>             slots;
+    uint32_t                      currentSlot = 0;
+    std::vector<uint32_t>         openScopes;
+    std::vector<GpuTiming>        timings;
+    uint64_t                      timingsFrameValue = 0;
+    std::unique_ptr<TracyContext> tracy;
+
+    // Methods
+   public:
+    /**
+     * @param queue the queue the measured command buffers are submitted to,
+     * the Tracy context calibrates with it.
+     */
+    GpuProfiler(const vk::raii::PhysicalDevice &physicalDevice,
+                const vk::raii::Device         &device,
+                const vk::raii::Queue          &queue,
+                uint32_t                        queueFamilyIndex,
+                uint32_t                        framesInFlight);
+    GpuProfiler(const GpuProfiler &)            = delete;
+    GpuProfiler &operator=(const GpuProfiler &) = delete;
+    ~GpuProfiler();
+
+    /**
+     * @brief Drops the pending results. None of the frame slots may be in use
+     * by the GPU.
+     */
+    void setFramesInFlight(uint32_t framesInFlight);
+
+    /**
+     * @brief Read the results of the slot, then reset its queries and open
+     * the "Frame" scope. First command of the frame, outside of rendering.
+     * @param frameValue FramePacer value of the frame being recorded.
+     */
+    void beginFrame(const vk::raii::CommandBuffer &commandBuffer, uint32_t slot, uint64_t frameValue);
+    void endFrame(const vk::raii::CommandBuffer &commandBuffer);
+
+    /**
+     * @brief Scopes nest and are dropped once the queries of the slot are
+     * used up.
+     */
+    void beginScope(const vk::raii::CommandBuffer &commandBuffer, const std::string &name);
+    void endScope(const vk::raii::CommandBuffer &commandBuffer);
+
+    /**
+     * @brief Timings of the most recent frame read back, the first one covers
+     * the whole frame. Empty when the queue can't write timestamps.
+     */
+    std::span<const GpuTiming> getTimings() const;
+    uint64_t                   getFrameValue() const;
+
+    bool isSupported() const;
+
+   private:
+    void readResults(Slot &slot);
+};
+
+}  // namespace Graphics
@@ -0,0 +1,169 @@
+#include "MipGenerator.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#include "profiling.hpp"
+
+namespace Graphics {
+
+namespace {
+
+vk::ImageMemoryBarrier2 levelBarrier(vk::Image               image,
+                                     uint32_t                baseMipLevel,
+                                     uint32_t                levelCount,
+                                     vk::ImageLayout         oldLayout,
+                                     vk::ImageLayout         newLayout,
+                                     vk::PipelineStageFlags2 srcStage,
+                                     vk::AccessFlags2        srcAccess,
+                                     vk::PipelineStageFlags2 dstStage,
+                                     vk::AccessFlags2        dstAccess)
+{
+    return {.srcStageMask        = srcStage,
+            .srcAccessMask       = srcAccess,
+            .dstStageMask        = dstStage,
+            .dstAccessMask       = dstAccess,
+            .oldLayout           = oldLayout,
+            .newLayout           = newLayout,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .image               = image,
+            .subresourceRange    = {.aspectMask     = vk::ImageAspectFlagBits::eColor,
+                                    .baseMipLevel   = baseMipLevel,
+                                    .levelCount     = levelCount,
+                                    .baseArrayLayer = 0,
+                                    .layerCount     = 1}};
+}
+
+int32_t mipDimension(uint32_t dimension, uint32_t mipLevel)
+{
+    return static_cast<int32_t>(std::max(1u, dimension >> mipLevel));
+}
+
+}  // namespace
+
+PROJECT_API uint32_t MipGenerator::getMipLevelCount(vk::Extent2D extent)
+{
+    return std::bit_width(std::max(extent.width, extent.height));
+}
+
+PROJECT_API bool MipGenerator::supportsLinearBlit(const vk::raii::PhysicalDevice &physicalDevice, vk::Format format)
+{
+    vk::FormatFeatureFlags features = physicalDevice.getFormatProperties(format).optimalTilingFeatures;
+    vk::FormatFeatureFlags required = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst |
+                                      vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    return (features & required) == required;
+}
+
+PROJECT_API void MipGenerator::enqueue(vk::Image               image,
+                                       vk::Extent2D            extent,
+                                       uint32_t                mipLevels,
+                                       vk::ImageLayout         finalLayout,
+                                       vk::PipelineStageFlags2 dstStage)
+{
+    pending.push_back(
+        {.image = image, .extent = extent, .mipLevels = mipLevels, .finalLayout = finalLayout, .dstStage = dstStage});
+}
+
+PROJECT_API bool MipGenerator::hasPendingWork() const
+{
+    return not pending.empty();
+}
+
+PROJECT_API void MipGenerator::record(const vk::raii::CommandBuffer &commandBuffer)
+{
+    if (pending.empty())
+    {
+        return;
+    }
+    ZoneScoped;
+
+    std::vector<vk::ImageMemoryBarrier2> barriers;
+    auto flush = [&]()
+    {
+        if (not barriers.empty())
+        {
+            commandBuffer.pipelineBarrier2({.imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size()),
+                                            .pImageMemoryBarriers    = barriers.data()});
+            barriers.clear();
+        }
+    };
+
+    uint32_t maxLevels = 0;
+    for (const auto &request : pending)
+    {
+        maxLevels = std::max(maxLevels, request.mipLevels);
+        if (request.mipLevels > 1)
+        {
+            barriers.push_back(levelBarrier(request.image,
+                                            1,
+                                            request.mipLevels - 1,
+                                            vk::ImageLayout::eUndefined,
+                                            vk::ImageLayout::eTransferDstOptimal,
+                                            vk::PipelineStageFlagBits2::eNone,
+                                            {},
+                                            vk::PipelineStageFlagBits2::eBlit,
+                                            vk::AccessFlagBits2::eTransferWrite));
+        }
+    }
+    flush();
+
+    // Level n of every image is written from level n - 1, then becomes the
+    // source of level n + 1.
+    for (uint32_t mipLevel = 1; mipLevel < maxLevels; mipLevel++)
+    {
+        for (const auto &request : pending)
+        {
+            if (mipLevel >= request.mipLevels)
+            {
+                continue;
+            }
+            vk::ImageBlit2 region{
+                .srcSubresource = {vk::ImageAspectFlagBits::eColor, mipLevel - 1, 0, 1},
+                .srcOffsets     = {{vk::Offset3D{0, 0, 0},
+                                    vk::Offset3D{mipDimension(request.extent.width, mipLevel - 1),
+                                                 mipDimension(request.extent.height, mipLevel - 1),
+                                                 1}}},
+                .dstSubresource = {vk::ImageAspectFlagBits::eColor, mipLevel, 0, 1},
+                .dstOffsets     = {{vk::Offset3D{0, 0, 0},
+                                    vk::Offset3D{mipDimension(request.extent.width, mipLevel),
+                                                 mipDimension(request.extent.height, mipLevel),
+                                                 1}}}
+            };
+            commandBuffer.blitImage2({.srcImage       = request.image,
+                                      .srcImageLayout = vk::ImageLayout::eTransferSrcOptimal,
+                                      .dstImage       = request.image,
+                                      .dstImageLayout = vk::ImageLayout::eTransferDstOptimal,
+                                      .regionCount    = 1,
+                                      .pRegions       = &region,
+                                      .filter         = vk::Filter::eLinear});
+            barriers.push_back(levelBarrier(request.image,
+                                            mipLevel,
+                                            1,
+                                            vk::ImageLayout::eTransferDstOptimal,
+                                            vk::ImageLayout::eTransferSrcOptimal,
+                                            vk::PipelineStageFlagBits2::eBlit,
+                                            vk::AccessFlagBits2::eTransferWrite,
+                                            vk::PipelineStageFlagBits2::eBlit,
+                                            vk::AccessFlagBits2::eTransferRead));
+        }
+        flush();
+    }
+
+    for (const auto &request : pending)
+    {
+        barriers.push_back(levelBarrier(request.image,
+                                        0,
+                                        request.mipLevels,
+                                        vk::ImageLayout::eTransferSrcOptimal,
+                                        request.finalLayout,
+                                        vk::PipelineStageFlagBits2::eBlit,
+                                        vk::AccessFlagBits2::eTransferRead | vk::AccessFlagBits2::eTransferWrite,
+                                        request.dstStage,
+                                        vk::AccessFlagBits2::eShaderSampledRead));
+    }
+    flush();
+    pending.clear();
+}
+
+}  // namespace Graphics
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#include "config.hpp"
+
+namespace Graphics {
+
+/**
+ * @class MipGenerator
+ * @brief Generates mip chains on the GPU with linear blits.
+ *
+ * Images are queued and the whole queue is recorded at once: every blit of a
+ * given level, for all images, shares the same barrier batch, so the cost of
+ * the barriers doesn't grow with the number of textures. Blits need a graphics
+ * queue, record() goes in a graphics command buffer.
+ *
+ * A queued image has its level 0 in eTransferSrcOptimal, readable by blits
+ * (see UploadBatcher), the other levels are undefined.
+ */
+class PROJECT_API MipGenerator
+{
+    // Members
+   private:
+    struct Request
+    {
+        vk::Image               image;
+        vk::Extent2D            extent;
+        uint32_t                mipLevels;
+        vk::ImageLayout         finalLayout;
+        vk::PipelineStageFlags2 dstStage;
+    };
+
+    std::vector<Request> pending;
+
+    // Methods
+   public:
+    static uint32_t getMipLevelCount(vk::Extent2D extent);
+
+    /**
+     * @brief Whether the format can be blitted with linear filtering.
+     */
+    static bool supportsLinearBlit(const vk::raii::PhysicalDevice &physicalDevice, vk::Format format);
+
+    void enqueue(vk::Image               image,
+                 vk::Extent2D            extent,
+                 uint32_t                mipLevels,
+                 vk::ImageLayout         finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+                 vk::PipelineStageFlags2 dstStage    = vk::PipelineStageFlagBits2::eFragmentShader);
+
+    bool hasPendingWork() const;
+
+    /**
+     * @brief Record the generation of every queued image, leaving all their
+     * levels in their final layout.
+     */
+    void record(const vk::raii::CommandBuffer &commandBuffer);
+};
+
+}  // namespace Graphics
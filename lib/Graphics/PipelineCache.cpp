@@ -0,0 +1,170 @@
+#include "PipelineCache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "Utils/MappedFile.hpp"
+#include "profiling.hpp"
+
+namespace Graphics {
+
+namespace {
+
+constexpr uint32_t CACHE_MAGIC          = 0x43505641;  // "AVPC"
+constexpr uint32_t CACHE_HEADER_VERSION = 1;
+
+}  // namespace
+
+PROJECT_API PipelineCache::PipelineCache(const vk::raii::PhysicalDevice &physicalDevice,
+                                         const vk::raii::Device         &device,
+                                         const std::filesystem::path    &directory)
+    : device(device)
+{
+    ZoneScoped;
+    vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+    expectedHeader = {.magic         = CACHE_MAGIC,
+                      .headerVersion = CACHE_HEADER_VERSION,
+                      .vendorID      = properties.vendorID,
+                      .deviceID      = properties.deviceID,
+                      .driverVersion = properties.driverVersion,
+                      .reserved      = 0,
+                      .dataSize      = 0,
+                      .dataHash      = 0};
+    std::copy(properties.pipelineCacheUUID.begin(),
+              properties.pipelineCacheUUID.end(),
+              expectedHeader.pipelineCacheUUID.begin());
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    path = directory / getFilename(physicalDevice);
+
+    std::vector<uint8_t> data;
+    if (load(data))
+    {
+        loadedSize = data.size();
+        loadedHash = hash(data.data(), data.size());
+    }
+
+    vk::PipelineCacheCreateInfo createInfo{.initialDataSize = data.size(), .pInitialData = data.data()};
+    cache = vk::raii::PipelineCache(device, createInfo);
+}
+
+PROJECT_API const vk::raii::PipelineCache &PipelineCache::get() const
+{
+    return cache;
+}
+
+PROJECT_API const std::filesystem::path &PipelineCache::getPath() const
+{
+    return path;
+}
+
+PROJECT_API size_t PipelineCache::getLoadedSize() const
+{
+    return loadedSize;
+}
+
+PROJECT_API bool PipelineCache::save() const
+{
+    ZoneScoped;
+    std::vector<uint8_t> data     = cache.getData();
+    uint64_t             dataHash = hash(data.data(), data.size());
+    if (data.size() == loadedSize && dataHash == loadedHash)
+    {
+        return true;
+    }
+
+    FileHeader header = expectedHeader;
+    header.dataSize   = data.size();
+    header.dataHash   = dataHash;
+
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+        file.flush();
+        if (not file)
+        {
+            std::error_code error;
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+    }
+
+    // rename() replaces the destination atomically, readers see either the
+    // old or the new cache.
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error)
+    {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
+
+bool PipelineCache::load(std::vector<uint8_t> &data) const
+{
+    std::error_code error;
+    if (std::filesystem::file_size(path, error) <= sizeof(FileHeader) or error)
+    {
+        return false;
+    }
+
+    try
+    {
+        Utils::Handlers::MappedFile file(path.string());
+        FileHeader                  header;
+        std::memcpy(&header, file.getData(), sizeof(header));
+        const auto *blob = reinterpret_cast<const uint8_t *>(file.getData() + sizeof(header));
+        if (header.magic != expectedHeader.magic or header.headerVersion != expectedHeader.headerVersion or
+            header.vendorID != expectedHeader.vendorID or header.deviceID != expectedHeader.deviceID or
+            header.driverVersion != expectedHeader.driverVersion or
+            header.pipelineCacheUUID != expectedHeader.pipelineCacheUUID or
+            header.dataSize != file.getSize() - sizeof(header) or header.dataHash != hash(blob, header.dataSize))
+        {
+            return false;
+        }
+        data.assign(blob, blob + header.dataSize);
+    } catch (const std::runtime_error &)
+    {
+        return false;
+    }
+    return true;
+}
+
+uint64_t PipelineCache::hash(const uint8_t *data, size_t size)
+{
+    // FNV-1a, only meant to catch truncated or corrupted files.
+    uint64_t value = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++)
+    {
+        value = (value ^ data[i]) * 0x100000001b3ull;
+    }
+    return value;
+}
+
+std::string PipelineCache::getFilename(const vk::raii::PhysicalDevice &physicalDevice)
+{
+    auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceIDProperties>();
+    const vk::PhysicalDeviceIDProperties &idProperties = properties.get<vk::PhysicalDeviceIDProperties>();
+
+    std::ostringstream filename;
+    filename << "pipeline-";
+    for (uint8_t byte : idProperties.deviceUUID)
+    {
+        filename << std::hex << std::setw(2) << std::setfill('0') << static_cast<uint32_t>(byte);
+    }
+    filename << ".cache";
+    return filename.str();
+}
+
+}  // namespace Graphics
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#include "config.hpp"
+
+namespace Graphics {
+
+/**
+ * @class PipelineCache
+ * @brief vk::PipelineCache persisted on disk between runs.
+ *
+ * The blob is stored in one file per device (named after its device UUID),
+ * behind a header holding the driver version, the pipeline cache UUID and a
+ * hash of the data. Any mismatch, e.g. after a driver update, or a truncated
+ * file starts from an empty cache instead of handing bad data to the driver.
+ * save() writes a temporary file then renames it over the previous one, so a
+ * crash never leaves a partial cache behind.
+ */
+class PROJECT_API PipelineCache
+{
+    // Members
+   private:
+    struct FileHeader
+    {
+        uint32_t                magic;
+        uint32_t                headerVersion;
+        uint32_t                vendorID;
+        uint32_t                deviceID;
+        uint32_t                driverVersion;
+        std::array<uint8_t, 16> pipelineCacheUUID;
+        uint32_t                reserved;
+        uint64_t                dataSize;
+        uint64_t                dataHash;
+    };
+
+    const vk::raii::Device &device;
+    FileHeader              expectedHeader;
+    std::filesystem::path   path;
+    vk::raii::PipelineCache cache      = nullptr;
+    uint64_t                loadedHash = 0;
+    size_t                  loadedSize = 0;
+
+    // Methods
+   public:
+    /**
+     * @param directory where the cache file lives, created if missing.
+     */
+    PipelineCache(const vk::raii::PhysicalDevice &physicalDevice,
+                  const vk::raii::Device         &device,
+                  const std::filesystem::path    &directory);
+    PipelineCache(const PipelineCache &)            = delete;
+    PipelineCache &operator=(const PipelineCache &) = delete;
+
+    const vk::raii::PipelineCache &get() const;
+    const std::filesystem::path   &getPath() const;
+
+    /**
+     * @brief Size of the blob loaded at startup, 0 on a cold start.
+     */
+    size_t getLoadedSize() const;
+
+    /**
+     * @brief Write the cache back to disk, skipped when nothing was added since
+     * it was loaded.
+     * @return false when the file could not be written.
+     */
+    bool save() const;
+
+   private:
+    bool               load(std::vector<uint8_t> &data) const;
+    static uint64_t    hash(const uint8_t *data, size_t size);
+    static std::string getFilename(const vk::raii::PhysicalDevice &physicalDevice);
+};
+
+}  // namespace Graphics
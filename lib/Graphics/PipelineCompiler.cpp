@@ -0,0 +1,190 @@
+#include "PipelineCompiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "profiling.hpp"
+
+namespace Graphics {
+
+namespace {
+
+constexpr std::array<vk::GraphicsPipelineLibraryFlagBitsEXT, 4> LIBRARY_PARTS = {
+    vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface,
+    vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders,
+    vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader,
+    vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface};
+
+/**
+ * @brief Stages compiled by a part, the others must not be given to it.
+ */
+bool isStageOf(vk::ShaderStageFlagBits stage, vk::GraphicsPipelineLibraryFlagBitsEXT part)
+{
+    switch (part)
+    {
+        case vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders:
+            return stage != vk::ShaderStageFlagBits::eFragment;
+        case vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader:
+            return stage == vk::ShaderStageFlagBits::eFragment;
+        default:
+            return false;
+    }
+}
+
+}  // namespace
+
+PROJECT_API PipelineCompiler::PipelineCompiler(const vk::raii::PhysicalDevice &physicalDevice,
+                                               const vk::raii::Device         &device,
+                                               const vk::raii::PipelineCache  &cache,
+                                               Jobs::JobSystem                &jobSystem,
+                                               bool                            librariesEnabled) :
+    device(device), cache(cache), jobSystem(jobSystem)
+{
+    if (librariesEnabled)
+    {
+        // Slow linking would cost about a monolithic compilation per link.
+        auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2,
+                                                        vk::PhysicalDeviceGraphicsPipelineLibraryPropertiesEXT>();
+        libraries = properties.get<vk::PhysicalDeviceGraphicsPipelineLibraryPropertiesEXT>()
+                        .graphicsPipelineLibraryFastLinking;
+    }
+}
+
+PROJECT_API PipelineCompiler::Linker PipelineCompiler::compile(GraphicsDescription describe) const
+{
+    ZoneScoped;
+    if (libraries)
+    {
+        // Both qualities link the same libraries.
+        return [this, compiled = compileLibraries(describe)](PipelineQuality quality) {
+            return link(*compiled, quality);
+        };
+    }
+    return [this, describe = std::move(describe)](PipelineQuality quality) {
+        return buildMonolithic(describe, quality);
+    };
+}
+
+PROJECT_API vk::raii::Pipeline PipelineCompiler::build(const GraphicsDescription &describe,
+                                                       PipelineQuality            quality) const
+{
+    ZoneScoped;
+    if (libraries)
+    {
+        return link(*compileLibraries(describe), quality);
+    }
+    return buildMonolithic(describe, quality);
+}
+
+PROJECT_API bool PipelineCompiler::usesLibraries() const
+{
+    return libraries;
+}
+
+PROJECT_API bool PipelineCompiler::isSupported(const vk::raii::PhysicalDevice &physicalDevice)
+{
+    std::vector<vk::ExtensionProperties> extensions = physicalDevice.enumerateDeviceExtensionProperties();
+    for (const char *name : EXTENSIONS)
+    {
+        if (std::ranges::none_of(extensions, [name](const vk::ExtensionProperties &extension) {
+                return std::strcmp(extension.extensionName, name) == 0;
+            }))
+        {
+            return false;
+        }
+    }
+
+    auto features = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                                vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>();
+    return features.get<vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>().graphicsPipelineLibrary;
+}
+
+vk::raii::Pipeline PipelineCompiler::buildMonolithic(const GraphicsDescription &describe,
+                                                     PipelineQuality            quality) const
+{
+    ZoneScoped;
+    vk::raii::Pipeline pipeline = nullptr;
+    describe([&](const vk::GraphicsPipelineCreateInfo &info) {
+        vk::GraphicsPipelineCreateInfo monolithic = info;
+        if (quality == PipelineQuality::eFast)
+        {
+            monolithic.flags |= vk::PipelineCreateFlagBits::eDisableOptimization;
+        }
+        pipeline = vk::raii::Pipeline(device, cache, monolithic);
+    });
+    if (not *pipeline)
+    {
+        throw std::runtime_error("pipeline description didn't provide a create info!");
+    }
+    return pipeline;
+}
+
+std::shared_ptr<const PipelineCompiler::Libraries> PipelineCompiler::compileLibraries(
+    const GraphicsDescription &describe) const
+{
+    ZoneScoped;
+    auto compiled  = std::make_shared<Libraries>();
+    bool described = false;
+    describe([&](const vk::GraphicsPipelineCreateInfo &info) {
+        described        = true;
+        compiled->flags  = info.flags;
+        compiled->layout = info.layout;
+        // Retained so eOptimized can link them again with link time optimization.
+        vk::PipelineCreateFlags libraryFlags = info.flags | vk::PipelineCreateFlagBits::eLibraryKHR |
+                                               vk::PipelineCreateFlagBits::eRetainLinkTimeOptimizationInfoEXT;
+
+        // The shader parts are the expensive ones, they compile side by side.
+        jobSystem.wait(jobSystem.parallelFor(
+            static_cast<uint32_t>(LIBRARY_PARTS.size()),
+            1,
+            [&](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; i++)
+                {
+                    std::vector<vk::PipelineShaderStageCreateInfo> stages;
+                    for (uint32_t stage = 0; stage < info.stageCount; stage++)
+                    {
+                        if (isStageOf(info.pStages[stage].stage, LIBRARY_PARTS[i]))
+                        {
+                            stages.push_back(info.pStages[stage]);
+                        }
+                    }
+                    // State outside of the part is ignored, the create info is shared.
+                    vk::GraphicsPipelineLibraryCreateInfoEXT partInfo{.pNext = info.pNext, .flags = LIBRARY_PARTS[i]};
+                    vk::GraphicsPipelineCreateInfo           library = info;
+
+                    library.pNext      = &partInfo;
+                    library.flags      = libraryFlags;
+                    library.stageCount = static_cast<uint32_t>(stages.size());
+                    library.pStages    = stages.data();
+                    compiled->parts[i] = vk::raii::Pipeline(device, cache, library);
+                }
+            },
+            {},
+            "Pipeline library"));
+    });
+    if (not described)
+    {
+        throw std::runtime_error("pipeline description didn't provide a create info!");
+    }
+    return compiled;
+}
+
+vk::raii::Pipeline PipelineCompiler::link(const Libraries &libraries, PipelineQuality quality) const
+{
+    ZoneScoped;
+    std::array<vk::Pipeline, LIBRARY_PARTS.size()> handles;
+    std::ranges::transform(libraries.parts, handles.begin(), [](const vk::raii::Pipeline &part) { return *part; });
+    vk::PipelineLibraryCreateInfoKHR linkInfo{.libraryCount = static_cast<uint32_t>(handles.size()),
+                                              .pLibraries   = handles.data()};
+    vk::GraphicsPipelineCreateInfo   linked{.pNext = &linkInfo, .flags = libraries.flags, .layout = libraries.layout};
+    if (quality == PipelineQuality::eOptimized)
+    {
+        linked.flags |= vk::PipelineCreateFlagBits::eLinkTimeOptimizationEXT;
+    }
+    // The pipeline doesn't reference the libraries, they may go once linked.
+    return vk::raii::Pipeline(device, cache, linked);
+}
+
+}  // namespace Graphics
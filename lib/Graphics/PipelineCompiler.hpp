@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <memory>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#include "Jobs/JobSystem.hpp"
+#include "config.hpp"
+
+namespace Graphics {
+
+enum class PipelineQuality
+{
+    eFast,       // ready soonest, drawn with until the optimized one is built
+    eOptimized,  // what the driver does best, worth a background compilation
+};
+
+/**
+ * @class PipelineCompiler
+ * @brief Builds graphics pipelines from any thread, through the persistent
+ * pipeline cache.
+ *
+ * With VK_EXT_graphics_pipeline_library and fast linking, the four parts of a
+ * pipeline (vertex input, pre-rasterization shaders, fragment shader,
+ * fragment output) are compiled once as libraries, in parallel on the job
+ * system, retaining their link time optimization info. compile() returns a
+ * Linker holding them: eFast links them without link time optimization,
+ * which is nearly free once the libraries exist, eOptimized links the same
+ * libraries again with it. Otherwise the pipeline is monolithic, eFast
+ * disabling the driver optimizations.
+ *
+ * It only compiles, the caller decides what to draw with meanwhile, see
+ * Graphics::ShaderManager.
+ */
+class PROJECT_API PipelineCompiler
+{
+   public:
+    static constexpr std::array<const char *, 2> EXTENSIONS = {vk::KHRPipelineLibraryExtensionName,
+                                                               vk::EXTGraphicsPipelineLibraryExtensionName};
+
+    using CreateInfoVisitor = std::function<void(const vk::GraphicsPipelineCreateInfo &info)>;
+    /**
+     * @brief Fills a complete create info on its stack and hands it to visit,
+     * the state it points to only has to live during the call.
+     */
+    using GraphicsDescription = std::function<void(const CreateInfoVisitor &visit)>;
+    /**
+     * @brief Builds the compiled pipeline in a quality, blocking the calling
+     * thread. Keeps the libraries, or the description of a monolithic
+     * pipeline, alive until it is destroyed.
+     */
+    using Linker = std::function<vk::raii::Pipeline(PipelineQuality quality)>;
+
+    // Members
+   private:
+    struct Libraries
+    {
+        std::array<vk::raii::Pipeline, 4> parts = {nullptr, nullptr, nullptr, nullptr};
+        vk::PipelineCreateFlags           flags;  // of the description
+        vk::PipelineLayout                layout;
+    };
+
+    const vk::raii::Device        &device;
+    const vk::raii::PipelineCache &cache;
+    Jobs::JobSystem               &jobSystem;
+    bool                           libraries = false;
+
+    // Methods
+   public:
+    /**
+     * @param librariesEnabled the device was created with EXTENSIONS and the
+     * graphicsPipelineLibrary feature, see isSupported().
+     */
+    PipelineCompiler(const vk::raii::PhysicalDevice &physicalDevice,
+                     const vk::raii::Device         &device,
+                     const vk::raii::PipelineCache  &cache,
+                     Jobs::JobSystem                &jobSystem,
+                     bool                            librariesEnabled);
+    PipelineCompiler(const PipelineCompiler &)            = delete;
+    PipelineCompiler &operator=(const PipelineCompiler &) = delete;
+
+    /**
+     * @brief Thread safe, compiles the libraries before returning. The
+     * description is kept for monolithic pipelines, what it references must
+     * outlive the linker.
+     */
+    Linker compile(GraphicsDescription describe) const;
+
+    /**
+     * @brief Thread safe, blocks the calling thread until the pipeline is built.
+     */
+    vk::raii::Pipeline build(const GraphicsDescription &describe, PipelineQuality quality) const;
+
+    /**
+     * @brief Whether pipelines are linked from libraries, only when linking is fast.
+     */
+    bool usesLibraries() const;
+
+    static bool isSupported(const vk::raii::PhysicalDevice &physicalDevice);
+
+   private:
+    vk::raii::Pipeline buildMonolithic(const GraphicsDescription &describe, PipelineQuality quality) const;
+    vk::raii::Pipeline link(const Libraries &libraries, PipelineQuality quality) const;
+
+    std::shared_ptr<const Libraries> compileLibraries(const GraphicsDescription &describe) const;
+};
+
+}  // namespace Graphics
@@ -0,0 +1,171 @@
+#include "PresentPacer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "profiling.hpp"
+
+namespace Graphics {
+
+namespace {
+
+double millisecondsSince(std::chrono::steady_clock::time_point time)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - time).count();
+}
+
+}  // namespace
+
+PROJECT_API PresentPacer::PresentPacer(const vk::raii::Device &device, bool enabled, uint32_t maxQueuedPresents) :
+    device(device), enabled(enabled), maxQueuedPresents(std::max(1u, maxQueuedPresents)), inputTime(Clock::now())
+{
+    TracyPlotConfig("Input to present (ms)", tracy::PlotFormatType::Number, false, false, 0);
+    TracyPlotConfig("Input to photon (ms)", tracy::PlotFormatType::Number, false, false, 0);
+    TracyPlotConfig("Present wait (ms)", tracy::PlotFormatType::Number, false, false, 0);
+}
+
+PROJECT_API bool PresentPacer::isSupported(const vk::raii::PhysicalDevice &physicalDevice)
+{
+    std::vector<vk::ExtensionProperties> extensions = physicalDevice.enumerateDeviceExtensionProperties();
+    for (const char *name : EXTENSIONS)
+    {
+        if (std::ranges::none_of(extensions, [name](const vk::ExtensionProperties &extension) {
+                return std::strcmp(extension.extensionName, name) == 0;
+            }))
+        {
+            return false;
+        }
+    }
+
+    auto features = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                                vk::PhysicalDevicePresentIdFeaturesKHR,
+                                                vk::PhysicalDevicePresentWaitFeaturesKHR>();
+    return features.get<vk::PhysicalDevicePresentIdFeaturesKHR>().presentId &&
+           features.get<vk::PhysicalDevicePresentWaitFeaturesKHR>().presentWait;
+}
+
+PROJECT_API vk::PresentModeKHR PresentPacer::selectPresentMode(vk::PresentModeKHR                     preferred,
+                                                               const std::vector<vk::PresentModeKHR> &available)
+{
+    std::vector<vk::PresentModeKHR> candidates = {preferred};
+    switch (preferred)
+    {
+        case vk::PresentModeKHR::eImmediate:
+            candidates.push_back(vk::PresentModeKHR::eMailbox);
+            break;
+        case vk::PresentModeKHR::eMailbox:
+            candidates.push_back(vk::PresentModeKHR::eImmediate);
+            break;
+        default:
+            break;
+    }
+    for (vk::PresentModeKHR mode : candidates)
+    {
+        if (std::ranges::find(available, mode) != available.end())
+        {
+            return mode;
+        }
+    }
+    return vk::PresentModeKHR::eFifo;
+}
+
+PROJECT_API std::optional<vk::PresentModeKHR> PresentPacer::parsePresentMode(std::string_view name)
+{
+    if (name == "immediate")
+    {
+        return vk::PresentModeKHR::eImmediate;
+    }
+    if (name == "mailbox")
+    {
+        return vk::PresentModeKHR::eMailbox;
+    }
+    if (name == "fifo")
+    {
+        return vk::PresentModeKHR::eFifo;
+    }
+    if (name == "fifo-relaxed")
+    {
+        return vk::PresentModeKHR::eFifoRelaxed;
+    }
+    return std::nullopt;
+}
+
+PROJECT_API bool PresentPacer::isEnabled() const
+{
+    return enabled;
+}
+
+PROJECT_API uint32_t PresentPacer::getMaxQueuedPresents() const
+{
+    return maxQueuedPresents;
+}
+
+PROJECT_API void PresentPacer::setMaxQueuedPresents(uint32_t count)
+{
+    maxQueuedPresents = std::max(1u, count);
+}
+
+PROJECT_API void PresentPacer::waitForDisplay(const vk::raii::SwapchainKHR &swapChain)
+{
+    if (not enabled or presentId < maxQueuedPresents)
+    {
+        return;
+    }
+    ZoneScoped;
+    uint64_t          waitId    = presentId - maxQueuedPresents + 1;
+    Clock::time_point waitStart = Clock::now();
+    vk::Result        result    = vk::Result::eSuccess;
+    try
+    {
+        result = device.waitForPresentKHR(*swapChain, waitId, WAIT_TIMEOUT_NS);
+    } catch (const vk::OutOfDateKHRError &)
+    {
+        // The swapchain is recreated by the next present, the ids with it.
+        result = vk::Result::eErrorOutOfDateKHR;
+    }
+    TracyPlot("Present wait (ms)", millisecondsSince(waitStart));
+
+    if (result != vk::Result::eSuccess)
+    {
+        return;
+    }
+    // Every present up to waitId is on screen, now is the time its input
+    // turned into photons.
+    while (not pending.empty() and pending.front().presentId <= waitId)
+    {
+        if (pending.front().presentId == waitId)
+        {
+            TracyPlot("Input to photon (ms)", millisecondsSince(pending.front().inputTime));
+        }
+        pending.pop_front();
+    }
+}
+
+PROJECT_API void PresentPacer::markInputSampled()
+{
+    inputTime = Clock::now();
+}
+
+PROJECT_API uint64_t PresentPacer::beginPresent()
+{
+    TracyPlot("Input to present (ms)", millisecondsSince(inputTime));
+    if (not enabled)
+    {
+        return 0;
+    }
+    presentId++;
+    if (pending.size() == MAX_PENDING_PRESENTS)
+    {
+        pending.pop_front();
+    }
+    pending.push_back({.presentId = presentId, .inputTime = inputTime});
+    return presentId;
+}
+
+PROJECT_API void PresentPacer::reset()
+{
+    presentId = 0;
+    pending.clear();
+}
+
+}  // namespace Graphics
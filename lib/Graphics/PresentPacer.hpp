@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#include "config.hpp"
+
+namespace Graphics {
+
+/**
+ * @class PresentPacer
+ * @brief Present mode policy and latency pacing on VK_KHR_present_wait.
+ *
+ * Every present is tagged with a VK_KHR_present_id value. Before sampling the
+ * input of a frame the CPU waits until the previous frames are on screen,
+ * keeping at most getMaxQueuedPresents() frames between the input and the
+ * display instead of filling the swapchain queue. Waiting for a present also
+ * tells when its frame reached the screen, which gives the input to photon
+ * latency plotted to Tracy.
+ *
+ * Without present wait support pacing is left to the frame pacer and only the
+ * input to present latency is reported.
+ */
+class PROJECT_API PresentPacer
+{
+   public:
+    static constexpr uint64_t WAIT_TIMEOUT_NS      = 100'000'000;  // never stall on a hidden window
+    static constexpr size_t   MAX_PENDING_PRESENTS = 64;
+
+    static constexpr std::array<const char *, 2> EXTENSIONS = {vk::KHRPresentIdExtensionName,
+                                                               vk::KHRPresentWaitExtensionName};
+
+    // Members
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    struct PendingPresent
+    {
+        uint64_t          presentId;
+        Clock::time_point inputTime;
+    };
+
+    const vk::raii::Device    &device;
+    bool                       enabled;
+    uint32_t                   maxQueuedPresents;
+    uint64_t                   presentId = 0;  // last id given to a present
+    Clock::time_point          inputTime;
+    std::deque<PendingPresent> pending;
+
+    // Methods
+   public:
+    PresentPacer(const vk::raii::Device &device, bool enabled, uint32_t maxQueuedPresents = 1);
+    PresentPacer(const PresentPacer &)            = delete;
+    PresentPacer &operator=(const PresentPacer &) = delete;
+
+    /**
+     * @brief Whether the device exposes presentId and presentWait.
+     */
+    static bool isSupported(const vk::raii::PhysicalDevice &physicalDevice);
+
+    /**
+     * @brief The preferred mode when the surface has it, otherwise the closest
+     * one: IMMEDIATE and MAILBOX fall back to each other, FIFO_RELAXED to FIFO
+     * which is always available.
+     */
+    static vk::PresentModeKHR selectPresentMode(vk::PresentModeKHR                     preferred,
+                                                const std::vector<vk::PresentModeKHR> &available);
+
+    /**
+     * @brief "immediate", "mailbox", "fifo" or "fifo-relaxed".
+     */
+    static std::optional<vk::PresentModeKHR> parsePresentMode(std::string_view name);
+
+    bool     isEnabled() const;
+    uint32_t getMaxQueuedPresents() const;
+    void     setMaxQueuedPresents(uint32_t count);
+
+    /**
+     * @brief Block until at most getMaxQueuedPresents() presents are waiting
+     * for the screen. Call right before sampling the input of the next frame.
+     */
+    void waitForDisplay(const vk::raii::SwapchainKHR &swapChain);
+
+    /**
+     * @brief Timestamp the input the next present is built from.
+     */
+    void markInputSampled();
+
+    /**
+     * @brief Id to chain in vk::PresentIdKHR for the next present, 0 when
+     * present ids are not enabled.
+     */
+    uint64_t beginPresent();
+
+    /**
+     * @brief Present ids only grow within a swapchain, restart them on a new one.
+     */
+    void reset();
+};
+
+}  // namespace Graphics
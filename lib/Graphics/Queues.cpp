@@ -0,0 +1,100 @@
+#include "Queues.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Graphics {
+
+PROJECT_API bool QueueFamilies::hasDedicatedTransfer() const
+{
+    return transfer != graphics;
+}
+
+PROJECT_API bool QueueFamilies::hasAsyncCompute() const
+{
+    return compute != graphics;
+}
+
+PROJECT_API std::vector<uint32_t> QueueFamilies::getUniqueFamilies() const
+{
+    std::vector<uint32_t> families = {graphics};
+    for (uint32_t family : {transfer, compute})
+    {
+        if (std::ranges::find(families, family) == families.end())
+        {
+            families.push_back(family);
+        }
+    }
+    return families;
+}
+
+PROJECT_API QueueFamilies QueueFamilies::select(const vk::raii::PhysicalDevice &physicalDevice,
+                                                const vk::raii::SurfaceKHR     &surface)
+{
+    std::vector<vk::QueueFamilyProperties> queueFamilyProperties = physicalDevice.getQueueFamilyProperties();
+    QueueFamilies                          families;
+
+    for (uint32_t qfpIndex = 0; qfpIndex < queueFamilyProperties.size(); qfpIndex++)
+    {
+        if ((queueFamilyProperties[qfpIndex].queueFlags & vk::QueueFlagBits::eGraphics) &&
+            (not *surface || physicalDevice.getSurfaceSupportKHR(qfpIndex, *surface)))
+        {
+            families.graphics = qfpIndex;
+            break;
+        }
+    }
+    if (families.graphics == INVALID)
+    {
+        throw std::runtime_error("Could not find a queue for graphics and present -> terminating");
+    }
+
+    // Copies of arbitrary image regions need a 1x1x1 transfer granularity,
+    // some DMA queues only move whole tiles.
+    auto canCopyAnyRegion = [](vk::QueueFamilyProperties const &qfp) {
+        auto granularity = qfp.minImageTransferGranularity;
+        return granularity.width == 1 && granularity.height == 1 && granularity.depth == 1;
+    };
+
+    uint32_t transferWithCompute = INVALID;
+    for (uint32_t qfpIndex = 0; qfpIndex < queueFamilyProperties.size(); qfpIndex++)
+    {
+        auto const &qfp = queueFamilyProperties[qfpIndex];
+        if (not(qfp.queueFlags & vk::QueueFlagBits::eTransfer) || (qfp.queueFlags & vk::QueueFlagBits::eGraphics) ||
+            not canCopyAnyRegion(qfp))
+        {
+            continue;
+        }
+        if (not(qfp.queueFlags & vk::QueueFlagBits::eCompute))
+        {
+            families.transfer = qfpIndex;
+            break;
+        }
+        if (transferWithCompute == INVALID)
+        {
+            transferWithCompute = qfpIndex;
+        }
+    }
+    if (families.transfer == INVALID)
+    {
+        families.transfer = transferWithCompute != INVALID ? transferWithCompute : families.graphics;
+    }
+
+    // Prefer a compute family that doesn't also carry the uploads.
+    for (uint32_t qfpIndex = 0; qfpIndex < queueFamilyProperties.size(); qfpIndex++)
+    {
+        auto const &qfp = queueFamilyProperties[qfpIndex];
+        if ((qfp.queueFlags & vk::QueueFlagBits::eCompute) && not(qfp.queueFlags & vk::QueueFlagBits::eGraphics) &&
+            (families.compute == INVALID || families.compute == families.transfer))
+        {
+            families.compute = qfpIndex;
+        }
+    }
+    if (families.compute == INVALID)
+    {
+        families.compute = families.graphics;
+    }
+
+    return families;
+}
+
+}  // namespace Graphics
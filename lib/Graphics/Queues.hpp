@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#include "config.hpp"
+
+namespace Graphics {
+
+/**
+ * @brief Queue families used by the engine.
+ *
+ * transfer and compute fall back to the graphics family when the hardware has
+ * no dedicated family for them, so callers can always use all three.
+ */
+struct PROJECT_API QueueFamilies
+{
+    static constexpr uint32_t INVALID = ~0u;
+
+    uint32_t graphics = INVALID;  // graphics + present
+    uint32_t transfer = INVALID;  // transfer only (DMA engine) when available
+    uint32_t compute  = INVALID;  // compute without graphics when available
+
+    bool hasDedicatedTransfer() const;
+    bool hasAsyncCompute() const;
+
+    /**
+     * @brief Distinct families, one vk::DeviceQueueCreateInfo each.
+     */
+    std::vector<uint32_t> getUniqueFamilies() const;
+
+    /**
+     * @param surface null when nothing is presented (headless), graphics is
+     * then the first graphics family.
+     */
+    static QueueFamilies select(const vk::raii::PhysicalDevice &physicalDevice, const vk::raii::SurfaceKHR &surface);
+};
+
+}  // namespace Graphics
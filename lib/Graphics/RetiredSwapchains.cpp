@@ -0,0 +1,164 @@
+#include "RetiredSwapchains.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <span>
+
+#include "profiling.hpp"
+
+namespace Graphics {
+
+namespace {
+
+bool hasExtensions(const std::vector<vk::ExtensionProperties> &available, std::span<const char *const> names)
+{
+    return std::ranges::all_of(names, [&available](const char *name) {
+        return std::ranges::any_of(available, [name](const vk::ExtensionProperties &extension) {
+            return std::strcmp(extension.extensionName, name) == 0;
+        });
+    });
+}
+
+}  // namespace
+
+PROJECT_API RetiredSwapchains::RetiredSwapchains(const vk::raii::Device &device, bool presentFences) :
+    device(device), presentFences(presentFences)
+{
+    TracyPlotConfig("Retired swapchains", tracy::PlotFormatType::Number, true, false, 0);
+}
+
+PROJECT_API RetiredSwapchains::~RetiredSwapchains()
+{
+    waitForPresents();
+}
+
+PROJECT_API bool RetiredSwapchains::isInstanceSupported(const vk::raii::Context &context)
+{
+    return hasExtensions(context.enumerateInstanceExtensionProperties(), INSTANCE_EXTENSIONS);
+}
+
+PROJECT_API bool RetiredSwapchains::isSupported(const vk::raii::PhysicalDevice &physicalDevice)
+{
+    if (not hasExtensions(physicalDevice.enumerateDeviceExtensionProperties(), EXTENSIONS))
+    {
+        return false;
+    }
+    auto features = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                                vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>();
+    return features.get<vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>().swapchainMaintenance1;
+}
+
+PROJECT_API bool RetiredSwapchains::hasPresentFences() const
+{
+    return presentFences;
+}
+
+PROJECT_API vk::Fence RetiredSwapchains::beginPresent()
+{
+    if (not presentFences)
+    {
+        return nullptr;
+    }
+    // Presents complete in order, the signaled fences are at the front.
+    while (not pendingFences.empty() and isSignaled(pendingFences.front()))
+    {
+        recycle(std::move(pendingFences.front()));
+        pendingFences.pop_front();
+    }
+    if (freeFences.empty())
+    {
+        pendingFences.emplace_back(device, vk::FenceCreateInfo{});
+    }
+    else
+    {
+        pendingFences.push_back(std::move(freeFences.back()));
+        freeFences.pop_back();
+    }
+    return *pendingFences.back();
+}
+
+PROJECT_API void RetiredSwapchains::retire(vk::raii::SwapchainKHR           swapChain,
+                                           std::vector<vk::raii::ImageView> imageViews,
+                                           std::vector<vk::raii::Semaphore> semaphores,
+                                           uint64_t                         frameValue)
+{
+    Retired entry{.swapChain     = std::move(swapChain),
+                  .imageViews    = std::move(imageViews),
+                  .semaphores    = std::move(semaphores),
+                  .presentFences = {},
+                  .frameValue    = frameValue};
+    for (vk::raii::Fence &fence : pendingFences)
+    {
+        entry.presentFences.push_back(std::move(fence));
+    }
+    pendingFences.clear();
+    retired.push_back(std::move(entry));
+    TracyPlot("Retired swapchains", static_cast<int64_t>(retired.size()));
+}
+
+PROJECT_API void RetiredSwapchains::collect(uint64_t completedValue)
+{
+    if (retired.empty())
+    {
+        return;
+    }
+    ZoneScoped;
+    for (auto it = retired.begin(); it != retired.end();)
+    {
+        bool done = presentFences ? std::ranges::all_of(it->presentFences,
+                                                        [this](const vk::raii::Fence &fence) {
+                                                            return isSignaled(fence);
+                                                        })
+                                  : completedValue >= it->frameValue;
+        if (not done)
+        {
+            ++it;
+            continue;
+        }
+        for (vk::raii::Fence &fence : it->presentFences)
+        {
+            recycle(std::move(fence));
+        }
+        it = retired.erase(it);
+    }
+    TracyPlot("Retired swapchains", static_cast<int64_t>(retired.size()));
+}
+
+PROJECT_API void RetiredSwapchains::waitForPresents()
+{
+    std::vector<vk::Fence> fences;
+    for (const Retired &entry : retired)
+    {
+        for (const vk::raii::Fence &fence : entry.presentFences)
+        {
+            fences.push_back(*fence);
+        }
+    }
+    for (const vk::raii::Fence &fence : pendingFences)
+    {
+        fences.push_back(*fence);
+    }
+    if (not fences.empty())
+    {
+        // Timeouts are ignored, the swapchains are destroyed either way.
+        (void)device.waitForFences(fences, vk::True, SHUTDOWN_TIMEOUT_NS);
+    }
+}
+
+PROJECT_API size_t RetiredSwapchains::getRetiredCount() const
+{
+    return retired.size();
+}
+
+bool RetiredSwapchains::isSignaled(const vk::raii::Fence &fence) const
+{
+    return fence.getStatus() == vk::Result::eSuccess;
+}
+
+void RetiredSwapchains::recycle(vk::raii::Fence &&fence)
+{
+    device.resetFences(*fence);
+    freeFences.push_back(std::move(fence));
+}
+
+}  // namespace Graphics
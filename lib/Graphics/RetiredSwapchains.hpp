@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#include "config.hpp"
+
+namespace Graphics {
+
+/**
+ * @class RetiredSwapchains
+ * @brief Keeps replaced swapchains alive until their presents are done, so a
+ * resize never waits for the device.
+ *
+ * The new swapchain takes over through oldSwapchain and the old one waits
+ * here with its image views and present semaphores. With
+ * VK_EXT_swapchain_maintenance1 every present signals a fence and a retired
+ * swapchain is destroyed once the fences of its presents are signaled.
+ * Without it presentation can't be observed: the swapchain is destroyed once
+ * the GPU completed a frame submitted after its retirement, its presents were
+ * queued before that frame.
+ */
+class PROJECT_API RetiredSwapchains
+{
+   public:
+    static constexpr uint64_t SHUTDOWN_TIMEOUT_NS = 1'000'000'000;  // a lost present doesn't hang the exit
+
+    // Instance extensions VK_EXT_swapchain_maintenance1 depends on.
+    static constexpr std::array<const char *, 2> INSTANCE_EXTENSIONS = {vk::KHRGetSurfaceCapabilities2ExtensionName,
+                                                                        vk::EXTSurfaceMaintenance1ExtensionName};
+    static constexpr std::array<const char *, 1> EXTENSIONS          = {vk::EXTSwapchainMaintenance1ExtensionName};
+
+    // Members
+   private:
+    struct Retired
+    {
+        vk::raii::SwapchainKHR           swapChain = nullptr;
+        std::vector<vk::raii::ImageView> imageViews;
+        std::vector<vk::raii::Semaphore> semaphores;
+        std::vector<vk::raii::Fence>     presentFences;
+        uint64_t                         frameValue = 0;  // first frame recorded after the retirement
+    };
+
+    const vk::raii::Device      &device;
+    bool                         presentFences;
+    std::deque<vk::raii::Fence>  pendingFences;  // presents to the current swapchain, oldest first
+    std::vector<vk::raii::Fence> freeFences;
+    std::deque<Retired>          retired;
+
+    // Methods
+   public:
+    /**
+     * @param presentFences swapchainMaintenance1 is enabled on the device.
+     */
+    RetiredSwapchains(const vk::raii::Device &device, bool presentFences);
+    RetiredSwapchains(const RetiredSwapchains &)            = delete;
+    RetiredSwapchains &operator=(const RetiredSwapchains &) = delete;
+    ~RetiredSwapchains();
+
+    static bool isInstanceSupported(const vk::raii::Context &context);
+    /**
+     * @brief Whether the device exposes swapchainMaintenance1. The instance
+     * needs INSTANCE_EXTENSIONS.
+     */
+    static bool isSupported(const vk::raii::PhysicalDevice &physicalDevice);
+
+    bool hasPresentFences() const;
+
+    /**
+     * @brief Fence to chain in vk::SwapchainPresentFenceInfoEXT for the next
+     * present to the current swapchain, null without present fences.
+     */
+    vk::Fence beginPresent();
+
+    /**
+     * @brief Hand over a replaced swapchain, right after its replacement was
+     * created.
+     * @param semaphores waited for by its presents.
+     * @param frameValue FramePacer value of the next frame recorded.
+     */
+    void retire(vk::raii::SwapchainKHR           swapChain,
+                std::vector<vk::raii::ImageView> imageViews,
+                std::vector<vk::raii::Semaphore> semaphores,
+                uint64_t                         frameValue);
+
+    /**
+     * @brief Destroy the swapchains done presenting, never waits.
+     * @param completedValue FramePacer::getCompletedValue().
+     */
+    void collect(uint64_t completedValue);
+
+    /**
+     * @brief Wait for every present fence, before the current swapchain is
+     * destroyed on exit.
+     */
+    void waitForPresents();
+
+    size_t getRetiredCount() const;
+
+   private:
+    bool isSignaled(const vk::raii::Fence &fence) const;
+    void recycle(vk::raii::Fence &&fence);
+};
+
+}  // namespace Graphics
@@ -0,0 +1,435 @@
+#include "ShaderManager.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <system_error>
+
+#if defined(SHADER_HOT_RELOAD)
+#    include <slang-com-ptr.h>
+#    include <slang.h>
+#endif
+
+#include "profiling.hpp"
+
+namespace Graphics {
+
+#if defined(SHADER_HOT_RELOAD)
+
+struct ShaderManager::Compiler
+{
+    Slang::ComPtr<slang::IGlobalSession> globalSession;
+    std::vector<std::string>             searchPaths;
+    std::mutex                           mutex;  // a global session is single threaded
+};
+
+namespace {
+
+slang::CompilerOptionEntry enableOption(slang::CompilerOptionName name)
+{
+    slang::CompilerOptionEntry entry;
+    entry.name            = name;
+    entry.value.kind      = slang::CompilerOptionValueKind::Int;
+    entry.value.intValue0 = 1;
+    return entry;
+}
+
+std::string getDiagnostics(slang::IBlob *diagnostics)
+{
+    if (diagnostics == nullptr)
+    {
+        return "unknown error";
+    }
+    return std::string(static_cast<const char *>(diagnostics->getBufferPointer()), diagnostics->getBufferSize());
+}
+
+}  // namespace
+
+#else
+
+struct ShaderManager::Compiler
+{
+};
+
+#endif
+
+PROJECT_API vk::SpecializationInfo Specialization::getInfo() const
+{
+    return {.mapEntryCount = static_cast<uint32_t>(entries.size()),
+            .pMapEntries   = entries.data(),
+            .dataSize      = data.size() * sizeof(uint32_t),
+            .pData         = data.data()};
+}
+
+PROJECT_API Specialization &Specialization::setWord(uint32_t constantId, uint32_t word)
+{
+    auto it = std::find_if(entries.begin(), entries.end(), [constantId](const vk::SpecializationMapEntry &entry) {
+        return entry.constantID == constantId;
+    });
+    if (it != entries.end())
+    {
+        data[it->offset / sizeof(uint32_t)] = word;
+        return *this;
+    }
+    entries.push_back({.constantID = constantId,
+                       .offset     = static_cast<uint32_t>(data.size() * sizeof(uint32_t)),
+                       .size       = sizeof(uint32_t)});
+    data.push_back(word);
+    return *this;
+}
+
+PROJECT_API ShaderManager::ShaderManager(Jobs::JobSystem                &jobSystem,
+                                         SpirvLoader                     loader,
+                                         const std::vector<std::string> &searchPaths) :
+    jobSystem(jobSystem), loader(std::move(loader)), nextPoll(std::chrono::steady_clock::now() + POLL_INTERVAL)
+{
+#if defined(SHADER_HOT_RELOAD)
+    compiler = std::make_unique<Compiler>();
+    if (SLANG_FAILED(slang::createGlobalSession(compiler->globalSession.writeRef())))
+    {
+        throw std::runtime_error("failed to create the Slang global session!");
+    }
+    compiler->searchPaths = searchPaths;
+#else
+    static_cast<void>(searchPaths);
+#endif
+}
+
+PROJECT_API ShaderManager::~ShaderManager()
+{
+    for (const Jobs::JobHandle &job : jobs)
+    {
+        jobSystem.wait(job);
+    }
+}
+
+PROJECT_API ShaderManager::ProgramId ShaderManager::addProgram(const ShaderProgramDesc &desc)
+{
+    ZoneScoped;
+    auto it = std::find_if(programs.begin(), programs.end(), [&desc](const Program &program) {
+        return program.desc == desc;
+    });
+    if (it != programs.end())
+    {
+        return static_cast<ProgramId>(it - programs.begin());
+    }
+    Program &program   = programs.emplace_back();
+    program.desc       = desc;
+    program.spirv      = compile(desc, program.dependencies);
+    program.writeTimes = getWriteTimes(program.dependencies);
+    return static_cast<ProgramId>(programs.size() - 1);
+}
+
+PROJECT_API ShaderManager::PipelineId ShaderManager::addPipeline(ProgramId program, PipelineBuilder builder)
+{
+    ZoneScoped;
+    PipelineId id       = static_cast<PipelineId>(pipelines.size());
+    Pipeline  &pipeline = pipelines.emplace_back();
+    pipeline.program    = program;
+    pipeline.builder    = std::move(builder);
+    scheduleBuild(id);
+    return id;
+}
+
+PROJECT_API void ShaderManager::setBuilder(PipelineId id, PipelineBuilder builder)
+{
+    ZoneScoped;
+    Pipeline &pipeline = pipelines[id];
+    pipeline.builder   = std::move(builder);
+    // Results of the builds in progress are dropped from now on.
+    pipeline.generation++;
+    scheduleBuild(id);
+}
+
+PROJECT_API vk::Pipeline ShaderManager::getPipeline(PipelineId pipeline) const
+{
+    return *pipelines[pipeline].pipeline;
+}
+
+PROJECT_API void ShaderManager::waitForPipeline(PipelineId id)
+{
+    ZoneScoped;
+    jobSystem.wait(pipelines[id].fastBuild);
+    applyRebuilds();
+    if (not *pipelines[id].pipeline)
+    {
+        throw std::runtime_error("failed to build pipeline, " + (errors.empty() ? std::string() : errors.back()));
+    }
+}
+
+PROJECT_API void ShaderManager::update(uint64_t frameValue, uint64_t completedValue)
+{
+    ZoneScoped;
+    lastFrameValue = frameValue;
+    applyRebuilds();
+    retired.collect(completedValue);
+    std::erase_if(jobs, [](const Jobs::JobHandle &job) { return job->isFinished(); });
+
+    auto now = std::chrono::steady_clock::now();
+    if (not compiler || now < nextPoll)
+    {
+        return;
+    }
+    nextPoll = now + POLL_INTERVAL;
+    for (ProgramId id = 0; id < programs.size(); id++)
+    {
+        Program &program = programs[id];
+        if (program.dependencies.empty() || (program.rebuild && not program.rebuild->isFinished()))
+        {
+            continue;
+        }
+        std::vector<std::filesystem::file_time_type> writeTimes = getWriteTimes(program.dependencies);
+        if (writeTimes != program.writeTimes)
+        {
+            // Not retried until the next change, even if it fails.
+            program.writeTimes = std::move(writeTimes);
+            scheduleRebuild(id);
+        }
+    }
+}
+
+PROJECT_API std::vector<std::string> ShaderManager::takeErrors()
+{
+    return std::exchange(errors, {});
+}
+
+PROJECT_API bool ShaderManager::isHotReloadEnabled() const
+{
+    return compiler != nullptr;
+}
+
+std::vector<uint32_t> ShaderManager::compile(const ShaderProgramDesc            &desc,
+                                             std::vector<std::filesystem::path> &dependencies)
+{
+    ZoneScoped;
+    dependencies.clear();
+#if defined(SHADER_HOT_RELOAD)
+    bool found = std::any_of(compiler->searchPaths.begin(), compiler->searchPaths.end(), [&desc](auto &path) {
+        return std::filesystem::exists(std::filesystem::path(path) / (desc.module + ".slang"));
+    });
+    if (found)
+    {
+        std::lock_guard lock(compiler->mutex);
+
+        std::vector<const char *> searchPaths;
+        for (const std::string &path : compiler->searchPaths)
+        {
+            searchPaths.push_back(path.c_str());
+        }
+        std::vector<slang::PreprocessorMacroDesc> macros;
+        for (const auto &[name, value] : desc.defines)
+        {
+            macros.push_back({name.c_str(), value.c_str()});
+        }
+        // Same options as add_slang_shader_target, so both compile the same SPIR-V.
+        std::array<slang::CompilerOptionEntry, 2> options = {
+            enableOption(slang::CompilerOptionName::EmitSpirvDirectly),
+            enableOption(slang::CompilerOptionName::VulkanUseEntryPointName)};
+        slang::TargetDesc target;
+        target.format                   = SLANG_SPIRV;
+        target.profile                  = compiler->globalSession->findProfile("spirv_1_4");
+        target.compilerOptionEntries    = options.data();
+        target.compilerOptionEntryCount = static_cast<uint32_t>(options.size());
+        slang::SessionDesc sessionDesc;
+        sessionDesc.targets                 = &target;
+        sessionDesc.targetCount             = 1;
+        sessionDesc.defaultMatrixLayoutMode = SLANG_MATRIX_LAYOUT_COLUMN_MAJOR;
+        sessionDesc.searchPaths             = searchPaths.data();
+        sessionDesc.searchPathCount         = static_cast<SlangInt>(searchPaths.size());
+        sessionDesc.preprocessorMacros      = macros.data();
+        sessionDesc.preprocessorMacroCount  = static_cast<SlangInt>(macros.size());
+
+        // A new session each time: sessions cache the modules they loaded.
+        Slang::ComPtr<slang::ISession> session;
+        if (SLANG_FAILED(compiler->globalSession->createSession(sessionDesc, session.writeRef())))
+        {
+            throw std::runtime_error("failed to create a Slang session!");
+        }
+        Slang::ComPtr<slang::IBlob> diagnostics;
+        slang::IModule             *module = session->loadModule(desc.module.c_str(), diagnostics.writeRef());
+        if (module == nullptr)
+        {
+            throw std::runtime_error(getDiagnostics(diagnostics));
+        }
+        for (SlangInt32 i = 0; i < module->getDependencyFileCount(); i++)
+        {
+            dependencies.emplace_back(module->getDependencyFilePath(i));
+        }
+
+        std::vector<Slang::ComPtr<slang::IEntryPoint>> entryPoints(desc.entryPoints.size());
+        std::vector<slang::IComponentType *>           components = {module};
+        for (size_t i = 0; i < desc.entryPoints.size(); i++)
+        {
+            if (SLANG_FAILED(module->findEntryPointByName(desc.entryPoints[i].c_str(), entryPoints[i].writeRef())))
+            {
+                throw std::runtime_error("entry point not found: " + desc.entryPoints[i]);
+            }
+            components.push_back(entryPoints[i]);
+        }
+        Slang::ComPtr<slang::IComponentType> composed;
+        Slang::ComPtr<slang::IComponentType> linked;
+        Slang::ComPtr<slang::IBlob>          code;
+        if (SLANG_FAILED(session->createCompositeComponentType(components.data(),
+                                                               static_cast<SlangInt>(components.size()),
+                                                               composed.writeRef(),
+                                                               diagnostics.writeRef())) ||
+            SLANG_FAILED(composed->link(linked.writeRef(), diagnostics.writeRef())) ||
+            SLANG_FAILED(linked->getTargetCode(0, code.writeRef(), diagnostics.writeRef())))
+        {
+            throw std::runtime_error(getDiagnostics(diagnostics));
+        }
+        const uint32_t *words = static_cast<const uint32_t *>(code->getBufferPointer());
+        return std::vector<uint32_t>(words, words + code->getBufferSize() / sizeof(uint32_t));
+    }
+#endif
+    return loader(desc.precompiled);
+}
+
+void ShaderManager::scheduleBuild(PipelineId id)
+{
+    // The jobs only read their copies, the manager may grow meanwhile.
+    Pipeline &pipeline = pipelines[id];
+    ProgramId program  = pipeline.program;
+    auto      targets  = std::make_shared<const std::vector<BuildTarget>>(
+        1, BuildTarget{id, pipeline.generation, pipeline.builder});
+    auto spirv   = std::make_shared<const std::vector<uint32_t>>(programs[program].spirv);
+    auto linkers = std::make_shared<std::vector<PipelineCompiler::Linker>>();
+    auto build   = [this, program, module = programs[program].desc.module, targets, spirv, linkers](
+                     PipelineQuality quality) {
+        publish(ShaderManager::build(program, module, *targets, *spirv, *linkers, quality));
+    };
+    // Draws can start with the fast version, the optimized one replaces it.
+    pipeline.fastBuild = jobSystem.schedule([build]() { build(PipelineQuality::eFast); }, {}, "Pipeline build");
+    jobs.push_back(pipeline.fastBuild);
+    jobs.push_back(jobSystem.schedule([build]() { build(PipelineQuality::eOptimized); },
+                                      {pipeline.fastBuild},
+                                      "Pipeline build"));
+}
+
+void ShaderManager::scheduleRebuild(ProgramId id)
+{
+    // Results of the builds in progress are dropped from now on.
+    std::vector<BuildTarget> targets;
+    for (PipelineId pipeline = 0; pipeline < pipelines.size(); pipeline++)
+    {
+        if (pipelines[pipeline].program == id)
+        {
+            targets.push_back({pipeline, ++pipelines[pipeline].generation, pipelines[pipeline].builder});
+        }
+    }
+    programs[id].rebuild = jobSystem.schedule(
+        [this, id, desc = programs[id].desc, targets = std::move(targets)]() {
+            ZoneScopedN("Shader rebuild");
+            std::vector<uint32_t>              spirv;
+            std::vector<std::filesystem::path> dependencies;
+            try
+            {
+                spirv = compile(desc, dependencies);
+            } catch (const std::exception &e)
+            {
+                Rebuild failed;
+                failed.program = id;
+                failed.error   = desc.module + ": " + e.what();
+                publish(std::move(failed));
+                return;
+            }
+            // The program changes with its fast pipelines, the optimized ones follow.
+            std::vector<PipelineCompiler::Linker> linkers;
+            Rebuild fast = build(id, desc.module, targets, spirv, linkers, PipelineQuality::eFast);
+            if (not fast.error.empty())
+            {
+                publish(std::move(fast));
+                return;
+            }
+            fast.compiled     = true;
+            fast.spirv        = spirv;
+            fast.writeTimes   = getWriteTimes(dependencies);
+            fast.dependencies = std::move(dependencies);
+            publish(std::move(fast));
+            publish(build(id, desc.module, targets, spirv, linkers, PipelineQuality::eOptimized));
+        },
+        {},
+        "Shader rebuild");
+    jobs.push_back(programs[id].rebuild);
+}
+
+ShaderManager::Rebuild ShaderManager::build(ProgramId                              program,
+                                            const std::string                     &module,
+                                            std::span<const BuildTarget>           targets,
+                                            std::span<const uint32_t>              spirv,
+                                            std::vector<PipelineCompiler::Linker> &linkers,
+                                            PipelineQuality                        quality)
+{
+    ZoneScoped;
+    Rebuild rebuild;
+    rebuild.program = program;
+    try
+    {
+        for (size_t i = linkers.size(); i < targets.size(); i++)
+        {
+            linkers.push_back(targets[i].builder(spirv));
+        }
+        for (size_t i = 0; i < targets.size(); i++)
+        {
+            rebuild.pipelines.push_back({targets[i].pipeline, targets[i].generation, linkers[i](quality)});
+        }
+    } catch (const std::exception &e)
+    {
+        rebuild.pipelines.clear();
+        rebuild.error = module + ": " + e.what();
+    }
+    return rebuild;
+}
+
+void ShaderManager::publish(Rebuild &&rebuild)
+{
+    std::lock_guard lock(rebuildMutex);
+    rebuilds.push_back(std::move(rebuild));
+}
+
+void ShaderManager::applyRebuilds()
+{
+    std::lock_guard lock(rebuildMutex);
+    for (Rebuild &rebuild : rebuilds)
+    {
+        if (not rebuild.error.empty())
+        {
+            errors.push_back(std::move(rebuild.error));
+            continue;
+        }
+        if (rebuild.compiled)
+        {
+            Program &program     = programs[rebuild.program];
+            program.spirv        = std::move(rebuild.spirv);
+            program.dependencies = std::move(rebuild.dependencies);
+            program.writeTimes   = std::move(rebuild.writeTimes);
+        }
+        for (BuiltPipeline &built : rebuild.pipelines)
+        {
+            Pipeline &pipeline = pipelines[built.pipeline];
+            if (built.generation != pipeline.generation)
+            {
+                continue;  // superseded by a later rebuild, never drawn with
+            }
+            // Frames up to the last submitted one may still draw with the previous one.
+            retired.retire(lastFrameValue, std::move(pipeline.pipeline));
+            pipeline.pipeline = std::move(built.result);
+        }
+    }
+    rebuilds.clear();
+}
+
+std::vector<std::filesystem::file_time_type> ShaderManager::getWriteTimes(
+    std::span<const std::filesystem::path> files)
+{
+    std::vector<std::filesystem::file_time_type> writeTimes;
+    for (const std::filesystem::path &file : files)
+    {
+        // A file being saved may be briefly missing, that is a change too.
+        std::error_code error;
+        writeTimes.push_back(std::filesystem::last_write_time(file, error));
+    }
+    return writeTimes;
+}
+
+}  // namespace Graphics
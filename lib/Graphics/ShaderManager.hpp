@@ -0,0 +1,277 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#include "DeletionQueue.hpp"
+#include "Jobs/JobSystem.hpp"
+#include "PipelineCompiler.hpp"
+#include "config.hpp"
+
+namespace Graphics {
+
+/**
+ * @class Specialization
+ * @brief Specialization constant values of a pipeline permutation.
+ *
+ * The driver folds the values into the shader when the pipeline is built, a
+ * branch on a [vk::constant_id] costs nothing at run time and a new
+ * permutation needs no recompilation. Values are 32-bit: bool, int, uint or
+ * float.
+ */
+class PROJECT_API Specialization
+{
+    // Members
+   private:
+    std::vector<vk::SpecializationMapEntry> entries;
+    std::vector<uint32_t>                   data;
+
+    // Methods
+   public:
+    template <typename T>
+    Specialization &set(uint32_t constantId, T value)
+    {
+        static_assert(std::is_same_v<T, bool> || (std::is_arithmetic_v<T> && sizeof(T) == sizeof(uint32_t)),
+                      "specialization constants are bool or 32-bit scalars");
+        uint32_t word = 0;
+        if constexpr (std::is_same_v<T, bool>)
+        {
+            word = value ? vk::True : vk::False;
+        }
+        else
+        {
+            std::memcpy(&word, &value, sizeof(word));
+        }
+        return setWord(constantId, word);
+    }
+
+    /**
+     * @brief Points into this object, valid until the next set().
+     */
+    vk::SpecializationInfo getInfo() const;
+
+   private:
+    Specialization &setWord(uint32_t constantId, uint32_t word);
+};
+
+/**
+ * @brief Slang module compiled to one SPIR-V blob holding its entry points.
+ */
+struct ShaderProgramDesc
+{
+    std::string                                      module;  // Slang module name, e.g. "shader_base"
+    std::vector<std::string>                         entryPoints;
+    std::vector<std::pair<std::string, std::string>> defines;      // preprocessor permutation, recompiled
+    std::string                                      precompiled;  // SPIR-V asset used without the compiler
+
+    bool operator==(const ShaderProgramDesc &) const = default;
+};
+
+/**
+ * @class ShaderManager
+ * @brief Compiles shader permutations on demand and owns the pipelines built
+ * from them, built in the background and rebuilt when their sources change.
+ *
+ * Built with the Slang compiler API (SHADER_HOT_RELOAD), programs are
+ * compiled from their modules at run time and every file the compilation
+ * read is watched. update() polls them every POLL_INTERVAL; a change
+ * recompiles the program and rebuilds its pipelines on the job system, then
+ * a later update() swaps them in. The frame never waits for the compiler: it
+ * keeps drawing with the previous pipeline, which is destroyed once the GPU
+ * completed the last frame using it. A failed reload keeps the previous
+ * pipeline and reports the compiler output through takeErrors().
+ *
+ * Pipelines are never built on the calling thread: addPipeline() schedules
+ * an eFast build then an eOptimized one (see PipelineCompiler), and draws use
+ * the best version swapped in so far. Builds and rebuilds publish their
+ * results the same way, a rebuild drops the results of older builds.
+ *
+ * Without the compiler, or when a module isn't found in the search paths,
+ * the precompiled SPIR-V of the build is loaded instead and nothing reloads.
+ *
+ * Preprocessor defines select permutations that need their own compilation,
+ * shared by every pipeline asking for the same program. Values that only
+ * remove branches are better as specialization constants, see
+ * Specialization: they cost a pipeline, not a compilation.
+ */
+class PROJECT_API ShaderManager
+{
+   public:
+    using ProgramId   = uint32_t;
+    using PipelineId  = uint32_t;
+    using SpirvLoader = std::function<std::vector<uint32_t>(const std::string &name)>;
+    /**
+     * @brief Compiles what the qualities of a build share (e.g. pipeline
+     * libraries, see PipelineCompiler::compile()), the linker then builds
+     * eFast and eOptimized from it.
+     */
+    using PipelineBuilder = std::function<PipelineCompiler::Linker(std::span<const uint32_t> spirv)>;
+
+    static constexpr std::chrono::milliseconds POLL_INTERVAL{250};
+
+    // Members
+   private:
+    struct Compiler;
+
+    struct Program
+    {
+        ShaderProgramDesc                            desc;
+        std::vector<uint32_t>                        spirv;
+        std::vector<std::filesystem::path>           dependencies;  // files read by the last compilation
+        std::vector<std::filesystem::file_time_type> writeTimes;
+        Jobs::JobHandle                              rebuild;  // background rebuild in progress
+    };
+
+    struct Pipeline
+    {
+        ProgramId          program = 0;
+        PipelineBuilder    builder;
+        vk::raii::Pipeline pipeline   = nullptr;  // null until the first build is done
+        uint32_t           generation = 0;        // bumped by every rebuild, older results are dropped
+        Jobs::JobHandle    fastBuild;
+    };
+
+    struct BuildTarget
+    {
+        PipelineId      pipeline;
+        uint32_t        generation;
+        PipelineBuilder builder;
+    };
+
+    struct BuiltPipeline
+    {
+        PipelineId         pipeline;
+        uint32_t           generation;
+        vk::raii::Pipeline result;
+    };
+
+    /**
+     * @brief Output of a background build, waiting for update().
+     */
+    struct Rebuild
+    {
+        ProgramId                                    program  = 0;
+        bool                                         compiled = false;  // the fields of the program are new
+        std::vector<uint32_t>                        spirv;
+        std::vector<std::filesystem::path>           dependencies;
+        std::vector<std::filesystem::file_time_type> writeTimes;
+        std::vector<BuiltPipeline>                   pipelines;
+        std::string                                  error;  // nothing is swapped when set
+    };
+
+    Jobs::JobSystem                      &jobSystem;
+    SpirvLoader                           loader;
+    std::unique_ptr<Compiler>             compiler;  // null without the Slang API
+    std::vector<Program>                  programs;
+    std::vector<Pipeline>                 pipelines;
+    DeletionQueue                         retired;  // replaced pipelines, by frame value
+    std::chrono::steady_clock::time_point nextPoll;
+    std::vector<std::string>              errors;  // of the failed builds
+    std::vector<Jobs::JobHandle>          jobs;    // waited for on destruction
+    uint64_t                              lastFrameValue = 0;
+
+    std::mutex           rebuildMutex;
+    std::vector<Rebuild> rebuilds;
+
+    // Methods
+   public:
+    /**
+     * @param loader reads a precompiled SPIR-V asset.
+     * @param searchPaths where modules and their imports are looked up.
+     */
+    ShaderManager(Jobs::JobSystem &jobSystem, SpirvLoader loader, const std::vector<std::string> &searchPaths);
+    ShaderManager(const ShaderManager &)            = delete;
+    ShaderManager &operator=(const ShaderManager &) = delete;
+    /**
+     * @brief Waits for the rebuilds in progress. The GPU must be idle.
+     */
+    ~ShaderManager();
+
+    /**
+     * @brief Compile the program now, or return the one already compiled
+     * from the same description.
+     */
+    ProgramId addProgram(const ShaderProgramDesc &desc);
+
+    /**
+     * @brief Build the pipeline on the job system: first eFast, swapped in by
+     * update() once ready, then eOptimized which replaces it. builder is
+     * called from worker threads, again on every reload.
+     */
+    PipelineId addPipeline(ProgramId program, PipelineBuilder builder);
+
+    /**
+     * @brief Replace the builder of the pipeline, e.g. when its attachment
+     * formats change, and build it again like addPipeline(). The previous
+     * version is drawn until waitForPipeline() or update() swaps the new one
+     * in.
+     */
+    void setBuilder(PipelineId pipeline, PipelineBuilder builder);
+
+    /**
+     * @brief The best version built so far, null before the first one.
+     */
+    vk::Pipeline getPipeline(PipelineId pipeline) const;
+
+    /**
+     * @brief Wait until the pipeline can be drawn with, throws when its
+     * build failed.
+     */
+    void waitForPipeline(PipelineId pipeline);
+
+    /**
+     * @brief Swap in the rebuilt pipelines, release the retired ones and poll
+     * the sources. Called once per frame, before recording.
+     * @param frameValue FramePacer value of the last submitted frame.
+     * @param completedValue FramePacer value the GPU has completed.
+     */
+    void update(uint64_t frameValue, uint64_t completedValue);
+
+    /**
+     * @brief Compiler output of the reloads that failed since the last call.
+     */
+    std::vector<std::string> takeErrors();
+
+    /**
+     * @brief Whether programs are compiled at run time and reloaded.
+     */
+    bool isHotReloadEnabled() const;
+
+   private:
+    std::vector<uint32_t> compile(const ShaderProgramDesc &desc, std::vector<std::filesystem::path> &dependencies);
+    void                  scheduleBuild(PipelineId pipeline);
+    void                  scheduleRebuild(ProgramId program);
+    void                  publish(Rebuild &&rebuild);
+    void                  applyRebuilds();
+
+    /**
+     * @param linkers of the targets, compiled by the first quality built and
+     * only linked again by the next one.
+     */
+    static Rebuild build(ProgramId                              program,
+                         const std::string                     &module,
+                         std::span<const BuildTarget>           targets,
+                         std::span<const uint32_t>              spirv,
+                         std::vector<PipelineCompiler::Linker> &linkers,
+                         PipelineQuality                        quality);
+
+    static std::vector<std::filesystem::file_time_type> getWriteTimes(std::span<const std::filesystem::path> files);
+};
+
+}  // namespace Graphics
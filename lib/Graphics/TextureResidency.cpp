@@ -0,0 +1,416 @@
+#include "TextureResidency.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "BindlessTable.hpp"
+#include "UploadBatcher.hpp"
+#include "profiling.hpp"
+
+namespace Graphics {
+
+namespace {
+
+/**
+ * @brief Bindless slot given back with the image it points to.
+ */
+class RetiredSlot
+{
+    BindlessTable *table;
+    uint32_t       index;
+
+   public:
+    RetiredSlot(BindlessTable &table, uint32_t index) : table(&table), index(index) {}
+    RetiredSlot(RetiredSlot &&other) noexcept : table(std::exchange(other.table, nullptr)), index(other.index) {}
+    RetiredSlot(const RetiredSlot &)            = delete;
+    RetiredSlot &operator=(const RetiredSlot &) = delete;
+    RetiredSlot &operator=(RetiredSlot &&)      = delete;
+
+    ~RetiredSlot()
+    {
+        if (table)
+        {
+            table->removeTexture(index);
+        }
+    }
+};
+
+}  // namespace
+
+PROJECT_API TextureResidency::TextureResidency(const vk::raii::PhysicalDevice &physicalDevice,
+                                               const vk::raii::Device         &device,
+                                               Memory::Allocator              &allocator,
+                                               UploadBatcher                  &uploadBatcher,
+                                               BindlessTable                  &bindlessTable,
+                                               uint32_t                        framesInFlight,
+                                               bool                            memoryBudget,
+                                               vk::DeviceSize                  uploadBytesPerFrame) :
+    physicalDevice(physicalDevice), device(device), allocator(allocator), uploadBatcher(uploadBatcher),
+    bindlessTable(bindlessTable), memoryBudget(memoryBudget), uploadBytesPerFrame(uploadBytesPerFrame)
+{
+    ZoneScoped;
+    const vk::PhysicalDeviceMemoryProperties &memoryProperties = allocator.getMemoryProperties();
+    for (uint32_t heap = 0; heap < memoryProperties.memoryHeapCount; heap++)
+    {
+        const vk::MemoryHeap &candidate = memoryProperties.memoryHeaps[heap];
+        const vk::MemoryHeap &current   = memoryProperties.memoryHeaps[heapIndex];
+        bool local        = static_cast<bool>(candidate.flags & vk::MemoryHeapFlagBits::eDeviceLocal);
+        bool currentLocal = static_cast<bool>(current.flags & vk::MemoryHeapFlagBits::eDeviceLocal);
+        if ((local && not currentLocal) || (local == currentLocal && candidate.size > current.size))
+        {
+            heapIndex = heap;
+        }
+    }
+    createFeedbackBuffer(framesInFlight);
+    updateBudget();
+    TracyPlotConfig("Texture residency", tracy::PlotFormatType::Memory, true, false, 0);
+    TracyPlotConfig("Texture budget", tracy::PlotFormatType::Memory, true, false, 0);
+}
+
+PROJECT_API bool TextureResidency::isSupported(const vk::raii::PhysicalDevice &physicalDevice)
+{
+    return std::ranges::any_of(physicalDevice.enumerateDeviceExtensionProperties(),
+                               [](const vk::ExtensionProperties &extension) {
+                                   return std::strcmp(extension.extensionName, EXTENSIONS[0]) == 0;
+                               });
+}
+
+PROJECT_API void TextureResidency::setFramesInFlight(uint32_t framesInFlight)
+{
+    createFeedbackBuffer(framesInFlight);
+}
+
+PROJECT_API TextureResidency::TextureId TextureResidency::addTexture(StreamedTextureDesc desc)
+{
+    ZoneScoped;
+    if (desc.levels.empty())
+    {
+        throw std::runtime_error("streamed texture has no level!");
+    }
+    TextureId id;
+    if (not freeIds.empty())
+    {
+        id = freeIds.back();
+        freeIds.pop_back();
+    }
+    else if (textures.size() < MAX_TEXTURES)
+    {
+        id = static_cast<TextureId>(textures.size());
+        textures.emplace_back();
+    }
+    else
+    {
+        throw std::runtime_error("too many streamed textures!");
+    }
+
+    Texture &texture = textures[id];
+    texture          = Texture{};
+    texture.desc     = std::move(desc);
+    texture.used     = true;
+    uint32_t width   = texture.desc.extent.width;
+    uint32_t height  = texture.desc.extent.height;
+    texture.baseLog2 = static_cast<uint32_t>(std::bit_width(std::max({width, height, 1u}))) - 1;
+    while (texture.tailLevel + 1 < texture.desc.levels.size() &&
+           std::max(width >> texture.tailLevel, height >> texture.tailLevel) > TAIL_SIZE)
+    {
+        texture.tailLevel++;
+    }
+    texture.desiredLevel = texture.tailLevel;
+    makeResident(texture, texture.tailLevel, lastFrameValue);
+    return id;
+}
+
+PROJECT_API void TextureResidency::removeTexture(TextureId id)
+{
+    Texture &texture = textures[id];
+    // Frames up to the last one recorded may sample it.
+    retired.retire(lastFrameValue,
+                   RetiredSlot(bindlessTable, texture.bindlessIndex),
+                   std::move(texture.view),
+                   std::move(texture.image),
+                   std::move(texture.allocation));
+    residentBytes -= texture.residentBytes;
+    texture = Texture{};
+    freeIds.push_back(id);
+}
+
+PROJECT_API void TextureResidency::setDistance(TextureId id, float distance)
+{
+    textures[id].distance = distance;
+}
+
+PROJECT_API void TextureResidency::update(uint32_t slot, uint64_t frameValue, uint64_t completedValue)
+{
+    ZoneScoped;
+    lastFrameValue = frameValue;
+    currentSlot    = slot;
+    retired.collect(completedValue);
+    readFeedback(slot);
+    slotFrameValues[slot] = frameValue;
+    updateBudget();
+
+    // Finer levels wait for the uploads below, coarser ones are dropped now.
+    // A texture unseen for long only keeps its tail.
+    std::vector<uint32_t>  targets(textures.size());
+    std::vector<TextureId> ids;
+    vk::DeviceSize         projectedBytes = 0;
+    for (TextureId id = 0; id < textures.size(); id++)
+    {
+        Texture &texture = textures[id];
+        if (not texture.used)
+        {
+            continue;
+        }
+        if (frameValue > texture.lastSeen + EVICTION_FRAMES)
+        {
+            texture.desiredLevel = texture.tailLevel;
+        }
+        targets[id] = std::max(texture.residentLevel, texture.desiredLevel);
+        projectedBytes += getChainBytes(texture, targets[id]);
+        ids.push_back(id);
+    }
+
+    // Over budget, the least recently seen textures give up their finest
+    // levels first, the farthest first among them.
+    std::ranges::sort(ids, [this](TextureId a, TextureId b) {
+        const Texture &left  = textures[a];
+        const Texture &right = textures[b];
+        return left.lastSeen != right.lastSeen ? left.lastSeen < right.lastSeen : left.distance > right.distance;
+    });
+    for (TextureId id : ids)
+    {
+        while (projectedBytes > budgetBytes && targets[id] < textures[id].tailLevel)
+        {
+            projectedBytes -= getChainBytes(textures[id], targets[id]);
+            projectedBytes += getChainBytes(textures[id], ++targets[id]);
+        }
+    }
+
+    // Finer levels, nearest first, as far as the budget and the uploads of
+    // the frame allow.
+    std::ranges::sort(ids, [this](TextureId a, TextureId b) {
+        const Texture &left  = textures[a];
+        const Texture &right = textures[b];
+        return left.distance != right.distance ? left.distance < right.distance : left.lastSeen > right.lastSeen;
+    });
+    vk::DeviceSize uploadedBytes = 0;
+    for (TextureId id : ids)
+    {
+        const Texture &texture = textures[id];
+        if (uploadedBytes >= uploadBytesPerFrame)
+        {
+            break;
+        }
+        uint32_t       level       = texture.desiredLevel;
+        vk::DeviceSize targetBytes = getChainBytes(texture, targets[id]);
+        while (level < targets[id] && projectedBytes - targetBytes + getChainBytes(texture, level) > budgetBytes)
+        {
+            level++;
+        }
+        if (level < targets[id])
+        {
+            projectedBytes += getChainBytes(texture, level) - targetBytes;
+            uploadedBytes += getChainBytes(texture, level);
+            targets[id] = level;
+        }
+    }
+
+    for (TextureId id : ids)
+    {
+        if (targets[id] != textures[id].residentLevel)
+        {
+            makeResident(textures[id], targets[id], frameValue);
+        }
+    }
+    TracyPlot("Texture residency", static_cast<int64_t>(residentBytes));
+    TracyPlot("Texture budget", static_cast<int64_t>(budgetBytes));
+}
+
+PROJECT_API uint32_t TextureResidency::getBindlessIndex(TextureId id) const
+{
+    return textures[id].bindlessIndex;
+}
+
+PROJECT_API uint32_t TextureResidency::getResidentLevel(TextureId id) const
+{
+    return textures[id].residentLevel;
+}
+
+PROJECT_API vk::DeviceAddress TextureResidency::getFeedbackAddress() const
+{
+    return feedbackAddress + static_cast<vk::DeviceAddress>(currentSlot) * MAX_TEXTURES * sizeof(uint32_t);
+}
+
+PROJECT_API void TextureResidency::recordFeedbackBarrier(const vk::raii::CommandBuffer &commandBuffer) const
+{
+    vk::BufferMemoryBarrier2 barrier{.srcStageMask  = vk::PipelineStageFlagBits2::eFragmentShader,
+                                     .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+                                     .dstStageMask  = vk::PipelineStageFlagBits2::eHost,
+                                     .dstAccessMask = vk::AccessFlagBits2::eHostRead,
+                                     .buffer        = *feedbackBuffer,
+                                     .offset        = currentSlot * MAX_TEXTURES * sizeof(uint32_t),
+                                     .size          = MAX_TEXTURES * sizeof(uint32_t)};
+    commandBuffer.pipelineBarrier2({.bufferMemoryBarrierCount = 1, .pBufferMemoryBarriers = &barrier});
+}
+
+PROJECT_API vk::DeviceSize TextureResidency::getResidentBytes() const
+{
+    return residentBytes;
+}
+
+PROJECT_API vk::DeviceSize TextureResidency::getBudgetBytes() const
+{
+    return budgetBytes;
+}
+
+void TextureResidency::createFeedbackBuffer(uint32_t framesInFlight)
+{
+    feedbackAllocation.reset();
+    vk::BufferCreateInfo bufferInfo{.size        = sizeof(uint32_t) * MAX_TEXTURES * framesInFlight,
+                                    .usage       = vk::BufferUsageFlagBits::eStorageBuffer |
+                                                   vk::BufferUsageFlagBits::eShaderDeviceAddress,
+                                    .sharingMode = vk::SharingMode::eExclusive};
+    feedbackBuffer = vk::raii::Buffer(device, bufferInfo);
+
+    // Written by the GPU and read by the CPU, cached when the device has it.
+    // Cached memory may not be coherent, readFeedback() invalidates and
+    // flushes it.
+    feedbackAllocation = allocator.allocate(
+        feedbackBuffer, vk::MemoryPropertyFlagBits::eHostVisible, vk::MemoryPropertyFlagBits::eHostCached);
+    feedback        = static_cast<uint32_t *>(feedbackAllocation.getMappedData());
+    feedbackAddress = device.getBufferAddress({.buffer = feedbackBuffer});
+    std::memset(feedback, 0, bufferInfo.size);
+    feedbackAllocation.flush();
+    slotFrameValues.assign(framesInFlight, 0);
+    currentSlot = 0;
+}
+
+void TextureResidency::readFeedback(uint32_t slot)
+{
+    uint64_t frameValue = slotFrameValues[slot];
+    if (frameValue == 0)
+    {
+        return;
+    }
+    // The frame pacer waited for the frame, its writes were made available to
+    // the host by recordFeedbackBarrier(). The values are cleared for the next
+    // frame of the slot, the host writes are visible to the GPU once it is
+    // submitted.
+    constexpr vk::DeviceSize slotSize = MAX_TEXTURES * sizeof(uint32_t);
+    feedbackAllocation.invalidate(slot * slotSize, slotSize);
+    uint32_t *demands = feedback + static_cast<size_t>(slot) * MAX_TEXTURES;
+    for (TextureId id = 0; id < textures.size(); id++)
+    {
+        Texture &texture = textures[id];
+        uint32_t demand  = demands[id];
+        if (demand == 0 || not texture.used)
+        {
+            continue;
+        }
+        // demand - 1 is the log2 of the texels needed across, the base level
+        // has baseLog2 of them.
+        int32_t  wanted = static_cast<int32_t>(texture.baseLog2) - static_cast<int32_t>(demand - 1);
+        uint32_t level  = static_cast<uint32_t>(std::clamp(wanted, 0, static_cast<int32_t>(texture.tailLevel)));
+        texture.lastSeen = std::max(texture.lastSeen, frameValue);
+        // Finer right away, coarser only once the finer level wasn't needed
+        // for a while, so the levels don't come and go with the view.
+        if (level <= texture.desiredLevel || frameValue > texture.desiredValue + EVICTION_FRAMES)
+        {
+            texture.desiredLevel = level;
+            texture.desiredValue = frameValue;
+        }
+    }
+    std::memset(demands, 0, textures.size() * sizeof(uint32_t));
+    feedbackAllocation.flush(slot * slotSize, slotSize);
+}
+
+void TextureResidency::updateBudget()
+{
+    vk::DeviceSize heapBudget;
+    vk::DeviceSize heapUsage;
+    if (memoryBudget)
+    {
+        auto properties = physicalDevice.getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2,
+                                                              vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        const auto &budget = properties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        heapBudget         = budget.heapBudget[heapIndex];
+        heapUsage          = budget.heapUsage[heapIndex];
+    }
+    else
+    {
+        heapBudget = allocator.getMemoryProperties().memoryHeaps[heapIndex].size;
+        heapUsage  = allocator.getHeapStats()[heapIndex].blockBytes;
+    }
+    // What the rest of the heap holds is left out of the texture budget.
+    vk::DeviceSize others = heapUsage > residentBytes ? heapUsage - residentBytes : 0;
+    auto           limit  = static_cast<vk::DeviceSize>(static_cast<double>(heapBudget) * BUDGET_FRACTION);
+    budgetBytes           = limit > others ? limit - others : 0;
+}
+
+vk::DeviceSize TextureResidency::getChainBytes(const Texture &texture, uint32_t firstLevel) const
+{
+    vk::DeviceSize bytes = 0;
+    for (size_t level = firstLevel; level < texture.desc.levels.size(); level++)
+    {
+        bytes += texture.desc.levels[level].size();
+    }
+    return bytes;
+}
+
+void TextureResidency::makeResident(Texture &texture, uint32_t firstLevel, uint64_t frameValue)
+{
+    ZoneScoped;
+    uint32_t            width      = std::max(1u, texture.desc.extent.width >> firstLevel);
+    uint32_t            height     = std::max(1u, texture.desc.extent.height >> firstLevel);
+    auto                levelCount = static_cast<uint32_t>(texture.desc.levels.size()) - firstLevel;
+    vk::ImageCreateInfo imageInfo{.imageType   = vk::ImageType::e2D,
+                                  .format      = texture.desc.format,
+                                  .extent      = {width, height, 1},
+                                  .mipLevels   = levelCount,
+                                  .arrayLayers = 1,
+                                  .samples     = vk::SampleCountFlagBits::e1,
+                                  .tiling      = vk::ImageTiling::eOptimal,
+                                  .usage       = vk::ImageUsageFlagBits::eTransferDst |
+                                                 vk::ImageUsageFlagBits::eSampled,
+                                  .sharingMode = vk::SharingMode::eExclusive};
+    vk::raii::Image    image(device, imageInfo);
+    Memory::Allocation allocation =
+        allocator.allocate(image, vk::ImageTiling::eOptimal, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    // Every level is written again, the previous image is only sampled until
+    // the frame recorded now.
+    std::span<const std::span<const std::byte>> levels(texture.desc.levels);
+    uploadBatcher.uploadImageLevels(*image, {width, height, 1}, levels.subspan(firstLevel));
+
+    vk::ImageViewCreateInfo viewInfo{.image            = *image,
+                                     .viewType         = vk::ImageViewType::e2D,
+                                     .format           = texture.desc.format,
+                                     .subresourceRange = {.aspectMask     = vk::ImageAspectFlagBits::eColor,
+                                                          .baseMipLevel   = 0,
+                                                          .levelCount     = levelCount,
+                                                          .baseArrayLayer = 0,
+                                                          .layerCount     = 1}};
+    vk::raii::ImageView view(device, viewInfo);
+    uint32_t            bindlessIndex = bindlessTable.addTexture(*view, vk::ImageLayout::eShaderReadOnlyOptimal);
+
+    if (*texture.image)
+    {
+        retired.retire(frameValue,
+                       RetiredSlot(bindlessTable, texture.bindlessIndex),
+                       std::move(texture.view),
+                       std::move(texture.image),
+                       std::move(texture.allocation));
+    }
+    vk::DeviceSize bytes  = getChainBytes(texture, firstLevel);
+    residentBytes         = residentBytes - texture.residentBytes + bytes;
+    texture.residentBytes = bytes;
+    texture.residentLevel = firstLevel;
+    texture.image         = std::move(image);
+    texture.allocation    = std::move(allocation);
+    texture.view          = std::move(view);
+    texture.bindlessIndex = bindlessIndex;
+}
+
+}  // namespace Graphics
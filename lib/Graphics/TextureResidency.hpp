@@ -0,0 +1,189 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#include "DeletionQueue.hpp"
+#include "Memory/Allocator.hpp"
+#include "config.hpp"
+
+namespace Graphics {
+
+class BindlessTable;
+class UploadBatcher;
+
+/**
+ * @brief Texture streamed by TextureResidency, e.g. the levels of an
+ * Images::Ktx2. The level bytes must outlive the texture.
+ */
+struct StreamedTextureDesc
+{
+    vk::Format                              format = vk::Format::eUndefined;
+    vk::Extent2D                            extent;  // of the base level
+    std::vector<std::span<const std::byte>> levels;  // from the base level down
+};
+
+/**
+ * @class TextureResidency
+ * @brief Streams the mip levels of textures in and out of device memory, from
+ * the demand reported by the GPU, within the memory budget.
+ *
+ * The levels up to TAIL_SIZE texels always stay resident, the finer ones only
+ * while they are seen. Shaders report what they sample: once every
+ * FEEDBACK_STRIDE x FEEDBACK_STRIDE pixels, the fragment shader raises the
+ * feedback value of the texture to 1 + log2 of the texels its footprint needs
+ * across (see shader_base.slang). The feedback of a frame slot is read back
+ * when the frame pacer gives the slot back, never waiting for the GPU.
+ *
+ * With VK_EXT_memory_budget the heap budget and usage are the driver's, other
+ * processes included. Without it they are the heap size and the allocator
+ * blocks. When the textures don't fit, the least recently seen ones give up
+ * their finest levels first. Finer levels go to the textures nearest to the
+ * camera first (setDistance()), up to uploadBytesPerFrame per frame.
+ *
+ * There is no sparse residency: a texture changing its resident levels gets a
+ * new image, written again from its level bytes through the UploadBatcher,
+ * and a new bindless slot. Its previous image and slot are kept until the
+ * frames using them completed, getBindlessIndex() must be read every frame.
+ */
+class PROJECT_API TextureResidency
+{
+   public:
+    using TextureId = uint32_t;
+
+    static constexpr std::array<const char *, 1> EXTENSIONS = {vk::EXTMemoryBudgetExtensionName};
+
+    static constexpr uint32_t       MAX_TEXTURES             = 4096;  // feedback slots
+    static constexpr uint32_t       FEEDBACK_STRIDE          = 4;     // in pixels, must match shader_base.slang
+    static constexpr uint32_t       TAIL_SIZE                = 128;   // in texels, smaller levels stay resident
+    static constexpr uint64_t       EVICTION_FRAMES          = 120;   // unneeded for that long, levels are dropped
+    static constexpr double         BUDGET_FRACTION          = 0.9;   // of the heap budget, the rest is headroom
+    static constexpr vk::DeviceSize DEFAULT_UPLOAD_PER_FRAME = 16ull * 1024 * 1024;
+
+    // Members
+   private:
+    struct Texture
+    {
+        StreamedTextureDesc desc;
+        uint32_t            baseLog2      = 0;  // of the largest side of the base level
+        uint32_t            tailLevel     = 0;  // coarsest level streamed, the ones below always stay
+        uint32_t            residentLevel = 0;  // finest level in memory
+        uint32_t            desiredLevel  = 0;
+        uint64_t            desiredValue  = 0;  // frame that demanded desiredLevel
+        uint64_t            lastSeen      = 0;  // frame value of the latest demand
+        float               distance      = std::numeric_limits<float>::max();
+        vk::DeviceSize      residentBytes = 0;
+        vk::raii::Image     image         = nullptr;
+        Memory::Allocation  allocation;
+        vk::raii::ImageView view          = nullptr;
+        uint32_t            bindlessIndex = 0;
+        bool                used          = false;
+    };
+
+    const vk::raii::PhysicalDevice &physicalDevice;
+    const vk::raii::Device         &device;
+    Memory::Allocator              &allocator;
+    UploadBatcher                  &uploadBatcher;
+    BindlessTable                  &bindlessTable;
+    bool                            memoryBudget;
+    uint32_t                        heapIndex = 0;  // largest device local heap
+    vk::DeviceSize                  uploadBytesPerFrame;
+
+    std::vector<Texture>   textures;  // by id
+    std::vector<TextureId> freeIds;
+    vk::DeviceSize         residentBytes  = 0;
+    vk::DeviceSize         budgetBytes    = 0;  // for the textures
+    uint64_t               lastFrameValue = 0;
+    DeletionQueue          retired;  // replaced images and slots, by frame value
+
+    vk::raii::Buffer      feedbackBuffer = nullptr;
+    Memory::Allocation    feedbackAllocation;
+    uint32_t             *feedback        = nullptr;
+    vk::DeviceAddress     feedbackAddress = 0;
+    std::vector<uint64_t> slotFrameValues;  // frame recorded in each slot, 0 when none
+    uint32_t              currentSlot = 0;
+
+    // Methods
+   public:
+    /**
+     * @param memoryBudget VK_EXT_memory_budget is enabled on the device.
+     */
+    TextureResidency(const vk::raii::PhysicalDevice &physicalDevice,
+                     const vk::raii::Device         &device,
+                     Memory::Allocator              &allocator,
+                     UploadBatcher                  &uploadBatcher,
+                     BindlessTable                  &bindlessTable,
+                     uint32_t                        framesInFlight,
+                     bool                            memoryBudget,
+                     vk::DeviceSize                  uploadBytesPerFrame = DEFAULT_UPLOAD_PER_FRAME);
+    TextureResidency(const TextureResidency &)            = delete;
+    TextureResidency &operator=(const TextureResidency &) = delete;
+
+    static bool isSupported(const vk::raii::PhysicalDevice &physicalDevice);
+
+    /**
+     * @brief Drops the pending feedback. No frame slot may be in use by the
+     * GPU.
+     */
+    void setFramesInFlight(uint32_t framesInFlight);
+
+    /**
+     * @brief Uploads the smallest levels of the texture, the finer ones are
+     * streamed in once they are seen. Sampled in eShaderReadOnlyOptimal.
+     */
+    TextureId addTexture(StreamedTextureDesc desc);
+    /**
+     * @brief The bindless slot stays valid for the frames already recorded.
+     */
+    void      removeTexture(TextureId id);
+
+    /**
+     * @brief Streaming priority, the nearest textures get their levels first.
+     */
+    void setDistance(TextureId id, float distance);
+
+    /**
+     * @brief Read the feedback of the slot, then stream levels in and out. Once
+     * per frame, after the frame pacer gave the slot back and before the
+     * uploads are submitted.
+     * @param frameValue FramePacer value of the frame being recorded.
+     * @param completedValue FramePacer::getCompletedValue().
+     */
+    void update(uint32_t slot, uint64_t frameValue, uint64_t completedValue);
+
+    uint32_t getBindlessIndex(TextureId id) const;
+    uint32_t getResidentLevel(TextureId id) const;
+
+    /**
+     * @brief uint feedback[MAX_TEXTURES] of the frame being recorded, indexed
+     * by TextureId.
+     */
+    vk::DeviceAddress getFeedbackAddress() const;
+    /**
+     * @brief Make the feedback the fragment shaders wrote to the frame being
+     * recorded available to the host. Outside rendering, after the draws.
+     */
+    void              recordFeedbackBarrier(const vk::raii::CommandBuffer &commandBuffer) const;
+
+    vk::DeviceSize getResidentBytes() const;
+    vk::DeviceSize getBudgetBytes() const;
+
+   private:
+    void           createFeedbackBuffer(uint32_t framesInFlight);
+    void           readFeedback(uint32_t slot);
+    void           updateBudget();
+    vk::DeviceSize getChainBytes(const Texture &texture, uint32_t firstLevel) const;
+    void           makeResident(Texture &texture, uint32_t firstLevel, uint64_t frameValue);
+};
+
+}  // namespace Graphics
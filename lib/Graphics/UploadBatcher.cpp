@@ -0,0 +1,447 @@
+#include "UploadBatcher.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "profiling.hpp"
+
+namespace Graphics {
+
+namespace {
+
+constexpr uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+vk::ImageSubresourceRange colorRange(uint32_t levelCount)
+{
+    return {.aspectMask     = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel   = 0,
+            .levelCount     = levelCount,
+            .baseArrayLayer = 0,
+            .layerCount     = 1};
+}
+
+// Images left for a blit (mip generation) are read by transfers, the others by shaders.
+vk::AccessFlags2 consumerAccess(vk::ImageLayout finalLayout)
+{
+    return finalLayout == vk::ImageLayout::eTransferSrcOptimal ? vk::AccessFlagBits2::eTransferRead
+                                                               : vk::AccessFlagBits2::eShaderSampledRead;
+}
+
+}  // namespace
+
+PROJECT_API UploadBatcher::UploadBatcher(const vk::raii::Device &device,
+                                         Memory::Allocator      &allocator,
+                                         const vk::raii::Queue  &queue,
+                                         uint32_t                queueFamilyIndex,
+                                         uint32_t                dstQueueFamilyIndex,
+                                         vk::DeviceSize          ringSize) :
+    device(device), allocator(allocator), queue(queue), queueFamilyIndex(queueFamilyIndex),
+    dstQueueFamilyIndex(dstQueueFamilyIndex), ringSize(ringSize)
+{
+    ZoneScoped;
+    vk::CommandPoolCreateInfo poolInfo{.flags = vk::CommandPoolCreateFlagBits::eTransient |
+                                                vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+                                       .queueFamilyIndex = queueFamilyIndex};
+    commandPool = vk::raii::CommandPool(device, poolInfo);
+
+    vk::StructureChain<vk::SemaphoreCreateInfo, vk::SemaphoreTypeCreateInfo> semaphoreChain = {
+        {},
+        {.semaphoreType = vk::SemaphoreType::eTimeline, .initialValue = 0}};
+    semaphore = vk::raii::Semaphore(device, semaphoreChain.get<vk::SemaphoreCreateInfo>());
+
+    vk::BufferCreateInfo bufferInfo{.size        = ringSize,
+                                    .usage       = vk::BufferUsageFlagBits::eTransferSrc,
+                                    .sharingMode = vk::SharingMode::eExclusive};
+    ringBuffer     = vk::raii::Buffer(device, bufferInfo);
+    ringAllocation = allocator.allocate(ringBuffer,
+                                        vk::MemoryPropertyFlagBits::eHostVisible |
+                                            vk::MemoryPropertyFlagBits::eHostCoherent,
+                                        Memory::AllocationStrategy::eDedicated);
+    ringMapped     = static_cast<std::byte *>(ringAllocation.getMappedData());
+}
+
+PROJECT_API UploadBatcher::~UploadBatcher()
+{
+    // The ring and the command buffers must not be freed while the GPU reads them.
+    if (lastSubmittedValue > 0)
+    {
+        wait(lastSubmittedValue);
+    }
+}
+
+PROJECT_API StagingRange UploadBatcher::reserve(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+    ZoneScoped;
+    if (size > ringSize)
+    {
+        // Too big for the ring, give it its own buffer released with the batch.
+        OversizedStaging     staging;
+        vk::BufferCreateInfo bufferInfo{.size        = size,
+                                        .usage       = vk::BufferUsageFlagBits::eTransferSrc,
+                                        .sharingMode = vk::SharingMode::eExclusive};
+        staging.buffer     = vk::raii::Buffer(device, bufferInfo);
+        staging.allocation = allocator.allocate(staging.buffer,
+                                                vk::MemoryPropertyFlagBits::eHostVisible |
+                                                    vk::MemoryPropertyFlagBits::eHostCoherent,
+                                                Memory::AllocationStrategy::eDedicated);
+        StagingRange range{.mapped = staging.allocation.getMappedData(),
+                           .buffer = *staging.buffer,
+                           .offset = 0,
+                           .size   = size};
+        pendingOversized.push_back(std::move(staging));
+        return range;
+    }
+
+    uint64_t offset = alignUp(ringHead, alignment);
+    if (offset % ringSize + size > ringSize)
+    {
+        // Don't straddle the end of the ring, restart at its beginning.
+        offset = alignUp(offset, ringSize);
+    }
+
+    retire();
+    while (offset + size - ringTail > ringSize)
+    {
+        if (inFlight.empty())
+        {
+            // Only the batch being recorded holds the ring, push it out.
+            submit();
+        }
+        if (inFlight.empty())
+        {
+            throw std::runtime_error("staging ring exhausted by unsubmitted reservations!");
+        }
+        wait(inFlight.front().value);
+        retire();
+    }
+
+    ringHead = offset + size;
+    return StagingRange{.mapped = ringMapped + offset % ringSize,
+                        .buffer = *ringBuffer,
+                        .offset = offset % ringSize,
+                        .size   = size};
+}
+
+PROJECT_API void UploadBatcher::uploadBuffer(vk::Buffer     dstBuffer,
+                                             vk::DeviceSize dstOffset,
+                                             const void    *data,
+                                             vk::DeviceSize size)
+{
+    StagingRange staging = reserve(size, 4);
+    memcpy(staging.mapped, data, size);
+    copyToBuffer(staging, dstBuffer, dstOffset);
+}
+
+PROJECT_API void UploadBatcher::copyToBuffer(const StagingRange &staging, vk::Buffer dstBuffer, vk::DeviceSize dstOffset)
+{
+    bufferCopies.push_back({.srcBuffer = staging.buffer,
+                            .dstBuffer = dstBuffer,
+                            .region    = {.srcOffset = staging.offset, .dstOffset = dstOffset, .size = staging.size}});
+    vk::BufferMemoryBarrier2 barrier{.srcStageMask        = vk::PipelineStageFlagBits2::eCopy,
+                                     .srcAccessMask       = vk::AccessFlagBits2::eTransferWrite,
+                                     .dstStageMask        = vk::PipelineStageFlagBits2::eAllCommands,
+                                     .dstAccessMask       = vk::AccessFlagBits2::eMemoryRead,
+                                     .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                                     .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                                     .buffer              = dstBuffer,
+                                     .offset              = dstOffset,
+                                     .size                = staging.size};
+    if (isOwnershipTransfer())
+    {
+        barrier.srcQueueFamilyIndex = queueFamilyIndex;
+        barrier.dstQueueFamilyIndex = dstQueueFamilyIndex;
+
+        vk::BufferMemoryBarrier2 acquire = barrier;
+        acquire.srcStageMask             = vk::PipelineStageFlagBits2::eAllCommands;
+        acquire.srcAccessMask            = {};
+        acquireBufferBarriers.push_back(acquire);
+
+        barrier.dstStageMask  = vk::PipelineStageFlagBits2::eNone;
+        barrier.dstAccessMask = {};
+    }
+    postBufferBarriers.push_back(barrier);
+}
+
+PROJECT_API void UploadBatcher::uploadImage(vk::Image               dstImage,
+                                            vk::Extent3D            extent,
+                                            const void             *data,
+                                            vk::DeviceSize          size,
+                                            vk::ImageLayout         finalLayout,
+                                            vk::PipelineStageFlags2 dstStage)
+{
+    StagingRange staging = reserve(size, 16);
+    memcpy(staging.mapped, data, size);
+    copyToImage(staging, dstImage, extent, finalLayout, dstStage);
+}
+
+PROJECT_API void UploadBatcher::copyToImage(const StagingRange     &staging,
+                                            vk::Image               dstImage,
+                                            vk::Extent3D            extent,
+                                            vk::ImageLayout         finalLayout,
+                                            vk::PipelineStageFlags2 dstStage)
+{
+    recordImageCopy(staging.buffer,
+                    dstImage,
+                    {{.bufferOffset      = staging.offset,
+                      .bufferRowLength   = 0,
+                      .bufferImageHeight = 0,
+                      .imageSubresource  = {vk::ImageAspectFlagBits::eColor, 0, 0, 1},
+                      .imageOffset       = {0, 0, 0},
+                      .imageExtent       = extent}},
+                    finalLayout,
+                    dstStage);
+}
+
+PROJECT_API void UploadBatcher::uploadImageLevels(vk::Image                                   dstImage,
+                                                  vk::Extent3D                                extent,
+                                                  std::span<const std::span<const std::byte>> levels,
+                                                  vk::ImageLayout                             finalLayout,
+                                                  vk::PipelineStageFlags2                     dstStage)
+{
+    // Level offsets must be multiples of the texel block size, 16 covers all formats.
+    constexpr vk::DeviceSize LEVEL_ALIGNMENT = 16;
+    vk::DeviceSize           totalSize       = 0;
+    for (const auto &level : levels)
+    {
+        totalSize = alignUp(totalSize, LEVEL_ALIGNMENT) + level.size();
+    }
+
+    StagingRange                     staging = reserve(totalSize, LEVEL_ALIGNMENT);
+    std::vector<vk::BufferImageCopy> regions;
+    vk::DeviceSize                   offset = 0;
+    for (uint32_t mipLevel = 0; mipLevel < levels.size(); mipLevel++)
+    {
+        offset = alignUp(offset, LEVEL_ALIGNMENT);
+        memcpy(static_cast<std::byte *>(staging.mapped) + offset, levels[mipLevel].data(), levels[mipLevel].size());
+        regions.push_back({.bufferOffset      = staging.offset + offset,
+                           .bufferRowLength   = 0,
+                           .bufferImageHeight = 0,
+                           .imageSubresource  = {vk::ImageAspectFlagBits::eColor, mipLevel, 0, 1},
+                           .imageOffset       = {0, 0, 0},
+                           .imageExtent       = {std::max(1u, extent.width >> mipLevel),
+                                                 std::max(1u, extent.height >> mipLevel),
+                                                 1}});
+        offset += levels[mipLevel].size();
+    }
+    recordImageCopy(staging.buffer, dstImage, std::move(regions), finalLayout, dstStage);
+}
+
+void UploadBatcher::recordImageCopy(vk::Buffer                       srcBuffer,
+                                    vk::Image                        dstImage,
+                                    std::vector<vk::BufferImageCopy> regions,
+                                    vk::ImageLayout                  finalLayout,
+                                    vk::PipelineStageFlags2          dstStage)
+{
+    vk::ImageSubresourceRange range = colorRange(static_cast<uint32_t>(regions.size()));
+    preImageBarriers.push_back({.srcStageMask        = vk::PipelineStageFlagBits2::eNone,
+                                .srcAccessMask       = {},
+                                .dstStageMask        = vk::PipelineStageFlagBits2::eCopy,
+                                .dstAccessMask       = vk::AccessFlagBits2::eTransferWrite,
+                                .oldLayout           = vk::ImageLayout::eUndefined,
+                                .newLayout           = vk::ImageLayout::eTransferDstOptimal,
+                                .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                                .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                                .image               = dstImage,
+                                .subresourceRange    = range});
+    imageCopies.push_back({.srcBuffer = srcBuffer, .dstImage = dstImage, .regions = std::move(regions)});
+    vk::ImageMemoryBarrier2 barrier{.srcStageMask        = vk::PipelineStageFlagBits2::eCopy,
+                                    .srcAccessMask       = vk::AccessFlagBits2::eTransferWrite,
+                                    .dstStageMask        = dstStage,
+                                    .dstAccessMask       = consumerAccess(finalLayout),
+                                    .oldLayout           = vk::ImageLayout::eTransferDstOptimal,
+                                    .newLayout           = finalLayout,
+                                    .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                                    .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                                    .image               = dstImage,
+                                    .subresourceRange    = range};
+    if (isOwnershipTransfer())
+    {
+        // Release and acquire carry the same layout transition, it happens once.
+        barrier.srcQueueFamilyIndex = queueFamilyIndex;
+        barrier.dstQueueFamilyIndex = dstQueueFamilyIndex;
+
+        vk::ImageMemoryBarrier2 acquire = barrier;
+        acquire.srcStageMask            = vk::PipelineStageFlagBits2::eAllCommands;
+        acquire.srcAccessMask           = {};
+        acquireImageBarriers.push_back(acquire);
+
+        barrier.dstStageMask  = vk::PipelineStageFlagBits2::eNone;
+        barrier.dstAccessMask = {};
+    }
+    postImageBarriers.push_back(barrier);
+}
+
+PROJECT_API bool UploadBatcher::hasPendingWork() const
+{
+    return not bufferCopies.empty() || not imageCopies.empty() || not preImageBarriers.empty() ||
+           not postImageBarriers.empty();
+}
+
+PROJECT_API uint64_t UploadBatcher::submit()
+{
+    ZoneScoped;
+    if (not hasPendingWork())
+    {
+        return lastSubmittedValue;
+    }
+
+    Batch batch;
+    batch.commandBuffer = acquireCommandBuffer();
+    batch.commandBuffer.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+    if (not preBufferBarriers.empty() || not preImageBarriers.empty())
+    {
+        batch.commandBuffer.pipelineBarrier2(
+            {.bufferMemoryBarrierCount = static_cast<uint32_t>(preBufferBarriers.size()),
+             .pBufferMemoryBarriers    = preBufferBarriers.data(),
+             .imageMemoryBarrierCount  = static_cast<uint32_t>(preImageBarriers.size()),
+             .pImageMemoryBarriers     = preImageBarriers.data()});
+    }
+    for (auto const &copy : bufferCopies)
+    {
+        batch.commandBuffer.copyBuffer(copy.srcBuffer, copy.dstBuffer, copy.region);
+    }
+    for (auto const &copy : imageCopies)
+    {
+        batch.commandBuffer.copyBufferToImage(copy.srcBuffer,
+                                              copy.dstImage,
+                                              vk::ImageLayout::eTransferDstOptimal,
+                                              copy.regions);
+    }
+    if (not postBufferBarriers.empty() || not postImageBarriers.empty())
+    {
+        batch.commandBuffer.pipelineBarrier2(
+            {.bufferMemoryBarrierCount = static_cast<uint32_t>(postBufferBarriers.size()),
+             .pBufferMemoryBarriers    = postBufferBarriers.data(),
+             .imageMemoryBarrierCount  = static_cast<uint32_t>(postImageBarriers.size()),
+             .pImageMemoryBarriers     = postImageBarriers.data()});
+    }
+    batch.commandBuffer.end();
+
+    batch.value   = ++lastSubmittedValue;
+    batch.ringEnd = ringHead;
+
+    vk::CommandBufferSubmitInfo commandBufferInfo{.commandBuffer = *batch.commandBuffer};
+    vk::SemaphoreSubmitInfo     signalInfo{.semaphore = *semaphore,
+                                           .value     = batch.value,
+                                           .stageMask = vk::PipelineStageFlagBits2::eAllCommands};
+    queue.submit2(vk::SubmitInfo2{.commandBufferInfoCount   = 1,
+                                  .pCommandBufferInfos      = &commandBufferInfo,
+                                  .signalSemaphoreInfoCount = 1,
+                                  .pSignalSemaphoreInfos    = &signalInfo});
+    inFlight.push_back(std::move(batch));
+    for (OversizedStaging &staging : pendingOversized)
+    {
+        retiredStaging.retire(lastSubmittedValue, std::move(staging.buffer), std::move(staging.allocation));
+    }
+    pendingOversized.clear();
+    if (isOwnershipTransfer())
+    {
+        acquireValue = lastSubmittedValue;
+    }
+
+    preBufferBarriers.clear();
+    preImageBarriers.clear();
+    bufferCopies.clear();
+    imageCopies.clear();
+    postBufferBarriers.clear();
+    postImageBarriers.clear();
+
+    return lastSubmittedValue;
+}
+
+PROJECT_API uint64_t UploadBatcher::recordAcquireBarriers(const vk::raii::CommandBuffer &commandBuffer)
+{
+    if (not isOwnershipTransfer())
+    {
+        // Same queue family, the post-copy barriers already made the data visible.
+        return lastSubmittedValue;
+    }
+
+    // Only barriers of submitted batches can be acquired, the ones of the batch
+    // being recorded are still waiting for their release.
+    size_t bufferCount = acquireBufferBarriers.size() - postBufferBarriers.size();
+    size_t imageCount  = acquireImageBarriers.size() - postImageBarriers.size();
+    if (bufferCount == 0 && imageCount == 0)
+    {
+        return 0;
+    }
+
+    commandBuffer.pipelineBarrier2({.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferCount),
+                                    .pBufferMemoryBarriers    = acquireBufferBarriers.data(),
+                                    .imageMemoryBarrierCount  = static_cast<uint32_t>(imageCount),
+                                    .pImageMemoryBarriers     = acquireImageBarriers.data()});
+    acquireBufferBarriers.erase(acquireBufferBarriers.begin(), acquireBufferBarriers.begin() + bufferCount);
+    acquireImageBarriers.erase(acquireImageBarriers.begin(), acquireImageBarriers.begin() + imageCount);
+    return acquireValue;
+}
+
+PROJECT_API void UploadBatcher::wait(uint64_t value) const
+{
+    ZoneScoped;
+    vk::SemaphoreWaitInfo waitInfo{.semaphoreCount = 1, .pSemaphores = &*semaphore, .pValues = &value};
+    if (device.waitSemaphores(waitInfo, UINT64_MAX) != vk::Result::eSuccess)
+    {
+        throw std::runtime_error("failed to wait for upload semaphore!");
+    }
+}
+
+PROJECT_API uint64_t UploadBatcher::getCompletedValue() const
+{
+    return semaphore.getCounterValue();
+}
+
+PROJECT_API uint64_t UploadBatcher::getLastSubmittedValue() const
+{
+    return lastSubmittedValue;
+}
+
+PROJECT_API vk::Semaphore UploadBatcher::getSemaphore() const
+{
+    return *semaphore;
+}
+
+bool UploadBatcher::isOwnershipTransfer() const
+{
+    return queueFamilyIndex != dstQueueFamilyIndex;
+}
+
+void UploadBatcher::retire()
+{
+    if (inFlight.empty())
+    {
+        return;
+    }
+
+    uint64_t completed = getCompletedValue();
+    while (not inFlight.empty() && inFlight.front().value <= completed)
+    {
+        ringTail = inFlight.front().ringEnd;
+        inFlight.front().commandBuffer.reset();
+        freeCommandBuffers.push_back(std::move(inFlight.front().commandBuffer));
+        inFlight.pop_front();
+    }
+    retiredStaging.collect(completed);
+}
+
+vk::raii::CommandBuffer UploadBatcher::acquireCommandBuffer()
+{
+    retire();
+    if (not freeCommandBuffers.empty())
+    {
+        vk::raii::CommandBuffer commandBuffer = std::move(freeCommandBuffers.back());
+        freeCommandBuffers.pop_back();
+        return commandBuffer;
+    }
+
+    vk::CommandBufferAllocateInfo allocInfo{.commandPool        = commandPool,
+                                            .level              = vk::CommandBufferLevel::ePrimary,
+                                            .commandBufferCount = 1};
+    return std::move(device.allocateCommandBuffers(allocInfo).front());
+}
+
+}  // namespace Graphics
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <vector>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#include "DeletionQueue.hpp"
+#include "Memory/Allocator.hpp"
+#include "config.hpp"
+
+namespace Graphics {
+
+/**
+ * @brief Range of the staging ring the caller can write before handing it to
+ * one of the copy methods.
+ */
+struct StagingRange
+{
+    void          *mapped = nullptr;
+    vk::Buffer     buffer;
+    vk::DeviceSize offset = 0;
+    vk::DeviceSize size   = 0;
+};
+
+/**
+ * @class UploadBatcher
+ * @brief Collects buffer and image uploads into one command buffer per batch.
+ *
+ * Copies are recorded as a single pre-copy barrier batch, the copies, then a
+ * single post-copy barrier batch (sync2). A submission signals a timeline
+ * semaphore instead of waiting for the queue: consumers wait on
+ * getSemaphore() / getLastSubmittedValue() on the GPU. Staging memory comes
+ * from a persistently mapped ring and a range is recycled as soon as the
+ * semaphore passes the value of the batch that used it.
+ *
+ * When the batcher runs on another queue family than the consumer (dedicated
+ * transfer queue), the post-copy barriers are queue family ownership releases
+ * and the consumer records the matching acquires with recordAcquireBarriers().
+ *
+ * Not thread safe, all calls must come from the same thread.
+ */
+class PROJECT_API UploadBatcher
+{
+   public:
+    static constexpr vk::DeviceSize DEFAULT_RING_SIZE = 64ull * 1024 * 1024;
+
+    // Members
+   private:
+    struct BufferCopy
+    {
+        vk::Buffer     srcBuffer;
+        vk::Buffer     dstBuffer;
+        vk::BufferCopy region;
+    };
+
+    struct ImageCopy
+    {
+        vk::Buffer                       srcBuffer;
+        vk::Image                        dstImage;
+        std::vector<vk::BufferImageCopy> regions;
+    };
+
+    struct OversizedStaging
+    {
+        vk::raii::Buffer   buffer = nullptr;
+        Memory::Allocation allocation;
+    };
+
+    struct Batch
+    {
+        vk::raii::CommandBuffer commandBuffer = nullptr;
+        uint64_t                value         = 0;
+        uint64_t                ringEnd       = 0;
+    };
+
+    const vk::raii::Device &device;
+    Memory::Allocator      &allocator;
+    const vk::raii::Queue  &queue;
+    uint32_t                queueFamilyIndex;
+    uint32_t                dstQueueFamilyIndex;
+
+    vk::raii::CommandPool commandPool        = nullptr;
+    vk::raii::Semaphore   semaphore          = nullptr;
+    uint64_t              lastSubmittedValue = 0;
+
+    vk::raii::Buffer   ringBuffer = nullptr;
+    Memory::Allocation ringAllocation;
+    std::byte         *ringMapped = nullptr;
+    vk::DeviceSize     ringSize   = 0;
+    uint64_t           ringHead   = 0;  // monotonic, position is ringHead % ringSize
+    uint64_t           ringTail   = 0;
+
+    std::vector<vk::BufferMemoryBarrier2> preBufferBarriers;
+    std::vector<vk::ImageMemoryBarrier2>  preImageBarriers;
+    std::vector<BufferCopy>               bufferCopies;
+    std::vector<ImageCopy>                imageCopies;
+    std::vector<vk::BufferMemoryBarrier2> postBufferBarriers;
+    std::vector<vk::ImageMemoryBarrier2>  postImageBarriers;
+    std::vector<OversizedStaging>         pendingOversized;
+
+    // Acquire side of the ownership transfers of submitted batches.
+    std::vector<vk::BufferMemoryBarrier2> acquireBufferBarriers;
+    std::vector<vk::ImageMemoryBarrier2>  acquireImageBarriers;
+    uint64_t                              acquireValue = 0;
+
+    std::deque<Batch>                    inFlight;
+    std::vector<vk::raii::CommandBuffer> freeCommandBuffers;
+    DeletionQueue                        retiredStaging;  // oversized staging, by batch value
+
+    // Methods
+   public:
+    UploadBatcher(const vk::raii::Device &device,
+                  Memory::Allocator      &allocator,
+                  const vk::raii::Queue  &queue,
+                  uint32_t                queueFamilyIndex,
+                  uint32_t                dstQueueFamilyIndex,
+                  vk::DeviceSize          ringSize = DEFAULT_RING_SIZE);
+    UploadBatcher(const UploadBatcher &)            = delete;
+    UploadBatcher &operator=(const UploadBatcher &) = delete;
+    ~UploadBatcher();
+
+    /**
+     * @brief Reserve staging memory, recycling retired ranges and waiting for
+     * the oldest batch only when the ring is full.
+     */
+    StagingRange reserve(vk::DeviceSize size, vk::DeviceSize alignment = 16);
+
+    void uploadBuffer(vk::Buffer dstBuffer, vk::DeviceSize dstOffset, const void *data, vk::DeviceSize size);
+    void copyToBuffer(const StagingRange &staging, vk::Buffer dstBuffer, vk::DeviceSize dstOffset);
+
+    /**
+     * @brief Upload the first mip level of a whole color image, leaving it in
+     * finalLayout for the given consumer stage. The other levels are left
+     * untouched, e.g. for a MipGenerator (finalLayout eTransferSrcOptimal,
+     * dstStage eBlit).
+     */
+    void uploadImage(vk::Image               dstImage,
+                     vk::Extent3D            extent,
+                     const void             *data,
+                     vk::DeviceSize          size,
+                     vk::ImageLayout         finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+                     vk::PipelineStageFlags2 dstStage    = vk::PipelineStageFlagBits2::eFragmentShader);
+    void copyToImage(const StagingRange     &staging,
+                     vk::Image               dstImage,
+                     vk::Extent3D            extent,
+                     vk::ImageLayout         finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+                     vk::PipelineStageFlags2 dstStage    = vk::PipelineStageFlagBits2::eFragmentShader);
+
+    /**
+     * @brief Upload precomputed mip levels (e.g. cooked KTX2 levels), from the
+     * base level down, in one staging range and one copy.
+     */
+    void uploadImageLevels(vk::Image                                   dstImage,
+                           vk::Extent3D                                extent,
+                           std::span<const std::span<const std::byte>> levels,
+                           vk::ImageLayout         finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+                           vk::PipelineStageFlags2 dstStage    = vk::PipelineStageFlagBits2::eFragmentShader);
+
+    bool hasPendingWork() const;
+
+    /**
+     * @brief Record and submit everything collected so far.
+     * @return the timeline value signaled when the batch completes.
+     */
+    uint64_t submit();
+
+    /**
+     * @brief Record the ownership acquires of every submitted batch on the
+     * consumer queue.
+     * @return the timeline value the submission of commandBuffer must wait
+     * for, 0 when there is nothing to wait for.
+     */
+    uint64_t recordAcquireBarriers(const vk::raii::CommandBuffer &commandBuffer);
+
+    void     wait(uint64_t value) const;
+    uint64_t getCompletedValue() const;
+    uint64_t getLastSubmittedValue() const;
+
+    vk::Semaphore getSemaphore() const;
+
+   private:
+    bool                    isOwnershipTransfer() const;
+    void                    recordImageCopy(vk::Buffer                       srcBuffer,
+                                            vk::Image                        dstImage,
+                                            std::vector<vk::BufferImageCopy> regions,
+                                            vk::ImageLayout                  finalLayout,
+                                            vk::PipelineStageFlags2          dstStage);
+    void                    retire();
+    vk::raii::CommandBuffer acquireCommandBuffer();
+};
+
+}  // namespace Graphics
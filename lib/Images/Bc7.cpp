@@ -0,0 +1,328 @@
+#include "Bc7.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace Images {
+
+namespace {
+
+constexpr std::array<uint32_t, 16> WEIGHTS = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+using Color = std::array<float, 4>;
+
+struct Endpoints
+{
+    std::array<uint8_t, 4> color[2];  // 7 bits per channel
+    uint8_t                pbit[2];
+};
+
+uint8_t expand(uint8_t value7, uint8_t pbit)
+{
+    return static_cast<uint8_t>((value7 << 1) | pbit);
+}
+
+uint8_t interpolate(uint8_t e0, uint8_t e1, uint32_t index)
+{
+    return static_cast<uint8_t>(((64 - WEIGHTS[index]) * e0 + WEIGHTS[index] * e1 + 32) >> 6);
+}
+
+/**
+ * Quantize an endpoint to 7 bits per channel for the given p-bit.
+ */
+std::array<uint8_t, 4> quantize(const Color &color, uint8_t pbit)
+{
+    std::array<uint8_t, 4> quantized;
+    for (size_t c = 0; c < 4; c++)
+    {
+        quantized[c] = static_cast<uint8_t>(std::clamp(std::round((color[c] - pbit) / 2.0f), 0.0f, 127.0f));
+    }
+    return quantized;
+}
+
+/**
+ * Pick the closest palette entry for every texel.
+ * @return the total squared error.
+ */
+float assignIndices(const Endpoints &endpoints, const uint8_t texels[64], std::array<uint8_t, 16> &indices)
+{
+    std::array<std::array<uint8_t, 4>, 16> palette;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        for (size_t c = 0; c < 4; c++)
+        {
+            palette[i][c] = interpolate(expand(endpoints.color[0][c], endpoints.pbit[0]),
+                                        expand(endpoints.color[1][c], endpoints.pbit[1]),
+                                        i);
+        }
+    }
+
+    float totalError = 0.0f;
+    for (size_t t = 0; t < 16; t++)
+    {
+        uint32_t bestError = std::numeric_limits<uint32_t>::max();
+        for (uint8_t i = 0; i < 16; i++)
+        {
+            uint32_t error = 0;
+            for (size_t c = 0; c < 4; c++)
+            {
+                int32_t delta = static_cast<int32_t>(texels[t * 4 + c]) - palette[i][c];
+                error += static_cast<uint32_t>(delta * delta);
+            }
+            if (error < bestError)
+            {
+                bestError  = error;
+                indices[t] = i;
+            }
+        }
+        totalError += static_cast<float>(bestError);
+    }
+    return totalError;
+}
+
+/**
+ * Endpoints minimizing the squared error for fixed indices (per channel 2x2
+ * least squares).
+ */
+bool refineEndpoints(const uint8_t texels[64], const std::array<uint8_t, 16> &indices, Color endpoints[2])
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    Color ax = {}, bx = {};
+    for (size_t t = 0; t < 16; t++)
+    {
+        float b = WEIGHTS[indices[t]] / 64.0f;
+        float a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (size_t c = 0; c < 4; c++)
+        {
+            ax[c] += a * texels[t * 4 + c];
+            bx[c] += b * texels[t * 4 + c];
+        }
+    }
+    float determinant = aa * bb - ab * ab;
+    if (std::abs(determinant) < 1e-6f)
+    {
+        return false;
+    }
+    for (size_t c = 0; c < 4; c++)
+    {
+        endpoints[0][c] = std::clamp((bb * ax[c] - ab * bx[c]) / determinant, 0.0f, 255.0f);
+        endpoints[1][c] = std::clamp((aa * bx[c] - ab * ax[c]) / determinant, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+/**
+ * Endpoints at the extremes of the block projected on its principal axis.
+ */
+void principalAxisEndpoints(const uint8_t texels[64], Color endpoints[2])
+{
+    Color mean = {};
+    for (size_t t = 0; t < 16; t++)
+    {
+        for (size_t c = 0; c < 4; c++)
+        {
+            mean[c] += texels[t * 4 + c] / 16.0f;
+        }
+    }
+
+    float covariance[4][4] = {};
+    for (size_t t = 0; t < 16; t++)
+    {
+        Color delta;
+        for (size_t c = 0; c < 4; c++)
+        {
+            delta[c] = texels[t * 4 + c] - mean[c];
+        }
+        for (size_t i = 0; i < 4; i++)
+        {
+            for (size_t j = 0; j < 4; j++)
+            {
+                covariance[i][j] += delta[i] * delta[j];
+            }
+        }
+    }
+
+    // Power iteration, the covariance is tiny so a few steps converge.
+    Color axis = {1.0f, 1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        Color next = {};
+        for (size_t i = 0; i < 4; i++)
+        {
+            for (size_t j = 0; j < 4; j++)
+            {
+                next[i] += covariance[i][j] * axis[j];
+            }
+        }
+        float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+        if (length < 1e-6f)
+        {
+            break;
+        }
+        for (size_t c = 0; c < 4; c++)
+        {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    float minProjection = std::numeric_limits<float>::max();
+    float maxProjection = std::numeric_limits<float>::lowest();
+    for (size_t t = 0; t < 16; t++)
+    {
+        float projection = 0.0f;
+        for (size_t c = 0; c < 4; c++)
+        {
+            projection += (texels[t * 4 + c] - mean[c]) * axis[c];
+        }
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+    for (size_t c = 0; c < 4; c++)
+    {
+        endpoints[0][c] = std::clamp(mean[c] + axis[c] * minProjection, 0.0f, 255.0f);
+        endpoints[1][c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.0f, 255.0f);
+    }
+}
+
+/**
+ * Quantize both endpoints, trying the four p-bit combinations: the p-bit is
+ * shared by the channels of an endpoint, so the best one depends on the
+ * indices it ends up with.
+ * @return the total squared error of the chosen encoding.
+ */
+float quantizeEndpoints(const Color              endpoints[2],
+                        const uint8_t            texels[64],
+                        Endpoints               &quantized,
+                        std::array<uint8_t, 16> &indices)
+{
+    float bestError = std::numeric_limits<float>::max();
+    for (uint8_t p0 = 0; p0 < 2; p0++)
+    {
+        for (uint8_t p1 = 0; p1 < 2; p1++)
+        {
+            Endpoints               candidate{.color = {quantize(endpoints[0], p0), quantize(endpoints[1], p1)},
+                                              .pbit  = {p0, p1}};
+            std::array<uint8_t, 16> candidateIndices;
+            float                   error = assignIndices(candidate, texels, candidateIndices);
+            if (error < bestError)
+            {
+                bestError = error;
+                quantized = candidate;
+                indices   = candidateIndices;
+            }
+        }
+    }
+    return bestError;
+}
+
+class BitWriter
+{
+    uint8_t *data;
+    uint32_t position = 0;
+
+   public:
+    explicit BitWriter(uint8_t *data) : data(data)
+    {
+        std::memset(data, 0, Bc7::BLOCK_SIZE);
+    }
+
+    void write(uint32_t value, uint32_t bitCount)
+    {
+        for (uint32_t bit = 0; bit < bitCount; bit++, position++)
+        {
+            data[position / 8] |= static_cast<uint8_t>(((value >> bit) & 1) << (position % 8));
+        }
+    }
+};
+
+}  // namespace
+
+PROJECT_API void Bc7::encodeBlock(const uint8_t texels[64], uint8_t block[BLOCK_SIZE])
+{
+    Color endpoints[2];
+    principalAxisEndpoints(texels, endpoints);
+
+    Endpoints               best;
+    std::array<uint8_t, 16> bestIndices;
+    float                   bestError = quantizeEndpoints(endpoints, texels, best, bestIndices);
+
+    if (bestError > 0.0f && refineEndpoints(texels, bestIndices, endpoints))
+    {
+        Endpoints               refined;
+        std::array<uint8_t, 16> refinedIndices;
+        float                   refinedError = quantizeEndpoints(endpoints, texels, refined, refinedIndices);
+        if (refinedError < bestError)
+        {
+            best        = refined;
+            bestIndices = refinedIndices;
+        }
+    }
+
+    // The anchor index is stored on 3 bits, its MSB must be 0.
+    if (bestIndices[0] & 0x8)
+    {
+        std::swap(best.color[0], best.color[1]);
+        std::swap(best.pbit[0], best.pbit[1]);
+        for (auto &index : bestIndices)
+        {
+            index = static_cast<uint8_t>(15 - index);
+        }
+    }
+
+    BitWriter writer(block);
+    writer.write(1 << 6, 7);  // mode 6
+    for (size_t c = 0; c < 4; c++)
+    {
+        writer.write(best.color[0][c], 7);
+        writer.write(best.color[1][c], 7);
+    }
+    writer.write(best.pbit[0], 1);
+    writer.write(best.pbit[1], 1);
+    writer.write(bestIndices[0], 3);
+    for (size_t t = 1; t < 16; t++)
+    {
+        writer.write(bestIndices[t], 4);
+    }
+}
+
+PROJECT_API std::vector<uint8_t> Bc7::encode(const uint8_t *rgba, uint32_t width, uint32_t height, size_t pitch)
+{
+    uint32_t             blocksX = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+    uint32_t             blocksY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+    std::vector<uint8_t> blocks(getEncodedSize(width, height));
+
+    for (uint32_t by = 0; by < blocksY; by++)
+    {
+        for (uint32_t bx = 0; bx < blocksX; bx++)
+        {
+            uint8_t texels[64];
+            for (uint32_t y = 0; y < BLOCK_DIMENSION; y++)
+            {
+                uint32_t       row  = std::min(by * BLOCK_DIMENSION + y, height - 1);
+                const uint8_t *line = rgba + row * pitch;
+                for (uint32_t x = 0; x < BLOCK_DIMENSION; x++)
+                {
+                    uint32_t column = std::min(bx * BLOCK_DIMENSION + x, width - 1);
+                    std::memcpy(&texels[(y * BLOCK_DIMENSION + x) * 4], line + column * 4, 4);
+                }
+            }
+            encodeBlock(texels, &blocks[(by * blocksX + bx) * BLOCK_SIZE]);
+        }
+    }
+    return blocks;
+}
+
+PROJECT_API size_t Bc7::getEncodedSize(uint32_t width, uint32_t height)
+{
+    size_t blocksX = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+    size_t blocksY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+    return blocksX * blocksY * BLOCK_SIZE;
+}
+
+}  // namespace Images
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "config.hpp"
+
+namespace Images {
+
+/**
+ * @class Bc7
+ * @brief BC7 block encoder used by the texture cooker.
+ *
+ * Every block is encoded in mode 6 (one subset, RGBA 7.7.7.7 endpoints with a
+ * p-bit, 4-bit indices): endpoints from the principal axis of the block, then
+ * one least-squares refinement pass. It is not a mode search encoder, but it
+ * is fast enough to run on every build and keeps color and alpha together.
+ */
+class PROJECT_API Bc7
+{
+   public:
+    static constexpr uint32_t BLOCK_DIMENSION = 4;
+    static constexpr size_t   BLOCK_SIZE      = 16;
+
+    // Methods
+   public:
+    /**
+     * @brief Encode one 4x4 block of RGBA8 texels (row major) into 16 bytes.
+     */
+    static void encodeBlock(const uint8_t texels[64], uint8_t block[BLOCK_SIZE]);
+
+    /**
+     * @brief Encode a whole RGBA8 image, edge blocks repeat the last row and
+     * column. Blocks are stored row by row, as Vulkan expects them.
+     */
+    static std::vector<uint8_t> encode(const uint8_t *rgba, uint32_t width, uint32_t height, size_t pitch);
+
+    static size_t getEncodedSize(uint32_t width, uint32_t height);
+};
+
+}  // namespace Images
@@ -0,0 +1,127 @@
+#include "DecodePool.hpp"
+
+#include <memory>
+#include <string>
+
+#include "profiling.hpp"
+
+namespace Images {
+
+namespace {
+
+/**
+ * @brief tjhandle of the calling thread, created on its first decode and
+ * destroyed with the thread.
+ */
+tjhandle threadHandle()
+{
+    struct Handle
+    {
+        // A failed tj3Init leaves handle null, each Jpeg then creates its own
+        // and reports the error through the job.
+        tjhandle handle = tj3Init(TJINIT_DECOMPRESS);
+
+        ~Handle()
+        {
+            if (handle != nullptr)
+            {
+                tj3Destroy(handle);
+            }
+        }
+    };
+    thread_local Handle handle;
+    return handle.handle;
+}
+
+}  // namespace
+
+PROJECT_API DecodePool::DecodePool(Jobs::JobSystem &jobSystem) : jobSystem(jobSystem)
+{
+}
+
+PROJECT_API std::future<Jpeg> DecodePool::decode(const std::string &filename, const DecodeOptions &options)
+{
+    // std::function must be copyable, the promise is shared with the job.
+    auto              promise = std::make_shared<std::promise<Jpeg>>();
+    std::future<Jpeg> future  = promise->get_future();
+    push(filename, [promise, filename, options](tjhandle handle) {
+        try
+        {
+            promise->set_value(Jpeg(filename, options, handle));
+        } catch (...)
+        {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    return future;
+}
+
+PROJECT_API std::vector<std::future<Jpeg>> DecodePool::decode(const std::vector<std::string> &filenames,
+                                                              const DecodeOptions            &options)
+{
+    std::vector<std::future<Jpeg>> futures;
+    futures.reserve(filenames.size());
+    for (const auto &filename : filenames)
+    {
+        futures.push_back(decode(filename, options));
+    }
+    return futures;
+}
+
+PROJECT_API void DecodePool::decode(const std::string   &filename,
+                                    DecodedCallback      onDecoded,
+                                    ErrorCallback        onError,
+                                    const DecodeOptions &options)
+{
+    push(filename,
+         [filename, options, onDecoded = std::move(onDecoded), onError = std::move(onError)](tjhandle handle) {
+             try
+             {
+                 onDecoded(Jpeg(filename, options, handle));
+             } catch (...)
+             {
+                 if (onError)
+                 {
+                     onError(filename, std::current_exception());
+                 }
+             }
+         });
+}
+
+PROJECT_API std::future<void> DecodePool::decompressInto(const Jpeg &image, void *destination, size_t pitch)
+{
+    auto              promise = std::make_shared<std::promise<void>>();
+    std::future<void> future  = promise->get_future();
+    push(image.getFilename(), [promise, &image, destination, pitch](tjhandle handle) {
+        try
+        {
+            image.decompressInto(destination, pitch, handle);
+            promise->set_value();
+        } catch (...)
+        {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    return future;
+}
+
+PROJECT_API uint32_t DecodePool::getThreadCount() const
+{
+    return jobSystem.getWorkerCount();
+}
+
+void DecodePool::push(const std::string &filename, std::function<void(tjhandle)> run)
+{
+    // The decode owns no thread: it is one more job, stolen by whatever worker
+    // is idle.
+    jobSystem.schedule(
+        [filename, run = std::move(run)]() {
+            ZoneScopedN("Decode JPEG");
+            TracyMessage(filename.c_str(), filename.size());
+            run(threadHandle());
+        },
+        {},
+        "Decode JPEG");
+}
+
+}  // namespace Images
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "Images/Jpeg.hpp"
+#include "Jobs/JobSystem.hpp"
+#include "config.hpp"
+
+namespace Images {
+
+/**
+ * @class DecodePool
+ * @brief Decodes JPEG files as jobs of a Jobs::JobSystem.
+ *
+ * Each job system thread lazily creates one tjhandle and reuses it for every
+ * image it decodes, instead of a tj3Init() per image. Results come back
+ * through futures, or through callbacks invoked on the decoding thread.
+ */
+class PROJECT_API DecodePool
+{
+   public:
+    using DecodedCallback = std::function<void(Jpeg &&)>;
+    using ErrorCallback   = std::function<void(const std::string &filename, std::exception_ptr)>;
+
+    // Members
+   private:
+    Jobs::JobSystem &jobSystem;
+
+    // Methods
+   public:
+    /**
+     * @param jobSystem must outlive the pool and the decodes it runs.
+     */
+    explicit DecodePool(Jobs::JobSystem &jobSystem);
+    DecodePool(const DecodePool &)            = delete;
+    DecodePool &operator=(const DecodePool &) = delete;
+
+    std::future<Jpeg> decode(const std::string &filename, const DecodeOptions &options = {});
+
+    std::vector<std::future<Jpeg>> decode(const std::vector<std::string> &filenames,
+                                          const DecodeOptions            &options = {});
+
+    /**
+     * @brief Decode without a future, onDecoded or onError runs on the worker.
+     * Failures are dropped when onError is empty.
+     */
+    void decode(const std::string   &filename,
+                DecodedCallback      onDecoded,
+                ErrorCallback        onError,
+                const DecodeOptions &options = {});
+
+    /**
+     * @brief Decode a header-only image straight into caller memory on a
+     * worker. image and destination must stay alive until the future is ready.
+     */
+    std::future<void> decompressInto(const Jpeg &image, void *destination, size_t pitch);
+
+    uint32_t getThreadCount() const;
+
+   private:
+    void push(const std::string &filename, std::function<void(tjhandle)> run);
+};
+
+}  // namespace Images
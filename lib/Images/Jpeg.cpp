@@ -1,105 +1,278 @@
 #include "Jpeg.hpp"
 
+#include <algorithm>
 #include <cstdint>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <utility>
 
-#include "Utils/Handlers.hpp"
+#include "Utils/MappedFile.hpp"
 
 
 namespace Images {
 
 PROJECT_API Jpeg::Jpeg(const std::string &filename, TJPF pixelFormat) :
-    handle(tj3Init(TJINIT_DECOMPRESS)), filename(filename),
-    jpegBuf(Utils::Handlers::File::getBuffer<uint8_t>(filename)), pixelFormat(pixelFormat)
+    Jpeg(filename, DecodeOptions{.pixelFormat = pixelFormat})
+{}
+
+PROJECT_API Jpeg::Jpeg(const std::string &filename, const DecodeOptions &options, tjhandle handle) :
+    handle(handle), ownsHandle(handle == nullptr), filename(filename), jpegFile(filename),
+    pixelFormat(options.pixelFormat)
 {
-    if (handle == nullptr)
+    // The destructor doesn't run when the constructor throws, the owned
+    // handle is freed here until the image is complete.
+    std::unique_ptr<void, decltype(&tj3Destroy)> owned(nullptr, tj3Destroy);
+    if (ownsHandle)
+    {
+        owned.reset(tj3Init(TJINIT_DECOMPRESS));
+        this->handle = owned.get();
+    }
+    if (this->handle == nullptr)
+    {
+        throw std::runtime_error(std::string("Failed to initialize TurboJPEG context : ") + tj3GetErrorStr(nullptr));
+    }
+    if (tj3DecompressHeader(this->handle, getJpegData(), getJpegSize()) != 0)
+    {
+        throw std::runtime_error(std::string("Failed to decompress JPEG header: ") + tj3GetErrorStr(this->handle));
+    }
+    precision = tj3Get(this->handle, TJPARAM_PRECISION);
+
+    int32_t jpegWidth  = tj3Get(this->handle, TJPARAM_JPEGWIDTH);
+    int32_t jpegHeight = tj3Get(this->handle, TJPARAM_JPEGHEIGHT);
+    scalingFactor      = options.maxDimension != 0 ? findScalingFactor(jpegWidth, jpegHeight, options.maxDimension)
+                                                   : options.scalingFactor;
+    // A reused handle keeps the factor of the previous image, always set it.
+    if (tj3SetScalingFactor(this->handle, scalingFactor) != 0)
+    {
+        throw std::runtime_error(std::string("Failed to set JPEG scaling factor: ") + tj3GetErrorStr(this->handle));
+    }
+    width  = TJSCALED(jpegWidth, scalingFactor);
+    height = TJSCALED(jpegHeight, scalingFactor);
+
+    if (not options.headerOnly)
     {
-        throw std::runtime_error(std::string("Failed to initialize TurboJPEG context : ") + tj3GetErrorStr(handle));
+        decompress();
     }
-    if (tj3DecompressHeader(handle, jpegBuf.data(), getJpegSize()) != 0)
+    if (ownsHandle)
     {
-        throw std::runtime_error(std::string("Failed to decompress JPEG header: ") + tj3GetErrorStr(handle));
+        this->handle = owned.release();
     }
-    if (decompress() != 0)
+    if (not ownsHandle)
+    {
+        // The handle goes back to its owner, later decodes get their own.
+        this->handle = nullptr;
+    }
+}
+
+PROJECT_API Jpeg::Jpeg(Jpeg &&other) noexcept :
+    handle(std::exchange(other.handle, nullptr)), ownsHandle(std::exchange(other.ownsHandle, false)),
+    filename(std::move(other.filename)), jpegFile(std::move(other.jpegFile)), rawBuffer(std::move(other.rawBuffer)),
+    pixelFormat(other.pixelFormat), scalingFactor(other.scalingFactor), precision(other.precision),
+    width(other.width), height(other.height)
+{}
+
+PROJECT_API Jpeg &Jpeg::operator=(Jpeg &&other) noexcept
+{
+    if (this != &other)
     {
-        throw std::runtime_error(std::string("Failed to decompress JPEG: ") + tj3GetErrorStr(handle));
+        if (ownsHandle)
+        {
+            tj3Destroy(handle);
+        }
+        handle        = std::exchange(other.handle, nullptr);
+        ownsHandle    = std::exchange(other.ownsHandle, false);
+        filename      = std::move(other.filename);
+        jpegFile      = std::move(other.jpegFile);
+        rawBuffer     = std::move(other.rawBuffer);
+        pixelFormat   = other.pixelFormat;
+        scalingFactor = other.scalingFactor;
+        precision     = other.precision;
+        width         = other.width;
+        height        = other.height;
     }
+    return *this;
 }
 
 PROJECT_API Jpeg::~Jpeg(void)
 {
-    tj3Destroy(handle);
+    if (ownsHandle)
+    {
+        tj3Destroy(handle);
+    }
+}
+
+PROJECT_API const std::string &Jpeg::getFilename() const
+{
+    return filename;
+}
+
+PROJECT_API int32_t Jpeg::getDataPrecision() const
+{
+    return precision;
 }
 
-inline int32_t Jpeg::getDataPrecision() const
+PROJECT_API const uint8_t *Jpeg::getJpegData() const
 {
-    return tj3Get(handle, TJPARAM_PRECISION);
+    return reinterpret_cast<const uint8_t *>(jpegFile.getData());
 }
 
-inline size_t Jpeg::getJpegSize() const
+PROJECT_API size_t Jpeg::getJpegSize() const
 {
-    return jpegBuf.size();
+    return jpegFile.getSize();
 }
 
-inline uint32_t Jpeg::getWidth() const
+PROJECT_API uint32_t Jpeg::getWidth() const
 {
-    return tj3Get(handle, TJPARAM_JPEGWIDTH);
+    return width;
 }
 
-inline uint32_t Jpeg::getHeight() const
+PROJECT_API uint32_t Jpeg::getHeight() const
 {
-    return tj3Get(handle, TJPARAM_JPEGHEIGHT);
+    return height;
 }
 
-inline size_t Jpeg::getPixelSize() const
+PROJECT_API size_t Jpeg::getPixelSize() const
 {
     return tjPixelSize[pixelFormat];
 }
 
-inline const void *Jpeg::getData() const
+PROJECT_API size_t Jpeg::getSampleSize() const
+{
+    return getDataPrecision() == DATA_PRECISION_8_BITS ? sizeof(jpeg_sample_8_t) : sizeof(jpeg_sample_16_t);
+}
+
+PROJECT_API size_t Jpeg::getRowPitch() const
+{
+    return getWidth() * getPixelSize() * getSampleSize();
+}
+
+PROJECT_API const void *Jpeg::getData() const
 {
     return std::visit([](auto const &_buf) -> const void * { return _buf.data(); }, rawBuffer);
 }
 
-inline size_t Jpeg::getSize() const
+PROJECT_API size_t Jpeg::getSize() const
 {
-    return getWidth() * getHeight() * getPixelSize();
+    return getRowPitch() * getHeight();
 }
 
-PROJECT_API int32_t Jpeg::decompress()
+PROJECT_API void Jpeg::decompress()
 {
+    size_t samples = getWidth() * getPixelSize() * getHeight();
+    void  *data    = nullptr;
     if (getDataPrecision() == DATA_PRECISION_8_BITS)
     {
-        auto &_buf = std::get<jpeg_buf_8_t>(rawBuffer);
-        _buf.resize(getSize());
-        return tj3Decompress8(handle, jpegBuf.data(), getSize(), _buf.data(), getWidth() * getPixelSize(), pixelFormat);
+        data = rawBuffer.emplace<jpeg_buf_8_t>(samples).data();
     }
     else if (getDataPrecision() == DATA_PRECISION_12_BITS)
     {
-        auto &_buf = std::get<jpeg_buf_12_t>(rawBuffer);
-        _buf.resize(getSize());
-        return tj3Decompress12(handle,
-                               jpegBuf.data(),
-                               getSize(),
-                               _buf.data(),
-                               getWidth() * getPixelSize(),
-                               pixelFormat);
+        data = rawBuffer.emplace<jpeg_buf_12_t>(samples).data();
     }
     else if (getDataPrecision() == DATA_PRECISION_16_BITS)
     {
-        auto &_buf = std::get<jpeg_buf_16_t>(rawBuffer);
-        _buf.resize(getSize());
-        return tj3Decompress16(handle,
-                               jpegBuf.data(),
-                               getSize(),
-                               _buf.data(),
-                               getWidth() * getPixelSize(),
-                               pixelFormat);
+        data = rawBuffer.emplace<jpeg_buf_16_t>(samples).data();
+    }
+    decompressInto(data, getRowPitch(), handle);
+}
+
+PROJECT_API void Jpeg::decompressInto(void *destination, size_t pitch, tjhandle handle) const
+{
+    if (pitch < getRowPitch() || pitch % getSampleSize() != 0)
+    {
+        throw std::runtime_error("invalid JPEG destination pitch: " + std::to_string(pitch));
+    }
+
+    tjhandle decodeHandle = handle != nullptr ? handle : this->handle;
+    bool     temporary    = decodeHandle == nullptr;
+    if (temporary)
+    {
+        decodeHandle = tj3Init(TJINIT_DECOMPRESS);
+        if (decodeHandle == nullptr)
+        {
+            throw std::runtime_error(std::string("Failed to initialize TurboJPEG context : ") +
+                                     tj3GetErrorStr(nullptr));
+        }
+    }
+
+    // The handle may have parsed another image since the constructor.
+    int32_t result = tj3DecompressHeader(decodeHandle, getJpegData(), getJpegSize());
+    if (result == 0)
+    {
+        result = tj3SetScalingFactor(decodeHandle, scalingFactor);
     }
-    else
+    if (result == 0)
+    {
+        // tj3 pitches are in samples.
+        int samplePitch = static_cast<int>(pitch / getSampleSize());
+        if (getDataPrecision() == DATA_PRECISION_8_BITS)
+        {
+            result = tj3Decompress8(decodeHandle,
+                                    getJpegData(),
+                                    getJpegSize(),
+                                    static_cast<jpeg_sample_8_t *>(destination),
+                                    samplePitch,
+                                    pixelFormat);
+        }
+        else if (getDataPrecision() == DATA_PRECISION_12_BITS)
+        {
+            result = tj3Decompress12(decodeHandle,
+                                     getJpegData(),
+                                     getJpegSize(),
+                                     static_cast<jpeg_sample_12_t *>(destination),
+                                     samplePitch,
+                                     pixelFormat);
+        }
+        else if (getDataPrecision() == DATA_PRECISION_16_BITS)
+        {
+            result = tj3Decompress16(decodeHandle,
+                                     getJpegData(),
+                                     getJpegSize(),
+                                     static_cast<jpeg_sample_16_t *>(destination),
+                                     samplePitch,
+                                     pixelFormat);
+        }
+        else
+        {
+            result = -1;
+        }
+    }
+
+    std::string error = result != 0 ? tj3GetErrorStr(decodeHandle) : "";
+    if (temporary)
+    {
+        tj3Destroy(decodeHandle);
+    }
+    if (result != 0)
+    {
+        throw std::runtime_error("Failed to decompress JPEG " + filename + ": " + error);
+    }
+}
+
+PROJECT_API tjscalingfactor Jpeg::findScalingFactor(uint32_t width, uint32_t height, uint32_t maxDimension)
+{
+    int                    count   = 0;
+    const tjscalingfactor *factors = tj3GetScalingFactors(&count);
+    tjscalingfactor        best    = TJUNSCALED;
+    uint32_t               bestMax = std::max(width, height);
+    if (factors == nullptr || bestMax <= maxDimension)
+    {
+        return TJUNSCALED;
+    }
+
+    // Keep the largest output that fits, or the smallest one if none does.
+    for (int i = 0; i < count; i++)
     {
-        return -1;
+        uint32_t scaledMax = std::max<uint32_t>(TJSCALED(width, factors[i]), TJSCALED(height, factors[i]));
+        bool     fits      = scaledMax <= maxDimension;
+        bool     bestFits  = bestMax <= maxDimension;
+        if ((fits && (not bestFits || scaledMax > bestMax)) || (not fits && not bestFits && scaledMax < bestMax))
+        {
+            best    = factors[i];
+            bestMax = scaledMax;
+        }
     }
+    return best;
 }
 
-}  // namespace Images
\ No newline at end of file
+}  // namespace Images
@@ -2,14 +2,45 @@
 
 #include <turbojpeg.h>
 
+#include <cstdint>
 #include <string>
 #include <variant>
 #include <vector>
 
+#include "Utils/MappedFile.hpp"
 #include "config.hpp"
 
 namespace Images {
 
+/**
+ * @brief How a JPEG is decoded.
+ *
+ * scalingFactor is one of tj3GetScalingFactors(), the decoder then skips the
+ * IDCT work for the dropped resolution. maxDimension, when set, overrides it
+ * with the smallest reduction that fits the image in maxDimension pixels.
+ * headerOnly stops after the header, the pixels are then decoded later with
+ * decompress() or decompressInto().
+ */
+struct DecodeOptions
+{
+    TJPF            pixelFormat   = TJPF_RGBA;
+    tjscalingfactor scalingFactor = TJUNSCALED;
+    uint32_t        maxDimension  = 0;
+    bool            headerOnly    = false;
+};
+
+/**
+ * @class Jpeg
+ * @brief Decoded JPEG image.
+ *
+ * The header values are cached at construction, so a Jpeg decoded with a
+ * borrowed tjhandle (see DecodePool) stays valid once the handle moves on to
+ * the next image. A borrowed handle is only used by the constructor.
+ *
+ * To avoid the intermediate buffer, open the image with headerOnly, size the
+ * destination with getSize() / getRowPitch(), then decompressInto() it (a
+ * mapped staging range, a ReBAR buffer...).
+ */
 class PROJECT_API Jpeg
 {
     // Members
@@ -19,9 +50,10 @@ class PROJECT_API Jpeg
     static constexpr int32_t DATA_PRECISION_16_BITS = 16;
 
    private:
-    tjhandle                   handle;
-    const std::string          filename;
-    const std::vector<uint8_t> jpegBuf;
+    tjhandle                    handle     = nullptr;
+    bool                        ownsHandle = false;
+    std::string                 filename;
+    Utils::Handlers::MappedFile jpegFile;
     // TODO: later make globals types
     using jpeg_sample_8_t  = uint8_t;
     using jpeg_sample_12_t = int16_t;
@@ -30,23 +62,63 @@ class PROJECT_API Jpeg
     using jpeg_buf_12_t    = std::vector<jpeg_sample_12_t>;
     using jpeg_buf_16_t    = std::vector<jpeg_sample_16_t>;
     using jpeg_raw_buf_t   = std::variant<jpeg_buf_8_t, jpeg_buf_12_t, jpeg_buf_16_t>;
-    jpeg_raw_buf_t rawBuffer;
-    const TJPF     pixelFormat;
+    jpeg_raw_buf_t  rawBuffer;
+    TJPF            pixelFormat;
+    tjscalingfactor scalingFactor = TJUNSCALED;
+    int32_t         precision     = 0;
+    uint32_t        width         = 0;
+    uint32_t        height        = 0;
 
     // Methods
    public:
     Jpeg(const std::string &filename, TJPF pixelFormat = TJPF_RGBA);
+    /**
+     * @param handle decompression handle reused across images, owned by the
+     * caller. nullptr creates one for this image.
+     */
+    Jpeg(const std::string &filename, const DecodeOptions &options, tjhandle handle = nullptr);
+    Jpeg(const Jpeg &)            = delete;
+    Jpeg &operator=(const Jpeg &) = delete;
+    Jpeg(Jpeg &&other) noexcept;
+    Jpeg &operator=(Jpeg &&other) noexcept;
     ~Jpeg(void);
 
-    inline int32_t     getDataPrecision() const;
-    inline size_t      getJpegSize() const;
-    inline uint32_t    getWidth() const;
-    inline uint32_t    getHeight() const;
-    inline size_t      getPixelSize() const;
-    inline const void *getData() const;
-    inline size_t      getSize() const;
+    const std::string &getFilename() const;
+
+    int32_t        getDataPrecision() const;
+    const uint8_t *getJpegData() const;
+    size_t         getJpegSize() const;
+    uint32_t       getWidth() const;
+    uint32_t       getHeight() const;
+    size_t         getPixelSize() const;
+    size_t         getSampleSize() const;
+    size_t         getRowPitch() const;
+    const void    *getData() const;
+    /**
+     * @brief Size in bytes of the decoded image with tightly packed rows,
+     * known from the header alone.
+     */
+    size_t         getSize() const;
+
+    /**
+     * @brief Decode into the image own buffer, see getData().
+     */
+    void decompress();
+
+    /**
+     * @brief Decode straight into caller memory.
+     * @param destination at least getHeight() rows of pitch bytes.
+     * @param pitch bytes between rows, at least getRowPitch().
+     * @param handle decompression handle to use, nullptr uses the image one or
+     * a temporary one when it was borrowed.
+     */
+    void decompressInto(void *destination, size_t pitch, tjhandle handle = nullptr) const;
 
-    int32_t decompress();
+    /**
+     * @brief Smallest supported reduction bringing width and height within
+     * maxDimension, TJUNSCALED when the image already fits.
+     */
+    static tjscalingfactor findScalingFactor(uint32_t width, uint32_t height, uint32_t maxDimension);
 };
 
-}  // namespace Images
\ No newline at end of file
+}  // namespace Images
@@ -0,0 +1,335 @@
+#include "Ktx2.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+namespace Images {
+
+namespace {
+
+constexpr std::array<uint8_t, 12> IDENTIFIER = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+// Khronos Data Format descriptor values (khr_df.h)
+constexpr uint8_t KHR_DF_MODEL_RGBSDA           = 1;
+constexpr uint8_t KHR_DF_MODEL_BC7              = 134;
+constexpr uint8_t KHR_DF_MODEL_ASTC             = 162;
+constexpr uint8_t KHR_DF_PRIMARIES_BT709        = 1;
+constexpr uint8_t KHR_DF_TRANSFER_LINEAR        = 1;
+constexpr uint8_t KHR_DF_TRANSFER_SRGB          = 2;
+constexpr uint8_t KHR_DF_CHANNEL_RGBSDA_ALPHA   = 15;
+constexpr uint8_t KHR_DF_SAMPLE_DATATYPE_LINEAR = 0x10;
+
+// The file layout puts the 64-bit fields on 4-byte boundaries.
+#pragma pack(push, 4)
+struct Header
+{
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+#pragma pack(pop)
+static_assert(sizeof(Header) == 68);
+
+struct LevelIndex
+{
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+bool isAstc(VkFormat format)
+{
+    return format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK;
+}
+
+bool isBc7(VkFormat format)
+{
+    return format == VK_FORMAT_BC7_UNORM_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
+bool isRgba8(VkFormat format)
+{
+    return format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB;
+}
+
+/**
+ * Bytes of a texel block, or of a texel for uncompressed formats.
+ */
+uint32_t getBlockBytes(VkFormat format)
+{
+    if (isRgba8(format))
+    {
+        return 4;
+    }
+    if (isBc7(format) || isAstc(format))
+    {
+        return 16;
+    }
+    throw std::runtime_error("unsupported KTX2 format!");
+}
+
+/**
+ * Basic data format descriptor, required by the specification so other tools
+ * (ktx info, RenderDoc...) can read the cooked files.
+ */
+std::vector<uint32_t> makeDataFormatDescriptor(VkFormat format)
+{
+    uint32_t blockWidth  = 1;
+    uint32_t blockHeight = 1;
+    Ktx2::getBlockExtent(format, blockWidth, blockHeight);
+    uint8_t transfer = Ktx2::isSrgb(format) ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR;
+
+    struct Sample
+    {
+        uint32_t bitOffset;
+        uint32_t bitLength;
+        uint32_t channelType;
+        uint32_t upper;
+    };
+    std::vector<Sample> samples;
+    uint8_t             model;
+    uint32_t            bytesPlane0;
+    if (isRgba8(format))
+    {
+        model       = KHR_DF_MODEL_RGBSDA;
+        bytesPlane0 = 4;
+        for (uint32_t channel = 0; channel < 4; channel++)
+        {
+            // sRGB applies to color only, alpha stays linear.
+            uint32_t channelType = channel == 3 ? KHR_DF_CHANNEL_RGBSDA_ALPHA : channel;
+            if (channel == 3 && transfer == KHR_DF_TRANSFER_SRGB)
+            {
+                channelType |= KHR_DF_SAMPLE_DATATYPE_LINEAR;
+            }
+            samples.push_back({.bitOffset = channel * 8, .bitLength = 7, .channelType = channelType, .upper = 255});
+        }
+    }
+    else if (isBc7(format) || isAstc(format))
+    {
+        model       = isBc7(format) ? KHR_DF_MODEL_BC7 : KHR_DF_MODEL_ASTC;
+        bytesPlane0 = 16;
+        samples.push_back({.bitOffset = 0, .bitLength = 127, .channelType = 0, .upper = 0xFFFFFFFF});
+    }
+    else
+    {
+        throw std::runtime_error("unsupported KTX2 format!");
+    }
+
+    uint32_t              blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+    std::vector<uint32_t> dfd;
+    dfd.push_back(4 + blockSize);  // dfdTotalSize
+    dfd.push_back(0);              // vendorId = Khronos, descriptorType = basic
+    dfd.push_back(2 | (blockSize << 16));
+    dfd.push_back(model | (KHR_DF_PRIMARIES_BT709 << 8) | (transfer << 16));
+    dfd.push_back((blockWidth - 1) | ((blockHeight - 1) << 8));
+    dfd.push_back(bytesPlane0);
+    dfd.push_back(0);
+    for (const auto &sample : samples)
+    {
+        dfd.push_back(sample.bitOffset | (sample.bitLength << 16) | (sample.channelType << 24));
+        dfd.push_back(0);  // sample position
+        dfd.push_back(0);  // lower
+        dfd.push_back(sample.upper);
+    }
+    return dfd;
+}
+
+uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+PROJECT_API Ktx2::Ktx2(const std::string &filename) : file(filename)
+{
+    parse(file.getBytes(), filename);
+}
+
+PROJECT_API Ktx2::Ktx2(std::span<const std::byte> bytes, const std::string &name)
+{
+    parse(bytes, name);
+}
+
+void Ktx2::parse(std::span<const std::byte> bytes, const std::string &name)
+{
+    if (bytes.size() < IDENTIFIER.size() + sizeof(Header) ||
+        std::memcmp(bytes.data(), IDENTIFIER.data(), IDENTIFIER.size()) != 0)
+    {
+        throw std::runtime_error("not a KTX2 file: " + name);
+    }
+
+    Header header;
+    std::memcpy(&header, bytes.data() + IDENTIFIER.size(), sizeof(Header));
+    if (header.supercompressionScheme != 0)
+    {
+        throw std::runtime_error("supercompressed KTX2 files are not supported: " + name);
+    }
+    if (header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1)
+    {
+        throw std::runtime_error("only 2D KTX2 textures are supported: " + name);
+    }
+
+    format               = static_cast<VkFormat>(header.vkFormat);
+    width                = header.pixelWidth;
+    height               = header.pixelHeight;
+    uint32_t levelCount  = std::max(1u, header.levelCount);
+    size_t   indexOffset = IDENTIFIER.size() + sizeof(Header);
+    if (bytes.size() < indexOffset + levelCount * sizeof(LevelIndex))
+    {
+        throw std::runtime_error("truncated KTX2 file: " + name);
+    }
+
+    levels.reserve(levelCount);
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        LevelIndex index;
+        std::memcpy(&index, bytes.data() + indexOffset + level * sizeof(LevelIndex), sizeof(LevelIndex));
+        if (index.byteOffset + index.byteLength > bytes.size())
+        {
+            throw std::runtime_error("truncated KTX2 file: " + name);
+        }
+        levels.push_back({.data   = bytes.subspan(index.byteOffset, index.byteLength),
+                          .width  = std::max(1u, width >> level),
+                          .height = std::max(1u, height >> level)});
+    }
+}
+
+PROJECT_API VkFormat Ktx2::getFormat() const
+{
+    return format;
+}
+
+PROJECT_API uint32_t Ktx2::getWidth() const
+{
+    return width;
+}
+
+PROJECT_API uint32_t Ktx2::getHeight() const
+{
+    return height;
+}
+
+PROJECT_API uint32_t Ktx2::getLevelCount() const
+{
+    return static_cast<uint32_t>(levels.size());
+}
+
+PROJECT_API const Ktx2::Level &Ktx2::getLevel(uint32_t level) const
+{
+    return levels.at(level);
+}
+
+PROJECT_API const std::vector<Ktx2::Level> &Ktx2::getLevels() const
+{
+    return levels;
+}
+
+PROJECT_API void Ktx2::getBlockExtent(VkFormat format, uint32_t &blockWidth, uint32_t &blockHeight)
+{
+    // ASTC formats come in UNORM/SRGB pairs, in this block size order.
+    static constexpr std::array<std::array<uint32_t, 2>, 14> ASTC_BLOCKS = {
+        {{4, 4}, {5, 4}, {5, 5}, {6, 5}, {6, 6}, {8, 5}, {8, 6}, {8, 8}, {10, 5}, {10, 6}, {10, 8}, {10, 10}, {12, 10},
+         {12, 12}}
+    };
+    if (isAstc(format))
+    {
+        auto block  = ASTC_BLOCKS[(format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) / 2];
+        blockWidth  = block[0];
+        blockHeight = block[1];
+    }
+    else if (isBc7(format))
+    {
+        blockWidth  = 4;
+        blockHeight = 4;
+    }
+    else
+    {
+        blockWidth  = 1;
+        blockHeight = 1;
+    }
+}
+
+PROJECT_API bool Ktx2::isSrgb(VkFormat format)
+{
+    if (isAstc(format))
+    {
+        return (format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) % 2 == 1;
+    }
+    return format == VK_FORMAT_BC7_SRGB_BLOCK || format == VK_FORMAT_R8G8B8A8_SRGB;
+}
+
+PROJECT_API void Ktx2::write(const std::string &filename, const Source &source)
+{
+    std::vector<uint32_t> dfd        = makeDataFormatDescriptor(source.format);
+    uint32_t              levelCount = static_cast<uint32_t>(source.levels.size());
+    // The specification aligns levels on lcm(texel block size, 4).
+    const uint64_t        levelAlignment = std::lcm(getBlockBytes(source.format), 4u);
+
+    Header header{.vkFormat               = static_cast<uint32_t>(source.format),
+                  .typeSize               = 1,
+                  .pixelWidth             = source.width,
+                  .pixelHeight            = source.height,
+                  .pixelDepth             = 0,
+                  .layerCount             = 0,
+                  .faceCount              = 1,
+                  .levelCount             = levelCount,
+                  .supercompressionScheme = 0,
+                  .dfdByteOffset          = 0,
+                  .dfdByteLength          = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t)),
+                  .kvdByteOffset          = 0,
+                  .kvdByteLength          = 0,
+                  .sgdByteOffset          = 0,
+                  .sgdByteLength          = 0};
+    header.dfdByteOffset = static_cast<uint32_t>(IDENTIFIER.size() + sizeof(Header) + levelCount * sizeof(LevelIndex));
+
+    // The specification stores the smallest level first.
+    std::vector<LevelIndex> index(levelCount);
+    uint64_t                offset = header.dfdByteOffset + header.dfdByteLength;
+    for (uint32_t level = levelCount; level-- > 0;)
+    {
+        offset       = alignUp(offset, levelAlignment);
+        index[level] = {.byteOffset             = offset,
+                        .byteLength             = source.levels[level].size(),
+                        .uncompressedByteLength = source.levels[level].size()};
+        offset += source.levels[level].size();
+    }
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (not out.is_open())
+    {
+        throw std::runtime_error("failed to open file " + filename + "!");
+    }
+    out.write(reinterpret_cast<const char *>(IDENTIFIER.data()), IDENTIFIER.size());
+    out.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    out.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(LevelIndex));
+    out.write(reinterpret_cast<const char *>(dfd.data()), dfd.size() * sizeof(uint32_t));
+    for (uint32_t level = levelCount; level-- > 0;)
+    {
+        std::vector<char> padding(index[level].byteOffset - out.tellp(), 0);
+        out.write(padding.data(), padding.size());
+        out.write(reinterpret_cast<const char *>(source.levels[level].data()), source.levels[level].size());
+    }
+    if (not out)
+    {
+        throw std::runtime_error("failed to write file " + filename + "!");
+    }
+}
+
+}  // namespace Images
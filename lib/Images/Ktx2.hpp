@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Utils/MappedFile.hpp"
+#include "config.hpp"
+
+namespace Images {
+
+/**
+ * @class Ktx2
+ * @brief GPU-ready texture container (KTX 2.0).
+ *
+ * Only what the engine cooks is supported: 2D, one layer, one face, no
+ * supercompression. The mip levels are views on the mapped file, so their
+ * blocks go to the staging ring without an intermediate copy.
+ */
+class PROJECT_API Ktx2
+{
+   public:
+    struct Level
+    {
+        std::span<const std::byte> data;
+        uint32_t                   width  = 0;
+        uint32_t                   height = 0;
+    };
+
+    /**
+     * @brief Image given to write(), levels from the base level down.
+     */
+    struct Source
+    {
+        VkFormat                          format = VK_FORMAT_UNDEFINED;
+        uint32_t                          width  = 0;
+        uint32_t                          height = 0;
+        std::vector<std::vector<uint8_t>> levels;
+    };
+
+    // Members
+   private:
+    Utils::Handlers::MappedFile file;
+    VkFormat                    format = VK_FORMAT_UNDEFINED;
+    uint32_t                    width  = 0;
+    uint32_t                    height = 0;
+    std::vector<Level>          levels;
+
+    // Methods
+   public:
+    explicit Ktx2(const std::string &filename);
+    /**
+     * @brief Parse a file already in memory, e.g. an asset pack entry. The
+     * levels view bytes, which must outlive the texture.
+     */
+    Ktx2(std::span<const std::byte> bytes, const std::string &name);
+
+    VkFormat                  getFormat() const;
+    uint32_t                  getWidth() const;
+    uint32_t                  getHeight() const;
+    uint32_t                  getLevelCount() const;
+    const Level              &getLevel(uint32_t level) const;
+    const std::vector<Level> &getLevels() const;
+
+    /**
+     * @brief Block dimensions of the supported formats, {1, 1} for
+     * uncompressed ones.
+     */
+    static void getBlockExtent(VkFormat format, uint32_t &blockWidth, uint32_t &blockHeight);
+    static bool isSrgb(VkFormat format);
+
+    static void write(const std::string &filename, const Source &source);
+
+   private:
+    void parse(std::span<const std::byte> bytes, const std::string &name);
+};
+
+}  // namespace Images
@@ -0,0 +1,301 @@
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "profiling.hpp"
+
+namespace Jobs {
+
+namespace {
+
+thread_local const JobSystem *currentSystem = nullptr;
+thread_local uint32_t         currentWorker = JobSystem::EXTERNAL_THREAD;
+#if defined(TRACY_FIBERS)
+thread_local const char *currentFiber = nullptr;
+#endif
+
+}  // namespace
+
+PROJECT_API bool Job::isFinished() const
+{
+    return finished.load();
+}
+
+PROJECT_API JobSystem::JobSystem(uint32_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        threadCount              = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+    for (uint32_t i = 0; i <= threadCount; i++)
+    {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    workers.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+PROJECT_API JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard lock(sleepMutex);
+        stopping = true;
+    }
+    sleepCondition.notify_all();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+PROJECT_API JobHandle JobSystem::schedule(std::function<void()>      function,
+                                          std::span<const JobHandle> dependencies,
+                                          const char                *name)
+{
+    auto job      = std::make_shared<Job>();
+    job->function = std::move(function);
+    job->name     = name;
+    for (const JobHandle &dependency : dependencies)
+    {
+        if (not dependency)
+        {
+            continue;
+        }
+        std::lock_guard lock(dependency->mutex);
+        if (not dependency->finished.load(std::memory_order_relaxed))
+        {
+            job->pendingDependencies.fetch_add(1, std::memory_order_relaxed);
+            dependency->continuations.push_back(job);
+        }
+    }
+    // Drop the scheduling reference, dependencies finishing meanwhile could
+    // not queue the job before this point.
+    if (job->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        push(job);
+    }
+    return job;
+}
+
+PROJECT_API JobHandle JobSystem::schedule(std::function<void()>            function,
+                                          std::initializer_list<JobHandle> dependencies,
+                                          const char                      *name)
+{
+    return schedule(std::move(function), std::span<const JobHandle>(dependencies.begin(), dependencies.size()), name);
+}
+
+PROJECT_API JobHandle JobSystem::parallelFor(uint32_t                         count,
+                                             uint32_t                         minBatchSize,
+                                             RangeFunction                    function,
+                                             std::initializer_list<JobHandle> dependencies,
+                                             const char                      *name)
+{
+    // A few batches per thread, so stealing can even out uneven batches.
+    uint32_t threads   = getWorkerCount() + 1;
+    uint32_t batchSize = std::max({1u, minBatchSize, (count + threads * 4 - 1) / (threads * 4)});
+
+    auto                   shared = std::make_shared<RangeFunction>(std::move(function));
+    std::vector<JobHandle> batches;
+    for (uint32_t begin = 0; begin < count; begin += batchSize)
+    {
+        uint32_t end = std::min(count, begin + batchSize);
+        batches.push_back(schedule([shared, begin, end]() { (*shared)(begin, end); }, dependencies, name));
+    }
+    if (batches.empty())
+    {
+        return schedule([]() {}, dependencies, name);
+    }
+    return schedule([]() {}, batches, name);
+}
+
+PROJECT_API void JobSystem::wait(const JobHandle &job)
+{
+    ZoneScoped;
+    uint32_t workerIndex = currentSystem == this ? currentWorker : EXTERNAL_THREAD;
+    while (not job->isFinished())
+    {
+        if (JobHandle next = take(workerIndex))
+        {
+            execute(next);
+            continue;
+        }
+        // Nothing to help with, the job runs elsewhere.
+        std::unique_lock lock(sleepMutex);
+        waitingThreads.fetch_add(1);
+        sleepCondition.wait(lock, [&]() { return job->isFinished() or queuedJobs.load() > 0; });
+        waitingThreads.fetch_sub(1);
+    }
+    if (job->error)
+    {
+        std::rethrow_exception(job->error);
+    }
+}
+
+PROJECT_API uint32_t JobSystem::getWorkerCount() const
+{
+    // The queues are all created before the first worker starts.
+    return static_cast<uint32_t>(queues.size() - 1);
+}
+
+PROJECT_API uint32_t JobSystem::getWorkerIndex()
+{
+    return currentWorker;
+}
+
+void JobSystem::push(JobHandle job)
+{
+    uint32_t     queueIndex = currentSystem == this ? currentWorker : getWorkerCount();
+    WorkerQueue &queue      = *queues[queueIndex];
+    {
+        std::lock_guard lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+    {
+        // Under the sleep mutex, a worker can't miss the wake up between its
+        // check and its wait.
+        std::lock_guard lock(sleepMutex);
+        queuedJobs.fetch_add(1);
+    }
+    sleepCondition.notify_one();
+}
+
+JobHandle JobSystem::pop(uint32_t queueIndex)
+{
+    WorkerQueue    &queue = *queues[queueIndex];
+    std::lock_guard lock(queue.mutex);
+    if (queue.jobs.empty())
+    {
+        return nullptr;
+    }
+    JobHandle job;
+    // The owner works LIFO on its own queue, everything else is taken FIFO.
+    if (queueIndex == currentWorker and currentSystem == this)
+    {
+        job = std::move(queue.jobs.back());
+        queue.jobs.pop_back();
+    }
+    else
+    {
+        job = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
+    }
+    queuedJobs.fetch_sub(1);
+    return job;
+}
+
+JobHandle JobSystem::take(uint32_t workerIndex)
+{
+    uint32_t workerCount = getWorkerCount();
+    if (workerIndex != EXTERNAL_THREAD)
+    {
+        if (JobHandle job = pop(workerIndex))
+        {
+            return job;
+        }
+    }
+    if (JobHandle job = pop(workerCount))
+    {
+        return job;
+    }
+    // Steal, starting from the next worker so thieves spread over the victims.
+    uint32_t start = workerIndex == EXTERNAL_THREAD ? 0 : workerIndex + 1;
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        uint32_t victim = (start + i) % workerCount;
+        if (victim == workerIndex)
+        {
+            continue;
+        }
+        if (JobHandle job = pop(victim))
+        {
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::execute(const JobHandle &job)
+{
+#if defined(TRACY_FIBERS)
+    const char *previousFiber = currentFiber;
+    currentFiber              = job->name;
+    TracyFiberEnter(job->name);
+#endif
+    {
+        ZoneScopedN("Job");
+        ZoneName(job->name, std::strlen(job->name));
+        try
+        {
+            job->function();
+        } catch (...)
+        {
+            job->error = std::current_exception();
+        }
+        // Release the captures now, handles may outlive the job a long time.
+        job->function = nullptr;
+    }
+#if defined(TRACY_FIBERS)
+    TracyFiberLeave;
+    currentFiber = previousFiber;
+    if (previousFiber)
+    {
+        // A job ran inside another one through wait(), go back to its fiber.
+        TracyFiberEnter(previousFiber);
+    }
+#endif
+
+    std::vector<JobHandle> continuations;
+    {
+        std::lock_guard lock(job->mutex);
+        job->finished.store(true);
+        continuations.swap(job->continuations);
+    }
+    for (JobHandle &continuation : continuations)
+    {
+        if (continuation->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            push(std::move(continuation));
+        }
+    }
+    if (waitingThreads.load() > 0)
+    {
+        // Wake the threads blocked in wait(), taking the mutex so none of
+        // them is between its check and its wait.
+        {
+            std::lock_guard lock(sleepMutex);
+        }
+        sleepCondition.notify_all();
+    }
+}
+
+void JobSystem::workerLoop(uint32_t workerIndex)
+{
+    currentSystem = this;
+    currentWorker = workerIndex;
+#if defined(TRACY_ENABLE)
+    std::string threadName = "Job worker " + std::to_string(workerIndex);
+    tracy::SetThreadName(threadName.c_str());
+#endif
+    while (true)
+    {
+        if (JobHandle job = take(workerIndex))
+        {
+            execute(job);
+            continue;
+        }
+        std::unique_lock lock(sleepMutex);
+        sleepCondition.wait(lock, [this]() { return stopping or queuedJobs.load() > 0; });
+        if (stopping and queuedJobs.load() == 0)
+        {
+            return;
+        }
+    }
+}
+
+}  // namespace Jobs
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "config.hpp"
+
+namespace Jobs {
+
+class JobSystem;
+
+/**
+ * @class Job
+ * @brief A unit of work scheduled on a JobSystem.
+ *
+ * Dependencies are continuations: a job is queued once every job it depends
+ * on has finished, nothing ever blocks a worker waiting for it.
+ */
+class PROJECT_API Job
+{
+    friend class JobSystem;
+
+    // Members
+   private:
+    std::function<void()>             function;
+    const char                       *name = nullptr;
+    std::atomic<uint32_t>             pendingDependencies{1};  // + 1 held while scheduling
+    std::mutex                        mutex;
+    std::vector<std::shared_ptr<Job>> continuations;
+    std::atomic<bool>                 finished{false};
+    std::exception_ptr                error;  // rethrown by JobSystem::wait()
+
+    // Methods
+   public:
+    bool isFinished() const;
+};
+
+using JobHandle = std::shared_ptr<Job>;
+
+/**
+ * @class JobSystem
+ * @brief Work-stealing job scheduler, the threading backbone of the engine.
+ *
+ * Each worker owns a deque: it pushes and pops its own jobs at the back (LIFO,
+ * hot in cache) while idle workers steal from the front of the others (FIFO,
+ * the oldest and usually biggest work). Jobs scheduled from another thread go
+ * to a shared injection queue. wait() runs jobs on the waiting thread until the
+ * awaited one finishes, so waiting from a job never deadlocks.
+ *
+ * With Tracy fibers enabled every job runs in a fiber named after the job, so
+ * its zones stay on one timeline whatever worker picks it up.
+ */
+class PROJECT_API JobSystem
+{
+   public:
+    static constexpr uint32_t EXTERNAL_THREAD = ~0u;
+
+    using RangeFunction = std::function<void(uint32_t begin, uint32_t end)>;
+
+    // Members
+   private:
+    struct WorkerQueue
+    {
+        std::mutex            mutex;
+        std::deque<JobHandle> jobs;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;  // one per worker, then the injection queue
+    std::vector<std::thread>                  workers;
+
+    std::mutex              sleepMutex;
+    std::condition_variable sleepCondition;
+    std::atomic<uint64_t>   queuedJobs{0};
+    std::atomic<uint32_t>   waitingThreads{0};
+    bool                    stopping = false;
+
+    // Methods
+   public:
+    /**
+     * @param threadCount 0 uses every hardware thread but one, left to the
+     * main thread which takes part through wait().
+     */
+    explicit JobSystem(uint32_t threadCount = 0);
+    JobSystem(const JobSystem &)            = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+    /**
+     * @brief Finish the queued jobs, then join the workers.
+     */
+    ~JobSystem();
+
+    /**
+     * @brief Run function once every dependency has finished.
+     * @param name static string, the Tracy fiber of the job.
+     */
+    JobHandle schedule(std::function<void()> function, std::span<const JobHandle> dependencies, const char *name);
+    JobHandle schedule(std::function<void()>            function,
+                       std::initializer_list<JobHandle> dependencies = {},
+                       const char                      *name         = "Job");
+
+    /**
+     * @brief Split [0, count) in batches of at least minBatchSize and run
+     * function(begin, end) on each.
+     * @return a job finishing with the last batch.
+     */
+    JobHandle parallelFor(uint32_t                         count,
+                          uint32_t                         minBatchSize,
+                          RangeFunction                    function,
+                          std::initializer_list<JobHandle> dependencies = {},
+                          const char                      *name         = "Parallel for");
+
+    /**
+     * @brief Run jobs on the calling thread until job has finished.
+     */
+    void wait(const JobHandle &job);
+
+    uint32_t getWorkerCount() const;
+
+    /**
+     * @brief Index of the calling worker in [0, getWorkerCount()), or
+     * EXTERNAL_THREAD outside of the workers.
+     */
+    static uint32_t getWorkerIndex();
+
+   private:
+    void      push(JobHandle job);
+    JobHandle pop(uint32_t queueIndex);
+    JobHandle take(uint32_t workerIndex);
+    void      execute(const JobHandle &job);
+    void      workerLoop(uint32_t workerIndex);
+};
+
+}  // namespace Jobs
@@ -0,0 +1,241 @@
+#include "Obj.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+#include "Utils/MappedFile.hpp"
+
+namespace Loaders {
+
+namespace {
+
+/**
+ * @brief Indices of a face corner in the position, texcoord and normal
+ * arrays, -1 when absent.
+ */
+struct Corner
+{
+    int32_t position = -1;
+    int32_t texCoord = -1;
+    int32_t normal   = -1;
+
+    bool operator==(const Corner &) const = default;
+};
+
+struct CornerHash
+{
+    size_t operator()(const Corner &corner) const
+    {
+        size_t hash = std::hash<int32_t>{}(corner.position);
+        hash        = hash * 31 + std::hash<int32_t>{}(corner.texCoord);
+        return hash * 31 + std::hash<int32_t>{}(corner.normal);
+    }
+};
+
+std::string_view nextToken(std::string_view &line)
+{
+    size_t begin = line.find_first_not_of(" \t\r");
+    if (begin == std::string_view::npos)
+    {
+        line = {};
+        return {};
+    }
+    line.remove_prefix(begin);
+    size_t           end   = std::min(line.find_first_of(" \t\r"), line.size());
+    std::string_view token = line.substr(0, end);
+    line.remove_prefix(end);
+    return token;
+}
+
+float parseFloat(std::string_view token)
+{
+    float value  = 0.0f;
+    auto  result = std::from_chars(token.data(), token.data() + token.size(), value);
+    if (result.ec != std::errc() || token.empty())
+    {
+        throw std::runtime_error("invalid number in OBJ file: " + std::string(token));
+    }
+    return value;
+}
+
+/**
+ * @brief OBJ indices start at 1, negative ones count back from the last
+ * element read so far.
+ */
+int32_t parseIndex(std::string_view token, size_t count)
+{
+    if (token.empty())
+    {
+        return -1;
+    }
+    int64_t value  = 0;
+    auto    result = std::from_chars(token.data(), token.data() + token.size(), value);
+    if (result.ec != std::errc() || value == 0)
+    {
+        throw std::runtime_error("invalid index in OBJ file: " + std::string(token));
+    }
+    int64_t index = value < 0 ? static_cast<int64_t>(count) + value : value - 1;
+    if (index < 0 || index >= static_cast<int64_t>(count))
+    {
+        throw std::runtime_error("OBJ index out of range: " + std::string(token));
+    }
+    return static_cast<int32_t>(index);
+}
+
+}  // namespace
+
+PROJECT_API Obj::Obj(const std::string &filename)
+{
+    Utils::Handlers::MappedFile file(filename);
+    std::string_view            text(reinterpret_cast<const char *>(file.getData()), file.getSize());
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> colors;
+    std::vector<glm::vec2> texCoords;
+    std::vector<glm::vec3> fileNormals;
+
+    std::unordered_map<Corner, uint32_t, CornerHash> corners;
+    std::vector<int32_t>                             vertexPositions;  // position index of each vertex
+    std::vector<bool>                                missingNormals;
+    std::vector<uint32_t>                            polygon;
+
+    while (not text.empty())
+    {
+        size_t           end  = std::min(text.find('\n'), text.size());
+        std::string_view line = text.substr(0, end);
+        text.remove_prefix(std::min(end + 1, text.size()));
+        line = line.substr(0, std::min(line.find('#'), line.size()));
+
+        std::string_view keyword = nextToken(line);
+        if (keyword == "v")
+        {
+            glm::vec3 position;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                position[axis] = parseFloat(nextToken(line));
+            }
+            positions.push_back(position);
+
+            glm::vec3        color(1.0f);
+            std::string_view red = nextToken(line);
+            if (not red.empty())
+            {
+                color = {parseFloat(red), parseFloat(nextToken(line)), parseFloat(nextToken(line))};
+            }
+            colors.push_back(color);
+        }
+        else if (keyword == "vt")
+        {
+            float u = parseFloat(nextToken(line));
+            float v = parseFloat(nextToken(line));
+            // OBJ puts the texture origin at the bottom left, Vulkan at the top left.
+            texCoords.emplace_back(u, 1.0f - v);
+        }
+        else if (keyword == "vn")
+        {
+            glm::vec3 normal;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                normal[axis] = parseFloat(nextToken(line));
+            }
+            float length = glm::length(normal);
+            fileNormals.push_back(length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f));
+        }
+        else if (keyword == "f")
+        {
+            polygon.clear();
+            for (std::string_view token = nextToken(line); not token.empty(); token = nextToken(line))
+            {
+                // position/texcoord/normal, the last two optional
+                size_t           firstSlash    = std::min(token.find('/'), token.size());
+                std::string_view rest          = token.substr(std::min(firstSlash + 1, token.size()));
+                size_t           secondSlash   = std::min(rest.find('/'), rest.size());
+                std::string_view positionToken = token.substr(0, firstSlash);
+                std::string_view texCoordToken = rest.substr(0, secondSlash);
+                std::string_view normalToken   = rest.substr(std::min(secondSlash + 1, rest.size()));
+
+                Corner corner{.position = parseIndex(positionToken, positions.size()),
+                              .texCoord = parseIndex(texCoordToken, texCoords.size()),
+                              .normal   = parseIndex(normalToken, fileNormals.size())};
+                if (corner.position < 0)
+                {
+                    throw std::runtime_error("OBJ face corner without a position in " + filename);
+                }
+
+                auto [it, inserted] = corners.try_emplace(corner, static_cast<uint32_t>(vertices.size()));
+                if (inserted)
+                {
+                    glm::vec2 texCoord = corner.texCoord >= 0 ? texCoords[corner.texCoord] : glm::vec2(0.0f);
+                    vertices.push_back(
+                        {.pos = positions[corner.position], .color = colors[corner.position], .texCoord = texCoord});
+                    normals.push_back(corner.normal >= 0 ? fileNormals[corner.normal] : glm::vec3(0.0f));
+                    vertexPositions.push_back(corner.position);
+                    missingNormals.push_back(corner.normal < 0);
+                }
+                polygon.push_back(it->second);
+            }
+            if (polygon.size() < 3)
+            {
+                throw std::runtime_error("OBJ face with less than 3 corners in " + filename);
+            }
+            for (size_t i = 1; i + 1 < polygon.size(); i++)
+            {
+                indices.insert(indices.end(), {polygon[0], polygon[i], polygon[i + 1]});
+            }
+        }
+    }
+
+    // Smooth normals by position, so corners split by their texture
+    // coordinates still share a normal.
+    std::vector<glm::vec3> smoothNormals(positions.size(), glm::vec3(0.0f));
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        const glm::vec3 &a    = vertices[indices[i]].pos;
+        glm::vec3        face = glm::cross(vertices[indices[i + 1]].pos - a, vertices[indices[i + 2]].pos - a);
+        for (size_t corner = 0; corner < 3; corner++)
+        {
+            smoothNormals[vertexPositions[indices[i + corner]]] += face;
+        }
+    }
+    for (size_t vertex = 0; vertex < vertices.size(); vertex++)
+    {
+        if (missingNormals[vertex])
+        {
+            glm::vec3 normal = smoothNormals[vertexPositions[vertex]];
+            float     length = glm::length(normal);
+            normals[vertex]  = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+        }
+    }
+}
+
+PROJECT_API const std::vector<Geometry::Vertex> &Obj::getVertices() const
+{
+    return vertices;
+}
+
+PROJECT_API const std::vector<glm::vec3> &Obj::getNormals() const
+{
+    return normals;
+}
+
+PROJECT_API const std::vector<uint32_t> &Obj::getIndices() const
+{
+    return indices;
+}
+
+PROJECT_API std::vector<Geometry::CompactVertex> Obj::getCompactVertices() const
+{
+    std::vector<Geometry::CompactVertex> compactVertices;
+    compactVertices.reserve(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        compactVertices.push_back(Geometry::CompactVertex::pack(vertices[i], normals[i]));
+    }
+    return compactVertices;
+}
+
+}  // namespace Loaders
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Geometry/Vextex.hpp"
+#include "config.hpp"
+
+namespace Loaders {
+
+/**
+ * @class Obj
+ * @brief Wavefront OBJ reader for the mesh cooker.
+ *
+ * Reads positions (with the optional vertex color extension), texture
+ * coordinates, normals and polygonal faces, fan triangulated. Every distinct
+ * position/texcoord/normal triple of the faces becomes one vertex. Corners
+ * without a normal get the area weighted average of the faces around their
+ * position. Groups, objects and materials are ignored: the file is one mesh.
+ */
+class PROJECT_API Obj
+{
+    // Members
+   private:
+    std::vector<Geometry::Vertex> vertices;
+    std::vector<glm::vec3>        normals;  // one per vertex
+    std::vector<uint32_t>         indices;
+
+    // Methods
+   public:
+    explicit Obj(const std::string &filename);
+
+    const std::vector<Geometry::Vertex> &getVertices() const;
+    const std::vector<glm::vec3>        &getNormals() const;
+    const std::vector<uint32_t>         &getIndices() const;
+
+    /**
+     * @brief The vertices quantized for rendering, with their normal.
+     */
+    std::vector<Geometry::CompactVertex> getCompactVertices() const;
+};
+
+}  // namespace Loaders
@@ -0,0 +1,570 @@
+#include "Allocator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <stdexcept>
+#include <utility>
+
+#include "profiling.hpp"
+
+namespace Memory {
+
+namespace {
+
+constexpr vk::DeviceSize SMALL_HEAP_SIZE = 1024ull * 1024 * 1024;
+
+constexpr vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+constexpr uint32_t buddyOrder(vk::DeviceSize size)
+{
+    return static_cast<uint32_t>(std::countr_zero(size / Allocator::MIN_BUDDY_SIZE));
+}
+
+}  // namespace
+
+// region ==== Allocation ====
+
+PROJECT_API Allocation::Allocation(std::nullptr_t)
+{
+}
+
+PROJECT_API Allocation::Allocation(Allocation &&other) noexcept :
+    allocator(std::exchange(other.allocator, nullptr)), block(std::exchange(other.block, nullptr)),
+    offset(std::exchange(other.offset, 0)), size(std::exchange(other.size, 0)),
+    mapped(std::exchange(other.mapped, nullptr))
+{
+}
+
+PROJECT_API Allocation &Allocation::operator=(Allocation &&other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        allocator = std::exchange(other.allocator, nullptr);
+        block     = std::exchange(other.block, nullptr);
+        offset    = std::exchange(other.offset, 0);
+        size      = std::exchange(other.size, 0);
+        mapped    = std::exchange(other.mapped, nullptr);
+    }
+    return *this;
+}
+
+PROJECT_API Allocation::~Allocation()
+{
+    reset();
+}
+
+PROJECT_API Allocation::operator bool() const
+{
+    return block != nullptr;
+}
+
+PROJECT_API vk::DeviceMemory Allocation::getMemory() const
+{
+    return *static_cast<Allocator::Block *>(block)->memory;
+}
+
+PROJECT_API vk::DeviceSize Allocation::getOffset() const
+{
+    return offset;
+}
+
+PROJECT_API vk::DeviceSize Allocation::getSize() const
+{
+    return size;
+}
+
+PROJECT_API uint32_t Allocation::getMemoryTypeIndex() const
+{
+    return static_cast<Allocator::Block *>(block)->memoryTypeIndex;
+}
+
+PROJECT_API void *Allocation::getMappedData() const
+{
+    return mapped;
+}
+
+PROJECT_API void Allocation::flush(vk::DeviceSize offset, vk::DeviceSize size) const
+{
+    allocator->flush(*this, offset, size);
+}
+
+PROJECT_API void Allocation::invalidate(vk::DeviceSize offset, vk::DeviceSize size) const
+{
+    allocator->invalidate(*this, offset, size);
+}
+
+PROJECT_API void Allocation::reset()
+{
+    if (allocator != nullptr && block != nullptr)
+    {
+        allocator->free(*this);
+    }
+    allocator = nullptr;
+    block     = nullptr;
+    offset    = 0;
+    size      = 0;
+    mapped    = nullptr;
+}
+
+// endregion
+
+// region ==== Allocator ====
+
+PROJECT_API Allocator::Allocator(const vk::raii::PhysicalDevice &physicalDevice,
+                                 const vk::raii::Device         &device,
+                                 bool                            bufferDeviceAddress,
+                                 vk::DeviceSize                  blockSize) :
+    device(device), memoryProperties(physicalDevice.getMemoryProperties()), blockSize(std::bit_floor(blockSize)),
+    bufferDeviceAddress(bufferDeviceAddress)
+{
+    ZoneScoped;
+    auto limits              = physicalDevice.getProperties().limits;
+    nonCoherentAtomSize      = std::max<vk::DeviceSize>(limits.nonCoherentAtomSize, 1);
+    maxMemoryAllocationCount = limits.maxMemoryAllocationCount;
+
+    plotNames.reserve(memoryProperties.memoryHeapCount * 3);
+    for (uint32_t heap = 0; heap < memoryProperties.memoryHeapCount; heap++)
+    {
+        plotNames.push_back(std::format("Heap {} used", heap));
+        plotNames.push_back(std::format("Heap {} committed", heap));
+        plotNames.push_back(std::format("Heap {} fragmentation %", heap));
+        TracyPlotConfig(plotNames[heap * 3].c_str(), tracy::PlotFormatType::Memory, false, true, 0);
+        TracyPlotConfig(plotNames[heap * 3 + 1].c_str(), tracy::PlotFormatType::Memory, false, true, 0);
+        TracyPlotConfig(plotNames[heap * 3 + 2].c_str(), tracy::PlotFormatType::Percentage, false, true, 0);
+    }
+}
+
+PROJECT_API const vk::PhysicalDeviceMemoryProperties &Allocator::getMemoryProperties() const
+{
+    return memoryProperties;
+}
+
+PROJECT_API uint32_t Allocator::findMemoryType(uint32_t                typeFilter,
+                                               vk::MemoryPropertyFlags required,
+                                               vk::MemoryPropertyFlags preferred) const
+{
+    // First pass honors the preferred flags, the second one only the required ones.
+    for (auto wanted : {required | preferred, required})
+    {
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+        {
+            if ((typeFilter & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & wanted) == wanted)
+                return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+PROJECT_API Allocation Allocator::allocate(const vk::raii::Buffer &buffer,
+                                           vk::MemoryPropertyFlags properties,
+                                           AllocationStrategy      strategy)
+{
+    return allocate(buffer, properties, {}, strategy);
+}
+
+PROJECT_API Allocation Allocator::allocate(const vk::raii::Buffer &buffer,
+                                           vk::MemoryPropertyFlags required,
+                                           vk::MemoryPropertyFlags preferred,
+                                           AllocationStrategy      strategy)
+{
+    auto requirementsChain = device.getBufferMemoryRequirements2<vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(
+        {.buffer = *buffer});
+    auto const &requirements = requirementsChain.get<vk::MemoryRequirements2>().memoryRequirements;
+    auto const &dedicated    = requirementsChain.get<vk::MemoryDedicatedRequirements>();
+
+    vk::MemoryDedicatedAllocateInfo dedicatedInfo{.buffer = *buffer};
+    if (dedicated.requiresDedicatedAllocation || dedicated.prefersDedicatedAllocation)
+    {
+        strategy = AllocationStrategy::eDedicated;
+    }
+
+    Allocation allocation =
+        allocate(requirements, required, preferred, ResourceKind::eLinear, strategy, &dedicatedInfo);
+    buffer.bindMemory(allocation.getMemory(), allocation.getOffset());
+    return allocation;
+}
+
+PROJECT_API Allocation Allocator::allocate(const vk::raii::Image  &image,
+                                           vk::ImageTiling         tiling,
+                                           vk::MemoryPropertyFlags properties,
+                                           AllocationStrategy      strategy)
+{
+    auto requirementsChain = device.getImageMemoryRequirements2<vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(
+        {.image = *image});
+    auto const &requirements = requirementsChain.get<vk::MemoryRequirements2>().memoryRequirements;
+    auto const &dedicated    = requirementsChain.get<vk::MemoryDedicatedRequirements>();
+
+    vk::MemoryDedicatedAllocateInfo dedicatedInfo{.image = *image};
+    if (dedicated.requiresDedicatedAllocation || dedicated.prefersDedicatedAllocation)
+    {
+        strategy = AllocationStrategy::eDedicated;
+    }
+
+    ResourceKind kind       = tiling == vk::ImageTiling::eOptimal ? ResourceKind::eOptimal : ResourceKind::eLinear;
+    Allocation   allocation = allocate(requirements, properties, kind, strategy, &dedicatedInfo);
+    image.bindMemory(allocation.getMemory(), allocation.getOffset());
+    return allocation;
+}
+
+PROJECT_API Allocation Allocator::allocate(const vk::MemoryRequirements          &requirements,
+                                           vk::MemoryPropertyFlags                properties,
+                                           ResourceKind                           kind,
+                                           AllocationStrategy                     strategy,
+                                           const vk::MemoryDedicatedAllocateInfo *dedicatedInfo)
+{
+    return allocate(requirements, properties, {}, kind, strategy, dedicatedInfo);
+}
+
+PROJECT_API Allocation Allocator::allocate(const vk::MemoryRequirements          &requirements,
+                                           vk::MemoryPropertyFlags                required,
+                                           vk::MemoryPropertyFlags                preferred,
+                                           ResourceKind                           kind,
+                                           AllocationStrategy                     strategy,
+                                           const vk::MemoryDedicatedAllocateInfo *dedicatedInfo)
+{
+    ZoneScoped;
+    uint32_t       memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, required, preferred);
+    vk::DeviceSize alignment       = requirements.alignment;
+    if (needsAtomAlignment(memoryTypeIndex))
+    {
+        alignment = std::max(alignment, nonCoherentAtomSize);
+    }
+
+    vk::DeviceSize typeBlockSize = getBlockSize(memoryTypeIndex);
+    if (strategy == AllocationStrategy::eDefault)
+    {
+        strategy = requirements.size > typeBlockSize / 2 ? AllocationStrategy::eDedicated : AllocationStrategy::eBuddy;
+    }
+    else if (strategy != AllocationStrategy::eDedicated && requirements.size > typeBlockSize)
+    {
+        strategy = AllocationStrategy::eDedicated;
+    }
+
+    std::scoped_lock lock(mutex);
+
+    Allocation allocation;
+    allocation.allocator = this;
+
+    if (strategy == AllocationStrategy::eDedicated)
+    {
+        // A dedicated allocation must be the exact resource size, flush()
+        // clamps its ranges to the block instead.
+        vk::DeviceSize size  = dedicatedInfo ? requirements.size : alignUp(requirements.size, alignment);
+        Block         *block = createBlock(memoryTypeIndex, size, strategy, kind, dedicatedInfo);
+        block->usedBytes        = size;
+        block->allocationCount  = 1;
+        allocation.block        = block;
+        allocation.size         = size;
+    }
+    else if (strategy == AllocationStrategy::eLinear)
+    {
+        for (auto &candidate : blocks)
+        {
+            if (candidate->strategy == strategy && candidate->memoryTypeIndex == memoryTypeIndex &&
+                candidate->kind == kind && linearAllocate(*candidate, requirements.size, alignment, allocation.offset))
+            {
+                allocation.block = candidate.get();
+                break;
+            }
+        }
+        if (allocation.block == nullptr)
+        {
+            Block *block = createBlock(memoryTypeIndex, typeBlockSize, strategy, kind, nullptr);
+            linearAllocate(*block, requirements.size, alignment, allocation.offset);
+            allocation.block = block;
+        }
+        allocation.size = requirements.size;
+    }
+    else
+    {
+        vk::DeviceSize size = std::bit_ceil(std::max({requirements.size, alignment, MIN_BUDDY_SIZE}));
+        for (auto &candidate : blocks)
+        {
+            if (candidate->strategy == strategy && candidate->memoryTypeIndex == memoryTypeIndex &&
+                candidate->kind == kind && buddyAllocate(*candidate, size, allocation.offset))
+            {
+                allocation.block = candidate.get();
+                break;
+            }
+        }
+        if (allocation.block == nullptr)
+        {
+            Block *block = createBlock(memoryTypeIndex, typeBlockSize, strategy, kind, nullptr);
+            buddyAllocate(*block, size, allocation.offset);
+            allocation.block = block;
+        }
+        allocation.size = size;
+    }
+
+    auto *block = static_cast<Block *>(allocation.block);
+    if (block->mapped != nullptr)
+    {
+        allocation.mapped = block->mapped + allocation.offset;
+    }
+    return allocation;
+}
+
+PROJECT_API std::vector<Allocator::HeapStats> Allocator::getHeapStats() const
+{
+    std::scoped_lock       lock(mutex);
+    std::vector<HeapStats> stats(memoryProperties.memoryHeapCount);
+
+    for (auto const &block : blocks)
+    {
+        HeapStats &heap = stats[memoryProperties.memoryTypes[block->memoryTypeIndex].heapIndex];
+        heap.blockBytes += block->size;
+        heap.usedBytes += block->usedBytes;
+        heap.allocationCount += block->allocationCount;
+        if (block->strategy == AllocationStrategy::eDedicated)
+        {
+            heap.dedicatedCount++;
+            continue;
+        }
+
+        heap.blockCount++;
+        vk::DeviceSize largest = 0;
+        if (block->strategy == AllocationStrategy::eLinear)
+        {
+            largest = block->size - block->head;
+        }
+        else
+        {
+            for (uint32_t order = static_cast<uint32_t>(block->freeLists.size()); order-- > 0;)
+            {
+                if (not block->freeLists[order].empty())
+                {
+                    largest = MIN_BUDDY_SIZE << order;
+                    break;
+                }
+            }
+        }
+        heap.largestFreeRange = std::max(heap.largestFreeRange, largest);
+    }
+
+    for (auto &heap : stats)
+    {
+        vk::DeviceSize freeBytes = heap.blockBytes - heap.usedBytes;
+        heap.fragmentation =
+            freeBytes > 0 ? 1.0f - static_cast<float>(heap.largestFreeRange) / static_cast<float>(freeBytes) : 0.0f;
+    }
+    return stats;
+}
+
+PROJECT_API void Allocator::publishStats() const
+{
+#if defined(TRACY_ENABLE)
+    auto stats = getHeapStats();
+    for (size_t heap = 0; heap < stats.size(); heap++)
+    {
+        TracyPlot(plotNames[heap * 3].c_str(), static_cast<int64_t>(stats[heap].usedBytes));
+        TracyPlot(plotNames[heap * 3 + 1].c_str(), static_cast<int64_t>(stats[heap].blockBytes));
+        TracyPlot(plotNames[heap * 3 + 2].c_str(), stats[heap].fragmentation * 100.0f);
+    }
+#endif
+}
+
+void Allocator::free(Allocation &allocation)
+{
+    std::scoped_lock lock(mutex);
+    auto            *block = static_cast<Block *>(allocation.block);
+
+    if (block->strategy == AllocationStrategy::eDedicated)
+    {
+        destroyBlock(block);
+        return;
+    }
+
+    if (block->strategy == AllocationStrategy::eBuddy)
+    {
+        buddyFree(*block, allocation.offset, allocation.size);
+    }
+    block->usedBytes -= allocation.size;
+    block->allocationCount--;
+
+    if (block->allocationCount > 0)
+    {
+        return;
+    }
+    // A linear block rewinds once it is empty.
+    block->head = 0;
+
+    // Keep one empty block per pool around to avoid allocation churn.
+    bool hasSpare = std::ranges::any_of(blocks, [block](auto const &other) {
+        return other.get() != block && other->strategy == block->strategy &&
+               other->memoryTypeIndex == block->memoryTypeIndex && other->kind == block->kind &&
+               other->allocationCount == 0;
+    });
+    if (hasSpare)
+    {
+        destroyBlock(block);
+    }
+}
+
+void Allocator::flush(const Allocation &allocation, vk::DeviceSize offset, vk::DeviceSize size) const
+{
+    if (needsAtomAlignment(static_cast<Block *>(allocation.block)->memoryTypeIndex))
+    {
+        device.flushMappedMemoryRanges(getAtomRange(allocation, offset, size));
+    }
+}
+
+void Allocator::invalidate(const Allocation &allocation, vk::DeviceSize offset, vk::DeviceSize size) const
+{
+    if (needsAtomAlignment(static_cast<Block *>(allocation.block)->memoryTypeIndex))
+    {
+        device.invalidateMappedMemoryRanges(getAtomRange(allocation, offset, size));
+    }
+}
+
+vk::MappedMemoryRange Allocator::getAtomRange(const Allocation &allocation,
+                                              vk::DeviceSize    offset,
+                                              vk::DeviceSize    size) const
+{
+    auto          *block = static_cast<Block *>(allocation.block);
+    vk::DeviceSize begin = allocation.offset + offset;
+    vk::DeviceSize end   = size == vk::WholeSize ? allocation.offset + allocation.size : begin + size;
+    begin                = begin & ~(nonCoherentAtomSize - 1);
+    end                  = std::min(alignUp(end, nonCoherentAtomSize), block->size);
+    return {.memory = *block->memory, .offset = begin, .size = end - begin};
+}
+
+vk::DeviceSize Allocator::getBlockSize(uint32_t memoryTypeIndex) const
+{
+    // Small heaps (BAR windows, some iGPUs) get smaller blocks so one block
+    // doesn't eat a large share of them.
+    vk::DeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+    return heapSize <= SMALL_HEAP_SIZE ? std::bit_floor(heapSize / 8) : blockSize;
+}
+
+bool Allocator::isHostVisible(uint32_t memoryTypeIndex) const
+{
+    return static_cast<bool>(memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags &
+                             vk::MemoryPropertyFlagBits::eHostVisible);
+}
+
+bool Allocator::needsAtomAlignment(uint32_t memoryTypeIndex) const
+{
+    auto flags = memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+    return (flags & vk::MemoryPropertyFlagBits::eHostVisible) && not(flags & vk::MemoryPropertyFlagBits::eHostCoherent);
+}
+
+Allocator::Block *Allocator::createBlock(uint32_t                               memoryTypeIndex,
+                                         vk::DeviceSize                         size,
+                                         AllocationStrategy                     strategy,
+                                         ResourceKind                           kind,
+                                         const vk::MemoryDedicatedAllocateInfo *dedicatedInfo)
+{
+    ZoneScoped;
+    if (maxMemoryAllocationCount != 0 && memoryAllocationCount >= maxMemoryAllocationCount)
+    {
+        throw std::runtime_error("maxMemoryAllocationCount reached!");
+    }
+
+    // Optimal images never share a block with buffers, their blocks skip the flag.
+    vk::MemoryAllocateFlagsInfo flagsInfo{
+        .pNext = strategy == AllocationStrategy::eDedicated ? dedicatedInfo : nullptr,
+        .flags = vk::MemoryAllocateFlagBits::eDeviceAddress};
+    bool                   deviceAddress = bufferDeviceAddress && kind == ResourceKind::eLinear;
+    vk::MemoryAllocateInfo allocInfo{
+        .pNext           = deviceAddress ? &flagsInfo : flagsInfo.pNext,
+        .allocationSize  = size,
+        .memoryTypeIndex = memoryTypeIndex};
+
+    auto block             = std::make_unique<Block>();
+    block->memory          = vk::raii::DeviceMemory(device, allocInfo);
+    block->size            = size;
+    block->memoryTypeIndex = memoryTypeIndex;
+    block->strategy        = strategy;
+    block->kind            = kind;
+    if (isHostVisible(memoryTypeIndex))
+    {
+        block->mapped = static_cast<std::byte *>(block->memory.mapMemory(0, vk::WholeSize));
+    }
+    if (strategy == AllocationStrategy::eBuddy)
+    {
+        block->freeLists.resize(buddyOrder(size) + 1);
+        block->freeLists.back().insert(0);
+    }
+    memoryAllocationCount++;
+
+    blocks.push_back(std::move(block));
+    return blocks.back().get();
+}
+
+void Allocator::destroyBlock(Block *block)
+{
+    std::erase_if(blocks, [block](auto const &candidate) { return candidate.get() == block; });
+    memoryAllocationCount--;
+}
+
+bool Allocator::buddyAllocate(Block &block, vk::DeviceSize size, vk::DeviceSize &offset)
+{
+    uint32_t order = buddyOrder(size);
+    uint32_t found = order;
+    while (found < block.freeLists.size() && block.freeLists[found].empty())
+    {
+        found++;
+    }
+    if (found >= block.freeLists.size())
+    {
+        return false;
+    }
+
+    auto nodeIt = block.freeLists[found].begin();
+    offset      = *nodeIt;
+    block.freeLists[found].erase(nodeIt);
+
+    // Split the node down to the requested order, freeing the upper halves.
+    while (found > order)
+    {
+        found--;
+        block.freeLists[found].insert(offset + (MIN_BUDDY_SIZE << found));
+    }
+
+    block.usedBytes += size;
+    block.allocationCount++;
+    return true;
+}
+
+void Allocator::buddyFree(Block &block, vk::DeviceSize offset, vk::DeviceSize size)
+{
+    uint32_t order = buddyOrder(size);
+    while (order + 1 < block.freeLists.size())
+    {
+        vk::DeviceSize buddy   = offset ^ (MIN_BUDDY_SIZE << order);
+        auto           buddyIt = block.freeLists[order].find(buddy);
+        if (buddyIt == block.freeLists[order].end())
+        {
+            break;
+        }
+        block.freeLists[order].erase(buddyIt);
+        offset = std::min(offset, buddy);
+        order++;
+    }
+    block.freeLists[order].insert(offset);
+}
+
+bool Allocator::linearAllocate(Block &block, vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize &offset)
+{
+    vk::DeviceSize aligned = alignUp(block.head, alignment);
+    if (aligned + size > block.size)
+    {
+        return false;
+    }
+
+    offset     = aligned;
+    block.head = aligned + size;
+    block.usedBytes += size;
+    block.allocationCount++;
+    return true;
+}
+
+// endregion
+
+}  // namespace Memory
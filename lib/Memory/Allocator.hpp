@@ -0,0 +1,243 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#include "config.hpp"
+
+namespace Memory {
+
+class Allocator;
+
+/**
+ * @brief Allocation path used to place a resource in device memory.
+ *
+ * - eDefault: buddy sub-allocation, promoted to dedicated for large resources
+ *   or when the driver asks for it.
+ * - eLinear: bump allocation, the block rewinds once all its ranges are freed.
+ *   Meant for short-lived data (staging, per-frame transients).
+ * - eBuddy: power-of-two sub-allocation with coalescing on free.
+ * - eDedicated: one vk::DeviceMemory per resource.
+ */
+enum class AllocationStrategy : uint8_t
+{
+    eDefault,
+    eLinear,
+    eBuddy,
+    eDedicated,
+};
+
+/**
+ * @brief Buffers and linear images must not share a page with optimal images
+ * (bufferImageGranularity), so they are placed in separate blocks.
+ */
+enum class ResourceKind : uint8_t
+{
+    eLinear,
+    eOptimal,
+};
+
+/**
+ * @class Allocation
+ * @brief Move-only handle on a range of device memory, returned to its
+ * Allocator on destruction.
+ */
+class PROJECT_API Allocation
+{
+    friend class Allocator;
+
+    // Members
+   private:
+    Allocator     *allocator = nullptr;
+    void          *block     = nullptr;
+    vk::DeviceSize offset    = 0;
+    vk::DeviceSize size      = 0;
+    void          *mapped    = nullptr;
+
+    // Methods
+   public:
+    Allocation() = default;
+    Allocation(std::nullptr_t);
+    Allocation(const Allocation &)            = delete;
+    Allocation &operator=(const Allocation &) = delete;
+    Allocation(Allocation &&other) noexcept;
+    Allocation &operator=(Allocation &&other) noexcept;
+    ~Allocation();
+
+    explicit operator bool() const;
+
+    vk::DeviceMemory getMemory() const;
+    vk::DeviceSize   getOffset() const;
+    vk::DeviceSize   getSize() const;
+    uint32_t         getMemoryTypeIndex() const;
+    void            *getMappedData() const;
+
+    /**
+     * @brief Make host writes visible to the device. No-op on coherent memory.
+     */
+    void flush(vk::DeviceSize offset = 0, vk::DeviceSize size = vk::WholeSize) const;
+    /**
+     * @brief Make device writes, made available to the host, visible to it.
+     * No-op on coherent memory.
+     */
+    void invalidate(vk::DeviceSize offset = 0, vk::DeviceSize size = vk::WholeSize) const;
+    void reset();
+};
+
+/**
+ * @class Allocator
+ * @brief Sub-allocates device memory from large per memory type blocks.
+ *
+ * Memory properties and limits are queried once at construction. Host visible
+ * blocks are persistently mapped, so allocations expose their pointer directly.
+ * The allocator must outlive every Allocation it hands out.
+ */
+class PROJECT_API Allocator
+{
+   public:
+    static constexpr vk::DeviceSize DEFAULT_BLOCK_SIZE = 256ull * 1024 * 1024;
+    static constexpr vk::DeviceSize MIN_BUDDY_SIZE     = 256;
+
+    struct HeapStats
+    {
+        vk::DeviceSize blockBytes       = 0;  // memory allocated from the driver
+        vk::DeviceSize usedBytes        = 0;  // memory handed out to resources
+        vk::DeviceSize largestFreeRange = 0;  // biggest range a new allocation can get
+        uint32_t       blockCount       = 0;
+        uint32_t       allocationCount  = 0;
+        uint32_t       dedicatedCount   = 0;
+        float          fragmentation    = 0.0f;  // 1 - largestFreeRange / free bytes
+    };
+
+    // Members
+   private:
+    struct Block
+    {
+        vk::raii::DeviceMemory memory          = nullptr;
+        std::byte             *mapped          = nullptr;
+        vk::DeviceSize         size            = 0;
+        uint32_t               memoryTypeIndex = 0;
+        AllocationStrategy     strategy        = AllocationStrategy::eBuddy;
+        ResourceKind           kind            = ResourceKind::eLinear;
+        vk::DeviceSize         usedBytes       = 0;
+        uint32_t               allocationCount = 0;
+        // eLinear
+        vk::DeviceSize head = 0;
+        // eBuddy: free offsets by order, a node of order n is MIN_BUDDY_SIZE << n bytes
+        std::vector<std::set<vk::DeviceSize>> freeLists;
+    };
+
+    const vk::raii::Device            &device;
+    vk::PhysicalDeviceMemoryProperties memoryProperties;
+    vk::DeviceSize                     nonCoherentAtomSize      = 1;
+    uint32_t                           maxMemoryAllocationCount = 0;
+    uint32_t                           memoryAllocationCount    = 0;
+    vk::DeviceSize                     blockSize;
+    bool                               bufferDeviceAddress      = false;
+
+    mutable std::mutex                  mutex;
+    std::vector<std::unique_ptr<Block>> blocks;
+    std::vector<std::string>            plotNames;  // Tracy keeps the name pointers
+
+    // Methods
+   public:
+    /**
+     * @param bufferDeviceAddress the bufferDeviceAddress feature is enabled,
+     * buffer memory is allocated with vk::MemoryAllocateFlagBits::eDeviceAddress
+     * so any buffer can be created with eShaderDeviceAddress.
+     */
+    Allocator(const vk::raii::PhysicalDevice &physicalDevice,
+              const vk::raii::Device         &device,
+              bool                            bufferDeviceAddress = false,
+              vk::DeviceSize                  blockSize           = DEFAULT_BLOCK_SIZE);
+    Allocator(const Allocator &)            = delete;
+    Allocator &operator=(const Allocator &) = delete;
+
+    const vk::PhysicalDeviceMemoryProperties &getMemoryProperties() const;
+
+    uint32_t findMemoryType(uint32_t                typeFilter,
+                            vk::MemoryPropertyFlags required,
+                            vk::MemoryPropertyFlags preferred = {}) const;
+
+    /**
+     * @brief Allocate memory for the buffer and bind it.
+     */
+    Allocation allocate(const vk::raii::Buffer &buffer,
+                        vk::MemoryPropertyFlags properties,
+                        AllocationStrategy      strategy = AllocationStrategy::eDefault);
+
+    /**
+     * @brief Allocate memory for the buffer and bind it, from a memory type
+     * with the preferred flags too when there is one.
+     */
+    Allocation allocate(const vk::raii::Buffer &buffer,
+                        vk::MemoryPropertyFlags required,
+                        vk::MemoryPropertyFlags preferred,
+                        AllocationStrategy      strategy = AllocationStrategy::eDefault);
+
+    /**
+     * @brief Allocate memory for the image and bind it.
+     */
+    Allocation allocate(const vk::raii::Image  &image,
+                        vk::ImageTiling         tiling,
+                        vk::MemoryPropertyFlags properties,
+                        AllocationStrategy      strategy = AllocationStrategy::eDefault);
+
+    Allocation allocate(const vk::MemoryRequirements &requirements,
+                        vk::MemoryPropertyFlags       properties,
+                        ResourceKind                  kind,
+                        AllocationStrategy            strategy,
+                        const vk::MemoryDedicatedAllocateInfo *dedicatedInfo = nullptr);
+    Allocation allocate(const vk::MemoryRequirements &requirements,
+                        vk::MemoryPropertyFlags       required,
+                        vk::MemoryPropertyFlags       preferred,
+                        ResourceKind                  kind,
+                        AllocationStrategy            strategy,
+                        const vk::MemoryDedicatedAllocateInfo *dedicatedInfo = nullptr);
+
+    std::vector<HeapStats> getHeapStats() const;
+
+    /**
+     * @brief Push per heap usage and fragmentation to Tracy plots.
+     */
+    void publishStats() const;
+
+   private:
+    friend class Allocation;
+
+    void free(Allocation &allocation);
+    void flush(const Allocation &allocation, vk::DeviceSize offset, vk::DeviceSize size) const;
+    void invalidate(const Allocation &allocation, vk::DeviceSize offset, vk::DeviceSize size) const;
+    // The range of the allocation rounded out to nonCoherentAtomSize, within its block.
+    vk::MappedMemoryRange getAtomRange(const Allocation &allocation,
+                                       vk::DeviceSize    offset,
+                                       vk::DeviceSize    size) const;
+
+    vk::DeviceSize getBlockSize(uint32_t memoryTypeIndex) const;
+    bool           isHostVisible(uint32_t memoryTypeIndex) const;
+    bool           needsAtomAlignment(uint32_t memoryTypeIndex) const;
+
+    Block *createBlock(uint32_t           memoryTypeIndex,
+                       vk::DeviceSize     size,
+                       AllocationStrategy strategy,
+                       ResourceKind       kind,
+                       const vk::MemoryDedicatedAllocateInfo *dedicatedInfo);
+    void   destroyBlock(Block *block);
+
+    static bool buddyAllocate(Block &block, vk::DeviceSize size, vk::DeviceSize &offset);
+    static void buddyFree(Block &block, vk::DeviceSize offset, vk::DeviceSize size);
+    static bool linearAllocate(Block &block, vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize &offset);
+};
+
+}  // namespace Memory
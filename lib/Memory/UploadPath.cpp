@@ -0,0 +1,93 @@
+#include "UploadPath.hpp"
+
+#include <algorithm>
+
+namespace Memory {
+
+PROJECT_API UploadCapabilities UploadCapabilities::detect(const vk::raii::PhysicalDevice &physicalDevice)
+{
+    UploadCapabilities capabilities;
+
+    auto properties       = physicalDevice.getProperties();
+    auto memoryProperties = physicalDevice.getMemoryProperties();
+    bool isUma            = properties.deviceType == vk::PhysicalDeviceType::eIntegratedGpu;
+
+    // Coherent too, the direct writers don't flush (see getHostWriteFlags()).
+    constexpr vk::MemoryPropertyFlags directFlags = vk::MemoryPropertyFlagBits::eDeviceLocal |
+                                                    vk::MemoryPropertyFlagBits::eHostVisible |
+                                                    vk::MemoryPropertyFlagBits::eHostCoherent;
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+    {
+        auto const &memoryType = memoryProperties.memoryTypes[i];
+        if ((memoryType.propertyFlags & directFlags) != directFlags)
+        {
+            continue;
+        }
+        vk::DeviceSize heapSize = memoryProperties.memoryHeaps[memoryType.heapIndex].size;
+        if ((isUma || heapSize > MIN_DIRECT_HEAP_SIZE) && heapSize > capabilities.heapSize)
+        {
+            capabilities.path      = UploadPath::eDirect;
+            capabilities.heapSize  = heapSize;
+            capabilities.heapIndex = memoryType.heapIndex;
+        }
+    }
+
+    if (properties.apiVersion >= vk::ApiVersion14)
+    {
+        auto features = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan14Features>();
+        capabilities.hostImageCopy = features.get<vk::PhysicalDeviceVulkan14Features>().hostImageCopy;
+    }
+    if (capabilities.hostImageCopy)
+    {
+        // The first query gives the layout count, the second one fills them.
+        vk::PhysicalDeviceVulkan14Properties properties14;
+        vk::PhysicalDeviceProperties2        properties2{.pNext = &properties14};
+        auto                                 query = [&]() {
+            physicalDevice.getDispatcher()->vkGetPhysicalDeviceProperties2(
+                static_cast<VkPhysicalDevice>(*physicalDevice),
+                reinterpret_cast<VkPhysicalDeviceProperties2 *>(&properties2));
+        };
+        query();
+        capabilities.hostCopyDstLayouts.resize(properties14.copyDstLayoutCount);
+        properties14.pCopyDstLayouts = capabilities.hostCopyDstLayouts.data();
+        query();
+    }
+
+    return capabilities;
+}
+
+PROJECT_API vk::MemoryPropertyFlags UploadCapabilities::getHostWriteFlags() const
+{
+    vk::MemoryPropertyFlags flags =
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+    if (path == UploadPath::eDirect)
+    {
+        flags |= vk::MemoryPropertyFlagBits::eDeviceLocal;
+    }
+    return flags;
+}
+
+PROJECT_API bool UploadCapabilities::canWriteDirectly(const Allocator &allocator, vk::DeviceSize size) const
+{
+    if (path != UploadPath::eDirect)
+    {
+        return false;
+    }
+    vk::DeviceSize used = allocator.getHeapStats()[heapIndex].blockBytes;
+    return used + size <= heapSize / DIRECT_HEAP_SHARE;
+}
+
+PROJECT_API bool UploadCapabilities::supportsHostCopy(const vk::raii::PhysicalDevice &physicalDevice,
+                                                      vk::Format                      format,
+                                                      vk::ImageLayout                 layout) const
+{
+    if (not hostImageCopy || std::ranges::find(hostCopyDstLayouts, layout) == hostCopyDstLayouts.end())
+    {
+        return false;
+    }
+    auto properties = physicalDevice.getFormatProperties2<vk::FormatProperties2, vk::FormatProperties3>(format);
+    return static_cast<bool>(properties.get<vk::FormatProperties3>().optimalTilingFeatures &
+                             vk::FormatFeatureFlagBits2::eHostImageTransfer);
+}
+
+}  // namespace Memory
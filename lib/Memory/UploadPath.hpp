@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
+#    include <vulkan/vulkan_raii.hpp>
+#else
+import vulkan_hpp;
+#endif
+
+#include "Allocator.hpp"
+#include "config.hpp"
+
+namespace Memory {
+
+/**
+ * @brief How resource contents reach device local memory.
+ *
+ * - eStaging: write a HOST_VISIBLE buffer then copy it on the GPU.
+ * - eDirect: the CPU writes device local memory itself, either through a
+ *   DEVICE_LOCAL | HOST_VISIBLE | HOST_COHERENT mapping (Resizable BAR /
+ *   SAM / UMA) or with a host image copy for optimal images.
+ */
+enum class UploadPath : uint8_t
+{
+    eStaging,
+    eDirect,
+};
+
+struct PROJECT_API UploadCapabilities
+{
+    // The legacy BAR window is 256 MiB, anything bigger means the whole VRAM
+    // (or a useful part of it) is mappable.
+    static constexpr vk::DeviceSize MIN_DIRECT_HEAP_SIZE = 256ull * 1024 * 1024;
+    // Buffers stop being written directly once that share of the heap is in
+    // use, the rest is left to the textures and the other device allocations.
+    static constexpr vk::DeviceSize DIRECT_HEAP_SHARE = 4;  // a quarter
+
+    UploadPath                   path          = UploadPath::eStaging;
+    vk::DeviceSize               heapSize      = 0;  // size of the heap backing the direct path
+    uint32_t                     heapIndex     = 0;
+    bool                         hostImageCopy = false;
+    std::vector<vk::ImageLayout> hostCopyDstLayouts;  // layouts host copies may write
+
+    static UploadCapabilities detect(const vk::raii::PhysicalDevice &physicalDevice);
+
+    /**
+     * @brief Memory for data the CPU writes and the GPU reads once, e.g. per
+     * frame buffers: device local on the direct path, system memory otherwise.
+     */
+    vk::MemoryPropertyFlags getHostWriteFlags() const;
+
+    /**
+     * @brief Whether a resource of that size is written directly: on the
+     * direct path, while the allocator keeps its share of the heap.
+     */
+    bool canWriteDirectly(const Allocator &allocator, vk::DeviceSize size) const;
+
+    /**
+     * @brief Whether the CPU can copy texels into an optimal image of that
+     * format, left in layout.
+     */
+    bool supportsHostCopy(const vk::raii::PhysicalDevice &physicalDevice,
+                          vk::Format                      format,
+                          vk::ImageLayout                 layout) const;
+};
+
+}  // namespace Memory
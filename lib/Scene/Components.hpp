@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "World.hpp"
+
+namespace Scene {
+
+/**
+ * @brief Transform relative to the Parent, or to the world for a root.
+ */
+struct LocalTransform
+{
+    glm::vec3 position{0.0f};
+    float     scale = 1.0f;
+    glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+};
+
+/**
+ * @brief Model matrix, written by updateTransforms().
+ */
+struct WorldTransform
+{
+    glm::mat4 matrix{1.0f};
+};
+
+/**
+ * @brief Makes the entity a child, see childOf().
+ */
+struct Parent
+{
+    Entity   entity;
+    uint32_t depth = 1;  // ancestor count
+};
+
+/**
+ * @brief Geometry drawn by the GPU culler, packed by packInstances().
+ */
+struct MeshInstance
+{
+    std::array<float, 4> boundingSphere{};  // xyz center, w radius, in model space
+    uint32_t             indexCount   = 0;
+    uint32_t             firstIndex   = 0;
+    int32_t              vertexOffset = 0;
+};
+
+/**
+ * @brief Rotation of the LocalTransform driven by updateSpin().
+ */
+struct Spin
+{
+    glm::vec3 axis{0.0f, 0.0f, 1.0f};
+    float     radiansPerSecond = 0.0f;
+};
+
+}  // namespace Scene
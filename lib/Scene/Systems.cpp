@@ -0,0 +1,137 @@
+// The aligned glm types below take the SSE / NEON code paths, only in this
+// file: the packed types shared with other libraries are unchanged.
+#define GLM_FORCE_INTRINSICS
+
+#include "Systems.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <glm/gtc/type_aligned.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "profiling.hpp"
+
+namespace Scene {
+
+namespace {
+
+glm::aligned_mat4 toMatrix(const LocalTransform &local)
+{
+    glm::aligned_mat4 matrix = glm::aligned_mat4(glm::mat4_cast(local.rotation)) * local.scale;
+    matrix[3]                = glm::aligned_vec4(local.position, 1.0f);
+    return matrix;
+}
+
+}  // namespace
+
+PROJECT_API Parent childOf(World &world, Entity parent)
+{
+    const Parent *grandParent = world.get<Parent>(parent);
+    return {.entity = parent, .depth = grandParent ? grandParent->depth + 1 : 1};
+}
+
+PROJECT_API void updateSpin(World &world, Jobs::JobSystem &jobSystem, float time)
+{
+    ZoneScoped;
+    world.parallelForEach<const Spin, LocalTransform>(
+        jobSystem,
+        [time](uint32_t, std::span<const Entity>, std::span<const Spin> spins, std::span<LocalTransform> locals) {
+            for (size_t i = 0; i < spins.size(); i++)
+            {
+                locals[i].rotation = glm::angleAxis(spins[i].radiansPerSecond * time, glm::normalize(spins[i].axis));
+            }
+        },
+        0,
+        "Spin");
+}
+
+PROJECT_API void updateTransforms(World &world, Jobs::JobSystem &jobSystem)
+{
+    ZoneScoped;
+    world.parallelForEach<const LocalTransform, WorldTransform>(
+        jobSystem,
+        [](uint32_t,
+           std::span<const Entity>,
+           std::span<const LocalTransform> locals,
+           std::span<WorldTransform>       worlds) {
+            for (size_t i = 0; i < locals.size(); i++)
+            {
+                worlds[i].matrix = glm::mat4(toMatrix(locals[i]));
+            }
+        },
+        world.getMask<Parent>(),
+        "Root transforms");
+
+    uint32_t maxDepth = 0;
+    world.forEach<const Parent>([&](uint32_t, std::span<const Entity>, std::span<const Parent> parents) {
+        for (const Parent &parent : parents)
+        {
+            maxDepth = std::max(maxDepth, parent.depth);
+        }
+    });
+
+    // Parents are one depth up, written by the previous pass.
+    const ComponentId worldId = world.getComponentId<WorldTransform>();
+    for (uint32_t depth = 1; depth <= maxDepth; depth++)
+    {
+        world.parallelForEach<const LocalTransform, const Parent, WorldTransform>(
+            jobSystem,
+            [&](uint32_t,
+                std::span<const Entity>,
+                std::span<const LocalTransform> locals,
+                std::span<const Parent>         parents,
+                std::span<WorldTransform>       worlds) {
+                for (size_t i = 0; i < locals.size(); i++)
+                {
+                    if (parents[i].depth != depth)
+                    {
+                        continue;
+                    }
+                    const WorldTransform *parent = world.get<WorldTransform>(parents[i].entity, worldId);
+                    glm::aligned_mat4     matrix = toMatrix(locals[i]);
+                    if (parent)
+                    {
+                        matrix = glm::aligned_mat4(parent->matrix) * matrix;
+                    }
+                    worlds[i].matrix = glm::mat4(matrix);
+                }
+            },
+            0,
+            "Child transforms");
+    }
+}
+
+PROJECT_API uint32_t packInstances(World                            &world,
+                                   Jobs::JobSystem                  &jobSystem,
+                                   std::span<Graphics::GpuInstance> instances)
+{
+    ZoneScoped;
+    const auto capacity = static_cast<uint32_t>(instances.size());
+    world.parallelForEach<const WorldTransform, const MeshInstance>(
+        jobSystem,
+        [&](uint32_t                        first,
+            std::span<const Entity>,
+            std::span<const WorldTransform> worlds,
+            std::span<const MeshInstance>   meshes) {
+            const uint32_t count = first < capacity ? std::min(static_cast<uint32_t>(worlds.size()), capacity - first)
+                                                    : 0;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                // Built whole then stored once, the destination may be write-combined.
+                Graphics::GpuInstance instance{.model          = {},
+                                               .boundingSphere = meshes[i].boundingSphere,
+                                               .indexCount     = meshes[i].indexCount,
+                                               .firstIndex     = meshes[i].firstIndex,
+                                               .vertexOffset   = meshes[i].vertexOffset,
+                                               .padding        = 0};
+                std::memcpy(instance.model.data(), glm::value_ptr(worlds[i].matrix), sizeof(instance.model));
+                instances[first + i] = instance;
+            }
+        },
+        0,
+        "Pack instances");
+    return std::min(world.count<WorldTransform, MeshInstance>(), capacity);
+}
+
+}  // namespace Scene
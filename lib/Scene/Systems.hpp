@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include "Components.hpp"
+#include "Graphics/GpuCuller.hpp"
+#include "Jobs/JobSystem.hpp"
+#include "World.hpp"
+#include "config.hpp"
+
+namespace Scene {
+
+/**
+ * @brief Parent component of a new child of parent, one level below it.
+ */
+PROJECT_API Parent childOf(World &world, Entity parent);
+
+/**
+ * @brief Set the rotation of every spinning entity for the time, in seconds.
+ */
+PROJECT_API void updateSpin(World &world, Jobs::JobSystem &jobSystem, float time);
+
+/**
+ * @brief Compose the LocalTransform of every entity with the WorldTransform of
+ * its parent: the roots first, then one depth of the hierarchy after the
+ * other, each spread over the job system. A parent destroyed before its
+ * children leaves them at their local transform.
+ */
+PROJECT_API void updateTransforms(World &world, Jobs::JobSystem &jobSystem);
+
+/**
+ * @brief Write the entities with a WorldTransform and a MeshInstance to
+ * instances, e.g. mapped memory the GPU culler reads, whole instances in
+ * order.
+ * @return the number of instances written, up to instances.size().
+ */
+PROJECT_API uint32_t packInstances(World                            &world,
+                                   Jobs::JobSystem                  &jobSystem,
+                                   std::span<Graphics::GpuInstance> instances);
+
+}  // namespace Scene
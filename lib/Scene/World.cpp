@@ -0,0 +1,214 @@
+#include "World.hpp"
+
+#include <bit>
+#include <stdexcept>
+
+namespace Scene {
+
+namespace {
+
+size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+PROJECT_API void World::destroy(Entity entity)
+{
+    if (not isAlive(entity))
+    {
+        return;
+    }
+    const Location location  = locations[entity.index];
+    Archetype     &archetype = archetypes[location.archetype];
+    Chunk         &chunk     = archetype.chunks[location.chunk];
+    Chunk         &last      = archetype.chunks.back();
+    const uint32_t lastRow   = last.count - 1;
+
+    if (&chunk != &last || location.row != lastRow)
+    {
+        // Keep the chunks dense: the last entity of the archetype takes the row.
+        auto        *entities = reinterpret_cast<Entity *>(chunk.storage.get());
+        const Entity moved    = reinterpret_cast<const Entity *>(last.storage.get())[lastRow];
+        entities[location.row] = moved;
+        for (ComponentId id : archetype.components)
+        {
+            const size_t size = components[id].size;
+            std::memcpy(chunk.storage.get() + archetype.offsets[id] + location.row * size,
+                        last.storage.get() + archetype.offsets[id] + lastRow * size,
+                        size);
+        }
+        locations[moved.index].chunk = location.chunk;
+        locations[moved.index].row   = location.row;
+    }
+    if (--last.count == 0)
+    {
+        archetype.chunks.pop_back();
+    }
+
+    Location &freed = locations[entity.index];
+    freed.archetype = UINT32_MAX;
+    freed.generation++;
+    freeIndices.push_back(entity.index);
+    entityCount--;
+}
+
+PROJECT_API bool World::isAlive(Entity entity) const
+{
+    return entity.index < locations.size() && locations[entity.index].archetype != UINT32_MAX &&
+           locations[entity.index].generation == entity.generation;
+}
+
+PROJECT_API uint32_t World::getEntityCount() const
+{
+    return entityCount;
+}
+
+PROJECT_API ComponentId World::registerComponent(std::type_index type, size_t size, size_t alignment)
+{
+    if (auto it = componentIds.find(type); it != componentIds.end())
+    {
+        return it->second;
+    }
+    if (components.size() == MAX_COMPONENTS)
+    {
+        throw std::runtime_error("too many component types!");
+    }
+    const auto id = static_cast<ComponentId>(components.size());
+    components.push_back({.size = static_cast<uint32_t>(size), .alignment = static_cast<uint32_t>(alignment)});
+    componentIds.emplace(type, id);
+    return id;
+}
+
+uint32_t World::getArchetype(ComponentMask mask)
+{
+    if (auto it = archetypeIndices.find(mask); it != archetypeIndices.end())
+    {
+        return it->second;
+    }
+
+    Archetype archetype{.mask = mask, .capacity = 0, .offsets = {}, .components = {}, .chunks = {}};
+    archetype.offsets.fill(UINT32_MAX);
+    size_t rowSize = sizeof(Entity);
+    for (ComponentMask bits = mask; bits != 0; bits &= bits - 1)
+    {
+        const auto id = static_cast<ComponentId>(std::countr_zero(bits));
+        archetype.components.push_back(id);
+        rowSize += components[id].size;
+    }
+
+    // As many rows as fit once every array is aligned.
+    const auto layout = [&](uint32_t capacity) {
+        size_t offset = sizeof(Entity) * capacity;
+        for (ComponentId id : archetype.components)
+        {
+            offset                = alignUp(offset, COLUMN_ALIGNMENT);
+            archetype.offsets[id] = static_cast<uint32_t>(offset);
+            offset += components[id].size * capacity;
+        }
+        return offset;
+    };
+    uint32_t capacity = static_cast<uint32_t>(CHUNK_SIZE / rowSize);
+    while (capacity > 0 && layout(capacity) > CHUNK_SIZE)
+    {
+        capacity--;
+    }
+    if (capacity == 0)
+    {
+        throw std::runtime_error("components too big for a chunk!");
+    }
+    archetype.capacity = capacity;
+
+    const auto index = static_cast<uint32_t>(archetypes.size());
+    archetypes.push_back(std::move(archetype));
+    archetypeIndices.emplace(mask, index);
+    return index;
+}
+
+PROJECT_API Entity World::allocate(ComponentMask mask)
+{
+    const uint32_t archetypeIndex = getArchetype(mask);
+    Archetype     &archetype      = archetypes[archetypeIndex];
+    if (archetype.chunks.empty() || archetype.chunks.back().count == archetype.capacity)
+    {
+        auto *storage = static_cast<std::byte *>(::operator new[](CHUNK_SIZE, std::align_val_t{COLUMN_ALIGNMENT}));
+        archetype.chunks.push_back({.storage = std::unique_ptr<std::byte[], ChunkDeleter>(storage), .count = 0});
+    }
+    Chunk &chunk = archetype.chunks.back();
+
+    uint32_t index;
+    if (not freeIndices.empty())
+    {
+        index = freeIndices.back();
+        freeIndices.pop_back();
+    }
+    else
+    {
+        index = static_cast<uint32_t>(locations.size());
+        locations.emplace_back();
+    }
+    Location &location = locations[index];
+    location.archetype = archetypeIndex;
+    location.chunk     = static_cast<uint32_t>(archetype.chunks.size() - 1);
+    location.row       = chunk.count;
+
+    const Entity entity{.index = index, .generation = location.generation};
+    reinterpret_cast<Entity *>(chunk.storage.get())[chunk.count++] = entity;
+    entityCount++;
+    return entity;
+}
+
+PROJECT_API void *World::getComponent(Entity entity, ComponentId id) const
+{
+    if (not isAlive(entity) || id >= MAX_COMPONENTS)
+    {
+        return nullptr;
+    }
+    const Location  &location  = locations[entity.index];
+    const Archetype &archetype = archetypes[location.archetype];
+    if (archetype.offsets[id] == UINT32_MAX)
+    {
+        return nullptr;
+    }
+    return archetype.chunks[location.chunk].storage.get() + archetype.offsets[id] +
+           static_cast<size_t>(location.row) * components[id].size;
+}
+
+PROJECT_API std::vector<World::ChunkView> World::getChunks(ComponentMask required, ComponentMask excluded)
+{
+    std::vector<ChunkView> views;
+    uint32_t               first = 0;
+    for (Archetype &archetype : archetypes)
+    {
+        if ((archetype.mask & required) != required || (archetype.mask & excluded) != 0)
+        {
+            continue;
+        }
+        for (Chunk &chunk : archetype.chunks)
+        {
+            views.push_back({.archetype = &archetype, .chunk = &chunk, .first = first});
+            first += chunk.count;
+        }
+    }
+    return views;
+}
+
+PROJECT_API uint32_t World::countMatching(ComponentMask required, ComponentMask excluded) const
+{
+    uint32_t count = 0;
+    for (const Archetype &archetype : archetypes)
+    {
+        if ((archetype.mask & required) != required || (archetype.mask & excluded) != 0)
+        {
+            continue;
+        }
+        for (const Chunk &chunk : archetype.chunks)
+        {
+            count += chunk.count;
+        }
+    }
+    return count;
+}
+
+}  // namespace Scene
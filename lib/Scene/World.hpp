@@ -0,0 +1,253 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Jobs/JobSystem.hpp"
+#include "config.hpp"
+
+namespace Scene {
+
+/**
+ * @brief Handle on an entity of a World, stale once the entity is destroyed.
+ */
+struct Entity
+{
+    uint32_t index      = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool operator==(const Entity &) const = default;
+};
+
+using ComponentId   = uint32_t;
+using ComponentMask = uint64_t;  // bit per ComponentId
+
+/**
+ * @class World
+ * @brief Entity component system storing the components by archetype, as
+ * structures of arrays.
+ *
+ * The entities with the same component set share an archetype, which stores
+ * them in CHUNK_SIZE chunks: the entity handles, then one array per component.
+ * A system only streams the arrays it reads, whatever else the entities carry.
+ * Chunks stay dense, destroying an entity moves the last one of its archetype
+ * into its row.
+ *
+ * Components are plain data (trivially copyable), copied with memcpy. Their id
+ * is given on first use, per world, at most MAX_COMPONENTS types. The
+ * component set of an entity is the one it was created with.
+ *
+ * forEach() and parallelForEach() call the function with the spans of each
+ * matching chunk, parallelForEach() spreads the chunks over the job system.
+ * While iterating, entities may not be created or destroyed, and get() may
+ * only read components no chunk function writes.
+ */
+class PROJECT_API World
+{
+   public:
+    static constexpr size_t   CHUNK_SIZE       = 16 * 1024;
+    static constexpr size_t   COLUMN_ALIGNMENT = 64;  // cache line, also the chunk alignment
+    static constexpr uint32_t MAX_COMPONENTS   = 64;
+
+    // Members
+   private:
+    struct ComponentInfo
+    {
+        uint32_t size;
+        uint32_t alignment;
+    };
+
+    struct ChunkDeleter
+    {
+        void operator()(std::byte *storage) const
+        {
+            ::operator delete[](storage, std::align_val_t{COLUMN_ALIGNMENT});
+        }
+    };
+
+    struct Chunk
+    {
+        std::unique_ptr<std::byte[], ChunkDeleter> storage;
+        uint32_t                                   count = 0;
+    };
+
+    struct Archetype
+    {
+        ComponentMask                        mask     = 0;
+        uint32_t                             capacity = 0;  // entities per chunk
+        std::array<uint32_t, MAX_COMPONENTS> offsets;       // of the arrays in a chunk, UINT32_MAX when absent
+        std::vector<ComponentId>             components;
+        std::vector<Chunk>                   chunks;  // full but the last one
+    };
+
+    struct Location
+    {
+        uint32_t archetype  = UINT32_MAX;  // UINT32_MAX while the index is free
+        uint32_t chunk      = 0;
+        uint32_t row        = 0;
+        uint32_t generation = 0;
+    };
+
+    struct ChunkView
+    {
+        Archetype *archetype;
+        Chunk     *chunk;
+        uint32_t   first;  // index of its first entity among the matching ones
+    };
+
+    std::unordered_map<std::type_index, ComponentId> componentIds;
+    std::vector<ComponentInfo>                       components;  // by id
+    std::unordered_map<ComponentMask, uint32_t>      archetypeIndices;
+    std::vector<Archetype>                           archetypes;
+    std::vector<Location>                            locations;  // by entity index
+    std::vector<uint32_t>                            freeIndices;
+    uint32_t                                         entityCount = 0;
+
+    // Methods
+   public:
+    World() = default;
+    World(const World &)            = delete;
+    World &operator=(const World &) = delete;
+
+    template <typename T>
+    ComponentId getComponentId()
+    {
+        using Component = std::remove_const_t<T>;
+        static_assert(std::is_trivially_copyable_v<Component>, "components are plain data");
+        static_assert(alignof(Component) <= COLUMN_ALIGNMENT, "component over aligned");
+        return registerComponent(typeid(Component), sizeof(Component), alignof(Component));
+    }
+
+    template <typename... Ts>
+    ComponentMask getMask()
+    {
+        return ((ComponentMask(1) << getComponentId<Ts>()) | ... | ComponentMask(0));
+    }
+
+    template <typename... Ts>
+    Entity create(const Ts &...components)
+    {
+        Entity entity = allocate(getMask<Ts...>());
+        (std::memcpy(getComponent(entity, getComponentId<Ts>()), &components, sizeof(Ts)), ...);
+        return entity;
+    }
+
+    /**
+     * @brief Ignored when the entity is already destroyed.
+     */
+    void destroy(Entity entity);
+    bool isAlive(Entity entity) const;
+
+    /**
+     * @return nullptr when the entity is destroyed or doesn't have T.
+     */
+    template <typename T>
+    T *get(Entity entity)
+    {
+        return get<T>(entity, getComponentId<T>());
+    }
+
+    /**
+     * @brief With the id of T, e.g. looked up once before a loop.
+     */
+    template <typename T>
+    T *get(Entity entity, ComponentId id) const
+    {
+        return static_cast<T *>(getComponent(entity, id));
+    }
+
+    uint32_t getEntityCount() const;
+
+    /**
+     * @brief Entities having every Ts and none of the excluded components.
+     */
+    template <typename... Ts>
+    uint32_t count(ComponentMask excluded = 0)
+    {
+        return countMatching(getMask<Ts...>(), excluded);
+    }
+
+    /**
+     * @brief Call function(first, entities, spans of Ts...) on every chunk of
+     * the entities having every Ts and none of the excluded components. first
+     * numbers the entities across the chunks, from 0 to count<Ts...>().
+     */
+    template <typename... Ts, typename Function>
+    void forEach(Function &&function, ComponentMask excluded = 0)
+    {
+        const std::array<ComponentId, sizeof...(Ts)> ids = {getComponentId<Ts>()...};
+        for (const ChunkView &view : getChunks(getMask<Ts...>(), excluded))
+        {
+            visit<Ts...>(view, ids, function, std::index_sequence_for<Ts...>{});
+        }
+    }
+
+    /**
+     * @brief forEach() with the chunks spread over the job system, returns
+     * once they are all done. May be called from a job.
+     */
+    template <typename... Ts, typename Function>
+    void parallelForEach(Jobs::JobSystem &jobSystem,
+                         Function       &&function,
+                         ComponentMask    excluded = 0,
+                         const char      *name     = "Chunks")
+    {
+        const std::array<ComponentId, sizeof...(Ts)> ids    = {getComponentId<Ts>()...};
+        const std::vector<ChunkView>                 chunks = getChunks(getMask<Ts...>(), excluded);
+        if (chunks.size() <= 1)
+        {
+            // Not worth a job.
+            for (const ChunkView &view : chunks)
+            {
+                visit<Ts...>(view, ids, function, std::index_sequence_for<Ts...>{});
+            }
+            return;
+        }
+        Jobs::JobHandle job = jobSystem.parallelFor(
+            static_cast<uint32_t>(chunks.size()),
+            1,
+            [&](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; i++)
+                {
+                    visit<Ts...>(chunks[i], ids, function, std::index_sequence_for<Ts...>{});
+                }
+            },
+            {},
+            name);
+        jobSystem.wait(job);
+    }
+
+   private:
+    ComponentId            registerComponent(std::type_index type, size_t size, size_t alignment);
+    uint32_t               getArchetype(ComponentMask mask);
+    Entity                 allocate(ComponentMask mask);
+    void                  *getComponent(Entity entity, ComponentId id) const;
+    std::vector<ChunkView> getChunks(ComponentMask required, ComponentMask excluded);
+    uint32_t               countMatching(ComponentMask required, ComponentMask excluded) const;
+
+    template <typename... Ts, typename Function, size_t... I>
+    static void visit(const ChunkView                               &view,
+                      const std::array<ComponentId, sizeof...(Ts)> &ids,
+                      Function                                     &function,
+                      std::index_sequence<I...>)
+    {
+        std::byte *storage = view.chunk->storage.get();
+        function(view.first,
+                 std::span<const Entity>(reinterpret_cast<const Entity *>(storage), view.chunk->count),
+                 std::span<Ts>(reinterpret_cast<Ts *>(storage + view.archetype->offsets[ids[I]]),
+                               view.chunk->count)...);
+    }
+};
+
+}  // namespace Scene
@@ -1,8 +1,10 @@
 #include "Handlers.hpp"
 
+#include <stdexcept>
+
 namespace Utils::Handlers {
 
-inline std::ifstream File::openFileAtEnd(const std::string &filename)
+PROJECT_API std::ifstream File::openFileAtEnd(const std::string &filename)
 {
     std::ifstream file(filename, std::ios::ate | std::ios::binary);
     if (!file.is_open())
@@ -1,9 +1,11 @@
 #pragma once
 
+#include <cstring>
 #include <fstream>
 #include <string>
 #include <vector>
 
+#include "Utils/MappedFile.hpp"
 #include "config.hpp"
 
 namespace Utils::Handlers {
@@ -12,18 +14,20 @@ class PROJECT_API File
 {
     // Methods
    public:
-    inline static std::ifstream openFileAtEnd(const std::string &filename);
+    static std::ifstream openFileAtEnd(const std::string &filename);
 
+    /**
+     * @brief Owned copy of the file bytes reinterpreted as T. Prefer a
+     * MappedFile view when the data doesn't need to outlive the file.
+     */
     template<typename T>
     static std::vector<T> getBuffer(const std::string &filename)
     {
-        std::ifstream  file = openFileAtEnd(filename);
-        std::vector<char> buffer(file.tellg() / sizeof(T));
-        file.seekg(0, std::ios::beg);
-        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
-        file.close();
+        MappedFile     file(filename);
+        std::vector<T> buffer(file.getSize() / sizeof(T));
+        std::memcpy(buffer.data(), file.getData(), buffer.size() * sizeof(T));
 
-        return std::vector<T>(buffer.begin(), buffer.end());
+        return buffer;
     }
 };
 
@@ -0,0 +1,201 @@
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#if defined(_WIN32)
+#    define WIN32_LEAN_AND_MEAN
+#    define NOMINMAX
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace Utils::Handlers {
+
+#if defined(_WIN32)
+
+PROJECT_API MappedFile::MappedFile(const std::string &filename, bool readAhead)
+{
+    DWORD  accessHint = readAhead ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+    HANDLE file       = CreateFileA(filename.c_str(),
+                                    GENERIC_READ,
+                                    FILE_SHARE_READ,
+                                    nullptr,
+                                    OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL | accessHint,
+                                    nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("failed to open file " + filename + "!");
+    }
+    fileHandle = file;
+
+    LARGE_INTEGER fileSize;
+    if (not GetFileSizeEx(file, &fileSize))
+    {
+        unmap();
+        throw std::runtime_error("failed to get size of file " + filename + "!");
+    }
+    size = static_cast<size_t>(fileSize.QuadPart);
+    if (size == 0)
+    {
+        // Empty files can't be mapped, the view is just empty.
+        return;
+    }
+
+    mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr)
+    {
+        unmap();
+        throw std::runtime_error("failed to map file " + filename + "!");
+    }
+    data = static_cast<const std::byte *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (data == nullptr)
+    {
+        unmap();
+        throw std::runtime_error("failed to map file " + filename + "!");
+    }
+}
+
+PROJECT_API void MappedFile::prefetch(size_t offset, size_t length) const
+{
+    if (offset >= size)
+    {
+        return;
+    }
+    WIN32_MEMORY_RANGE_ENTRY range{.VirtualAddress = const_cast<std::byte *>(data + offset),
+                                   .NumberOfBytes  = std::min(length, size - offset)};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+void MappedFile::unmap()
+{
+    if (data != nullptr)
+    {
+        UnmapViewOfFile(data);
+    }
+    if (mappingHandle != nullptr)
+    {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != nullptr)
+    {
+        CloseHandle(fileHandle);
+    }
+    data          = nullptr;
+    size          = 0;
+    mappingHandle = nullptr;
+    fileHandle    = nullptr;
+}
+
+#else
+
+PROJECT_API MappedFile::MappedFile(const std::string &filename, bool readAhead)
+{
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::runtime_error("failed to open file " + filename + "!");
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("failed to get size of file " + filename + "!");
+    }
+    size = static_cast<size_t>(fileStat.st_size);
+    if (size == 0)
+    {
+        // Empty files can't be mapped, the view is just empty.
+        close(fd);
+        return;
+    }
+
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference on the file.
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        size = 0;
+        throw std::runtime_error("failed to map file " + filename + "!");
+    }
+    data = static_cast<const std::byte *>(mapping);
+    // Loose assets are read front to back right after being opened, start the
+    // read-ahead now. Archives are read piecemeal, only what is touched.
+    madvise(mapping, size, readAhead ? MADV_WILLNEED : MADV_RANDOM);
+}
+
+PROJECT_API void MappedFile::prefetch(size_t offset, size_t length) const
+{
+    if (offset >= size)
+    {
+        return;
+    }
+    // madvise wants a page aligned start, the mapping itself is.
+    static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t              begin    = offset & ~(pageSize - 1);
+    size_t              end      = std::min(size, offset + length);
+    madvise(const_cast<std::byte *>(data + begin), end - begin, MADV_WILLNEED);
+}
+
+void MappedFile::unmap()
+{
+    if (data != nullptr)
+    {
+        munmap(const_cast<std::byte *>(data), size);
+    }
+    data = nullptr;
+    size = 0;
+}
+
+#endif
+
+PROJECT_API MappedFile::MappedFile(MappedFile &&other) noexcept :
+    data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0))
+#if defined(_WIN32)
+    ,
+    fileHandle(std::exchange(other.fileHandle, nullptr)), mappingHandle(std::exchange(other.mappingHandle, nullptr))
+#endif
+{}
+
+PROJECT_API MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other)
+    {
+        unmap();
+        data = std::exchange(other.data, nullptr);
+        size = std::exchange(other.size, 0);
+#if defined(_WIN32)
+        fileHandle    = std::exchange(other.fileHandle, nullptr);
+        mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+    }
+    return *this;
+}
+
+PROJECT_API MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+PROJECT_API const std::byte *MappedFile::getData() const
+{
+    return data;
+}
+
+PROJECT_API size_t MappedFile::getSize() const
+{
+    return size;
+}
+
+PROJECT_API std::span<const std::byte> MappedFile::getBytes() const
+{
+    return {data, size};
+}
+
+}  // namespace Utils::Handlers
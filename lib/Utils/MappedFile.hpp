@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+#include "config.hpp"
+
+namespace Utils::Handlers {
+
+/**
+ * @class MappedFile
+ * @brief Read-only view of a whole file mapped in memory.
+ *
+ * Pages come straight from the OS page cache (POSIX mmap, Win32
+ * MapViewOfFile), nothing is read or copied until the view is touched. The
+ * mapping is page aligned, so any scalar type can be viewed in place.
+ */
+class PROJECT_API MappedFile
+{
+    // Members
+   private:
+    const std::byte *data = nullptr;
+    size_t           size = 0;
+#if defined(_WIN32)
+    void *fileHandle    = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+
+    // Methods
+   public:
+    MappedFile() = default;
+    /**
+     * @param readAhead start reading the whole file in the background, off for
+     * archives read piecemeal, see prefetch().
+     */
+    explicit MappedFile(const std::string &filename, bool readAhead = true);
+    MappedFile(const MappedFile &)            = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+    ~MappedFile();
+
+    const std::byte *getData() const;
+    size_t           getSize() const;
+
+    std::span<const std::byte> getBytes() const;
+
+    /**
+     * @brief Ask the OS to start reading a range in the background, e.g. the
+     * next region to stream. Only a hint, it never fails.
+     */
+    void prefetch(size_t offset, size_t length) const;
+
+    /**
+     * @brief The file reinterpreted as an array of T, e.g. SPIR-V words.
+     */
+    template<typename T>
+    std::span<const T> getSpan() const
+    {
+        if (size % sizeof(T) != 0)
+        {
+            throw std::runtime_error("file size is not a multiple of the element size!");
+        }
+        return std::span<const T>(reinterpret_cast<const T *>(data), size / sizeof(T));
+    }
+
+   private:
+    void unmap();
+};
+
+}  // namespace Utils::Handlers
@@ -3,12 +3,16 @@
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <filesystem>
+#include <format>
 #include <iostream>
 #include <limits>
 #include <stdexcept>
+#include <string>
 #include <tracy/Tracy.hpp>
 #include <vector>
 
@@ -21,6 +25,7 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 // Vulkan header or module
 #if defined(__INTELLISENSE__) || !defined(USE_CPP20_MODULE)
@@ -38,11 +43,35 @@ import vulkan_hpp;
 
 #include "Geometry/Vextex.hpp"
 #include "Images/Jpeg.hpp"
+#include "Images/Ktx2.hpp"
 #include "Utils/Handlers.hpp"
 
+namespace {
+
+double millisecondsSince(std::chrono::steady_clock::time_point time)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - time).count();
+}
+
+// Pack payloads and the mapping are aligned enough to be viewed as words.
+std::span<const uint32_t> toSpirv(std::span<const std::byte> code)
+{
+    if (code.size() % sizeof(uint32_t) != 0)
+    {
+        throw std::runtime_error("SPIR-V size is not a multiple of 4!");
+    }
+    return {reinterpret_cast<const uint32_t *>(code.data()), code.size() / sizeof(uint32_t)};
+}
+
+}  // namespace
+
 void HelloTriangleApplication::initWindow()
 {
     ZoneScoped;
+    if (headless)
+    {
+        return;
+    }
     if (not SDL_Init(SDL_INIT_VIDEO))
         throw SDLException("SDL_Init failed");
 
@@ -54,37 +83,97 @@ void HelloTriangleApplication::initWindow()
 void HelloTriangleApplication::initVulkan()
 {
     ZoneScoped;
-    createInstance();
-    setupDebugMessenger();
-    createSurface();
-    pickPhysicalDevice();
-    createLogicalDevice();
-    createSwapChain();
-    createImageViews();
-    createDescriptorSetLayout();
-    createGraphicsPipeline();
-    createCommandPool();
-    createDepthResources();
-    createTextureImage();
-    createTextureImageView();
-    createTextureSampler();
-    createVertexBuffer();
-    createIndexBuffer();
-    createUniformBuffers();
-    createDescriptorPool();
-    createDescriptorSets();
-    createCommandBuffers();
-    createSyncObjects();
+    // Textures decode on the job system while the device is brought up.
+    jobSystem = std::make_unique<Jobs::JobSystem>();
+    if (std::filesystem::exists("assets.apak"))
+    {
+        // One mapping for every built asset instead of a file per asset.
+        assetPack = std::make_unique<Assets::Pack>("assets.apak");
+    }
+    decodePool = std::make_unique<Images::DecodePool>(*jobSystem);
+    if (not hasAsset("texture.ktx2"))
+    {
+        // The JPEG is only needed without the cooked texture.
+        textureDecode = decodePool->decode("texture.jpg", {.headerOnly = true});
+    }
+
+    // Every step is timed for the benchmark report, see reportBenchmark().
+    runStartupPhase("createInstance", &HelloTriangleApplication::createInstance);
+    runStartupPhase("setupDebugMessenger", &HelloTriangleApplication::setupDebugMessenger);
+    runStartupPhase("createSurface", &HelloTriangleApplication::createSurface);
+    runStartupPhase("pickPhysicalDevice", &HelloTriangleApplication::pickPhysicalDevice);
+    runStartupPhase("createLogicalDevice", &HelloTriangleApplication::createLogicalDevice);
+    runStartupPhase("createAllocator", &HelloTriangleApplication::createAllocator);
+    runStartupPhase("createPipelineCache", &HelloTriangleApplication::createPipelineCache);
+    runStartupPhase("createFramePacer", &HelloTriangleApplication::createFramePacer);
+    runStartupPhase("createSwapChain", &HelloTriangleApplication::createSwapChain);
+    runStartupPhase("createImageViews", &HelloTriangleApplication::createImageViews);
+    runStartupPhase("createDynamicResolution", &HelloTriangleApplication::createDynamicResolution);
+    runStartupPhase("createBindlessTable", &HelloTriangleApplication::createBindlessTable);
+    runStartupPhase("createShaderManager", &HelloTriangleApplication::createShaderManager);
+    runStartupPhase("createGraphicsPipeline", &HelloTriangleApplication::createGraphicsPipeline);
+    runStartupPhase("createGpuCuller", &HelloTriangleApplication::createGpuCuller);
+    runStartupPhase("createCommandPool", &HelloTriangleApplication::createCommandPool);
+    runStartupPhase("createUploadBatcher", &HelloTriangleApplication::createUploadBatcher);
+    runStartupPhase("createGpuProfiler", &HelloTriangleApplication::createGpuProfiler);
+    runStartupPhase("createFrameGraph", &HelloTriangleApplication::createFrameGraph);
+    runStartupPhase("createTextureResidency", &HelloTriangleApplication::createTextureResidency);
+    runStartupPhase("createTextureImage", &HelloTriangleApplication::createTextureImage);
+    runStartupPhase("createTextureImageView", &HelloTriangleApplication::createTextureImageView);
+    runStartupPhase("createTextureSampler", &HelloTriangleApplication::createTextureSampler);
+    runStartupPhase("createVertexBuffer", &HelloTriangleApplication::createVertexBuffer);
+    runStartupPhase("createIndexBuffer", &HelloTriangleApplication::createIndexBuffer);
+    runStartupPhase("createScene", &HelloTriangleApplication::createScene);
+    runStartupPhase("createInstanceBuffer", &HelloTriangleApplication::createInstanceBuffer);
+    // Every startup upload goes out in one batch, the first frame waits for it on the GPU.
+    std::chrono::steady_clock::time_point submitStart = std::chrono::steady_clock::now();
+    uploadBatcher->submit();
+    startupPhases.emplace_back("submitUploads", millisecondsSince(submitStart));
+    runStartupPhase("createFrameArena", &HelloTriangleApplication::createFrameArena);
+    runStartupPhase("createCommandBuffers", &HelloTriangleApplication::createCommandBuffers);
+    runStartupPhase("createSyncObjects", &HelloTriangleApplication::createSyncObjects);
+    // The scene pipeline compiled on the workers meanwhile, the first frame
+    // draws with its fast version if the optimized one isn't ready yet.
+    std::chrono::steady_clock::time_point pipelineStart = std::chrono::steady_clock::now();
+    shaderManager->waitForPipeline(scenePipeline);
+    startupPhases.emplace_back("waitForPipeline", millisecondsSince(pipelineStart));
+}
+
+void HelloTriangleApplication::runStartupPhase(const char *name, void (HelloTriangleApplication::*create)())
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    (this->*create)();
+    startupPhases.emplace_back(name, millisecondsSince(start));
 }
 
 void HelloTriangleApplication::mainLoop()
 {
     ZoneScoped;
+    frameStart      = std::chrono::steady_clock::now();
+    simulationStart = frameStart;
+    if (headless)
+    {
+        // No window and no display to wait for, the frames are GPU bound.
+        for (uint32_t frame = 0; frame < benchmarkFrames; frame++)
+        {
+            drawFrame();
+        }
+        device.waitIdle();
+        reportBenchmark();
+        return;
+    }
+
     bool minimized = false;
     SDL_ShowWindow(window);
 
     while (not shouldBeClose)
     {
+        // Wait for the screen before sampling the input, not after: the frame
+        // is built from the freshest input instead of queueing behind others.
+        if (not minimized)
+        {
+            presentPacer->waitForDisplay(swapChain);
+        }
         for (SDL_Event event; SDL_PollEvent(&event);)
         {
             if (event.type == SDL_EVENT_QUIT)
@@ -101,7 +190,12 @@ void HelloTriangleApplication::mainLoop()
                 std::cout << "Window is restored!" << std::endl;
                 minimized = false;
             }
+            else if (event.type == SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED)
+            {
+                framebufferResized = true;
+            }
         }
+        presentPacer->markInputSampled();
         if (not minimized)
         {
             drawFrame();
@@ -114,6 +208,14 @@ void HelloTriangleApplication::mainLoop()
 void HelloTriangleApplication::cleanup()
 {
     ZoneScoped;
+    if (not pipelineCache->save())
+    {
+        std::cerr << "failed to write pipeline cache " << pipelineCache->getPath() << "!" << std::endl;
+    }
+    if (not timingsPath.empty() && not frameTimings.save(timingsPath))
+    {
+        std::cerr << "failed to write frame timings " << timingsPath << "!" << std::endl;
+    }
     cleanupSwapChain();
 
     SDL_DestroyWindow(window);
@@ -160,6 +262,21 @@ void HelloTriangleApplication::createInstance()
         }
     }
 
+    // Swapchain maintenance is optional, its present fences tell when a
+    // replaced swapchain can be destroyed (see Graphics::RetiredSwapchains).
+    surfaceMaintenance = not headless && Graphics::RetiredSwapchains::isInstanceSupported(context);
+    if (surfaceMaintenance)
+    {
+        for (const char *extension : Graphics::RetiredSwapchains::INSTANCE_EXTENSIONS)
+        {
+            if (std::ranges::none_of(requiredExtensions,
+                                     [extension](const char *name) { return strcmp(name, extension) == 0; }))
+            {
+                requiredExtensions.push_back(extension);
+            }
+        }
+    }
+
     vk::InstanceCreateInfo createInfo{.pApplicationInfo        = &appInfo,
                                       .enabledLayerCount       = static_cast<uint32_t>(requiredLayers.size()),
                                       .ppEnabledLayerNames     = requiredLayers.data(),
@@ -199,6 +316,10 @@ void HelloTriangleApplication::setupDebugMessenger()
 void HelloTriangleApplication::createSurface()
 {
     ZoneScoped;
+    if (headless)
+    {
+        return;
+    }
     VkSurfaceKHR _surface;
     if (not SDL_Vulkan_CreateSurface(window, *instance, nullptr, &_surface))
     {
@@ -266,12 +387,19 @@ void HelloTriangleApplication::pickPhysicalDevice()
 
         auto features = device.template getFeatures2<vk::PhysicalDeviceFeatures2,
                                                                                 // TODO Remove: vk::PhysicalDeviceVulkan11Features,
+                                                                                vk::PhysicalDeviceVulkan12Features,
                                                                                 vk::PhysicalDeviceVulkan13Features,
                                                                                 vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>();
         bool supportsRequiredFeatures =
             features.template get<vk::PhysicalDeviceFeatures2>().features.samplerAnisotropy &&
+            features.template get<vk::PhysicalDeviceFeatures2>().features.drawIndirectFirstInstance &&
+            features.template get<vk::PhysicalDeviceFeatures2>().features.shaderInt64 &&
             // TODO Remove: features.template
             // get<vk::PhysicalDeviceVulkan11Features>().shaderDrawParameters &&
+            features.template get<vk::PhysicalDeviceVulkan12Features>().timelineSemaphore &&
+            features.template get<vk::PhysicalDeviceVulkan12Features>().drawIndirectCount &&
+            features.template get<vk::PhysicalDeviceVulkan12Features>().bufferDeviceAddress &&
+            Graphics::BindlessTable::isSupported(features.template get<vk::PhysicalDeviceVulkan12Features>()) &&
             features.template get<vk::PhysicalDeviceVulkan13Features>().synchronization2 &&
             features.template get<vk::PhysicalDeviceVulkan13Features>().dynamicRendering &&
             features.template get<vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>().extendedDynamicState;
@@ -286,6 +414,14 @@ void HelloTriangleApplication::pickPhysicalDevice()
     {
         throw std::runtime_error("failed to find a suitable GPU!");
     }
+
+    // Resizable BAR / SAM / UMA devices expose a mappable device local heap,
+    // uploads write it directly instead of going through a staging copy.
+    uploadCapabilities = Memory::UploadCapabilities::detect(physicalDevice);
+#if defined(_DEBUG)
+    std::cout << "Upload path: " << (uploadCapabilities.path == Memory::UploadPath::eDirect ? "direct" : "staging")
+              << " (host image copy: " << uploadCapabilities.hostImageCopy << ")" << std::endl;
+#endif
 }
 
 // XXX: if have graphicQueue and presentationQueue separate check👇
@@ -295,88 +431,235 @@ void HelloTriangleApplication::pickPhysicalDevice()
 void HelloTriangleApplication::createLogicalDevice()
 {
     ZoneScoped;
-    // TODO: Consider implementing a dedicated transfer queue for buffer
-    // operations
-    //       This would require:
-    //       1. Modifying queue family selection to find a queue with
-    //       VK_QUEUE_TRANSFER_BIT
-    //       2. Creating a separate command pool for transfer operations
-    //       3. Setting resources to VK_SHARING_MODE_CONCURRENT
-    //       4. Submitting transfer commands to the transfer queue instead of
-    //       graphics queue This is more complex but can improve performance for
-    //       large transfers
-
-    // find the index of the first queue family that supports graphics
-    std::vector<vk::QueueFamilyProperties> queueFamilyProperties = physicalDevice.getQueueFamilyProperties();
+    // Uploads go to a dedicated transfer family (DMA engine) when there is one,
+    // resources stay VK_SHARING_MODE_EXCLUSIVE and change owner through
+    // release/acquire barriers (see Graphics::UploadBatcher).
+    queueFamilies = Graphics::QueueFamilies::select(physicalDevice, surface);
+    queueIndex    = queueFamilies.graphics;
 
-    for (uint32_t qfpIndex = 0; qfpIndex < queueFamilyProperties.size(); qfpIndex++)
-    {
-        if ((queueFamilyProperties[qfpIndex].queueFlags & vk::QueueFlagBits::eGraphics) &&
-            physicalDevice.getSurfaceSupportKHR(qfpIndex, *surface))
-        {
-            queueIndex = qfpIndex;
-            break;
-        }
-    }
-    if (queueIndex == ~0u)
-    {
-        throw std::runtime_error("Could not find a queue for graphics and present -> terminating");
-    }
+    // Block compressed textures are used when the cooked format is supported.
+    vk::PhysicalDeviceFeatures supportedFeatures = physicalDevice.getFeatures();
 
     // query for Vulkan 1.3 features
     vk::StructureChain<vk::PhysicalDeviceFeatures2,
                        //    vk::PhysicalDeviceVulkan11Features,
+                       vk::PhysicalDeviceVulkan12Features,
                        vk::PhysicalDeviceVulkan13Features,
-                       vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>
+                       vk::PhysicalDeviceVulkan14Features,
+                       vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT,
+                       vk::PhysicalDevicePresentIdFeaturesKHR,
+                       vk::PhysicalDevicePresentWaitFeaturesKHR,
+                       vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT,
+                       vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>
         featureChain = {
-            {.features = {.samplerAnisotropy = vk::True}},  // vk::PhysicalDeviceFeatures2
+            // vk::PhysicalDeviceFeatures2
+            {.features = {.drawIndirectFirstInstance  = vk::True,
+                          .samplerAnisotropy          = vk::True,
+                          .textureCompressionASTC_LDR = supportedFeatures.textureCompressionASTC_LDR,
+                          .textureCompressionBC       = supportedFeatures.textureCompressionBC,
+                          .shaderInt64                = vk::True}},
             // {.shaderDrawParameters = vk::True},  //
             // vk::PhysicalDeviceVulkan11Features
+            // vk::PhysicalDeviceVulkan12Features, descriptor indexing for Graphics::BindlessTable
+            {.drawIndirectCount                            = vk::True,
+             .descriptorBindingSampledImageUpdateAfterBind = vk::True,
+             .descriptorBindingUpdateUnusedWhilePending    = vk::True,
+             .descriptorBindingPartiallyBound              = vk::True,
+             .runtimeDescriptorArray                       = vk::True,
+             .timelineSemaphore                            = vk::True,
+             .bufferDeviceAddress                          = vk::True},
             {.synchronization2 = vk::True, .dynamicRendering = vk::True},  // vk::PhysicalDeviceVulkan13Features
-            {.extendedDynamicState = true}  // vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT
+            {.hostImageCopy = uploadCapabilities.hostImageCopy},           // vk::PhysicalDeviceVulkan14Features
+            {.extendedDynamicState = true},  // vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT
+            {.presentId = vk::True},         // vk::PhysicalDevicePresentIdFeaturesKHR
+            {.presentWait = vk::True},       // vk::PhysicalDevicePresentWaitFeaturesKHR
+            {.graphicsPipelineLibrary = vk::True},  // vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT
+            {.swapchainMaintenance1 = vk::True}     // vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT
         };
 
+    // Vulkan 1.3 devices are accepted, the 1.4 features are only chained on 1.4 ones.
+    if (physicalDevice.getProperties().apiVersion < vk::ApiVersion14)
+    {
+        featureChain.unlink<vk::PhysicalDeviceVulkan14Features>();
+    }
+
+    // Present wait is optional, frames are only paced by the frame pacer without it.
+    bool                      presentWait      = not headless && Graphics::PresentPacer::isSupported(physicalDevice);
+    std::vector<const char *> deviceExtensions = requiredDeviceExtension;
+    if (presentWait)
+    {
+        deviceExtensions.insert(deviceExtensions.end(),
+                                Graphics::PresentPacer::EXTENSIONS.begin(),
+                                Graphics::PresentPacer::EXTENSIONS.end());
+    }
+    else
+    {
+        featureChain.unlink<vk::PhysicalDevicePresentIdFeaturesKHR>();
+        featureChain.unlink<vk::PhysicalDevicePresentWaitFeaturesKHR>();
+    }
+
+    // Pipeline libraries are optional too, pipelines are monolithic without them.
+    pipelineLibraries = Graphics::PipelineCompiler::isSupported(physicalDevice);
+    if (pipelineLibraries)
+    {
+        deviceExtensions.insert(deviceExtensions.end(),
+                                Graphics::PipelineCompiler::EXTENSIONS.begin(),
+                                Graphics::PipelineCompiler::EXTENSIONS.end());
+    }
+    else
+    {
+        featureChain.unlink<vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>();
+    }
+
+    // Present fences, replaced swapchains are otherwise kept for a frame.
+    bool presentFences = surfaceMaintenance && Graphics::RetiredSwapchains::isSupported(physicalDevice);
+    if (presentFences)
+    {
+        deviceExtensions.insert(deviceExtensions.end(),
+                                Graphics::RetiredSwapchains::EXTENSIONS.begin(),
+                                Graphics::RetiredSwapchains::EXTENSIONS.end());
+    }
+    else
+    {
+        featureChain.unlink<vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>();
+    }
+
+    // Without the memory budget, textures are streamed within the heap size.
+    memoryBudget = Graphics::TextureResidency::isSupported(physicalDevice);
+    if (memoryBudget)
+    {
+        deviceExtensions.insert(deviceExtensions.end(),
+                                Graphics::TextureResidency::EXTENSIONS.begin(),
+                                Graphics::TextureResidency::EXTENSIONS.end());
+    }
+
+    // Transfer and compute share a family on some hardware, give them their
+    // own queue of that family when it exposes more than one.
+    std::vector<vk::QueueFamilyProperties> queueFamilyProperties = physicalDevice.getQueueFamilyProperties();
+    bool sharedAsyncFamily = queueFamilies.hasAsyncCompute() && queueFamilies.compute == queueFamilies.transfer &&
+                             queueFamilyProperties[queueFamilies.compute].queueCount > 1;
+
     // create a (logical) Device
-    float                     queuePriority = 0.5f;
-    vk::DeviceQueueCreateInfo deviceQueueCreateInfo{.queueFamilyIndex = queueIndex,
-                                                    .queueCount       = 1,
-                                                    .pQueuePriorities = &queuePriority};
-    vk::DeviceCreateInfo      deviceCreateInfo{
-             .pNext                   = &featureChain.get<vk::PhysicalDeviceFeatures2>(),
-             .queueCreateInfoCount    = 1,
-             .pQueueCreateInfos       = &deviceQueueCreateInfo,
-             .enabledExtensionCount   = static_cast<uint32_t>(requiredDeviceExtension.size()),
-             .ppEnabledExtensionNames = requiredDeviceExtension.data()};
+    std::array                             queuePriorities = {0.5f, 0.5f};
+    std::vector<vk::DeviceQueueCreateInfo> deviceQueueCreateInfos;
+    for (uint32_t family : queueFamilies.getUniqueFamilies())
+    {
+        uint32_t queueCount = sharedAsyncFamily && family == queueFamilies.compute ? 2 : 1;
+        deviceQueueCreateInfos.push_back({.queueFamilyIndex = family,
+                                          .queueCount       = queueCount,
+                                          .pQueuePriorities = queuePriorities.data()});
+    }
+    vk::DeviceCreateInfo deviceCreateInfo{
+        .pNext                   = &featureChain.get<vk::PhysicalDeviceFeatures2>(),
+        .queueCreateInfoCount    = static_cast<uint32_t>(deviceQueueCreateInfos.size()),
+        .pQueueCreateInfos       = deviceQueueCreateInfos.data(),
+        .enabledExtensionCount   = static_cast<uint32_t>(deviceExtensions.size()),
+        .ppEnabledExtensionNames = deviceExtensions.data()};
+
+    device            = vk::raii::Device(physicalDevice, deviceCreateInfo);
+    queue             = vk::raii::Queue(device, queueIndex, 0);
+    transferQueue     = vk::raii::Queue(device, queueFamilies.transfer, 0);
+    computeQueue      = vk::raii::Queue(device, queueFamilies.compute, sharedAsyncFamily ? 1 : 0);
+    presentPacer      = std::make_unique<Graphics::PresentPacer>(device, presentWait);
+    retiredSwapChains = std::make_unique<Graphics::RetiredSwapchains>(device, presentFences);
+
+#if defined(_DEBUG)
+    std::cout << "Queue families: graphics " << queueFamilies.graphics << ", transfer " << queueFamilies.transfer
+              << ", compute " << queueFamilies.compute << std::endl;
+#endif
+}
+
+void HelloTriangleApplication::createAllocator()
+{
+    ZoneScoped;
+    // Memory properties are cached by the allocator, every resource is
+    // sub-allocated from its blocks instead of owning a vk::DeviceMemory.
+    allocator = std::make_unique<Memory::Allocator>(physicalDevice, device, true);
+}
+
+void HelloTriangleApplication::createPipelineCache()
+{
+    ZoneScoped;
+    // Kept in the per-user writable directory, the working directory may be
+    // read-only once installed.
+    std::filesystem::path directory = ".";
+    if (char *prefPath = SDL_GetPrefPath("AIperture-Labs", "AetherEngine"))
+    {
+        directory = prefPath;
+        SDL_free(prefPath);
+    }
+    pipelineCache = std::make_unique<Graphics::PipelineCache>(physicalDevice, device, directory);
 
-    device = vk::raii::Device(physicalDevice, deviceCreateInfo);
-    queue  = vk::raii::Queue(device, queueIndex, 0);
+#if defined(_DEBUG)
+    std::cout << "Pipeline cache (" << pipelineCache->getPath() << "): " << pipelineCache->getLoadedSize() << " bytes"
+              << std::endl;
+#endif
+}
+
+void HelloTriangleApplication::createFramePacer()
+{
+    ZoneScoped;
+    framePacer     = std::make_unique<Graphics::FramePacer>(device, framesInFlight);
+    framesInFlight = framePacer->getFramesInFlight();
 }
 
 void HelloTriangleApplication::cleanupSwapChain()
 {
     ZoneScoped;
+    retiredSwapChains->waitForPresents();
     swapChainImageViews.clear();
+    renderFinishedSemaphores.clear();
     swapChain = nullptr;
+    offscreenImages.clear();
+    offscreenAllocations.clear();
 }
 
 void HelloTriangleApplication::recreateSwapChain()
 {
     ZoneScoped;
-    device.waitIdle();
-
-    cleanupSwapChain();
+    // Nothing can be presented while the window has no area, try again on
+    // the next frame.
+    vk::Extent2D extent = physicalDevice.getSurfaceCapabilitiesKHR(surface).currentExtent;
+    if (extent.width == 0 || extent.height == 0)
+    {
+        swapChainOutOfDate = true;
+        return;
+    }
 
+    // No device idle: the frames in flight finish with the old images while
+    // the new swapchain is created from the old one, which is destroyed once
+    // its presents are done. The frame graph resizes the depth attachment of
+    // each frame slot the next time the slot records.
+    presentPacer->reset();
+    vk::Format previousFormat = swapChainSurfaceFormat.format;
     createSwapChain();
     createImageViews();
-    createDepthResources();
+    if (swapChainSurfaceFormat.format != previousFormat)
+    {
+        // The scene pipeline is built again for the new color attachment, the
+        // next frame can't draw with the previous one.
+        shaderManager->setBuilder(scenePipeline, getScenePipelineBuilder());
+        shaderManager->waitForPipeline(scenePipeline);
+    }
+    swapChainOutOfDate = false;
+    framebufferResized = false;
 }
 
 void HelloTriangleApplication::createSwapChain()
 {
     ZoneScoped;
+    if (headless)
+    {
+        createOffscreenTarget();
+        return;
+    }
     auto surfaceCapabilities = physicalDevice.getSurfaceCapabilitiesKHR(surface);
     swapChainSurfaceFormat   = chooseSwapSurfaceFormat(physicalDevice.getSurfaceFormatsKHR(surface));
     swapChainExtent          = chooseSwapExtent(surfaceCapabilities);
+    // Transfer destination too when possible, the dynamic resolution upscale
+    // blits to the images.
+    swapChainUsage = vk::ImageUsageFlagBits::eColorAttachment |
+                     (surfaceCapabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst);
 
     vk::SwapchainCreateInfoKHR swapChainCreateInfo{
         .flags            = vk::SwapchainCreateFlagsKHR(),
@@ -386,16 +669,62 @@ void HelloTriangleApplication::createSwapChain()
         .imageColorSpace  = swapChainSurfaceFormat.colorSpace,
         .imageExtent      = swapChainExtent,
         .imageArrayLayers = 1,  // 2 if VR
-        .imageUsage       = vk::ImageUsageFlagBits::eColorAttachment,
+        .imageUsage       = swapChainUsage,
         .imageSharingMode = vk::SharingMode::eExclusive,
         .preTransform     = surfaceCapabilities.currentTransform,
         .compositeAlpha   = vk::CompositeAlphaFlagBitsKHR::eOpaque,
         .presentMode      = chooseSwapPresentMode(physicalDevice.getSurfacePresentModesKHR(surface)),
         .clipped          = true,
-        .oldSwapchain     = nullptr};
+        .oldSwapchain     = *swapChain};
+
+    vk::raii::SwapchainKHR newSwapChain(device, swapChainCreateInfo);
+    if (*swapChain)
+    {
+        // Its views and present semaphores outlive it until its presents are done.
+        retiredSwapChains->retire(std::move(swapChain),
+                                  std::move(swapChainImageViews),
+                                  std::move(renderFinishedSemaphores),
+                                  framePacer->getFrameValue());
+        swapChainImageViews.clear();
+        renderFinishedSemaphores.clear();
+    }
+    swapChain          = std::move(newSwapChain);
+    swapChainImages    = swapChain.getImages();
+    presentModeChanged = false;
 
-    swapChain       = vk::raii::SwapchainKHR(device, swapChainCreateInfo);
-    swapChainImages = swapChain.getImages();
+    // A present waits for the semaphore of its image, the image count may
+    // change with every swapchain.
+    for (size_t i = 0; i < swapChainImages.size(); i++)
+    {
+        renderFinishedSemaphores.emplace_back(device, vk::SemaphoreCreateInfo());
+    }
+}
+
+void HelloTriangleApplication::createOffscreenTarget()
+{
+    ZoneScoped;
+    // Same format as a desktop swapchain, the pipelines don't depend on the mode.
+    swapChainSurfaceFormat = {.format = vk::Format::eB8G8R8A8Srgb, .colorSpace = vk::ColorSpaceKHR::eSrgbNonlinear};
+    swapChainExtent        = headless_extent;
+    swapChainUsage         = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc |
+                             vk::ImageUsageFlagBits::eTransferDst;
+    swapChainImages.clear();
+    for (uint32_t i = 0; i < headless_image_count; i++)
+    {
+        vk::raii::Image    image = nullptr;
+        Memory::Allocation imageAllocation;
+        createImage(swapChainExtent.width,
+                    swapChainExtent.height,
+                    swapChainSurfaceFormat.format,
+                    vk::ImageTiling::eOptimal,
+                    swapChainUsage,
+                    vk::MemoryPropertyFlagBits::eDeviceLocal,
+                    image,
+                    imageAllocation);
+        swapChainImages.push_back(*image);
+        offscreenImages.push_back(std::move(image));
+        offscreenAllocations.push_back(std::move(imageAllocation));
+    }
 }
 
 void HelloTriangleApplication::createImageViews()
@@ -418,49 +747,111 @@ void HelloTriangleApplication::createImageViews()
     }
 }
 
-void HelloTriangleApplication::createDescriptorSetLayout()
+void HelloTriangleApplication::createDynamicResolution()
+{
+    ZoneScoped;
+    if (targetFrameTime <= 0.0)
+    {
+        return;
+    }
+    // The upscale is a linear blit to the swapchain images.
+    if (not(swapChainUsage & vk::ImageUsageFlagBits::eTransferDst) ||
+        not Graphics::MipGenerator::supportsLinearBlit(physicalDevice, swapChainSurfaceFormat.format))
+    {
+        std::cerr << "dynamic resolution disabled, the swapchain images can't be blitted to!" << std::endl;
+        return;
+    }
+    dynamicResolution = std::make_unique<Graphics::DynamicResolution>(targetFrameTime);
+}
+
+void HelloTriangleApplication::createBindlessTable()
 {
-    std::array                        bindings = {vk::DescriptorSetLayoutBinding(0,
-                                                          vk::DescriptorType::eUniformBuffer,
-                                                          1,
-                                                          vk::ShaderStageFlagBits::eVertex,
-                                                          nullptr),
-                                                  vk::DescriptorSetLayoutBinding(1,
-                                                          vk::DescriptorType::eCombinedImageSampler,
-                                                          1,
-                                                          vk::ShaderStageFlagBits::eFragment,
-                                                          nullptr)};
-    vk::DescriptorSetLayoutCreateInfo layoutInfo{.bindingCount = bindings.size(), .pBindings = bindings.data()};
-    descriptorSetLayout = vk::raii::DescriptorSetLayout(device, layoutInfo);
+    ZoneScoped;
+    // A single set for the whole application, bound once per draw list and
+    // never reallocated with the frames in flight.
+    bindlessTable = std::make_unique<Graphics::BindlessTable>(physicalDevice, device);
+}
+
+void HelloTriangleApplication::createShaderManager()
+{
+    ZoneScoped;
+    // Sources are only reachable from the build tree, a shipped build loads
+    // the precompiled SPIR-V of the pack.
+    std::vector<std::string> searchPaths;
+#if defined(SHADER_SOURCE_DIR)
+    searchPaths.push_back(SHADER_SOURCE_DIR);
+#endif
+    pipelineCompiler = std::make_unique<Graphics::PipelineCompiler>(
+        physicalDevice, device, pipelineCache->get(), *jobSystem, pipelineLibraries);
+    shaderManager = std::make_unique<Graphics::ShaderManager>(
+        *jobSystem,
+        [this](const std::string &name) {
+            Utils::Handlers::MappedFile file;
+            std::vector<std::byte>      storage;
+            std::span<const uint32_t>   code = toSpirv(loadAsset(name, file, storage));
+            return std::vector<uint32_t>(code.begin(), code.end());
+        },
+        searchPaths);
 }
 
 void HelloTriangleApplication::createGraphicsPipeline()
 {
     ZoneScoped;
-    std::string filename   = "slang.spv";
-    auto        shaderCode = Utils::Handlers::File::getBuffer<char>(filename);
+    vk::PushConstantRange        pushConstantRange{.stageFlags = vk::ShaderStageFlagBits::eVertex |
+                                                                 vk::ShaderStageFlagBits::eFragment,
+                                                   .offset     = 0,
+                                                   .size       = sizeof(DrawPushConstants)};
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo{.setLayoutCount         = 1,
+                                                    .pSetLayouts            = &*bindlessTable->getLayout(),
+                                                    .pushConstantRangeCount = 1,
+                                                    .pPushConstantRanges    = &pushConstantRange};
+    pipelineLayout = vk::raii::PipelineLayout(device, pipelineLayoutInfo);
 
-#if defined(_DEBUG)
-    std::cout << "Shader Buffer Size(" << filename << "): " << shaderCode.size() * sizeof(char) << std::endl;
-#endif
+    Graphics::ShaderManager::ProgramId program = shaderManager->addProgram({.module      = "shader_base",
+                                                                            .entryPoints = {"vertMain", "fragMain"},
+                                                                            .defines     = {},
+                                                                            .precompiled = "slang.spv"});
+    scenePipeline = shaderManager->addPipeline(program, getScenePipelineBuilder());
+}
 
-    vk::raii::ShaderModule shaderModule = createShaderModule(shaderCode);
+Graphics::ShaderManager::PipelineBuilder HelloTriangleApplication::getScenePipelineBuilder()
+{
+    // Built on the job system, fast then optimized, and again whenever
+    // shader_base.slang or one of its imports changes: everything the
+    // description reads must stay valid meanwhile. The attachment formats are
+    // copied, the swapchain may change them while a build runs.
+    Graphics::RenderingFormats formats{.colorFormats = {swapChainSurfaceFormat.format},
+                                       .depthFormat  = findDepthFormat()};
+    return [this, formats](std::span<const uint32_t> spirv) {
+        return pipelineCompiler->compile(
+            [this, spirv, formats](const Graphics::PipelineCompiler::CreateInfoVisitor &visit) {
+                describeScenePipeline(spirv, formats, visit);
+            });
+    };
+}
+
+void HelloTriangleApplication::describeScenePipeline(std::span<const uint32_t>                           spirv,
+                                                     const Graphics::RenderingFormats                    &formats,
+                                                     const Graphics::PipelineCompiler::CreateInfoVisitor &visit) const
+{
+    vk::raii::ShaderModule shaderModule = createShaderModule(spirv);
+
+    // The tint branch of fragMain is folded away when the pipeline is built.
+    Graphics::Specialization fragmentConstants;
+    fragmentConstants.set(SCENE_VERTEX_COLOR_CONSTANT, vertexColorTint);
+    vk::SpecializationInfo fragmentSpecialization = fragmentConstants.getInfo();
 
     vk::PipelineShaderStageCreateInfo vertShaderStageInfo{.stage  = vk::ShaderStageFlagBits::eVertex,
                                                           .module = shaderModule,
                                                           .pName  = "vertMain"};
-    vk::PipelineShaderStageCreateInfo fragShaderStageInfo{.stage  = vk::ShaderStageFlagBits::eFragment,
-                                                          .module = shaderModule,
-                                                          .pName  = "fragMain"};
+    vk::PipelineShaderStageCreateInfo fragShaderStageInfo{
+        .stage               = vk::ShaderStageFlagBits::eFragment,
+        .module              = shaderModule,
+        .pName               = "fragMain",
+        .pSpecializationInfo = &fragmentSpecialization};
     vk::PipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
-    auto                                   bindingDescription   = Geometry::Vertex::getBindingDescription();
-    auto                                   attributeDescription = Geometry::Vertex::getAttributeDescriptions();
-    vk::PipelineVertexInputStateCreateInfo vertexInputInfo{
-        .vertexBindingDescriptionCount   = 1,
-        .pVertexBindingDescriptions      = &bindingDescription,
-        .vertexAttributeDescriptionCount = attributeDescription.size(),
-        .pVertexAttributeDescriptions    = attributeDescription.data()};
+    vk::PipelineVertexInputStateCreateInfo   vertexInputInfo = SceneVertexLayout::getInputState();
     vk::PipelineInputAssemblyStateCreateInfo inputAssembly{.topology = vk::PrimitiveTopology::eTriangleList};
     vk::PipelineViewportStateCreateInfo      viewportState{.viewportCount = 1, .scissorCount = 1};
     vk::PipelineRasterizationStateCreateInfo rasterizer{.depthClampEnable        = vk::False,
@@ -487,13 +878,9 @@ void HelloTriangleApplication::createGraphicsPipeline()
         vk::DynamicState::eViewport,
         vk::DynamicState::eScissor,
     };
-    vk::PipelineDynamicStateCreateInfo dynamicState{.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()),
-                                                    .pDynamicStates    = dynamicStates.data()};
-
-    vk::PipelineLayoutCreateInfo pipelineLayoutInfo{.setLayoutCount         = 1,
-                                                    .pSetLayouts            = &*descriptorSetLayout,
-                                                    .pushConstantRangeCount = 0};
-    pipelineLayout = vk::raii::PipelineLayout(device, pipelineLayoutInfo);
+    vk::PipelineDynamicStateCreateInfo dynamicState{
+        .dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()),
+        .pDynamicStates    = dynamicStates.data()};
 
     vk::PipelineDepthStencilStateCreateInfo depthStencil{.depthTestEnable       = vk::True,
                                                          .depthWriteEnable      = vk::True,
@@ -501,7 +888,7 @@ void HelloTriangleApplication::createGraphicsPipeline()
                                                          .depthBoundsTestEnable = vk::False,
                                                          .stencilTestEnable     = vk::False};
 
-    vk::StructureChain<vk::GraphicsPipelineCreateInfo, vk::PipelineRenderingCreateInfo> pipelineCreateInfoChain = {
+    vk::StructureChain<vk::GraphicsPipelineCreateInfo, vk::PipelineRenderingCreateInfo> pipelineCreateInfoChain{
         {.stageCount          = 2,
          .pStages             = shaderStages,
          .pVertexInputState   = &vertexInputInfo,
@@ -514,12 +901,29 @@ void HelloTriangleApplication::createGraphicsPipeline()
          .pDynamicState       = &dynamicState,
          .layout              = *pipelineLayout,
          .renderPass          = nullptr},
-        {.colorAttachmentCount    = 1,
-         .pColorAttachmentFormats = &swapChainSurfaceFormat.format,
-         .depthAttachmentFormat   = findDepthFormat()}};
+        {.colorAttachmentCount    = static_cast<uint32_t>(formats.colorFormats.size()),
+         .pColorAttachmentFormats = formats.colorFormats.data(),
+         .depthAttachmentFormat   = formats.depthFormat}};
 
-    graphicsPipeline =
-        vk::raii::Pipeline(device, nullptr, pipelineCreateInfoChain.get<vk::GraphicsPipelineCreateInfo>());
+    visit(pipelineCreateInfoChain.get<vk::GraphicsPipelineCreateInfo>());
+}
+
+void HelloTriangleApplication::createGpuCuller()
+{
+    ZoneScoped;
+    Utils::Handlers::MappedFile shaderFile;
+    std::vector<std::byte>      shaderStorage;
+    std::span<const std::byte>  shaderCode = loadAsset("cull.spv", shaderFile, shaderStorage);
+    // Culled on the async compute queue when there is one, drawn on the
+    // graphics queue.
+    uint32_t cullFamily = queueFamilies.hasAsyncCompute() ? queueFamilies.compute : queueIndex;
+    gpuCuller           = std::make_unique<Graphics::GpuCuller>(device,
+                                                      *allocator,
+                                                      pipelineCache->get(),
+                                                      toSpirv(shaderCode),
+                                                      cullFamily,
+                                                      queueIndex,
+                                                      framePacer->getFramesInFlight());
 }
 
 void HelloTriangleApplication::createCommandPool()
@@ -528,20 +932,61 @@ void HelloTriangleApplication::createCommandPool()
     vk::CommandPoolCreateInfo poolInfo{.flags            = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
                                        .queueFamilyIndex = queueIndex};
     commandPool = vk::raii::CommandPool(device, poolInfo);
+
+    // Draws are recorded into secondary buffers from per-thread pools, the
+    // primary buffers above only hold barriers and the rendering pass.
+    commandRecorder =
+        std::make_unique<Graphics::CommandRecorder>(device, *jobSystem, queueIndex, framePacer->getFramesInFlight());
+    // A draw is a whole culling batch, worth a secondary buffer on its own.
+    commandRecorder->setMinDrawsPerChunk(1);
+
+    if (queueFamilies.hasAsyncCompute())
+    {
+        vk::CommandPoolCreateInfo computePoolInfo{
+            .flags            = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+            .queueFamilyIndex = queueFamilies.compute};
+        computeCommandPool = vk::raii::CommandPool(device, computePoolInfo);
+    }
 }
 
-void HelloTriangleApplication::createDepthResources()
+void HelloTriangleApplication::createUploadBatcher()
 {
-    vk::Format depthFormat = findDepthFormat();
-    createImage(swapChainExtent.width,
-                swapChainExtent.height,
-                depthFormat,
-                vk::ImageTiling::eOptimal,
-                vk::ImageUsageFlagBits::eDepthStencilAttachment,
-                vk::MemoryPropertyFlagBits::eDeviceLocal,
-                depthImage,
-                depthImageMemory);
-    depthImageView = createImageView(depthImage, depthFormat, vk::ImageAspectFlagBits::eDepth);
+    ZoneScoped;
+    uploadBatcher = std::make_unique<Graphics::UploadBatcher>(device,
+                                                              *allocator,
+                                                              transferQueue,
+                                                              queueFamilies.transfer,
+                                                              queueFamilies.graphics);
+    mipGenerator  = std::make_unique<Graphics::MipGenerator>();
+}
+
+void HelloTriangleApplication::createGpuProfiler()
+{
+    ZoneScoped;
+    // Timestamps are written by the graphics queue, the frame is recorded
+    // and submitted there.
+    gpuProfiler = std::make_unique<Graphics::GpuProfiler>(
+        physicalDevice, device, queue, queueFamilies.graphics, framePacer->getFramesInFlight());
+}
+
+void HelloTriangleApplication::createFrameGraph()
+{
+    ZoneScoped;
+    // Attachments are transients of the graph, declared again every frame,
+    // so they follow the swapchain extent without being recreated here.
+    frameGraph = std::make_unique<Graphics::FrameGraph>(device, *allocator, framePacer->getFramesInFlight());
+}
+
+void HelloTriangleApplication::createTextureResidency()
+{
+    ZoneScoped;
+    textureResidency = std::make_unique<Graphics::TextureResidency>(physicalDevice,
+                                                                    device,
+                                                                    *allocator,
+                                                                    *uploadBatcher,
+                                                                    *bindlessTable,
+                                                                    framePacer->getFramesInFlight(),
+                                                                    memoryBudget);
 }
 
 vk::Format HelloTriangleApplication::findSupportedFormat(const std::vector<vk::Format> &candidates,
@@ -580,161 +1025,176 @@ bool HelloTriangleApplication::hasStencileComponent(vk::Format format)
 void HelloTriangleApplication::createTextureImage()
 {
     ZoneScoped;
-    Images::Jpeg img("texture.jpg");
-
-    vk::raii::Buffer       stagingBuffer({});
-    vk::raii::DeviceMemory stagingBufferMemory({});
-    createBuffer(img.getSize(),
-                 vk::BufferUsageFlagBits::eTransferSrc,
-                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-                 stagingBuffer,
-                 stagingBufferMemory);
+    // Prefer the block compressed texture cooked at build time.
+    if (createCompressedTextureImage("texture.ktx2"))
+    {
+        return;
+    }
 
-    void *data = stagingBufferMemory.mapMemory(0, img.getSize());
-    memcpy(data, img.getData(), img.getSize());
-    stagingBufferMemory.unmapMemory();
+    if (not textureDecode.valid())
+    {
+        // The cooked texture wasn't usable on this device.
+        textureDecode = decodePool->decode("texture.jpg", {.headerOnly = true});
+    }
+    // Only the header is parsed yet, the texels are decoded where they are consumed.
+    Images::Jpeg img = textureDecode.get();
 
+    // The mip chain is blitted on the graphics queue from level 0, the
+    // transfer queue can't blit.
+    vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+    if (Graphics::MipGenerator::supportsLinearBlit(physicalDevice, textureFormat))
+    {
+        textureMipLevels  = Graphics::MipGenerator::getMipLevelCount({img.getWidth(), img.getHeight()});
+        usage            |= vk::ImageUsageFlagBits::eTransferSrc;
+    }
+    // Level 0 is written in the layout it is used in next, by the blits or the
+    // shaders. The CPU copies the texels straight into the optimal image, no
+    // staging buffer and no queue copy, when host copies may write that layout.
+    vk::ImageLayout level0Layout =
+        textureMipLevels > 1 ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::eShaderReadOnlyOptimal;
+    bool hostCopy = uploadCapabilities.path == Memory::UploadPath::eDirect &&
+                    uploadCapabilities.supportsHostCopy(physicalDevice, textureFormat, level0Layout);
+    if (hostCopy)
+    {
+        usage |= vk::ImageUsageFlagBits::eHostTransfer;
+    }
     createImage(img.getWidth(),
                 img.getHeight(),
-                vk::Format::eR8G8B8A8Srgb,
+                textureFormat,
                 vk::ImageTiling::eOptimal,
-                vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+                usage,
                 vk::MemoryPropertyFlagBits::eDeviceLocal,
                 textureImage,
-                textureImageMemory);
-    transitionImageLayout(textureImage, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
-    copyBufferToImage(stagingBuffer, textureImage, img.getWidth(), img.getHeight());
-    transitionImageLayout(textureImage, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
-}
-
-void HelloTriangleApplication::createImage(uint32_t                width,
-                                           uint32_t                height,
-                                           vk::Format              format,
-                                           vk::ImageTiling         tiling,
-                                           vk::ImageUsageFlags     usage,
-                                           vk::MemoryPropertyFlags properties,
-                                           vk::raii::Image        &image,
-                                           vk::raii::DeviceMemory &imageMemory)
-{
-    vk::ImageCreateInfo imageInfo{.imageType   = vk::ImageType::e2D,
-                                  .format      = format,
-                                  .extent      = {width, height, 1},
-                                  .mipLevels   = 1,
-                                  .arrayLayers = 1,
-                                  .samples     = vk::SampleCountFlagBits::e1,
-                                  .tiling      = tiling,
-                                  .usage       = usage,
-                                  .sharingMode = vk::SharingMode::eExclusive};
-
-    image = vk::raii::Image(device, imageInfo);
-
-    vk::MemoryRequirements memRequirements = image.getMemoryRequirements();
-    vk::MemoryAllocateInfo allocInfo{.allocationSize  = memRequirements.size,
-                                     .memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties)};
-    imageMemory = vk::raii::DeviceMemory(device, allocInfo);
-    image.bindMemory(imageMemory, 0);
-}
-
-vk::raii::CommandBuffer HelloTriangleApplication::beginSimgleTimeCommands()
-{
-    vk::CommandBufferAllocateInfo allocInfo{.commandPool        = commandPool,
-                                            .level              = vk::CommandBufferLevel::ePrimary,
-                                            .commandBufferCount = 1};
-    // Allocate a temporary command buffer for the one-time transfer operation
-    // from staging buffer (CPU-accessible) to the final vertex buffer
-    // (GPU-local). This buffer is temporary and will be automatically destroyed
-    // after the copy operation completes. Unlike the persistent command buffers
-    // used for rendering, this buffer is created and used exclusively for data
-    // staging and is not reused.
-    vk::raii::CommandBuffer commandBuffer = std::move(device.allocateCommandBuffers(allocInfo).front());
+                textureImageAllocation,
+                textureMipLevels);
 
-    vk::CommandBufferBeginInfo beginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit};
-    commandBuffer.begin(beginInfo);
-
-    return commandBuffer;
-}
-
-void HelloTriangleApplication::endSingleTimeCommands(vk::raii::CommandBuffer &commandBuffer)
-{
-    commandBuffer.end();
-
-    vk::SubmitInfo submitInfo{.commandBufferCount = 1, .pCommandBuffers = &*commandBuffer};
-    queue.submit(submitInfo, nullptr);
-    queue.waitIdle();
+    if (hostCopy)
+    {
+        img.decompress();
+        // The other levels stay undefined until the blits write them.
+        vk::HostImageLayoutTransitionInfo transitionInfo{.image            = textureImage,
+                                                         .oldLayout        = vk::ImageLayout::eUndefined,
+                                                         .newLayout        = level0Layout,
+                                                         .subresourceRange = {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}};
+        device.transitionImageLayout(transitionInfo);
+
+        vk::MemoryToImageCopy region{.pHostPointer     = img.getData(),
+                                     .imageSubresource = {vk::ImageAspectFlagBits::eColor, 0, 0, 1},
+                                     .imageOffset      = {0, 0, 0},
+                                     .imageExtent      = {img.getWidth(), img.getHeight(), 1}};
+        device.copyMemoryToImage(vk::CopyMemoryToImageInfo{.dstImage       = textureImage,
+                                                           .dstImageLayout = level0Layout,
+                                                           .regionCount    = 1,
+                                                           .pRegions       = &region});
+    }
+    else
+    {
+        // Decode straight into the staging ring, no intermediate image buffer.
+        Graphics::StagingRange staging = uploadBatcher->reserve(img.getSize());
+        img.decompressInto(staging.mapped, img.getRowPitch());
+        if (textureMipLevels == 1)
+        {
+            uploadBatcher->copyToImage(staging, *textureImage, {img.getWidth(), img.getHeight(), 1});
+            return;
+        }
+        uploadBatcher->copyToImage(staging,
+                                   *textureImage,
+                                   {img.getWidth(), img.getHeight(), 1},
+                                   vk::ImageLayout::eTransferSrcOptimal,
+                                   vk::PipelineStageFlagBits2::eBlit);
+    }
+    if (textureMipLevels > 1)
+    {
+        mipGenerator->enqueue(*textureImage, {img.getWidth(), img.getHeight()}, textureMipLevels);
+    }
 }
 
-void HelloTriangleApplication::transitionImageLayout(const vk::raii::Image &image,
-                                                     vk::ImageLayout        oldLayout,
-                                                     vk::ImageLayout        newLayout)
+bool HelloTriangleApplication::createCompressedTextureImage(const std::string &filename)
 {
-    auto commandBuffer = beginSimgleTimeCommands();
-
-    vk::ImageMemoryBarrier barrier{.oldLayout        = oldLayout,
-                                   .newLayout        = newLayout,
-                                   .image            = image,
-                                   .subresourceRange = {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}};
-
-    vk::PipelineStageFlags sourceStage;
-    vk::PipelineStageFlags destinationStage;
-
-    if (oldLayout == vk::ImageLayout::eUndefined && newLayout == vk::ImageLayout::eTransferDstOptimal)
+    ZoneScoped;
+    if (not hasAsset(filename))
     {
-        barrier.srcAccessMask = {};
-        barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-
-        sourceStage      = vk::PipelineStageFlagBits::eTopOfPipe;
-        destinationStage = vk::PipelineStageFlagBits::eTransfer;
+        return false;
     }
-    else if (oldLayout == vk::ImageLayout::eTransferDstOptimal && newLayout == vk::ImageLayout::eShaderReadOnlyOptimal)
-    {
-        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
 
-        sourceStage      = vk::PipelineStageFlagBits::eTransfer;
-        destinationStage = vk::PipelineStageFlagBits::eFragmentShader;
-    }
-    else
+    // The levels view the asset bytes, they stay mapped for the streaming.
+    Utils::Handlers::MappedFile file;
+    std::vector<std::byte>      storage;
+    Images::Ktx2                texture(loadAsset(filename, file, storage), filename);
+    vk::Format                  format = static_cast<vk::Format>(texture.getFormat());
+    // BC on most desktop GPUs, ASTC on mobile and integrated ones.
+    if (not(physicalDevice.getFormatProperties(format).optimalTilingFeatures &
+            vk::FormatFeatureFlagBits::eSampledImage))
     {
-        throw std::invalid_argument("unsupported layout transition!");
+        return false;
     }
 
-    commandBuffer.pipelineBarrier(sourceStage, destinationStage, {}, {}, nullptr, barrier);
-    endSingleTimeCommands(commandBuffer);
+    // Blocks go from the mapped file to the staging ring as they are. Only
+    // the smallest levels are uploaded now, the residency streams the finer
+    // ones once the GPU samples them.
+    Graphics::StreamedTextureDesc desc{.format = format,
+                                       .extent = {texture.getWidth(), texture.getHeight()},
+                                       .levels = {}};
+    for (const Images::Ktx2::Level &level : texture.getLevels())
+    {
+        desc.levels.push_back(level.data);
+    }
+    textureFile      = std::move(file);
+    textureStorage   = std::move(storage);
+    textureFormat    = format;
+    textureMipLevels = texture.getLevelCount();
+    streamedTexture  = textureResidency->addTexture(std::move(desc));
+    textureStreamed  = true;
+    return true;
 }
 
-void HelloTriangleApplication::copyBufferToImage(const vk::raii::Buffer &buffer,
-                                                 vk::raii::Image        &image,
-                                                 uint32_t                width,
-                                                 uint32_t                height)
+void HelloTriangleApplication::createImage(uint32_t                   width,
+                                           uint32_t                   height,
+                                           vk::Format                 format,
+                                           vk::ImageTiling            tiling,
+                                           vk::ImageUsageFlags        usage,
+                                           vk::MemoryPropertyFlags    properties,
+                                           vk::raii::Image           &image,
+                                           Memory::Allocation        &imageAllocation,
+                                           uint32_t                   mipLevels,
+                                           Memory::AllocationStrategy strategy)
 {
-    vk::raii::CommandBuffer commandBuffer = beginSimgleTimeCommands();
+    vk::ImageCreateInfo imageInfo{.imageType   = vk::ImageType::e2D,
+                                  .format      = format,
+                                  .extent      = {width, height, 1},
+                                  .mipLevels   = mipLevels,
+                                  .arrayLayers = 1,
+                                  .samples     = vk::SampleCountFlagBits::e1,
+                                  .tiling      = tiling,
+                                  .usage       = usage,
+                                  .sharingMode = vk::SharingMode::eExclusive};
 
-    vk::BufferImageCopy region{.bufferOffset      = 0,
-                               .bufferRowLength   = 0,
-                               .bufferImageHeight = 0,
-                               .imageSubresource  = {vk::ImageAspectFlagBits::eColor, 0, 0, 1},
-                               .imageOffset       = {0, 0, 0},
-                               .imageExtent       = {width, height, 1}};
-    commandBuffer.copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal, {region});
-    // Submit the buffer copy toe the graphics queue
-    endSingleTimeCommands(commandBuffer);
+    image           = vk::raii::Image(device, imageInfo);
+    imageAllocation = allocator->allocate(image, tiling, properties, strategy);
 }
 
 void HelloTriangleApplication::createTextureImageView()
 {
-    textureImageView = createImageView(textureImage, vk::Format::eR8G8B8A8Srgb, vk::ImageAspectFlagBits::eColor);
+    if (textureStreamed)
+    {
+        return;  // the residency owns its images and bindless slots
+    }
+    textureImageView =
+        createImageView(textureImage, textureFormat, vk::ImageAspectFlagBits::eColor, textureMipLevels);
+    textureIndex = bindlessTable->addTexture(textureImageView, textureImageLayout);
 }
 
 vk::raii::ImageView HelloTriangleApplication::createImageView(vk::raii::Image     &image,
                                                               vk::Format           format,
-                                                              vk::ImageAspectFlags aspectFlags)
+                                                              vk::ImageAspectFlags aspectFlags,
+                                                              uint32_t             mipLevels)
 {
     vk::ImageViewCreateInfo viewInfo{.image            = image,
                                      .viewType         = vk::ImageViewType::e2D,
                                      .format           = format,
                                      .subresourceRange = {.aspectMask     = aspectFlags,
                                                           .baseMipLevel   = 0,
-                                                          .levelCount     = 1,
+                                                          .levelCount     = mipLevels,
                                                           .baseArrayLayer = 0,
                                                           .layerCount     = 1}};
     return vk::raii::ImageView(device, viewInfo);
@@ -752,8 +1212,37 @@ void HelloTriangleApplication::createTextureSampler()
                                              .anisotropyEnable = vk::True,
                                              .maxAnisotropy    = properties.limits.maxSamplerAnisotropy,
                                              .compareEnable    = vk::False,
-                                             .compareOp        = vk::CompareOp::eAlways};
+                                             .compareOp        = vk::CompareOp::eAlways,
+                                             .minLod           = 0.0f,
+                                             .maxLod           = vk::LodClampNone};
     textureSampler = vk::raii::Sampler(device, samplerInfo);
+    samplerIndex   = bindlessTable->addSampler(textureSampler);
+}
+
+void HelloTriangleApplication::createDeviceLocalBuffer(const void          *data,
+                                                       vk::DeviceSize       size,
+                                                       vk::BufferUsageFlags usage,
+                                                       vk::raii::Buffer    &buffer,
+                                                       Memory::Allocation  &bufferAllocation)
+{
+    ZoneScoped;
+    // Staging buffers were needed because GPUs historically couldn't expose
+    // their memory to the CPU. With Resizable BAR / Smart Access Memory or UMA
+    // the CPU writes the device local buffer itself. See discussion:
+    // https://www.reddit.com/r/vulkan/comments/1qad9io/continuing_with_the_official_tutorial/
+    if (uploadCapabilities.canWriteDirectly(*allocator, size))
+    {
+        createBuffer(size, usage, uploadCapabilities.getHostWriteFlags(), buffer, bufferAllocation);
+        memcpy(bufferAllocation.getMappedData(), data, size);
+        return;
+    }
+
+    createBuffer(size,
+                 usage | vk::BufferUsageFlagBits::eTransferDst,
+                 vk::MemoryPropertyFlagBits::eDeviceLocal,
+                 buffer,
+                 bufferAllocation);
+    uploadBatcher->uploadBuffer(*buffer, 0, data, size);
 }
 
 void HelloTriangleApplication::createVertexBuffer()
@@ -766,162 +1255,124 @@ void HelloTriangleApplication::createVertexBuffer()
     //       reuse through aliasing when resources aren't used simultaneously.
     //       See:
     //       https://vulkan.lunarg.com/doc/sdk/1.3.280.0/windows/html/vkspec.html#VUID-vkCmdBindVertexBuffers-pVertexBuffers-0x20
-    vk::DeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
-    // XXX: Staging buffers are used here to copy data from host-visible memory
-    // to device-local memory because many GPUs historically couldn't access
-    // system memory directly. On systems with Resizable BAR / Smart Access
-    // Memory or UMA, explicit staging may be unnecessary or suboptimal. See
-    // discussion:
-    // https://www.reddit.com/r/vulkan/comments/1qad9io/continuing_with_the_official_tutorial/
-    // Create staging buffer using createBuffer helper
-    vk::raii::Buffer       stagingBuffer({});
-    vk::raii::DeviceMemory stagingBufferMemory({});
-    createBuffer(bufferSize,
-                 vk::BufferUsageFlagBits::eTransferSrc,
-                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-                 stagingBuffer,
-                 stagingBufferMemory);
-
-    void *dataStaging = stagingBufferMemory.mapMemory(0, bufferSize);
-    memcpy(dataStaging, vertices.data(), bufferSize);
-    stagingBufferMemory.unmapMemory();
-
-    // Create vertex buffer using createBuffer helper
-    createBuffer(bufferSize,
-                 vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
-                 vk::MemoryPropertyFlagBits::eDeviceLocal,
-                 vertexBuffer,
-                 vertexBufferMemory);
+    std::vector<Geometry::CompactVertex> compactVertices;
+    compactVertices.reserve(vertices.size());
+    for (const Geometry::Vertex &vertex : vertices)
+    {
+        compactVertices.push_back(Geometry::CompactVertex::pack(vertex));
+    }
 
-    copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+    vk::DeviceSize bufferSize = sizeof(compactVertices[0]) * compactVertices.size();
+    createDeviceLocalBuffer(compactVertices.data(),
+                            bufferSize,
+                            vk::BufferUsageFlagBits::eVertexBuffer,
+                            vertexBuffer,
+                            vertexBufferAllocation);
 }
 
 void HelloTriangleApplication::createIndexBuffer()
 {
     vk::DeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-    vk::raii::Buffer       stagingBuffer({});
-    vk::raii::DeviceMemory stagingBufferMemory({});
-    createBuffer(bufferSize,
-                 vk::BufferUsageFlagBits::eTransferSrc,
-                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-                 stagingBuffer,
-                 stagingBufferMemory);
-
-    void *data = stagingBufferMemory.mapMemory(0, bufferSize);
-    memcpy(data, indices.data(), bufferSize);
-    stagingBufferMemory.unmapMemory();
-
-    createBuffer(bufferSize,
-                 vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer,
-                 vk::MemoryPropertyFlagBits::eDeviceLocal,
-                 indexBuffer,
-                 indexBufferMemory);
-
-    copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+    createDeviceLocalBuffer(indices.data(),
+                            bufferSize,
+                            vk::BufferUsageFlagBits::eIndexBuffer,
+                            indexBuffer,
+                            indexBufferAllocation);
 }
 
-void HelloTriangleApplication::createUniformBuffers()
+void HelloTriangleApplication::createScene()
 {
-    uniformBuffers.clear();
-    uniformBuffersMemory.clear();
-    uniformBuffersMapped.clear();
-
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    ZoneScoped;
+    // Every instance draws the whole mesh, bounded by the sphere around its
+    // axis aligned box.
+    glm::vec3 boundsMin = vertices[0].pos;
+    glm::vec3 boundsMax = vertices[0].pos;
+    for (const Geometry::Vertex &vertex : vertices)
     {
-        vk::DeviceSize         bufferSize = sizeof(UniformBufferObject);
-        vk::raii::Buffer       buffer({});
-        vk::raii::DeviceMemory bufferMem({});
-        createBuffer(bufferSize,
-                     vk::BufferUsageFlagBits::eUniformBuffer,
-                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-                     buffer,
-                     bufferMem);
-        uniformBuffers.emplace_back(std::move(buffer));
-        uniformBuffersMemory.emplace_back(std::move(bufferMem));
-        uniformBuffersMapped.emplace_back(uniformBuffersMemory[i].mapMemory(0, bufferSize));
+        boundsMin = glm::min(boundsMin, vertex.pos);
+        boundsMax = glm::max(boundsMax, vertex.pos);
+    }
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    float     radius = 0.0f;
+    for (const Geometry::Vertex &vertex : vertices)
+    {
+        radius = std::max(radius, glm::distance(center, vertex.pos));
     }
-}
 
-void HelloTriangleApplication::createDescriptorPool()
-{
-    std::array poolSize = {vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, MAX_FRAMES_IN_FLIGHT),
-                           vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, MAX_FRAMES_IN_FLIGHT)};
-    vk::DescriptorPoolCreateInfo poolInfo{.flags         = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
-                                          .maxSets       = MAX_FRAMES_IN_FLIGHT,
-                                          .poolSizeCount = poolSize.size(),
-                                          .pPoolSizes    = poolSize.data()};
-    descriptorPool = vk::raii::DescriptorPool(device, poolInfo);
+    Scene::MeshInstance mesh{.boundingSphere = {center.x, center.y, center.z, radius},
+                             .indexCount     = static_cast<uint32_t>(indices.size()),
+                             .firstIndex     = 0,
+                             .vertexOffset   = 0};
+
+    // The grid turns around the Z axis as a whole, under a root entity only
+    // carrying the rotation.
+    Scene::Spin   spin{.axis = glm::vec3(0.0f, 0.0f, 1.0f), .radiansPerSecond = glm::radians(90.0f)};
+    Scene::Entity root   = scene.create(Scene::LocalTransform{}, Scene::WorldTransform{}, spin);
+    Scene::Parent parent = Scene::childOf(scene, root);
+
+    // Laid out on a square grid of the XY plane centered on the origin, a
+    // single instance stays at the origin.
+    constexpr float spacing = 1.5f;
+    uint32_t        side    = static_cast<uint32_t>(std::ceil(std::sqrt(instanceCount)));
+    for (uint32_t i = 0; i < instanceCount; i++)
+    {
+        glm::vec3 offset((static_cast<float>(i % side) - static_cast<float>(side - 1) * 0.5f) * spacing,
+                         (static_cast<float>(i / side) - static_cast<float>(side - 1) * 0.5f) * spacing,
+                         0.0f);
+        Scene::LocalTransform local{.position = offset, .scale = 1.0f, .rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f)};
+        scene.create(local, Scene::WorldTransform{}, parent, mesh);
+    }
 }
 
-void HelloTriangleApplication::createDescriptorSets()
+void HelloTriangleApplication::createInstanceBuffer()
 {
-    std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, *descriptorSetLayout);
-    vk::DescriptorSetAllocateInfo        allocInfo{.descriptorPool     = descriptorPool,
-                                                   .descriptorSetCount = static_cast<uint32_t>(layouts.size()),
-                                                   .pSetLayouts        = layouts.data()};
-
-    descriptorSets.clear();
-    descriptorSets = device.allocateDescriptorSets(allocInfo);
-
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    ZoneScoped;
+    // Packed by the simulation every frame, one region per frame slot so a
+    // frame writes its instances while the previous ones are still drawn.
+    vk::DeviceSize alignment  = physicalDevice.getProperties().limits.minStorageBufferOffsetAlignment;
+    instanceStride            = (instanceCount * sizeof(Graphics::GpuInstance) + alignment - 1) / alignment * alignment;
+    vk::DeviceSize bufferSize = instanceStride * framePacer->getFramesInFlight();
+
+    // Read by the culling and by the draws, on two families with async compute.
+    std::array           families = {queueFamilies.compute, queueIndex};
+    vk::BufferCreateInfo bufferInfo{.size        = bufferSize,
+                                    .usage       = vk::BufferUsageFlagBits::eStorageBuffer |
+                                                   vk::BufferUsageFlagBits::eVertexBuffer,
+                                    .sharingMode = vk::SharingMode::eExclusive};
+    if (queueFamilies.hasAsyncCompute())
     {
-        vk::DescriptorBufferInfo bufferInfo{.buffer = uniformBuffers[i],
-                                            .offset = 0,
-                                            .range  = sizeof(UniformBufferObject)};
-        vk::DescriptorImageInfo  imageInfo{.sampler     = textureSampler,
-                                           .imageView   = textureImageView,
-                                           .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal};
-        std::array               descriptorWrites{vk::WriteDescriptorSet{.dstSet          = descriptorSets[i],
-                                                                         .dstBinding      = 0,
-                                                                         .dstArrayElement = 0,
-                                                                         .descriptorCount = 1,
-                                                                         .descriptorType = vk::DescriptorType::eUniformBuffer,
-                                                                         .pBufferInfo = &bufferInfo},
-                                    vk::WriteDescriptorSet{.dstSet          = descriptorSets[i],
-                                                                         .dstBinding      = 1,
-                                                                         .dstArrayElement = 0,
-                                                                         .descriptorCount = 1,
-                                                                         .descriptorType = vk::DescriptorType::eCombinedImageSampler,
-                                                                         .pImageInfo = &imageInfo}};
-        device.updateDescriptorSets(descriptorWrites, {});
+        bufferInfo.sharingMode           = vk::SharingMode::eConcurrent;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(families.size());
+        bufferInfo.pQueueFamilyIndices   = families.data();
     }
+    instanceBuffer           = vk::raii::Buffer(device, bufferInfo);
+    instanceBufferAllocation = allocator->allocate(instanceBuffer, uploadCapabilities.getHostWriteFlags());
+    instanceMapped = static_cast<std::byte *>(instanceBufferAllocation.getMappedData());
+    gpuCuller->setInstances(*instanceBuffer, instanceCount, instanceStride);
 }
 
-void HelloTriangleApplication::copyBuffer(vk::raii::Buffer &srcBuffer, vk::raii::Buffer &dstBuffer, vk::DeviceSize size)
+void HelloTriangleApplication::createFrameArena()
 {
-    vk::raii::CommandBuffer commandCopyBuffer = beginSimgleTimeCommands();
-    commandCopyBuffer.copyBuffer(srcBuffer, dstBuffer, vk::BufferCopy(0, 0, size));
-    endSingleTimeCommands(commandCopyBuffer);
+    ZoneScoped;
+    // Transient per-frame data (frame uniforms today, per-object data later)
+    // is bump allocated, one region per frame slot rewound by beginFrame().
+    frameArena = std::make_unique<Graphics::FrameArena>(physicalDevice,
+                                                        device,
+                                                        *allocator,
+                                                        uploadCapabilities,
+                                                        framePacer->getFramesInFlight());
 }
 
-void HelloTriangleApplication::createBuffer(vk::DeviceSize          size,
-                                            vk::BufferUsageFlags    usage,
-                                            vk::MemoryPropertyFlags properties,
-                                            vk::raii::Buffer       &buffer,
-                                            vk::raii::DeviceMemory &bufferMemory)
+void HelloTriangleApplication::createBuffer(vk::DeviceSize             size,
+                                            vk::BufferUsageFlags       usage,
+                                            vk::MemoryPropertyFlags    properties,
+                                            vk::raii::Buffer          &buffer,
+                                            Memory::Allocation        &bufferAllocation,
+                                            Memory::AllocationStrategy strategy)
 {
     vk::BufferCreateInfo bufferInfo{.size = size, .usage = usage, .sharingMode = vk::SharingMode::eExclusive};
-    buffer                                 = vk::raii::Buffer(device, bufferInfo);
-    vk::MemoryRequirements memRequirements = buffer.getMemoryRequirements();
-    vk::MemoryAllocateInfo allocInfo{.allocationSize  = memRequirements.size,
-                                     .memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties)};
-    bufferMemory = vk::raii::DeviceMemory(device, allocInfo);
-    buffer.bindMemory(*bufferMemory, 0);
-}
-
-uint32_t HelloTriangleApplication::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties)
-{
-    vk::PhysicalDeviceMemoryProperties memProperties = physicalDevice.getMemoryProperties();
-
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
-    {
-        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
-            return i;
-    }
-
-    throw std::runtime_error("failed to find suitable memory type!");
+    buffer           = vk::raii::Buffer(device, bufferInfo);
+    bufferAllocation = allocator->allocate(buffer, properties, strategy);
 }
 
 void HelloTriangleApplication::createCommandBuffers()
@@ -930,143 +1381,290 @@ void HelloTriangleApplication::createCommandBuffers()
     commandBuffers.clear();
     vk::CommandBufferAllocateInfo allocInfo{.commandPool        = commandPool,
                                             .level              = vk::CommandBufferLevel::ePrimary,
-                                            .commandBufferCount = MAX_FRAMES_IN_FLIGHT};
+                                            .commandBufferCount = framePacer->getFramesInFlight()};
     commandBuffers = vk::raii::CommandBuffers(device, allocInfo);
+
+    computeCommandBuffers.clear();
+    if (queueFamilies.hasAsyncCompute())
+    {
+        allocInfo.commandPool = computeCommandPool;
+        computeCommandBuffers = vk::raii::CommandBuffers(device, allocInfo);
+    }
 }
 
 void HelloTriangleApplication::recordCommandBuffer(uint32_t imageIndex)
 {
     auto &commandBuffer = commandBuffers[frameIndex];
     commandBuffer.begin({});
+    gpuProfiler->beginFrame(commandBuffer, frameIndex, framePacer->getFrameValue());
+
+    // Take ownership of what the transfer queue uploaded since the last frame.
+    gpuProfiler->beginScope(commandBuffer, "Uploads");
+    uploadWaitValue = uploadBatcher->recordAcquireBarriers(commandBuffer);
+    mipGenerator->record(commandBuffer);
+    gpuProfiler->endScope(commandBuffer);
+    // The visible instances are known on the GPU only, they are drawn with an
+    // indirect count draw per culling batch.
+    if (queueFamilies.hasAsyncCompute())
+    {
+        // Culled on the compute queue, submitted with this frame which waits
+        // for it, see drawFrame().
+        auto &computeCommandBuffer = computeCommandBuffers[frameIndex];
+        computeCommandBuffer.reset();
+        computeCommandBuffer.begin({});
+        gpuCuller->record(computeCommandBuffer);
+        computeCommandBuffer.end();
+        gpuCuller->recordAcquireBarriers(commandBuffer);
+    }
+    else
+    {
+        gpuProfiler->beginScope(commandBuffer, "Culling");
+        gpuCuller->record(commandBuffer);
+        gpuProfiler->endScope(commandBuffer);
+    }
+
+    // The scene is the only pass for now, the graph works out the layouts
+    // of its attachments and the barriers around it.
+    frameGraph->reset();
+    // Nothing reads the offscreen images headless, they stay attachments.
+    Graphics::ImageState presentState = {.layout = vk::ImageLayout::ePresentSrcKHR,
+                                         .stages = vk::PipelineStageFlagBits2::eBottomOfPipe,
+                                         .access = {}};
+    if (headless)
+    {
+        presentState = {.layout = vk::ImageLayout::eColorAttachmentOptimal,
+                        .stages = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                        .access = {}};
+    }
+    Graphics::FrameGraph::ImageId color = frameGraph->importImage(
+        "Swapchain",
+        swapChainImages[imageIndex],
+        *swapChainImageViews[imageIndex],
+        vk::ImageAspectFlagBits::eColor,
+        // The acquire semaphore is waited for by the color output stage.
+        {.layout = vk::ImageLayout::eUndefined,
+         .stages = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+         .access = {}},
+        presentState);
+    Graphics::FrameGraph::ImageId depth = frameGraph->createImage(
+        "Depth",
+        {.format = findDepthFormat(), .extent = swapChainExtent, .aspect = vk::ImageAspectFlagBits::eDepth});
+    if (not dynamicResolution)
+    {
+        frameGraph
+            ->addPass("Scene",
+                      [this, color, depth](const vk::raii::CommandBuffer &passBuffer) {
+                          recordScenePass(passBuffer,
+                                          frameGraph->getImageView(color),
+                                          frameGraph->getImageView(depth),
+                                          swapChainExtent);
+                      })
+            .write(color, Graphics::ImageAccess::eColorAttachment)
+            .write(depth, Graphics::ImageAccess::eDepthAttachment);
+    }
+    else
+    {
+        // The attachments keep the swapchain extent and the scene renders in
+        // their top left corner: a new scale reallocates nothing.
+        vk::Extent2D                  renderExtent = dynamicResolution->getRenderExtent(swapChainExtent);
+        Graphics::FrameGraph::ImageId sceneColor   = frameGraph->createImage("SceneColor",
+                                                                           {.format = swapChainSurfaceFormat.format,
+                                                                            .extent = swapChainExtent,
+                                                                            .aspect = vk::ImageAspectFlagBits::eColor});
+        frameGraph
+            ->addPass("Scene",
+                      [this, sceneColor, depth, renderExtent](const vk::raii::CommandBuffer &passBuffer) {
+                          recordScenePass(passBuffer,
+                                          frameGraph->getImageView(sceneColor),
+                                          frameGraph->getImageView(depth),
+                                          renderExtent);
+                      })
+            .write(sceneColor, Graphics::ImageAccess::eColorAttachment)
+            .write(depth, Graphics::ImageAccess::eDepthAttachment);
+        frameGraph
+            ->addPass("Upscale",
+                      [this, sceneColor, color, renderExtent](const vk::raii::CommandBuffer &passBuffer) {
+                          recordUpscalePass(passBuffer,
+                                            frameGraph->getImage(sceneColor),
+                                            renderExtent,
+                                            frameGraph->getImage(color));
+                      })
+            .read(sceneColor, Graphics::ImageAccess::eTransferSrc)
+            .write(color, Graphics::ImageAccess::eTransferDst);
+    }
+    frameGraph->execute(commandBuffer, frameIndex, gpuProfiler.get());
+
+    gpuProfiler->endFrame(commandBuffer);
+    commandBuffer.end();
+}
 
-    // Before starting rendering, transition the swapchain image to
-    // COLOR_ATTACHMENT_OPTIMAL
-    transition_image_layout(swapChainImages[imageIndex],
-                            vk::ImageLayout::eUndefined,
-                            vk::ImageLayout::eColorAttachmentOptimal,
-                            {},  // srcAccessMask (no need to wait for previous operations)
-                            vk::AccessFlagBits2::eColorAttachmentWrite,          // dstAccessMask
-                            vk::PipelineStageFlagBits2::eColorAttachmentOutput,  // srcStage
-                            vk::PipelineStageFlagBits2::eColorAttachmentOutput,  // dstStage
-                            vk::ImageAspectFlagBits::eColor);
-    // New transition for the depth image
-    transition_image_layout(
-        *depthImage,
-        vk::ImageLayout::eUndefined,
-        vk::ImageLayout::eDepthAttachmentOptimal,
-        vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
-        vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
-        vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests,
-        vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests,
-        vk::ImageAspectFlagBits::eDepth);
+void HelloTriangleApplication::recordScenePass(const vk::raii::CommandBuffer &commandBuffer,
+                                               vk::ImageView                  colorView,
+                                               vk::ImageView                  depthView,
+                                               vk::Extent2D                   extent)
+{
+    ZoneScoped;
     vk::ClearValue              clearColor          = vk::ClearColorValue(0.0f, 0.0f, 0.0f, 1.0f);
     vk::ClearValue              clearDepth          = vk::ClearDepthStencilValue(1.0f, 0);
-    vk::RenderingAttachmentInfo attachmentInfo      = {.imageView   = swapChainImageViews[imageIndex],
+    vk::RenderingAttachmentInfo attachmentInfo      = {.imageView   = colorView,
                                                        .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
                                                        .loadOp      = vk::AttachmentLoadOp::eClear,
                                                        .storeOp     = vk::AttachmentStoreOp::eStore,
                                                        .clearValue  = clearColor};
-    vk::RenderingAttachmentInfo depthAttachmentInfo = {.imageView   = depthImageView,
+    vk::RenderingAttachmentInfo depthAttachmentInfo = {.imageView   = depthView,
                                                        .imageLayout = vk::ImageLayout::eDepthAttachmentOptimal,
                                                        .loadOp      = vk::AttachmentLoadOp::eClear,
                                                        .storeOp     = vk::AttachmentStoreOp::eDontCare,
                                                        .clearValue  = clearDepth};
 
-    vk::RenderingInfo renderingInfo = {.renderArea           = {.offset = {.x = 0, .y = 0}, .extent = swapChainExtent},
+    vk::RenderingInfo renderingInfo = {.flags                = vk::RenderingFlagBits::eContentsSecondaryCommandBuffers,
+                                       .renderArea           = {.offset = {.x = 0, .y = 0}, .extent = extent},
                                        .layerCount           = 1,
                                        .colorAttachmentCount = 1,
                                        .pColorAttachments    = &attachmentInfo,
                                        .pDepthAttachment     = &depthAttachmentInfo};
 
+    // Every secondary buffer binds its own state, nothing is inherited from
+    // the primary one. The CPU records one draw per culling batch, the chunks
+    // of batches are recorded in parallel.
+    Graphics::RenderingFormats     formats{.colorFormats = {swapChainSurfaceFormat.format},
+                                           .depthFormat  = findDepthFormat()};
+    uint32_t                       drawCount        = gpuCuller->getBatchCount();
+    vk::Pipeline                   pipeline         = shaderManager->getPipeline(scenePipeline);
+    std::vector<vk::CommandBuffer> secondaryBuffers = commandRecorder->record(
+        formats,
+        drawCount,
+        [this, pipeline, extent](const vk::raii::CommandBuffer &secondary, uint32_t first, uint32_t count) {
+            secondary.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+            secondary.setViewport(0,
+                                  vk::Viewport(0.0f,
+                                               0.0f,
+                                               static_cast<float>(extent.width),
+                                               static_cast<float>(extent.height),
+                                               0.0f,
+                                               1.0f));
+            secondary.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), extent));
+            // Per-vertex stream then per-instance stream, see SceneVertexLayout.
+            secondary.bindVertexBuffers(0, {*vertexBuffer, *instanceBuffer}, {0, gpuCuller->getInstanceOffset()});
+            secondary.bindIndexBuffer(*indexBuffer, 0, vk::IndexTypeValue<decltype(indices)::value_type>::value);
+            // The only per-frame binding is the push constant address of the
+            // frame uniforms.
+            secondary.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                         pipelineLayout,
+                                         0,
+                                         bindlessTable->getSet(),
+                                         nullptr);
+            DrawPushConstants constants{
+                .frame         = frameUniformsAddress,
+                .textureIndex  = textureIndex,
+                .samplerIndex  = samplerIndex,
+                .feedback      = textureStreamed ? textureResidency->getFeedbackAddress() : 0,
+                .feedbackIndex = streamedTexture};
+            secondary.pushConstants<DrawPushConstants>(pipelineLayout,
+                                                       vk::ShaderStageFlagBits::eVertex |
+                                                           vk::ShaderStageFlagBits::eFragment,
+                                                       0,
+                                                       constants);
+            gpuCuller->draw(secondary, first, count);
+        });
+
     commandBuffer.beginRendering(renderingInfo);
-    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *graphicsPipeline);
-    commandBuffer.setViewport(0,
-                              vk::Viewport(0.0f,
-                                           0.0f,
-                                           static_cast<float>(swapChainExtent.width),
-                                           static_cast<float>(swapChainExtent.height),
-                                           0.0f,
-                                           1.0f));
-    commandBuffer.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), swapChainExtent));
-    commandBuffer.bindVertexBuffers(0, *vertexBuffer, {0});
-    commandBuffer.bindIndexBuffer(*indexBuffer, 0, vk::IndexTypeValue<decltype(indices)::value_type>::value);
-    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
-                                     pipelineLayout,
-                                     0,
-                                     *descriptorSets[frameIndex],
-                                     nullptr);
-    commandBuffer.drawIndexed(indices.size(), 1, 0, 0, 0);
+    commandBuffer.executeCommands(secondaryBuffers);
     commandBuffer.endRendering();
-
-    // After rendering, transition the swapchain image to PRESENT_SRC
-    transition_image_layout(swapChainImages[imageIndex],
-                            vk::ImageLayout::eColorAttachmentOptimal,
-                            vk::ImageLayout::ePresentSrcKHR,
-                            vk::AccessFlagBits2::eColorAttachmentWrite,
-                            {},
-                            vk::PipelineStageFlagBits2::eColorAttachmentOutput,
-                            vk::PipelineStageFlagBits2::eBottomOfPipe,
-                            vk::ImageAspectFlagBits::eColor);
-
-    commandBuffer.end();
+    if (textureStreamed)
+    {
+        textureResidency->recordFeedbackBarrier(commandBuffer);
+    }
 }
 
-void HelloTriangleApplication::transition_image_layout(vk::Image               image,
-                                                       vk::ImageLayout         oldLayout,
-                                                       vk::ImageLayout         newLayout,
-                                                       vk::AccessFlags2        srcAccessMask,
-                                                       vk::AccessFlags2        dstAccessMask,
-                                                       vk::PipelineStageFlags2 srcStageMask,
-                                                       vk::PipelineStageFlags2 dstStageMask,
-                                                       vk::ImageAspectFlags    image_aspect_flags)
+void HelloTriangleApplication::recordUpscalePass(const vk::raii::CommandBuffer &commandBuffer,
+                                                 vk::Image                      source,
+                                                 vk::Extent2D                   sourceExtent,
+                                                 vk::Image                      destination)
 {
     ZoneScoped;
-    vk::ImageMemoryBarrier2 barrier        = {.srcStageMask        = srcStageMask,
-                                              .srcAccessMask       = srcAccessMask,
-                                              .dstStageMask        = dstStageMask,
-                                              .dstAccessMask       = dstAccessMask,
-                                              .oldLayout           = oldLayout,
-                                              .newLayout           = newLayout,
-                                              .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                                              .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-                                              .image               = image,
-                                              .subresourceRange    = {.aspectMask     = image_aspect_flags,
-                                                                      .baseMipLevel   = 0,
-                                                                      .levelCount     = 1,
-                                                                      .baseArrayLayer = 0,
-                                                                      .layerCount     = 1}};
-    vk::DependencyInfo      dependencyInfo = {.dependencyFlags         = {},
-                                              .imageMemoryBarrierCount = 1,
-                                              .pImageMemoryBarriers    = &barrier};
-    commandBuffers[frameIndex].pipelineBarrier2(dependencyInfo);
+    // Bilinear, the one spatial filter a blit has.
+    vk::ImageSubresourceLayers layers{.aspectMask     = vk::ImageAspectFlagBits::eColor,
+                                      .mipLevel       = 0,
+                                      .baseArrayLayer = 0,
+                                      .layerCount     = 1};
+    vk::ImageBlit2             region;
+    region.srcSubresource = layers;
+    region.srcOffsets[1]  = vk::Offset3D(static_cast<int32_t>(sourceExtent.width),
+                                        static_cast<int32_t>(sourceExtent.height),
+                                        1);
+    region.dstSubresource = layers;
+    region.dstOffsets[1]  = vk::Offset3D(static_cast<int32_t>(swapChainExtent.width),
+                                        static_cast<int32_t>(swapChainExtent.height),
+                                        1);
+    commandBuffer.blitImage2({.srcImage       = source,
+                              .srcImageLayout = vk::ImageLayout::eTransferSrcOptimal,
+                              .dstImage       = destination,
+                              .dstImageLayout = vk::ImageLayout::eTransferDstOptimal,
+                              .regionCount    = 1,
+                              .pRegions       = &region,
+                              .filter         = vk::Filter::eLinear});
 }
 
 void HelloTriangleApplication::createSyncObjects()
 {
     ZoneScoped;
-    assert(presentCompleteSemaphores.empty() && renderFinishedSemaphores.empty() && inFlightFences.empty());
+    assert(presentCompleteSemaphores.empty());
 
-    for (size_t i = 0; i < swapChainImages.size(); i++)
+    // Presentation only takes binary semaphores, the CPU waits on the frame
+    // pacer timeline instead of per-frame fences. The render finished ones
+    // come with the swapchain, see createSwapChain().
+    for (size_t i = 0; i < framePacer->getFramesInFlight(); i++)
     {
-        renderFinishedSemaphores.emplace_back(device, vk::SemaphoreCreateInfo());
+        presentCompleteSemaphores.emplace_back(device, vk::SemaphoreCreateInfo());
     }
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    // The frame values only grow, the culling of each frame signals its own.
+    vk::StructureChain<vk::SemaphoreCreateInfo, vk::SemaphoreTypeCreateInfo> semaphoreChain = {
+        {},
+        {.semaphoreType = vk::SemaphoreType::eTimeline, .initialValue = 0}};
+    cullSemaphore = vk::raii::Semaphore(device, semaphoreChain.get<vk::SemaphoreCreateInfo>());
+}
+
+void HelloTriangleApplication::createFrameResources()
+{
+    ZoneScoped;
+    // Waits for every frame in flight, nothing below is in use afterwards.
+    framePacer->setFramesInFlight(framesInFlight);
+    framesInFlight = framePacer->getFramesInFlight();
+
+    commandBuffers.clear();
+    computeCommandBuffers.clear();
+    commandRecorder->setFramesInFlight(framesInFlight);
+    gpuCuller->setFramesInFlight(framesInFlight);
+    createInstanceBuffer();  // a region per slot
+    frameArena->setFramesInFlight(framesInFlight);
+    frameGraph->setFramesInFlight(framesInFlight);
+    gpuProfiler->setFramesInFlight(framesInFlight);
+    textureResidency->setFramesInFlight(framesInFlight);
+    createCommandBuffers();
+
+    presentCompleteSemaphores.clear();
+    for (size_t i = 0; i < framePacer->getFramesInFlight(); i++)
     {
         presentCompleteSemaphores.emplace_back(device, vk::SemaphoreCreateInfo());
-        inFlightFences.emplace_back(device, vk::FenceCreateInfo{.flags = vk::FenceCreateFlagBits::eSignaled});
     }
 }
 
-void HelloTriangleApplication::updateUniformBuffer(uint32_t currentImage)
+void HelloTriangleApplication::updateScene(std::byte *instances, float time)
 {
-    static auto startTime = std::chrono::high_resolution_clock::now();
-
-    auto  currentTime = std::chrono::high_resolution_clock::now();
-    float time        = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+    ZoneScoped;
+    Scene::updateSpin(scene, *jobSystem, time);
+    Scene::updateTransforms(scene, *jobSystem);
+    Scene::packInstances(
+        scene, *jobSystem, std::span(reinterpret_cast<Graphics::GpuInstance *>(instances), instanceCount));
+}
 
+void HelloTriangleApplication::updateUniformBuffer(void *destination, float time)
+{
     UniformBufferObject ubo{};
-    ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    // The instance transforms are already in world space.
+    ubo.model = glm::mat4(1.0f);
     ubo.view  = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
     ubo.proj  = glm::perspective(glm::radians(45.0f),
                                 static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height),
@@ -1077,60 +1675,206 @@ void HelloTriangleApplication::updateUniformBuffer(uint32_t currentImage)
     // in the projection matrix so the final image isn't rendered upside down.
     ubo.proj[1][1] *= -1;
 
-    memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
+    memcpy(destination, &ubo, sizeof(ubo));
+
+    // So are the culling planes.
+    glm::mat4 viewProjection = ubo.proj * ubo.view;
+    gpuCuller->updateFrustum(std::span<const float, 16>(glm::value_ptr(viewProjection), 16));
 }
 
 void HelloTriangleApplication::drawFrame()
 {
     ZoneScoped;
-    auto fenceResult = device.waitForFences(*inFlightFences[frameIndex], vk::True, UINT64_MAX);
-    if (fenceResult != vk::Result::eSuccess)
+    if (framesInFlight != framePacer->getFramesInFlight())
     {
-        throw std::runtime_error("failed to wait for fence!");
+        createFrameResources();
     }
-    device.resetFences(*inFlightFences[frameIndex]);
-
-    auto [acquireResult, imageIndex] =
-        swapChain.acquireNextImage(UINT64_MAX, *presentCompleteSemaphores[frameIndex], nullptr);
-
-    if (acquireResult == vk::Result::eErrorOutOfDateKHR)
+    // Every reason to recreate the swapchain ends up here, between frames.
+    if (not headless && (swapChainOutOfDate || framebufferResized || presentModeChanged))
     {
         recreateSwapChain();
-        return;
+        if (swapChainOutOfDate)
+        {
+            return;
+        }
     }
-
-    if (acquireResult != vk::Result::eSuccess && acquireResult != vk::Result::eSuboptimalKHR)
+    // Frame to frame, the counters below are its parts.
+    Graphics::CpuFrameTimings             cpuTimings;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    cpuTimings.total = std::chrono::duration<double, std::milli>(now - frameStart).count();
+    frameStart       = now;
+
+    // Nothing is reset here: an early return (out of date swapchain) leaves
+    // the slot free for the next frame.
+    frameIndex           = framePacer->beginFrame();
+    cpuTimings.fenceWait = millisecondsSince(now);
+    retiredSwapChains->collect(framePacer->getCompletedValue());
+    // Swaps in the pipelines rebuilt since the last frame, never waits for one.
+    shaderManager->update(framePacer->getFrameValue(), framePacer->getCompletedValue());
+    for (const std::string &error : shaderManager->takeErrors())
+    {
+        std::cerr << "shader reload failed, " << error << std::endl;
+    }
+    // The levels streamed in go out with the uploads submitted below, this
+    // frame already samples them.
+    textureResidency->update(frameIndex, framePacer->getFrameValue(), framePacer->getCompletedValue());
+    if (textureStreamed)
     {
-        throw std::runtime_error("failed to acquire swap chain image!");
+        textureIndex = textureResidency->getBindlessIndex(streamedTexture);
     }
-    updateUniformBuffer(frameIndex);
+    commandRecorder->beginFrame(frameIndex);
+    gpuCuller->beginFrame(frameIndex);
+    frameArena->beginFrame(frameIndex);
+
+    // Headless, nothing is acquired. Slots sharing an offscreen image are
+    // ordered by its first barrier, from the color output stage as after an
+    // acquire.
+    uint32_t imageIndex = frameIndex % static_cast<uint32_t>(swapChainImages.size());
+    if (not headless)
+    {
+        std::chrono::steady_clock::time_point acquireStart = std::chrono::steady_clock::now();
+        auto [acquireResult, acquiredIndex] =
+            swapChain.acquireNextImage(UINT64_MAX, *presentCompleteSemaphores[frameIndex], nullptr);
+        cpuTimings.acquireWait = millisecondsSince(acquireStart);
+
+        if (acquireResult == vk::Result::eErrorOutOfDateKHR)
+        {
+            swapChainOutOfDate = true;
+            return;
+        }
 
-    device.resetFences(*inFlightFences[frameIndex]);
+        if (acquireResult != vk::Result::eSuccess && acquireResult != vk::Result::eSuboptimalKHR)
+        {
+            throw std::runtime_error("failed to acquire swap chain image!");
+        }
+        imageIndex = acquiredIndex;
+    }
+    // The simulation runs on the job system while this thread records. Its
+    // output is allocated up front so the draws can reference its address.
+    Graphics::FrameAllocation frameUniforms = frameArena->allocate(sizeof(UniformBufferObject));
+    frameUniformsAddress                    = frameUniforms.address;
+    // A fixed 60 Hz step headless, every benchmark run renders the same frames.
+    float time = headless ? static_cast<float>(framePacer->getFrameValue()) / 60.0f
+                          : std::chrono::duration<float>(std::chrono::steady_clock::now() - simulationStart).count();
+    std::byte      *instances  = instanceMapped + frameIndex * instanceStride;
+    Jobs::JobHandle simulation = jobSystem->schedule(
+        [this, frameUniforms, instances, time]() {
+            updateScene(instances, time);
+            updateUniformBuffer(frameUniforms.mapped, time);
+        },
+        {},
+        "Simulation");
+    allocator->publishStats();
+
+    // Streamed uploads go out first so their release barriers are submitted
+    // before the frame records the matching acquires. The frame only waits for
+    // them on the GPU, and not at all when nothing was uploaded.
+    uploadBatcher->submit();
+
+    std::chrono::steady_clock::time_point recordStart = std::chrono::steady_clock::now();
     commandBuffers[frameIndex].reset();
     recordCommandBuffer(imageIndex);
+    jobSystem->wait(simulation);
+    cpuTimings.record = millisecondsSince(recordStart);
+    // The profiler read the GPU timings of an older frame while recording.
+    if (gpuProfiler->getFrameValue() != gpuTimingsFrameValue)
+    {
+        gpuTimingsFrameValue = gpuProfiler->getFrameValue();
+        frameTimings.addGpu(gpuTimingsFrameValue, gpuProfiler->getTimings());
+        if (dynamicResolution && not gpuProfiler->getTimings().empty())
+        {
+            dynamicResolution->update(gpuProfiler->getTimings().front().milliseconds);
+        }
+    }
 
-    vk::PipelineStageFlags waitDestinationStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput);
-    const vk::SubmitInfo   submitInfo{.waitSemaphoreCount   = 1,
-                                      .pWaitSemaphores      = &*presentCompleteSemaphores[frameIndex],
-                                      .pWaitDstStageMask    = &waitDestinationStageMask,
-                                      .commandBufferCount   = 1,
-                                      .pCommandBuffers      = &*commandBuffers[frameIndex],
-                                      .signalSemaphoreCount = 1,
-                                      .pSignalSemaphores    = &*renderFinishedSemaphores[imageIndex]};
-    queue.submit(submitInfo, *inFlightFences[frameIndex]);
+    // The binary semaphores of the swapchain are left out headless.
+    std::array<vk::SemaphoreSubmitInfo, 3> waitSemaphoreInfos;
+    uint32_t                               waitSemaphoreCount = 0;
+    if (not headless)
+    {
+        waitSemaphoreInfos[waitSemaphoreCount++] = {.semaphore = *presentCompleteSemaphores[frameIndex],
+                                                    .stageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput};
+    }
+    if (uploadWaitValue > 0)
+    {
+        waitSemaphoreInfos[waitSemaphoreCount++] = {.semaphore = uploadBatcher->getSemaphore(),
+                                                    .value     = uploadWaitValue,
+                                                    .stageMask = vk::PipelineStageFlagBits2::eAllCommands};
+    }
+    if (queueFamilies.hasAsyncCompute())
+    {
+        // The culling reads the instances and the frustum the simulation
+        // wrote, it is submitted once the simulation completed.
+        vk::CommandBufferSubmitInfo cullCommandBufferInfo{.commandBuffer = *computeCommandBuffers[frameIndex]};
+        vk::SemaphoreSubmitInfo     cullSignalInfo{.semaphore = *cullSemaphore,
+                                                   .value     = framePacer->getFrameValue(),
+                                                   .stageMask = vk::PipelineStageFlagBits2::eAllCommands};
+        computeQueue.submit2(vk::SubmitInfo2{.commandBufferInfoCount   = 1,
+                                             .pCommandBufferInfos      = &cullCommandBufferInfo,
+                                             .signalSemaphoreInfoCount = 1,
+                                             .pSignalSemaphoreInfos    = &cullSignalInfo});
+        waitSemaphoreInfos[waitSemaphoreCount++] = {.semaphore = *cullSemaphore,
+                                                    .value     = framePacer->getFrameValue(),
+                                                    .stageMask = vk::PipelineStageFlagBits2::eDrawIndirect};
+    }
+    vk::CommandBufferSubmitInfo            commandBufferInfo{.commandBuffer = *commandBuffers[frameIndex]};
+    std::array<vk::SemaphoreSubmitInfo, 2> signalSemaphoreInfos;
+    uint32_t                               signalSemaphoreCount = 0;
+    signalSemaphoreInfos[signalSemaphoreCount++] = {.semaphore = framePacer->getSemaphore(),
+                                                    .value     = framePacer->getFrameValue(),
+                                                    .stageMask = vk::PipelineStageFlagBits2::eAllCommands};
+    if (not headless)
+    {
+        signalSemaphoreInfos[signalSemaphoreCount++] = {
+            .semaphore = *renderFinishedSemaphores[imageIndex],
+            .stageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput};
+    }
+    const vk::SubmitInfo2 submitInfo{.waitSemaphoreInfoCount   = waitSemaphoreCount,
+                                     .pWaitSemaphoreInfos      = waitSemaphoreInfos.data(),
+                                     .commandBufferInfoCount   = 1,
+                                     .pCommandBufferInfos      = &commandBufferInfo,
+                                     .signalSemaphoreInfoCount = signalSemaphoreCount,
+                                     .pSignalSemaphoreInfos    = signalSemaphoreInfos.data()};
+    uint64_t                              frameValue  = framePacer->getFrameValue();
+    std::chrono::steady_clock::time_point submitStart = std::chrono::steady_clock::now();
+    queue.submit2(submitInfo);
+    cpuTimings.submit = millisecondsSince(submitStart);
+    framePacer->endFrame();
+    if (headless)
+    {
+        frameTimings.addCpu(frameValue, cpuTimings);
+        FrameMark;
+        return;
+    }
 
     try
     {
-        const vk::PresentInfoKHR presentInfoKHR{.waitSemaphoreCount = 1,
+        uint64_t         presentId = presentPacer->beginPresent();
+        vk::PresentIdKHR presentIdInfo{.swapchainCount = 1, .pPresentIds = &presentId};
+        const void      *presentNext = presentId > 0 ? &presentIdInfo : nullptr;
+        // Signaled once the image is released, see Graphics::RetiredSwapchains.
+        vk::Fence                        presentFence = retiredSwapChains->beginPresent();
+        vk::SwapchainPresentFenceInfoEXT presentFenceInfo{.pNext          = presentNext,
+                                                          .swapchainCount = 1,
+                                                          .pFences        = &presentFence};
+        if (presentFence)
+        {
+            presentNext = &presentFenceInfo;
+        }
+        const vk::PresentInfoKHR presentInfoKHR{.pNext              = presentNext,
+                                                .waitSemaphoreCount = 1,
                                                 .pWaitSemaphores    = &*renderFinishedSemaphores[imageIndex],
                                                 .swapchainCount     = 1,
                                                 .pSwapchains        = &*swapChain,
                                                 .pImageIndices      = &imageIndex};
-        vk::Result               result = queue.presentKHR(presentInfoKHR);
-        if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || framebufferResized)
+        std::chrono::steady_clock::time_point presentStart = std::chrono::steady_clock::now();
+        vk::Result                            result       = queue.presentKHR(presentInfoKHR);
+        cpuTimings.present                                 = millisecondsSince(presentStart);
+        frameTimings.addCpu(frameValue, cpuTimings);
+        FrameMark;
+        if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR)
         {
-            framebufferResized = false;
-            recreateSwapChain();
+            swapChainOutOfDate = true;
         }
         else if (result != vk::Result::eSuccess)
         {
@@ -1140,7 +1884,7 @@ void HelloTriangleApplication::drawFrame()
     {
         if (e.code().value() == static_cast<int>(vk::Result::eErrorOutOfDateKHR))
         {
-            recreateSwapChain();
+            swapChainOutOfDate = true;
             return;
         }
         else
@@ -1148,14 +1892,122 @@ void HelloTriangleApplication::drawFrame()
             throw;
         }
     }
-    frameIndex = (frameIndex + 1) % MAX_FRAMES_IN_FLIGHT;
 }
 
-vk::raii::ShaderModule HelloTriangleApplication::createShaderModule(const std::vector<char> &code) const
+double HelloTriangleApplication::measureUploadThroughput()
+{
+    ZoneScoped;
+    // A fixed 256 MiB in 4 MiB uploads to a scratch buffer, batched whenever
+    // the staging ring fills up. Its ownership releases are never acquired,
+    // nothing draws with it.
+    constexpr vk::DeviceSize chunkSize   = 4ull * 1024 * 1024;
+    constexpr vk::DeviceSize scratchSize = 64ull * 1024 * 1024;
+    constexpr vk::DeviceSize totalSize   = 256ull * 1024 * 1024;
+
+    vk::raii::Buffer   scratch = nullptr;
+    Memory::Allocation scratchAllocation;
+    createBuffer(scratchSize,
+                 vk::BufferUsageFlagBits::eTransferDst,
+                 vk::MemoryPropertyFlagBits::eDeviceLocal,
+                 scratch,
+                 scratchAllocation);
+    std::vector<std::byte> chunk(chunkSize, std::byte{0xa5});
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (vk::DeviceSize offset = 0; offset < totalSize; offset += chunkSize)
+    {
+        uploadBatcher->uploadBuffer(*scratch, offset % scratchSize, chunk.data(), chunkSize);
+    }
+    uploadBatcher->wait(uploadBatcher->submit());
+    double seconds = millisecondsSince(start) / 1000.0;
+    return static_cast<double>(totalSize) / (1024.0 * 1024.0) / seconds;
+}
+
+double HelloTriangleApplication::measureDecodeThroughput()
+{
+    ZoneScoped;
+    // The startup texture, read and decoded again a few times per decode thread.
+    std::vector<std::string> filenames(std::max(decodePool->getThreadCount(), 1u) * 4, "texture.jpg");
+
+    std::chrono::steady_clock::time_point  start   = std::chrono::steady_clock::now();
+    std::vector<std::future<Images::Jpeg>> decodes = decodePool->decode(filenames);
+    size_t                                 bytes   = 0;
+    for (std::future<Images::Jpeg> &decode : decodes)
+    {
+        bytes += decode.get().getSize();
+    }
+    double seconds = millisecondsSince(start) / 1000.0;
+    return static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds;
+}
+
+void HelloTriangleApplication::reportBenchmark()
 {
     ZoneScoped;
-    vk::ShaderModuleCreateInfo createInfo{.codeSize = code.size() * sizeof(char),
-                                          .pCode    = reinterpret_cast<const uint32_t *>(code.data())};
+    double uploadThroughput = measureUploadThroughput();
+    double decodeThroughput = measureDecodeThroughput();
+
+    std::cout << std::format("Benchmark: {} frames at {}x{}, {} instances, {} frames in flight\n",
+                             benchmarkFrames,
+                             swapChainExtent.width,
+                             swapChainExtent.height,
+                             instanceCount,
+                             framesInFlight);
+    double startupTotal = 0.0;
+    for (const auto &[name, milliseconds] : startupPhases)
+    {
+        std::cout << std::format("  startup   {:<24} {:9.3f} ms\n", name, milliseconds);
+        startupTotal += milliseconds;
+    }
+    std::cout << std::format("  startup   {:<24} {:9.3f} ms\n", "total", startupTotal);
+
+    // Frame values start at 1, the warm-up frames are the first ones.
+    auto printPercentiles = [](const char *name, const Graphics::FrameTimePercentiles &percentiles) {
+        std::cout << std::format("  {:<9} p50 {:.3f} p90 {:.3f} p99 {:.3f} max {:.3f} ms over {} frames\n",
+                                 name,
+                                 percentiles.p50,
+                                 percentiles.p90,
+                                 percentiles.p99,
+                                 percentiles.max,
+                                 percentiles.frames);
+    };
+    printPercentiles("cpu frame",
+                     frameTimings.getCpuPercentiles(&Graphics::CpuFrameTimings::total, benchmark_warmup + 1));
+    printPercentiles("gpu frame", frameTimings.getGpuPercentiles(benchmark_warmup + 1));
+    if (dynamicResolution)
+    {
+        std::cout << std::format("  scale     {:.3f} for a {:.2f} ms target\n",
+                                 dynamicResolution->getScale(),
+                                 dynamicResolution->getTargetMilliseconds());
+    }
+    std::cout << std::format("  textures  {:.1f} MiB resident of a {:.1f} MiB budget\n",
+                             static_cast<double>(textureResidency->getResidentBytes()) / (1024.0 * 1024.0),
+                             static_cast<double>(textureResidency->getBudgetBytes()) / (1024.0 * 1024.0));
+    std::cout << std::format("  upload    {:.1f} MiB/s\n", uploadThroughput);
+    std::cout << std::format("  decode    {:.1f} MiB/s\n", decodeThroughput) << std::flush;
+}
+
+bool HelloTriangleApplication::hasAsset(const std::string &name) const
+{
+    return assetPack ? assetPack->contains(name) : std::filesystem::exists(name);
+}
+
+std::span<const std::byte> HelloTriangleApplication::loadAsset(const std::string           &name,
+                                                               Utils::Handlers::MappedFile &file,
+                                                               std::vector<std::byte>      &storage) const
+{
+    ZoneScoped;
+    if (assetPack)
+    {
+        return assetPack->get(name, storage);
+    }
+    file = Utils::Handlers::MappedFile(name);
+    return file.getBytes();
+}
+
+vk::raii::ShaderModule HelloTriangleApplication::createShaderModule(std::span<const uint32_t> code) const
+{
+    ZoneScoped;
+    vk::ShaderModuleCreateInfo createInfo{.codeSize = code.size_bytes(), .pCode = code.data()};
     vk::raii::ShaderModule     shaderModule{device, createInfo};
     return shaderModule;
 }
@@ -1190,15 +2042,12 @@ vk::PresentModeKHR HelloTriangleApplication::chooseSwapPresentMode(
     const std::vector<vk::PresentModeKHR> &availablePresentModes)
 {
     ZoneScoped;
-    // TODO: switch to ranges any_of ???
-    for (const auto &availablePresentMode : availablePresentModes)
-    {
-        if (availablePresentMode == vk::PresentModeKHR::eMailbox)
-        {
-            return availablePresentMode;
-        }
-    }
-    return vk::PresentModeKHR::eFifo;
+    vk::PresentModeKHR presentMode =
+        Graphics::PresentPacer::selectPresentMode(preferredPresentMode, availablePresentModes);
+#if defined(_DEBUG)
+    std::cout << "Present mode: " << vk::to_string(presentMode) << std::endl;
+#endif
+    return presentMode;
 }
 
 vk::Extent2D HelloTriangleApplication::chooseSwapExtent(const vk::SurfaceCapabilitiesKHR &capabilities)
@@ -1209,21 +2058,30 @@ vk::Extent2D HelloTriangleApplication::chooseSwapExtent(const vk::SurfaceCapabil
         return capabilities.currentExtent;
     }
 
-    SDL_Surface *sdl_surface = SDL_GetWindowSurface(window);
-    if (sdl_surface == nullptr)
+    // SDL_GetWindowSurface() would give the window a software framebuffer.
+    int width  = 0;
+    int height = 0;
+    if (not SDL_GetWindowSizeInPixels(window, &width, &height))
     {
-        throw std::runtime_error("Failed to get SDL window surface!");
+        throw SDLException("SDL_GetWindowSizeInPixels failed");
     }
 
-    return {
-        std::clamp<uint32_t>(sdl_surface->w, capabilities.minImageExtent.width, capabilities.maxImageExtent.width),
-        std::clamp<uint32_t>(sdl_surface->h, capabilities.minImageExtent.height, capabilities.maxImageExtent.height)};
+    return {std::clamp<uint32_t>(width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width),
+            std::clamp<uint32_t>(height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height)};
 }
 
 std::vector<const char *> HelloTriangleApplication::getRequiredExtensions()
 {
     ZoneScoped;
+    // Nothing is presented headless, no surface extension either.
     uint32_t sdlExtensionCount = 0;
+    if (headless)
+    {
+        std::vector<const char *> extensions;
+        if (enableValidationLayers)
+            extensions.push_back(vk::EXTDebugUtilsExtensionName);
+        return extensions;
+    }
     // return in Windows
     // - sdlExtensions[0] = VK_KHR_surface
     // - sdlExtensions[2] = VK_KHR_win32_surface
@@ -1270,3 +2128,38 @@ void HelloTriangleApplication::run()
     mainLoop();
     cleanup();
 }
+
+void HelloTriangleApplication::setTimingsOutput(const std::filesystem::path &path)
+{
+    timingsPath = path;
+}
+
+void HelloTriangleApplication::setHeadless(uint32_t frames)
+{
+    headless        = true;
+    benchmarkFrames = frames;
+    // Offscreen images only, the device doesn't need to present.
+    std::erase_if(requiredDeviceExtension,
+                  [](const char *extension) { return strcmp(extension, vk::KHRSwapchainExtensionName) == 0; });
+}
+
+void HelloTriangleApplication::setTargetFrameTime(double milliseconds)
+{
+    targetFrameTime = std::max(milliseconds, 0.0);
+}
+
+void HelloTriangleApplication::setFramesInFlight(uint32_t count)
+{
+    framesInFlight = std::clamp(count, 1u, Graphics::FramePacer::MAX_FRAMES_IN_FLIGHT);
+}
+
+void HelloTriangleApplication::setInstanceCount(uint32_t count)
+{
+    instanceCount = std::max(count, 1u);
+}
+
+void HelloTriangleApplication::setPresentMode(vk::PresentModeKHR mode)
+{
+    presentModeChanged   = presentModeChanged || mode != preferredPresentMode;
+    preferredPresentMode = mode;
+}
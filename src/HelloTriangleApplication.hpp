@@ -1,7 +1,14 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <span>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 // SDL headers
@@ -29,8 +36,34 @@ import vulkan_hpp;
 #endif
 #include <tracy/Tracy.hpp>
 
+#include "Assets/Pack.hpp"
 #include "Geometry/Vextex.hpp"
+#include "Graphics/BindlessTable.hpp"
+#include "Graphics/CommandRecorder.hpp"
+#include "Graphics/DynamicResolution.hpp"
+#include "Graphics/FrameArena.hpp"
+#include "Graphics/FrameGraph.hpp"
+#include "Graphics/FrameTimings.hpp"
+#include "Graphics/FramePacer.hpp"
+#include "Graphics/GpuCuller.hpp"
+#include "Graphics/GpuProfiler.hpp"
+#include "Graphics/MipGenerator.hpp"
+#include "Graphics/PipelineCache.hpp"
+#include "Graphics/PipelineCompiler.hpp"
+#include "Graphics/PresentPacer.hpp"
+#include "Graphics/Queues.hpp"
+#include "Graphics/RetiredSwapchains.hpp"
+#include "Graphics/ShaderManager.hpp"
+#include "Graphics/TextureResidency.hpp"
+#include "Graphics/UploadBatcher.hpp"
+#include "Images/DecodePool.hpp"
+#include "Jobs/JobSystem.hpp"
+#include "Memory/Allocator.hpp"
+#include "Memory/UploadPath.hpp"
+#include "Scene/Systems.hpp"
+#include "Scene/World.hpp"
 #include "Utils/Handlers.hpp"
+#include "Utils/MappedFile.hpp"
 
 const std::vector<char const *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
 
@@ -40,8 +73,6 @@ constexpr bool enableValidationLayers = true;
 constexpr bool enableValidationLayers = false;
 #endif
 
-constexpr int MAX_FRAMES_IN_FLIGHT = 2;
-
 const std::vector<Geometry::Vertex> vertices = {{{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
                                                 {{0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
                                                 {{0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f}},
@@ -61,6 +92,35 @@ struct UniformBufferObject
     alignas(16) glm::mat4 proj;
 };
 
+/**
+ * @brief Per-draw data of shader_base.slang, buffers by device address and
+ * resources by bindless index.
+ */
+struct DrawPushConstants
+{
+    vk::DeviceAddress frame;  // UniformBufferObject of the frame, in the frame arena
+    uint32_t          textureIndex;
+    uint32_t          samplerIndex;
+    vk::DeviceAddress feedback;  // Graphics::TextureResidency, 0 when the texture isn't streamed
+    uint32_t          feedbackIndex;
+};
+
+// [vk::constant_id] of shader_base.slang, see Graphics::Specialization.
+constexpr uint32_t SCENE_VERTEX_COLOR_CONSTANT = 0;
+
+/**
+ * @brief Vertex input of the scene pipeline: compact vertices, then the model
+ * matrix of each Graphics::GpuInstance read straight from the instance buffer.
+ * The culled indirect draws pass the instance index as firstInstance, which
+ * selects the element of the per-instance stream.
+ */
+using SceneVertexLayout =
+    Geometry::VertexLayout<Geometry::VertexStream<Geometry::CompactVertex>,
+                           Geometry::VertexStream<Geometry::InstanceTransform,
+                                                  vk::VertexInputRate::eInstance,
+                                                  sizeof(Graphics::GpuInstance)>>;
+static_assert(offsetof(Graphics::GpuInstance, model) == offsetof(Geometry::InstanceTransform, model));
+
 /**
  * @class SDLException
  * @brief Exception class for SDL-related errors.
@@ -94,6 +154,7 @@ class HelloTriangleApplication
         SDL_WINDOW_VULKAN | SDL_WINDOW_HIDDEN | SDL_WINDOW_HIGH_PIXEL_DENSITY | SDL_WINDOW_RESIZABLE;
 
     SDL_Window                      *window = nullptr;
+    std::unique_ptr<Jobs::JobSystem> jobSystem;  // outlives everything its jobs touch
     vk::raii::Context                context;
     vk::raii::Instance               instance       = nullptr;
     vk::raii::DebugUtilsMessengerEXT debugMessenger = nullptr;
@@ -101,47 +162,121 @@ class HelloTriangleApplication
     vk::raii::Device                 device         = nullptr; /* logicalDevice */
     uint32_t                         queueIndex     = ~0u;
     vk::raii::Queue                  queue          = nullptr;
+    Graphics::QueueFamilies          queueFamilies;
+    vk::raii::Queue                  transferQueue  = nullptr;
+    vk::raii::Queue                  computeQueue   = nullptr;
     vk::raii::SurfaceKHR             surface        = nullptr;
     vk::raii::SwapchainKHR           swapChain      = nullptr;
     std::vector<vk::Image>           swapChainImages;
     vk::SurfaceFormatKHR             swapChainSurfaceFormat;
     vk::Extent2D                     swapChainExtent;
+    vk::ImageUsageFlags              swapChainUsage;
     std::vector<vk::raii::ImageView> swapChainImageViews;
 
-    vk::raii::DescriptorSetLayout descriptorSetLayout = nullptr;
-    vk::raii::PipelineLayout      pipelineLayout      = nullptr;
-    vk::raii::Pipeline            graphicsPipeline    = nullptr;
-
-    vk::raii::Buffer       vertexBuffer       = nullptr;
-    vk::raii::DeviceMemory vertexBufferMemory = nullptr;
-    vk::raii::Buffer       indexBuffer        = nullptr;
-    vk::raii::DeviceMemory indexBufferMemory  = nullptr;
-
-    std::vector<vk::raii::Buffer>       uniformBuffers;
-    std::vector<vk::raii::DeviceMemory> uniformBuffersMemory;
-    std::vector<void *>                 uniformBuffersMapped;
-
-    vk::raii::DescriptorPool             descriptorPool = nullptr;
-    std::vector<vk::raii::DescriptorSet> descriptorSets;
+    std::unique_ptr<Graphics::PresentPacer> presentPacer;
+    vk::PresentModeKHR                      preferredPresentMode = vk::PresentModeKHR::eMailbox;
+    bool                                    presentModeChanged   = false;
+
+    std::unique_ptr<Graphics::RetiredSwapchains> retiredSwapChains;  // replaced swapchains still presenting
+    std::vector<vk::raii::Semaphore>             renderFinishedSemaphores;  // one per image of swapChain
+    bool                                         surfaceMaintenance = false;  // VK_EXT_surface_maintenance1
+    bool                                         swapChainOutOfDate = false;  // recreated before the next frame
+
+    std::unique_ptr<Memory::Allocator> allocator;
+    Memory::UploadCapabilities         uploadCapabilities;
+
+    std::unique_ptr<Graphics::UploadBatcher> uploadBatcher;
+    uint64_t                                 uploadWaitValue = 0;
+    std::unique_ptr<Graphics::MipGenerator>  mipGenerator;
+
+    std::unique_ptr<Graphics::PipelineCache>    pipelineCache;
+    std::unique_ptr<Graphics::PipelineCompiler> pipelineCompiler;
+    bool                                        pipelineLibraries = false;  // VK_EXT_graphics_pipeline_library
+
+    std::unique_ptr<Graphics::BindlessTable> bindlessTable;
+    vk::raii::PipelineLayout                 pipelineLayout = nullptr;
+    std::unique_ptr<Graphics::ShaderManager> shaderManager;  // owns the pipelines, rebuilt on shader edits
+    Graphics::ShaderManager::PipelineId      scenePipeline   = 0;
+    bool                                     vertexColorTint = false;  // fragMain specialization
+
+    vk::raii::Buffer   vertexBuffer           = nullptr;
+    Memory::Allocation vertexBufferAllocation = nullptr;
+    vk::raii::Buffer   indexBuffer            = nullptr;
+    Memory::Allocation indexBufferAllocation  = nullptr;
+
+    std::unique_ptr<Graphics::GpuCuller> gpuCuller;
+    // With async compute the culling is submitted to computeQueue, signaling
+    // cullSemaphore with the frame value. Unused otherwise.
+    vk::raii::CommandPool                computeCommandPool       = nullptr;
+    std::vector<vk::raii::CommandBuffer> computeCommandBuffers;  // one per frame slot
+    vk::raii::Semaphore                  cullSemaphore            = nullptr;
+    vk::raii::Buffer                     instanceBuffer           = nullptr;
+    Memory::Allocation                   instanceBufferAllocation = nullptr;
+    std::byte                           *instanceMapped           = nullptr;
+    vk::DeviceSize                       instanceStride           = 0;  // region of a frame slot
+    uint32_t                             instanceCount            = 1;
+    Scene::World                         scene;  // packed into the instance buffer every frame
+
+    std::unique_ptr<Graphics::FrameArena> frameArena;
+    vk::DeviceAddress                     frameUniformsAddress = 0;  // UniformBufferObject of the frame
+
+    vk::raii::CommandPool                      commandPool = nullptr;
+    std::vector<vk::raii::CommandBuffer>       commandBuffers;
+    std::unique_ptr<Graphics::CommandRecorder> commandRecorder;
+
+    std::unique_ptr<Graphics::FrameGraph> frameGraph;  // owns the attachments
+
+    // Null when the scene renders straight into the swapchain images.
+    std::unique_ptr<Graphics::DynamicResolution> dynamicResolution;
+    double                                       targetFrameTime = 0.0;  // GPU milliseconds, 0 disables scaling
+
+    std::unique_ptr<Graphics::GpuProfiler> gpuProfiler;
+    Graphics::FrameTimings                 frameTimings;
+    uint64_t                               gpuTimingsFrameValue = 0;  // last frame given to frameTimings
+    std::chrono::steady_clock::time_point  frameStart;
+    std::filesystem::path                  timingsPath;  // empty when not exported
+
+    std::unique_ptr<Assets::Pack>       assetPack;  // null when the built assets are loose files
+    std::unique_ptr<Images::DecodePool> decodePool;
+    std::future<Images::Jpeg>           textureDecode;  // invalid while the cooked texture is used
+
+    // The cooked texture streams its levels from the asset bytes, kept mapped.
+    Utils::Handlers::MappedFile                 textureFile;
+    std::vector<std::byte>                      textureStorage;  // when the pack entry is compressed
+    std::unique_ptr<Graphics::TextureResidency> textureResidency;
+    Graphics::TextureResidency::TextureId       streamedTexture = 0;
+    bool                                        textureStreamed = false;
+    bool                                        memoryBudget    = false;  // VK_EXT_memory_budget
+
+    vk::raii::Image     textureImage           = nullptr;
+    Memory::Allocation  textureImageAllocation = nullptr;
+    vk::Format          textureFormat          = vk::Format::eR8G8B8A8Srgb;
+    uint32_t            textureMipLevels       = 1;
+    vk::ImageLayout     textureImageLayout     = vk::ImageLayout::eShaderReadOnlyOptimal;
+    vk::raii::ImageView textureImageView       = nullptr;
+    vk::raii::Sampler   textureSampler         = nullptr;
+    uint32_t            textureIndex           = 0;  // in the bindless table
+    uint32_t            samplerIndex           = 0;
+
+    std::unique_ptr<Graphics::FramePacer> framePacer;
+    uint32_t                              framesInFlight = Graphics::FramePacer::DEFAULT_FRAMES_IN_FLIGHT;
+    uint32_t                              frameIndex     = 0;  // slot of the frame being recorded
+    std::vector<vk::raii::Semaphore>      presentCompleteSemaphores;
 
-    vk::raii::CommandPool                commandPool = nullptr;
-    std::vector<vk::raii::CommandBuffer> commandBuffers;
-
-    vk::raii::Image        depthImage       = nullptr;
-    vk::raii::DeviceMemory depthImageMemory = nullptr;
-    vk::raii::ImageView    depthImageView   = nullptr;
-
-    vk::raii::Image        textureImage       = nullptr;
-    vk::raii::DeviceMemory textureImageMemory = nullptr;
-    vk::raii::ImageView    textureImageView   = nullptr;
-    vk::raii::Sampler      textureSampler     = nullptr;
+    bool framebufferResized = false;
 
-    std::vector<vk::raii::Semaphore> presentCompleteSemaphores;
-    std::vector<vk::raii::Semaphore> renderFinishedSemaphores;
-    std::vector<vk::raii::Fence>     inFlightFences;
-    uint32_t                         frameIndex = 0;
+    // Headless benchmark, see setHeadless(). The offscreen images stand in
+    // for the swapchain ones, at a fixed extent.
+    static constexpr vk::Extent2D headless_extent      = {1920, 1080};
+    static constexpr uint32_t     headless_image_count = 3;
+    static constexpr uint32_t     benchmark_warmup     = 60;  // frames left out of the percentiles
 
-    bool framebufferResized = false;
+    bool                                         headless        = false;
+    uint32_t                                     benchmarkFrames = 0;
+    std::vector<vk::raii::Image>                 offscreenImages;
+    std::vector<Memory::Allocation>              offscreenAllocations;
+    std::chrono::steady_clock::time_point        simulationStart;
+    std::vector<std::pair<const char *, double>> startupPhases;  // initVulkan steps, in milliseconds
 
     std::vector<const char *> requiredDeviceExtension = {
         vk::KHRSwapchainExtensionName,
@@ -155,6 +290,7 @@ class HelloTriangleApplication
    private:
     void initWindow();
     void initVulkan();
+    void runStartupPhase(const char *name, void (HelloTriangleApplication::*create)());
     void mainLoop();
     void cleanup();
     void createInstance();
@@ -162,14 +298,31 @@ class HelloTriangleApplication
     void createSurface();
     void pickPhysicalDevice();
     void createLogicalDevice();
+    void createAllocator();
+    void createPipelineCache();
+    void createFramePacer();
     void cleanupSwapChain();
     void recreateSwapChain();
     void createSwapChain();
+    void createOffscreenTarget();
     void createImageViews();
-    void createDescriptorSetLayout();
+    void createDynamicResolution();
+    void createBindlessTable();
+    void createShaderManager();
     void createGraphicsPipeline();
+    void describeScenePipeline(std::span<const uint32_t>                           spirv,
+                               const Graphics::RenderingFormats                    &formats,
+                               const Graphics::PipelineCompiler::CreateInfoVisitor &visit) const;
+    /**
+     * @brief Scene pipeline builder for the current attachment formats.
+     */
+    Graphics::ShaderManager::PipelineBuilder getScenePipelineBuilder();
+    void createGpuCuller();
     void createCommandPool();
-    void createDepthResources();
+    void createUploadBatcher();
+    void createGpuProfiler();
+    void createFrameGraph();
+    void createTextureResidency();
 
     vk::Format findSupportedFormat(const std::vector<vk::Format> &candidates,
                                    vk::ImageTiling                tiling,
@@ -179,52 +332,87 @@ class HelloTriangleApplication
 
     bool hasStencileComponent(vk::Format format);
     void createTextureImage();
-    void createImage(uint32_t                width,
-                     uint32_t                height,
-                     vk::Format              format,
-                     vk::ImageTiling         tiling,
-                     vk::ImageUsageFlags     usage,
-                     vk::MemoryPropertyFlags properties,
-                     vk::raii::Image        &image,
-                     vk::raii::DeviceMemory &imageMemory);
-
-    vk::raii::CommandBuffer beginSimgleTimeCommands();
-
-    void endSingleTimeCommands(vk::raii::CommandBuffer &commandBuffer);
-    void transitionImageLayout(const vk::raii::Image &image, vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
-    void copyBufferToImage(const vk::raii::Buffer &buffer, vk::raii::Image &image, uint32_t width, uint32_t height);
+    bool createCompressedTextureImage(const std::string &filename);
+    void createImage(uint32_t                   width,
+                     uint32_t                   height,
+                     vk::Format                 format,
+                     vk::ImageTiling            tiling,
+                     vk::ImageUsageFlags        usage,
+                     vk::MemoryPropertyFlags    properties,
+                     vk::raii::Image           &image,
+                     Memory::Allocation        &imageAllocation,
+                     uint32_t                   mipLevels = 1,
+                     Memory::AllocationStrategy strategy  = Memory::AllocationStrategy::eDefault);
+
     void createTextureImageView();
 
-    vk::raii::ImageView createImageView(vk::raii::Image &image, vk::Format format, vk::ImageAspectFlags aspectFlags);
+    vk::raii::ImageView createImageView(vk::raii::Image     &image,
+                                        vk::Format           format,
+                                        vk::ImageAspectFlags aspectFlags,
+                                        uint32_t             mipLevels = 1);
 
     void     createTextureSampler();
+    void     createDeviceLocalBuffer(const void          *data,
+                                     vk::DeviceSize       size,
+                                     vk::BufferUsageFlags usage,
+                                     vk::raii::Buffer    &buffer,
+                                     Memory::Allocation  &bufferAllocation);
     void     createVertexBuffer();
     void     createIndexBuffer();
-    void     createUniformBuffers();
-    void     createDescriptorPool();
-    void     createDescriptorSets();
-    void     copyBuffer(vk::raii::Buffer &srcBuffer, vk::raii::Buffer &dstBuffer, vk::DeviceSize size);
-    void     createBuffer(vk::DeviceSize          size,
-                          vk::BufferUsageFlags    usage,
-                          vk::MemoryPropertyFlags properties,
-                          vk::raii::Buffer       &buffer,
-                          vk::raii::DeviceMemory &bufferMemory);
-    uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
+    void     createScene();
+    void     createInstanceBuffer();
+    void     createFrameArena();
+    void     createBuffer(vk::DeviceSize             size,
+                          vk::BufferUsageFlags       usage,
+                          vk::MemoryPropertyFlags    properties,
+                          vk::raii::Buffer          &buffer,
+                          Memory::Allocation        &bufferAllocation,
+                          Memory::AllocationStrategy strategy = Memory::AllocationStrategy::eDefault);
     void     createCommandBuffers();
     void     recordCommandBuffer(uint32_t imageIndex);
-    void     transition_image_layout(vk::Image               image,
-                                     vk::ImageLayout         oldLayout,
-                                     vk::ImageLayout         newLayout,
-                                     vk::AccessFlags2        srcAccessMask,
-                                     vk::AccessFlags2        dstAccessMask,
-                                     vk::PipelineStageFlags2 srcStageMask,
-                                     vk::PipelineStageFlags2 dstStageMask,
-                                     vk::ImageAspectFlags    image_aspect_flags);
+    void     recordScenePass(const vk::raii::CommandBuffer &commandBuffer,
+                             vk::ImageView                  colorView,
+                             vk::ImageView                  depthView,
+                             vk::Extent2D                   extent);
+    /**
+     * @brief Stretch the top left sourceExtent of source over the whole
+     * destination swapchain image.
+     */
+    void     recordUpscalePass(const vk::raii::CommandBuffer &commandBuffer,
+                               vk::Image                      source,
+                               vk::Extent2D                   sourceExtent,
+                               vk::Image                      destination);
     void     createSyncObjects();
-    void     updateUniformBuffer(uint32_t currentImage);
+    void     createFrameResources();
+    /**
+     * @brief Run the scene systems and pack the instances to the region of
+     * the frame slot.
+     */
+    void     updateScene(std::byte *instances, float time);
+    void     updateUniformBuffer(void *destination, float time);
     void     drawFrame();
 
-    [[nodiscard]] vk::raii::ShaderModule createShaderModule(const std::vector<char> &code) const;
+    /**
+     * @brief MiB per second through the upload batcher, staging writes
+     * included. Only once no frame will record acquires anymore.
+     */
+    double measureUploadThroughput();
+    /**
+     * @brief MiB of decoded texels per second, every decode thread busy.
+     */
+    double measureDecodeThroughput();
+    void   reportBenchmark();
+
+    [[nodiscard]] vk::raii::ShaderModule createShaderModule(std::span<const uint32_t> code) const;
+
+    bool hasAsset(const std::string &name) const;
+    /**
+     * @brief A built asset from the pack when there is one, viewed in place or
+     * decompressed into storage, else the loose file mapped into file.
+     */
+    std::span<const std::byte> loadAsset(const std::string           &name,
+                                         Utils::Handlers::MappedFile &file,
+                                         std::vector<std::byte>      &storage) const;
 
     static uint32_t           calculateMinImageCount(const vk::SurfaceCapabilitiesKHR &surfaceCapabilities);
     vk::SurfaceFormatKHR      chooseSwapSurfaceFormat(const std::vector<vk::SurfaceFormatKHR> &availableFormats);
@@ -241,4 +429,44 @@ class HelloTriangleApplication
 
    public:
     void run();
+
+    /**
+     * @brief Frames the CPU may record ahead of the GPU, clamped to
+     * [1, FramePacer::MAX_FRAMES_IN_FLIGHT]. Takes effect on the next frame.
+     */
+    void setFramesInFlight(uint32_t count);
+
+    /**
+     * @brief Object instances drawn, scene entities laid out on a grid and
+     * culled on the GPU. Must be set before run().
+     */
+    void setInstanceCount(uint32_t count);
+
+    /**
+     * @brief Preferred present mode, see PresentPacer::selectPresentMode() for
+     * the fallbacks. Recreates the swapchain after the next present.
+     */
+    void setPresentMode(vk::PresentModeKHR mode);
+
+    /**
+     * @brief Write the timings of the last frames there on exit, JSON for a
+     * .json extension and CSV otherwise.
+     */
+    void setTimingsOutput(const std::filesystem::path &path);
+
+    /**
+     * @brief Render frames offscreen without a window, then print the frame
+     * time percentiles, the upload and decode throughputs and the startup
+     * phases. The simulation advances at a fixed step, every run renders the
+     * same frames. Percentiles cover at most the last FrameTimings::HISTORY
+     * frames. Must be set before run().
+     */
+    void setHeadless(uint32_t frames);
+
+    /**
+     * @brief Render the scene at the resolution that holds this GPU frame
+     * time, then upscale it to the swapchain. 0 renders at the swapchain
+     * resolution. Must be set before run().
+     */
+    void setTargetFrameTime(double milliseconds);
 };
\ No newline at end of file
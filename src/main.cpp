@@ -2,7 +2,9 @@
 // SPDX-License-Identifier: MIT
 // main.cpp
 
+#include <cstdlib>
 #include <iostream>
+#include <string>
 
 // Tracy
 #if defined(__clang__) || defined(__GNUC__)
@@ -14,13 +16,48 @@
 
 #include "HelloTriangleApplication.hpp"
 
-int main()
+int main(int argc, char **argv)
 {
-#if defined(_DEBUG) && defined(TRACY_ENABLE)
+    // A no-op unless built with TRACY_ENABLE, release builds included.
     ZoneScoped;
-#endif
     HelloTriangleApplication app;
 
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (argument == "--frames-in-flight" && i + 1 < argc)
+        {
+            app.setFramesInFlight(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (argument == "--instances" && i + 1 < argc)
+        {
+            app.setInstanceCount(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (argument == "--headless" && i + 1 < argc)
+        {
+            app.setHeadless(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (argument == "--target-frame-time" && i + 1 < argc)
+        {
+            app.setTargetFrameTime(std::strtod(argv[++i], nullptr));
+        }
+        else if (argument == "--timings" && i + 1 < argc)
+        {
+            app.setTimingsOutput(argv[++i]);
+        }
+        else if (argument == "--present-mode" && i + 1 < argc)
+        {
+            auto presentMode = Graphics::PresentPacer::parsePresentMode(argv[++i]);
+            if (not presentMode)
+            {
+                std::cerr << "unknown present mode " << argv[i] << ", expected immediate, mailbox, fifo or fifo-relaxed"
+                          << std::endl;
+                return EXIT_FAILURE;
+            }
+            app.setPresentMode(*presentMode);
+        }
+    }
+
     try
     {
         app.run();
@@ -0,0 +1,91 @@
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "Assets/Lz4.hpp"
+
+namespace {
+
+std::vector<std::byte> randomBytes(size_t size, uint32_t seed)
+{
+    std::mt19937           random(seed);
+    std::vector<std::byte> bytes(size);
+    for (std::byte &byte : bytes)
+    {
+        byte = static_cast<std::byte>(random() & 0xFF);
+    }
+    return bytes;
+}
+
+std::vector<std::byte> roundTrip(const std::vector<std::byte> &source)
+{
+    std::vector<std::byte> compressed = Assets::Lz4::compress(source);
+    CHECK(compressed.size() <= Assets::Lz4::getMaxCompressedSize(source.size()));
+    std::vector<std::byte> decompressed(source.size());
+    Assets::Lz4::decompress(compressed, decompressed);
+    return decompressed;
+}
+
+}  // namespace
+
+TEST_CASE("Lz4 round trips short inputs as literals")
+{
+    for (size_t size : {0, 1, 5, 12, 13})
+    {
+        std::vector<std::byte> source = randomBytes(size, static_cast<uint32_t>(size));
+        CHECK(roundTrip(source) == source);
+    }
+}
+
+TEST_CASE("Lz4 compresses repetitive data")
+{
+    std::vector<std::byte> source(64 * 1024);
+    for (size_t i = 0; i < source.size(); i++)
+    {
+        source[i] = static_cast<std::byte>(i % 7);
+    }
+    CHECK(Assets::Lz4::compress(source).size() < source.size() / 10);
+    CHECK(roundTrip(source) == source);
+}
+
+TEST_CASE("Lz4 round trips long literal runs and long matches")
+{
+    // Incompressible runs need extra literal length bytes, the zeros extra
+    // match length bytes.
+    std::vector<std::byte> source = randomBytes(1000, 1);
+    source.resize(source.size() + 5000, std::byte{0});
+    std::vector<std::byte> tail = randomBytes(3000, 2);
+    source.insert(source.end(), tail.begin(), tail.end());
+    CHECK(roundTrip(source) == source);
+}
+
+TEST_CASE("Lz4 keeps incompressible data within the bound")
+{
+    std::vector<std::byte> source = randomBytes(100 * 1024, 3);
+    CHECK(roundTrip(source) == source);
+}
+
+TEST_CASE("Lz4 rejects corrupted blocks")
+{
+    std::vector<std::byte> source(4096, std::byte{42});
+    std::vector<std::byte> compressed = Assets::Lz4::compress(source);
+
+    std::vector<std::byte> tooSmall(source.size() - 1);
+    CHECK_THROWS_AS(Assets::Lz4::decompress(compressed, tooSmall), std::runtime_error);
+
+    std::vector<std::byte> tooBig(source.size() + 1);
+    CHECK_THROWS_AS(Assets::Lz4::decompress(compressed, tooBig), std::runtime_error);
+
+    std::vector<std::byte> truncated(compressed.begin(), compressed.begin() + 2);
+    std::vector<std::byte> destination(source.size());
+    CHECK_THROWS_AS(Assets::Lz4::decompress(truncated, destination), std::runtime_error);
+
+    // A match reaching before the start of the output.
+    std::vector<std::byte> badOffset = {std::byte{0x10}, std::byte{1}, std::byte{2}, std::byte{0}};
+    std::vector<std::byte> output(5);
+    CHECK_THROWS_AS(Assets::Lz4::decompress(badOffset, output), std::runtime_error);
+}
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "Assets/Pack.hpp"
+
+namespace {
+
+constexpr uint32_t CHUNK_SIZE = 1024;
+
+std::filesystem::path getTestDirectory()
+{
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "aether-pack-tests";
+    std::filesystem::create_directories(directory);
+    return directory;
+}
+
+std::string writeFile(const std::string &name, const std::vector<std::byte> &bytes)
+{
+    std::filesystem::path path = getTestDirectory() / name;
+    std::ofstream         out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return path.string();
+}
+
+std::vector<std::byte> randomBytes(size_t size, uint32_t seed)
+{
+    std::mt19937           random(seed);
+    std::vector<std::byte> bytes(size);
+    for (std::byte &byte : bytes)
+    {
+        byte = static_cast<std::byte>(random() & 0xFF);
+    }
+    return bytes;
+}
+
+std::vector<std::byte> patternBytes(size_t size)
+{
+    std::vector<std::byte> bytes(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        bytes[i] = static_cast<std::byte>(i / 16 % 5);
+    }
+    return bytes;
+}
+
+bool equals(std::span<const std::byte> a, const std::vector<std::byte> &b)
+{
+    return std::equal(a.begin(), a.end(), b.begin(), b.end());
+}
+
+// Copy of the pack with a 32 bit field overwritten, at offset from the start of the file.
+std::string patchPack(const std::string &filename, const std::string &name, size_t offset, uint32_t value)
+{
+    std::ifstream          in(filename, std::ios::binary);
+    std::vector<std::byte> bytes(std::filesystem::file_size(filename));
+    in.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    std::memcpy(bytes.data() + offset, &value, sizeof(value));
+    return writeFile(name, bytes);
+}
+
+}  // namespace
+
+TEST_CASE("Pack round trips stored and compressed entries")
+{
+    // Compressible chunks, then incompressible ones stored inside an LZ4 entry.
+    std::vector<std::byte> texture = randomBytes(3000, 1);
+    std::vector<std::byte> mesh    = patternBytes(5 * CHUNK_SIZE + 100);
+    std::vector<std::byte> mixed   = patternBytes(2 * CHUNK_SIZE);
+    std::vector<std::byte> noise   = randomBytes(2 * CHUNK_SIZE, 2);
+    mixed.insert(mixed.end(), noise.begin(), noise.end());
+
+    std::vector<Assets::Pack::Source> sources = {
+        {.name = "texture.ktx2", .path = writeFile("texture.ktx2", texture), .compression = Assets::Compression::eNone},
+        {.name = "mesh.amesh", .path = writeFile("mesh.amesh", mesh), .compression = Assets::Compression::eLz4},
+        {.name = "mixed.bin", .path = writeFile("mixed.bin", mixed), .compression = Assets::Compression::eLz4},
+        {.name = "empty.bin", .path = writeFile("empty.bin", {}), .compression = Assets::Compression::eNone}};
+    std::string filename = (getTestDirectory() / "round-trip.apak").string();
+    Assets::Pack::write(filename, sources, CHUNK_SIZE);
+
+    Assets::Pack pack(filename);
+    CHECK(pack.getEntryCount() == sources.size());
+    CHECK(pack.getChunkSize() == CHUNK_SIZE);
+    CHECK(pack.contains("mesh.amesh"));
+    CHECK_FALSE(pack.contains("missing.bin"));
+    CHECK(pack.getSize("mesh.amesh") == mesh.size());
+
+    // Stored entries are viewed in place, aligned.
+    std::span<const std::byte> view = pack.view("texture.ktx2");
+    CHECK(equals(view, texture));
+    CHECK(reinterpret_cast<uintptr_t>(view.data()) % Assets::Pack::PAYLOAD_ALIGNMENT == 0);
+    CHECK(pack.view("empty.bin").empty());
+    CHECK_THROWS_AS(pack.view("mesh.amesh"), std::runtime_error);
+
+    std::vector<std::byte> storage;
+    CHECK(equals(pack.get("mesh.amesh", storage), mesh));
+    CHECK(equals(pack.get("mixed.bin", storage), mixed));
+    CHECK(equals(pack.get("texture.ktx2", storage), texture));
+
+    // Chunks decompress independently, in any order.
+    const Assets::Pack::Entry &entry = pack.getEntry(*pack.find("mesh.amesh"));
+    CHECK(entry.chunkCount == 6);
+    std::vector<std::byte> chunked(entry.size);
+    for (uint32_t chunk = entry.chunkCount; chunk-- > 0;)
+    {
+        pack.readChunk(entry, chunk, chunked);
+    }
+    CHECK(chunked == mesh);
+
+    std::vector<std::byte> wrongSize(mesh.size() + 1);
+    CHECK_THROWS_AS(pack.read("mesh.amesh", wrongSize), std::runtime_error);
+    CHECK_THROWS_AS(pack.getSize("missing.bin"), std::runtime_error);
+}
+
+TEST_CASE("Pack rejects invalid inputs")
+{
+    std::string path = writeFile("duplicate.bin", randomBytes(100, 3));
+    std::vector<Assets::Pack::Source> duplicates = {{.name = "a", .path = path}, {.name = "a", .path = path}};
+    std::string                       filename   = (getTestDirectory() / "invalid.apak").string();
+    CHECK_THROWS_AS(Assets::Pack::write(filename, duplicates), std::runtime_error);
+
+    std::vector<Assets::Pack::Source> sources = {{.name = "a", .path = path}};
+    CHECK_THROWS_AS(Assets::Pack::write(filename, sources, 0), std::runtime_error);
+
+    CHECK_THROWS_AS(Assets::Pack(writeFile("not-a-pack.apak", randomBytes(256, 4))), std::runtime_error);
+}
+
+TEST_CASE("Pack rejects corrupted tables")
+{
+    // One entry of three LZ4 chunks: the entry follows the 56 byte header, its
+    // chunks follow it.
+    std::vector<Assets::Pack::Source> sources = {
+        {.name        = "mesh.amesh",
+         .path        = writeFile("corrupted.amesh", patternBytes(3 * CHUNK_SIZE)),
+         .compression = Assets::Compression::eLz4}};
+    std::string filename = (getTestDirectory() / "valid.apak").string();
+    Assets::Pack::write(filename, sources, CHUNK_SIZE);
+    CHECK(Assets::Pack(filename).getEntry(0).chunkCount == 3);
+
+    constexpr size_t chunkSizeField  = 16;
+    constexpr size_t chunkCountField = 56 + 28;
+    constexpr size_t storedSizeField = 56 + 32 + 8;
+    CHECK_THROWS_AS(Assets::Pack(patchPack(filename, "no-chunk-size.apak", chunkSizeField, 0)), std::runtime_error);
+    CHECK_THROWS_AS(Assets::Pack(patchPack(filename, "chunk-count.apak", chunkCountField, 2)), std::runtime_error);
+    CHECK_THROWS_AS(Assets::Pack(patchPack(filename, "stored-size.apak", storedSizeField, UINT32_MAX)),
+                    std::runtime_error);
+}
@@ -0,0 +1,89 @@
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "Graphics/DeletionQueue.hpp"
+
+namespace {
+
+/**
+ * Records its id in log when destroyed, like a vk::raii handle it is move only.
+ */
+class Tracked
+{
+    std::vector<int> *log;
+    int               id;
+
+   public:
+    Tracked(std::vector<int> &log, int id) : log(&log), id(id) {}
+    Tracked(Tracked &&other) noexcept : log(std::exchange(other.log, nullptr)), id(other.id) {}
+    Tracked(const Tracked &) = delete;
+    ~Tracked()
+    {
+        if (log)
+        {
+            log->push_back(id);
+        }
+    }
+};
+
+}  // namespace
+
+TEST_CASE("DeletionQueue frees batches once their value completed")
+{
+    std::vector<int>        log;
+    Graphics::DeletionQueue queue;
+    CHECK(queue.isEmpty());
+
+    queue.retire(1, Tracked(log, 1), Tracked(log, 2));
+    queue.retire(2, Tracked(log, 3));
+    queue.retire(4, Tracked(log, 4));
+    CHECK(queue.getPendingCount() == 4);
+    CHECK(log.empty());
+
+    queue.collect(0);
+    CHECK(log.empty());
+
+    // Batches go in value order, resources in retirement order.
+    queue.collect(2);
+    CHECK(log == std::vector<int>{1, 2, 3});
+    CHECK(queue.getPendingCount() == 1);
+
+    queue.collect(3);
+    CHECK(log.size() == 3);
+    queue.collect(4);
+    CHECK(log == std::vector<int>{1, 2, 3, 4});
+    CHECK(queue.isEmpty());
+    CHECK(queue.getPendingCount() == 0);
+}
+
+TEST_CASE("DeletionQueue keeps an older value with the latest batch")
+{
+    std::vector<int>        log;
+    Graphics::DeletionQueue queue;
+    queue.retire(5, Tracked(log, 1));
+    queue.retire(3, Tracked(log, 2));
+
+    queue.collect(3);
+    CHECK(log.empty());
+    queue.collect(5);
+    CHECK(log == std::vector<int>{1, 2});
+}
+
+TEST_CASE("DeletionQueue flush and destruction free everything")
+{
+    std::vector<int> log;
+    {
+        Graphics::DeletionQueue queue;
+        queue.retire(10, Tracked(log, 1));
+        queue.retire(20, Tracked(log, 2));
+        queue.flush();
+        CHECK(log == std::vector<int>{1, 2});
+        CHECK(queue.isEmpty());
+
+        queue.retire(30, Tracked(log, 3));
+    }
+    CHECK(log == std::vector<int>{1, 2, 3});
+}
@@ -0,0 +1,71 @@
+#include <cstdint>
+
+#include <doctest/doctest.h>
+
+#include "Graphics/DynamicResolution.hpp"
+
+namespace {
+
+/**
+ * Feed the frame times of a GPU whose cost follows the square of the scale.
+ */
+void simulate(Graphics::DynamicResolution &resolution, double fullScaleMilliseconds, uint32_t frameCount)
+{
+    for (uint32_t frame = 0; frame < frameCount; frame++)
+    {
+        double scale = resolution.getScale();
+        resolution.update(fullScaleMilliseconds * scale * scale);
+    }
+}
+
+}  // namespace
+
+TEST_CASE("DynamicResolution starts at the highest scale and holds it under budget")
+{
+    Graphics::DynamicResolution resolution(16.0, 0.5f, 1.0f);
+    CHECK(resolution.getScale() == 1.0f);
+    simulate(resolution, 10.0, 100);
+    CHECK(resolution.getScale() == 1.0f);
+}
+
+TEST_CASE("DynamicResolution scales down to the budget")
+{
+    Graphics::DynamicResolution resolution(16.0, 0.25f, 1.0f);
+    simulate(resolution, 32.0, 200);
+    float scale = resolution.getScale();
+    CHECK(scale < 1.0f);
+    CHECK(32.0 * scale * scale <= 16.0);
+    // The headroom keeps it from oscillating around the target.
+    CHECK(32.0 * scale * scale >= 16.0 * (1.0 - Graphics::DynamicResolution::HEADROOM));
+
+    // A multiple of the step, so the render area doesn't drift.
+    float steps = scale / Graphics::DynamicResolution::SCALE_STEP;
+    CHECK(steps == static_cast<float>(static_cast<uint32_t>(steps)));
+
+    simulate(resolution, 32.0, 200);
+    CHECK(resolution.getScale() == scale);
+}
+
+TEST_CASE("DynamicResolution stays within its scale range")
+{
+    Graphics::DynamicResolution resolution(16.0, 0.5f, 0.75f);
+    CHECK(resolution.getScale() == 0.75f);
+    simulate(resolution, 1000.0, 200);
+    CHECK(resolution.getScale() == 0.5f);
+
+    // Back to an easy load, it goes up to the highest scale again.
+    simulate(resolution, 1.0, 200);
+    CHECK(resolution.getScale() == 0.75f);
+}
+
+TEST_CASE("DynamicResolution render extent")
+{
+    Graphics::DynamicResolution resolution(16.0, 0.5f, 0.5f);
+    vk::Extent2D                extent = resolution.getRenderExtent({1920, 1080});
+    CHECK(extent.width == 960);
+    CHECK(extent.height == 540);
+
+    extent = resolution.getRenderExtent({1, 1});
+    CHECK(extent.width == 1);
+    CHECK(extent.height == 1);
+}
@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "Images/Bc7.hpp"
+
+namespace {
+
+using Texels = std::array<uint8_t, 64>;
+
+/**
+ * Mode 6 decoder, the only mode the encoder writes.
+ */
+Texels decodeBlock(const uint8_t *block)
+{
+    uint32_t position = 0;
+    auto     read     = [&](uint32_t bitCount) {
+        uint32_t value = 0;
+        for (uint32_t bit = 0; bit < bitCount; bit++, position++)
+        {
+            value |= ((block[position / 8] >> (position % 8)) & 1u) << bit;
+        }
+        return value;
+    };
+    REQUIRE(read(7) == 1u << 6);
+
+    std::array<std::array<uint32_t, 4>, 2> endpoints;
+    for (size_t c = 0; c < 4; c++)
+    {
+        endpoints[0][c] = read(7) << 1;
+        endpoints[1][c] = read(7) << 1;
+    }
+    uint32_t pbits[2] = {read(1), read(1)};
+
+    constexpr std::array<uint32_t, 16> WEIGHTS = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+    Texels                             texels;
+    for (size_t t = 0; t < 16; t++)
+    {
+        uint32_t index = read(t == 0 ? 3 : 4);
+        for (size_t c = 0; c < 4; c++)
+        {
+            uint32_t e0       = endpoints[0][c] | pbits[0];
+            uint32_t e1       = endpoints[1][c] | pbits[1];
+            texels[t * 4 + c] = static_cast<uint8_t>(((64 - WEIGHTS[index]) * e0 + WEIGHTS[index] * e1 + 32) >> 6);
+        }
+    }
+    return texels;
+}
+
+int getMaxError(const Texels &a, const Texels &b)
+{
+    int error = 0;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        error = std::max(error, std::abs(int(a[i]) - int(b[i])));
+    }
+    return error;
+}
+
+}  // namespace
+
+TEST_CASE("Bc7 sizes count whole blocks")
+{
+    CHECK(Images::Bc7::getEncodedSize(4, 4) == 16);
+    CHECK(Images::Bc7::getEncodedSize(5, 5) == 4 * 16);
+    CHECK(Images::Bc7::getEncodedSize(1, 1) == 16);
+    CHECK(Images::Bc7::getEncodedSize(256, 128) == 64 * 32 * 16);
+}
+
+TEST_CASE("Bc7 encodes a solid block almost exactly")
+{
+    Texels texels;
+    for (size_t t = 0; t < 16; t++)
+    {
+        texels[t * 4 + 0] = 200;
+        texels[t * 4 + 1] = 100;
+        texels[t * 4 + 2] = 37;
+        texels[t * 4 + 3] = 255;
+    }
+    uint8_t block[Images::Bc7::BLOCK_SIZE];
+    Images::Bc7::encodeBlock(texels.data(), block);
+    CHECK(getMaxError(decodeBlock(block), texels) <= 1);
+}
+
+TEST_CASE("Bc7 encodes a gradient within a few steps")
+{
+    Texels texels;
+    for (size_t t = 0; t < 16; t++)
+    {
+        auto value        = static_cast<uint8_t>(t * 16);
+        texels[t * 4 + 0] = value;
+        texels[t * 4 + 1] = static_cast<uint8_t>(255 - value);
+        texels[t * 4 + 2] = static_cast<uint8_t>(value / 2);
+        texels[t * 4 + 3] = 255;
+    }
+    uint8_t block[Images::Bc7::BLOCK_SIZE];
+    Images::Bc7::encodeBlock(texels.data(), block);
+    CHECK(getMaxError(decodeBlock(block), texels) <= 8);
+}
+
+TEST_CASE("Bc7 repeats the edge texels of partial blocks")
+{
+    // A 3x3 image encodes like the 4x4 one repeating its last row and column.
+    std::vector<uint8_t> small(3 * 3 * 4);
+    std::vector<uint8_t> padded(4 * 4 * 4);
+    for (uint32_t y = 0; y < 4; y++)
+    {
+        for (uint32_t x = 0; x < 4; x++)
+        {
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                auto value = static_cast<uint8_t>(std::min(x, 2u) * 60 + std::min(y, 2u) * 20 + c * 10);
+                padded[(y * 4 + x) * 4 + c] = value;
+                if (x < 3 && y < 3)
+                {
+                    small[(y * 3 + x) * 4 + c] = value;
+                }
+            }
+        }
+    }
+    std::vector<uint8_t> encoded = Images::Bc7::encode(small.data(), 3, 3, 3 * 4);
+    REQUIRE(encoded.size() == Images::Bc7::BLOCK_SIZE);
+    CHECK(encoded == Images::Bc7::encode(padded.data(), 4, 4, 4 * 4));
+}
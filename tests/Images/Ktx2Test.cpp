@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "Images/Ktx2.hpp"
+
+namespace {
+
+std::string getTestPath(const std::string &name)
+{
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "aether-ktx2-tests";
+    std::filesystem::create_directories(directory);
+    return (directory / name).string();
+}
+
+std::vector<std::byte> readFile(const std::string &filename)
+{
+    std::vector<std::byte> bytes(std::filesystem::file_size(filename));
+    std::ifstream          in(filename, std::ios::binary);
+    in.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return bytes;
+}
+
+std::vector<uint8_t> makeLevel(size_t size, uint8_t seed)
+{
+    std::vector<uint8_t> level(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        level[i] = static_cast<uint8_t>(seed + i * 7);
+    }
+    return level;
+}
+
+/**
+ * Write then parse source, checking every level against it.
+ */
+void checkRoundTrip(const Images::Ktx2::Source &source, size_t levelAlignment)
+{
+    std::string filename = getTestPath("round-trip.ktx2");
+    Images::Ktx2::write(filename, source);
+
+    std::vector<std::byte> bytes = readFile(filename);
+    Images::Ktx2           texture(bytes, filename);
+    CHECK(texture.getFormat() == source.format);
+    CHECK(texture.getWidth() == source.width);
+    CHECK(texture.getHeight() == source.height);
+    REQUIRE(texture.getLevelCount() == source.levels.size());
+    for (uint32_t level = 0; level < texture.getLevelCount(); level++)
+    {
+        const Images::Ktx2::Level  &parsed = texture.getLevel(level);
+        const std::vector<uint8_t> &data   = source.levels[level];
+        CHECK(parsed.width == std::max(1u, source.width >> level));
+        CHECK(parsed.height == std::max(1u, source.height >> level));
+        CHECK(static_cast<size_t>(parsed.data.data() - bytes.data()) % levelAlignment == 0);
+        REQUIRE(parsed.data.size() == data.size());
+        CHECK(std::memcmp(parsed.data.data(), data.data(), data.size()) == 0);
+    }
+
+    // The file constructor maps it instead.
+    Images::Ktx2 mapped(filename);
+    CHECK(mapped.getLevelCount() == source.levels.size());
+}
+
+}  // namespace
+
+TEST_CASE("Ktx2 round trips RGBA8 levels")
+{
+    Images::Ktx2::Source source{.format = VK_FORMAT_R8G8B8A8_SRGB, .width = 5, .height = 3, .levels = {}};
+    source.levels = {makeLevel(5 * 3 * 4, 1), makeLevel(2 * 1 * 4, 2), makeLevel(1 * 1 * 4, 3)};
+    checkRoundTrip(source, 4);
+}
+
+TEST_CASE("Ktx2 round trips block compressed levels")
+{
+    // 8x8 is 2x2 blocks, then 1 block for 4x4, 2x2 and 1x1.
+    Images::Ktx2::Source source{.format = VK_FORMAT_BC7_UNORM_BLOCK, .width = 8, .height = 8, .levels = {}};
+    source.levels = {makeLevel(4 * 16, 1), makeLevel(16, 2), makeLevel(16, 3), makeLevel(16, 4)};
+    checkRoundTrip(source, 16);
+
+    source.format = VK_FORMAT_ASTC_4x4_SRGB_BLOCK;
+    checkRoundTrip(source, 16);
+}
+
+TEST_CASE("Ktx2 block extents and sRGB formats")
+{
+    uint32_t blockWidth  = 0;
+    uint32_t blockHeight = 0;
+    Images::Ktx2::getBlockExtent(VK_FORMAT_BC7_SRGB_BLOCK, blockWidth, blockHeight);
+    CHECK(blockWidth == 4);
+    CHECK(blockHeight == 4);
+    Images::Ktx2::getBlockExtent(VK_FORMAT_R8G8B8A8_UNORM, blockWidth, blockHeight);
+    CHECK(blockWidth == 1);
+    CHECK(blockHeight == 1);
+
+    CHECK(Images::Ktx2::isSrgb(VK_FORMAT_R8G8B8A8_SRGB));
+    CHECK(Images::Ktx2::isSrgb(VK_FORMAT_BC7_SRGB_BLOCK));
+    CHECK(Images::Ktx2::isSrgb(VK_FORMAT_ASTC_4x4_SRGB_BLOCK));
+    CHECK_FALSE(Images::Ktx2::isSrgb(VK_FORMAT_ASTC_4x4_UNORM_BLOCK));
+    CHECK_FALSE(Images::Ktx2::isSrgb(VK_FORMAT_BC7_UNORM_BLOCK));
+}
+
+TEST_CASE("Ktx2 rejects invalid files")
+{
+    std::vector<std::byte> garbage(128, std::byte{0x5A});
+    CHECK_THROWS_AS(Images::Ktx2(garbage, "garbage"), std::runtime_error);
+
+    Images::Ktx2::Source source{.format = VK_FORMAT_R8G8B8A8_UNORM, .width = 4, .height = 4, .levels = {}};
+    source.levels        = {makeLevel(4 * 4 * 4, 1)};
+    std::string filename = getTestPath("truncated.ktx2");
+    Images::Ktx2::write(filename, source);
+    std::vector<std::byte> bytes = readFile(filename);
+    bytes.resize(bytes.size() - 1);
+    CHECK_THROWS_AS(Images::Ktx2(bytes, filename), std::runtime_error);
+
+    source.format = VK_FORMAT_UNDEFINED;
+    CHECK_THROWS_AS(Images::Ktx2::write(filename, source), std::runtime_error);
+}
@@ -0,0 +1,74 @@
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "Jobs/JobSystem.hpp"
+
+TEST_CASE("JobSystem runs a job after its dependencies")
+{
+    Jobs::JobSystem       jobSystem(4);
+    std::atomic<uint32_t> order = 0;
+    uint32_t              first = 0;
+    uint32_t              then  = 0;
+
+    Jobs::JobHandle a = jobSystem.schedule([&]() { first = ++order; }, {}, "First");
+    Jobs::JobHandle b = jobSystem.schedule([&]() { then = ++order; }, {a}, "Then");
+    jobSystem.wait(b);
+    CHECK(a->isFinished());
+    CHECK(first == 1);
+    CHECK(then == 2);
+}
+
+TEST_CASE("JobSystem parallelFor covers the range once")
+{
+    Jobs::JobSystem       jobSystem(4);
+    std::vector<uint32_t> hits(100000, 0);
+    jobSystem.wait(jobSystem.parallelFor(
+        static_cast<uint32_t>(hits.size()),
+        64,
+        [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                hits[i]++;
+            }
+        },
+        {},
+        "Range"));
+    for (uint32_t hit : hits)
+    {
+        CHECK(hit == 1);
+    }
+}
+
+TEST_CASE("JobSystem waits from inside a job")
+{
+    Jobs::JobSystem       jobSystem(2);
+    std::atomic<uint32_t> sum = 0;
+    Jobs::JobHandle       outer = jobSystem.schedule(
+        [&]() {
+            // The waiting worker runs the inner jobs, it never blocks the pool.
+            std::vector<Jobs::JobHandle> inner;
+            for (uint32_t i = 1; i <= 16; i++)
+            {
+                inner.push_back(jobSystem.schedule([&sum, i]() { sum += i; }, {}, "Inner"));
+            }
+            for (const Jobs::JobHandle &job : inner)
+            {
+                jobSystem.wait(job);
+            }
+        },
+        {},
+        "Outer");
+    jobSystem.wait(outer);
+    CHECK(sum == 136);
+}
+
+TEST_CASE("JobSystem rethrows job errors on wait")
+{
+    Jobs::JobSystem jobSystem(2);
+    Jobs::JobHandle job = jobSystem.schedule([]() { throw std::runtime_error("job failed!"); }, {}, "Failing");
+    CHECK_THROWS_AS(jobSystem.wait(job), std::runtime_error);
+}
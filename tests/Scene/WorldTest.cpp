@@ -0,0 +1,162 @@
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "Jobs/JobSystem.hpp"
+#include "Scene/World.hpp"
+
+namespace {
+
+struct Position
+{
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+};
+
+struct Id
+{
+    uint32_t value = 0;
+};
+
+struct Tag
+{
+};
+
+}  // namespace
+
+TEST_CASE("World creates, reads and destroys entities")
+{
+    Scene::World  world;
+    Scene::Entity a = world.create(Position{1.0f, 2.0f, 3.0f}, Id{1});
+    Scene::Entity b = world.create(Id{2});
+    CHECK(world.getEntityCount() == 2);
+    CHECK(world.isAlive(a));
+
+    REQUIRE(world.get<Position>(a) != nullptr);
+    CHECK(world.get<Position>(a)->y == 2.0f);
+    CHECK(world.get<Id>(b)->value == 2);
+    CHECK(world.get<Position>(b) == nullptr);
+
+    world.destroy(a);
+    CHECK_FALSE(world.isAlive(a));
+    CHECK(world.get<Id>(a) == nullptr);
+    CHECK(world.getEntityCount() == 1);
+    world.destroy(a);
+    CHECK(world.getEntityCount() == 1);
+
+    // The index is reused, the stale handle stays dead.
+    Scene::Entity c = world.create(Id{3});
+    CHECK(c.index == a.index);
+    CHECK(c.generation != a.generation);
+    CHECK_FALSE(world.isAlive(a));
+    CHECK(world.get<Id>(c)->value == 3);
+}
+
+TEST_CASE("World keeps the chunks dense when destroying")
+{
+    Scene::World               world;
+    std::vector<Scene::Entity> entities;
+    constexpr uint32_t         COUNT = 10000;  // several chunks
+    for (uint32_t i = 0; i < COUNT; i++)
+    {
+        entities.push_back(world.create(Position{static_cast<float>(i), 0.0f, 0.0f}, Id{i}));
+    }
+    for (uint32_t i = 0; i < COUNT; i += 3)
+    {
+        world.destroy(entities[i]);
+    }
+
+    uint32_t alive = 0;
+    for (uint32_t i = 0; i < COUNT; i++)
+    {
+        if (i % 3 == 0)
+        {
+            CHECK_FALSE(world.isAlive(entities[i]));
+            continue;
+        }
+        alive++;
+        REQUIRE(world.isAlive(entities[i]));
+        CHECK(world.get<Id>(entities[i])->value == i);
+        CHECK(world.get<Position>(entities[i])->x == static_cast<float>(i));
+    }
+    CHECK(world.count<Id>() == alive);
+
+    // Chunk spans only hold live entities, numbered without gaps.
+    std::vector<uint32_t> visits(alive, 0);
+    uint32_t              chunkCount = 0;
+    world.forEach<const Id>([&](uint32_t first, std::span<const Scene::Entity> chunk, std::span<const Id> ids) {
+        chunkCount++;
+        CHECK(chunk.size() == ids.size());
+        for (size_t i = 0; i < ids.size(); i++)
+        {
+            CHECK(world.isAlive(chunk[i]));
+            CHECK(world.get<Id>(chunk[i]) == &ids[i]);
+            visits[first + i]++;
+        }
+    });
+    CHECK(chunkCount > 1);
+    for (uint32_t visit : visits)
+    {
+        CHECK(visit == 1);
+    }
+}
+
+TEST_CASE("World matches archetypes by required and excluded components")
+{
+    Scene::World world;
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        world.create(Id{i});
+        world.create(Id{i}, Position{});
+        world.create(Id{i}, Position{}, Tag{});
+    }
+    CHECK(world.count<Id>() == 30);
+    CHECK(world.count<Id, Position>() == 20);
+    CHECK(world.count<Id, Position>(world.getMask<Tag>()) == 10);
+    CHECK(world.count<Tag>() == 10);
+
+    world.forEach<Id, Position>(
+        [](uint32_t, std::span<const Scene::Entity>, std::span<Id> ids, std::span<Position> positions) {
+            for (size_t i = 0; i < ids.size(); i++)
+            {
+                positions[i].x = static_cast<float>(ids[i].value);
+            }
+        },
+        world.getMask<Tag>());
+    float sum = 0.0f;
+    world.forEach<const Position>([&](uint32_t, std::span<const Scene::Entity>, std::span<const Position> positions) {
+        for (const Position &position : positions)
+        {
+            sum += position.x;
+        }
+    });
+    CHECK(sum == 45.0f);
+}
+
+TEST_CASE("World spreads its chunks over the job system")
+{
+    Jobs::JobSystem jobSystem(4);
+    Scene::World    world;
+    uint64_t        expected = 0;
+    for (uint32_t i = 0; i < 20000; i++)
+    {
+        world.create(Id{i});
+        expected += i;
+    }
+
+    std::atomic<uint64_t> sum   = 0;
+    std::atomic<uint32_t> count = 0;
+    world.parallelForEach<const Id>(jobSystem, [&](uint32_t, std::span<const Scene::Entity>, std::span<const Id> ids) {
+        for (const Id &id : ids)
+        {
+            sum += id.value;
+        }
+        count += static_cast<uint32_t>(ids.size());
+    });
+    CHECK(count == 20000);
+    CHECK(sum == expected);
+}
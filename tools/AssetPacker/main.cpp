@@ -0,0 +1,99 @@
+// Copyright (c) 2025 AIperture-Labs <xavier.beheydt@gmail.com>
+// SPDX-License-Identifier: MIT
+// AssetPacker: build-time archiving of cooked assets to one .apak.
+//
+// Usage: AssetPacker <output.apak> [--chunk-size N] [--store|--lz4|--zstd] <[name=]file>...
+// Each switch sets the compression of the files after it, LZ4 by default. An
+// entry is named after its file unless given as name=file, see Assets::Pack.
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Assets/Pack.hpp"
+
+int main(int argc, char **argv)
+{
+    std::vector<Assets::Pack::Source> sources;
+    std::string                       output;
+    Assets::Compression               compression = Assets::Compression::eLz4;
+    uint32_t                          chunkSize   = Assets::Pack::DEFAULT_CHUNK_SIZE;
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string argument = argv[i];
+            if (argument == "--store")
+            {
+                compression = Assets::Compression::eNone;
+            }
+            else if (argument == "--lz4")
+            {
+                compression = Assets::Compression::eLz4;
+            }
+            else if (argument == "--zstd")
+            {
+                if (not Assets::Pack::isSupported(Assets::Compression::eZstd))
+                {
+                    std::cerr << "built without zstd, falling back to LZ4" << std::endl;
+                }
+                else
+                {
+                    compression = Assets::Compression::eZstd;
+                }
+            }
+            else if (argument == "--chunk-size" && i + 1 < argc)
+            {
+                chunkSize = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (output.empty())
+            {
+                output = argument;
+            }
+            else
+            {
+                size_t separator = argument.find('=');
+                if (separator == std::string::npos)
+                {
+                    sources.push_back({.name = argument, .path = argument, .compression = compression});
+                }
+                else
+                {
+                    sources.push_back({.name        = argument.substr(0, separator),
+                                       .path        = argument.substr(separator + 1),
+                                       .compression = compression});
+                }
+            }
+        }
+    } catch (const std::exception &)
+    {
+        output.clear();
+    }
+    if (output.empty() || sources.empty())
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " <output.apak> [--chunk-size N] [--store|--lz4|--zstd] <[name=]file>..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        Assets::Pack::write(output, sources, chunkSize);
+
+        Assets::Pack pack(output);
+        uint64_t     size = 0;
+        for (uint32_t i = 0; i < pack.getEntryCount(); i++)
+        {
+            size += pack.getEntry(i).size;
+        }
+        std::cout << output << ": " << pack.getEntryCount() << " assets, " << size << " -> "
+                  << Utils::Handlers::MappedFile(output, false).getSize() << " bytes" << std::endl;
+    } catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
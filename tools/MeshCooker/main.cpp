@@ -0,0 +1,67 @@
+// Copyright (c) 2025 AIperture-Labs <xavier.beheydt@gmail.com>
+// SPDX-License-Identifier: MIT
+// MeshCooker: build-time conversion of OBJ meshes to GPU-ready .amesh.
+//
+// Usage: MeshCooker [--no-overdraw] [--no-meshlets] <input.obj> <output.amesh>
+// The vertices are quantized to Geometry::CompactVertex, deduplicated and
+// reordered for the vertex cache, overdraw and vertex fetch, then split into
+// meshlets, see Geometry::MeshOptimizer.
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include "Geometry/Mesh.hpp"
+#include "Geometry/MeshOptimizer.hpp"
+#include "Loaders/Obj.hpp"
+
+int main(int argc, char **argv)
+{
+    Geometry::MeshOptimizer::Options options;
+    std::string                      input;
+    std::string                      output;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (argument == "--no-overdraw")
+        {
+            options.reduceOverdraw = false;
+        }
+        else if (argument == "--no-meshlets")
+        {
+            options.buildMeshlets = false;
+        }
+        else if (input.empty())
+        {
+            input = argument;
+        }
+        else
+        {
+            output = argument;
+        }
+    }
+    if (input.empty() || output.empty())
+    {
+        std::cerr << "usage: " << argv[0] << " [--no-overdraw] [--no-meshlets] <input.obj> <output.amesh>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        Loaders::Obj       obj(input);
+        Geometry::MeshData mesh = Geometry::MeshOptimizer::process(obj.getCompactVertices(), obj.getIndices(), options);
+        Geometry::Mesh::write(output, mesh);
+
+        std::cout << input << ": " << mesh.indices.size() / 3 << " triangles, " << obj.getVertices().size() << " -> "
+                  << mesh.vertices.size() << " vertices, ACMR "
+                  << Geometry::MeshOptimizer::getAcmr(obj.getIndices(), obj.getVertices().size()) << " -> "
+                  << Geometry::MeshOptimizer::getAcmr(mesh.indices, mesh.vertices.size()) << ", "
+                  << mesh.meshlets.size() << " meshlets" << std::endl;
+    } catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,198 @@
+// Copyright (c) 2025 AIperture-Labs <xavier.beheydt@gmail.com>
+// SPDX-License-Identifier: MIT
+// TextureCooker: build-time conversion of source images to GPU-ready KTX2.
+//
+// Usage: TextureCooker [--linear] [--no-mips] <input> <output.ktx2>
+// - .jpg/.jpeg inputs are decoded and encoded to BC7, with their whole mip
+//   chain unless --no-mips is given.
+// - .astc inputs (astcenc output) are wrapped as they are, ASTC encoding is
+//   left to astcenc.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Images/Bc7.hpp"
+#include "Images/Jpeg.hpp"
+#include "Images/Ktx2.hpp"
+#include "Utils/MappedFile.hpp"
+
+namespace {
+
+constexpr std::array<uint8_t, 4> ASTC_MAGIC = {0x13, 0xAB, 0xA1, 0x5C};
+
+float srgbToLinear(uint8_t value)
+{
+    float c = value / 255.0f;
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+uint8_t linearToSrgb(float value)
+{
+    float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+}
+
+/**
+ * @brief 2x2 box filter of a tightly packed RGBA level. The color of sRGB
+ * levels is averaged in linear space, alpha is always linear.
+ */
+std::vector<uint8_t> downsample(const std::vector<uint8_t> &rgba, uint32_t width, uint32_t height, bool linear)
+{
+    uint32_t             mipWidth  = std::max(1u, width / 2);
+    uint32_t             mipHeight = std::max(1u, height / 2);
+    std::vector<uint8_t> mip(static_cast<size_t>(mipWidth) * mipHeight * 4);
+    for (uint32_t y = 0; y < mipHeight; y++)
+    {
+        for (uint32_t x = 0; x < mipWidth; x++)
+        {
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                float sum = 0.0f;
+                for (uint32_t dy = 0; dy < 2; dy++)
+                {
+                    for (uint32_t dx = 0; dx < 2; dx++)
+                    {
+                        uint32_t sx    = std::min(x * 2 + dx, width - 1);
+                        uint32_t sy    = std::min(y * 2 + dy, height - 1);
+                        uint8_t  texel = rgba[(static_cast<size_t>(sy) * width + sx) * 4 + c];
+                        sum += (linear || c == 3) ? texel / 255.0f : srgbToLinear(texel);
+                    }
+                }
+                float   average = sum / 4.0f;
+                uint8_t value   = (linear || c == 3)
+                                      ? static_cast<uint8_t>(std::clamp(average * 255.0f + 0.5f, 0.0f, 255.0f))
+                                      : linearToSrgb(average);
+                mip[(static_cast<size_t>(y) * mipWidth + x) * 4 + c] = value;
+            }
+        }
+    }
+    return mip;
+}
+
+Images::Ktx2::Source cookJpeg(const std::string &input, bool linear, bool mips)
+{
+    Images::Jpeg image(input, TJPF_RGBA);
+    if (image.getDataPrecision() != Images::Jpeg::DATA_PRECISION_8_BITS)
+    {
+        throw std::runtime_error("only 8-bit JPEGs can be cooked: " + input);
+    }
+
+    Images::Ktx2::Source source{.format = linear ? VK_FORMAT_BC7_UNORM_BLOCK : VK_FORMAT_BC7_SRGB_BLOCK,
+                                .width  = image.getWidth(),
+                                .height = image.getHeight()};
+    source.levels.push_back(Images::Bc7::encode(static_cast<const uint8_t *>(image.getData()),
+                                                image.getWidth(),
+                                                image.getHeight(),
+                                                image.getRowPitch()));
+    if (not mips)
+    {
+        return source;
+    }
+
+    // Each level is filtered from the previous uncompressed one, never from
+    // BC7 blocks, so the encoding error doesn't accumulate down the chain.
+    const auto          *pixels = static_cast<const uint8_t *>(image.getData());
+    std::vector<uint8_t> level(pixels, pixels + image.getSize());
+    uint32_t             width  = image.getWidth();
+    uint32_t             height = image.getHeight();
+    while (width > 1 || height > 1)
+    {
+        level  = downsample(level, width, height, linear);
+        width  = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+        source.levels.push_back(Images::Bc7::encode(level.data(), width, height, static_cast<size_t>(width) * 4));
+    }
+    return source;
+}
+
+Images::Ktx2::Source cookAstc(const std::string &input, bool linear)
+{
+    Utils::Handlers::MappedFile file(input);
+    auto                        bytes = file.getSpan<uint8_t>();
+    if (bytes.size() < 16 || std::memcmp(bytes.data(), ASTC_MAGIC.data(), ASTC_MAGIC.size()) != 0)
+    {
+        throw std::runtime_error("not an .astc file: " + input);
+    }
+    uint32_t blockWidth  = bytes[4];
+    uint32_t blockHeight = bytes[5];
+    uint32_t width       = bytes[7] | (bytes[8] << 8) | (bytes[9] << 16);
+    uint32_t height      = bytes[10] | (bytes[11] << 8) | (bytes[12] << 16);
+    if (bytes[6] != 1)
+    {
+        throw std::runtime_error("3D ASTC blocks are not supported: " + input);
+    }
+
+    Images::Ktx2::Source source{.width = width, .height = height};
+    for (int format = VK_FORMAT_ASTC_4x4_UNORM_BLOCK; format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK; format += 2)
+    {
+        uint32_t formatBlockWidth  = 0;
+        uint32_t formatBlockHeight = 0;
+        Images::Ktx2::getBlockExtent(static_cast<VkFormat>(format), formatBlockWidth, formatBlockHeight);
+        if (formatBlockWidth == blockWidth && formatBlockHeight == blockHeight)
+        {
+            source.format = static_cast<VkFormat>(linear ? format : format + 1);
+        }
+    }
+    if (source.format == VK_FORMAT_UNDEFINED)
+    {
+        throw std::runtime_error("unsupported ASTC block size: " + input);
+    }
+    source.levels.emplace_back(bytes.begin() + 16, bytes.end());
+    return source;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    bool        linear = false;
+    bool        mips   = true;
+    std::string input;
+    std::string output;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (argument == "--linear")
+        {
+            linear = true;
+        }
+        else if (argument == "--no-mips")
+        {
+            mips = false;
+        }
+        else if (input.empty())
+        {
+            input = argument;
+        }
+        else
+        {
+            output = argument;
+        }
+    }
+    if (input.empty() || output.empty())
+    {
+        std::cerr << "usage: " << argv[0] << " [--linear] [--no-mips] <input.jpg|input.astc> <output.ktx2>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        std::string          extension = std::filesystem::path(input).extension().string();
+        Images::Ktx2::Source source    = extension == ".astc" ? cookAstc(input, linear) : cookJpeg(input, linear, mips);
+        Images::Ktx2::write(output, source);
+    } catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}